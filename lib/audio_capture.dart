@@ -12,6 +12,11 @@ export 'package:desktop_audio_capture/system/system_audio_capture.dart';
 export 'package:desktop_audio_capture/model/decibel_data.dart';
 export 'package:desktop_audio_capture/model/input_device_type.dart';
 export 'package:desktop_audio_capture/model/audio_status.dart';
+export 'package:desktop_audio_capture/model/capture_backend.dart';
+export 'package:desktop_audio_capture/model/capture_gap.dart';
+export 'package:desktop_audio_capture/model/capture_stats.dart';
+export 'package:desktop_audio_capture/model/channel_layout.dart';
+export 'package:desktop_audio_capture/model/sample_format.dart';
 
 /// Abstract base class for audio capture functionality.
 ///
@@ -40,6 +40,7 @@ class MicAudioConfig extends AudioCaptureConfig {
   ///
   /// - 1: Mono (single channel)
   /// - 2: Stereo (two channels)
+  /// - up to 8 with a [channelLayout] other than [ChannelLayout.mono]
   final int channels;
 
   /// Bit depth (default: 16).
@@ -62,6 +63,74 @@ class MicAudioConfig extends AudioCaptureConfig {
   /// - 1.0: Full volume
   final double inputVolume;
 
+  /// Rate at which level readings are published on the decibel stream, in
+  /// Hz (default: 30, range: 1 to 120).
+  ///
+  /// Readings are independent of the audio chunk size. Currently honoured on
+  /// Linux; other platforms publish one reading per chunk.
+  final double meterRateHz;
+
+  /// Sound server API used on Linux (default: [CaptureBackend.auto]).
+  ///
+  /// [CaptureBackend.auto] records through native PipeWire when a daemon is
+  /// running and falls back to PulseAudio. Ignored on other platforms.
+  final CaptureBackend backend;
+
+  /// Capture latency to ask the sound server for, in milliseconds (default:
+  /// null, range: 5 to 500).
+  ///
+  /// When set, the server delivers audio in transfers of this length and
+  /// shrinks its device buffering to match, which live captioning needs for
+  /// sub-50 ms capture-to-callback latency. Chunks delivered to the audio
+  /// stream keep their own size. The latency actually granted is reported by
+  /// `getStats()` as [CaptureStats.negotiatedLatencyUs]. Currently honoured
+  /// on Linux.
+  final int? targetLatencyMs;
+
+  /// Id of the input device to record (default: null, the system default).
+  ///
+  /// Use an [InputDevice.id] from
+  /// `MicAudioCapture.getAvailableInputDevices()`. Starting fails if the id
+  /// is unknown. Currently honoured on Linux.
+  final String? deviceId;
+
+  /// Open the device in its own sample rate, channel count and channel map
+  /// and convert in the plugin (default: false).
+  ///
+  /// By default the sound server converts to [sampleRate] and [channels]
+  /// with its own resampler. When set, the plugin downmixes and resamples
+  /// itself with a windowed-sinc resampler whose cost is reported by
+  /// `getStats()` as [CaptureStats.resample]. Nothing is resampled when the
+  /// device already runs at [sampleRate]. When [channelLayout] keeps the
+  /// channels apart, only the device's rate is used and the sound server
+  /// still remixes to [channels]; `getStats()` reports what the device
+  /// delivered as [CaptureStats.sourceChannels]. Currently honoured on
+  /// Linux.
+  final bool nativeFormat;
+
+  /// Encoding of the chunks delivered to the audio stream (default:
+  /// [SampleFormat.int16]).
+  ///
+  /// Picking [SampleFormat.float32] or [SampleFormat.int32] records in float
+  /// and keeps the audio in float through the gain boost and resampling, so
+  /// it is converted once instead of by the caller. Currently honoured on
+  /// Linux.
+  final SampleFormat sampleFormat;
+
+  /// How channels are laid out in the delivered chunks (default:
+  /// [ChannelLayout.mono]).
+  ///
+  /// With [ChannelLayout.interleaved] or [ChannelLayout.planar] up to 8
+  /// [channels] are delivered as recorded instead of being downmixed, and
+  /// the decibel stream reports each one in [DecibelData.channels], also
+  /// with [nativeFormat]. Currently honoured on Linux.
+  final ChannelLayout channelLayout;
+
+  /// Gain for each channel, applied on top of the gain boost when channels
+  /// are kept apart (default: null, unity for every channel). Missing
+  /// entries are 1.0; values are clamped to 0.0-10.0.
+  final List<double>? channelGains;
+
   /// Creates a new [MicAudioConfig] instance.
   ///
   /// All parameters are optional and have default values:
@@ -70,6 +139,14 @@ class MicAudioConfig extends AudioCaptureConfig {
   /// - [bitDepth]: 16
   /// - [gainBoost]: 2.5
   /// - [inputVolume]: 1.0
+  /// - [meterRateHz]: 30.0
+  /// - [backend]: [CaptureBackend.auto]
+  /// - [targetLatencyMs]: null (server default)
+  /// - [deviceId]: null (default device)
+  /// - [nativeFormat]: false
+  /// - [sampleFormat]: [SampleFormat.int16]
+  /// - [channelLayout]: [ChannelLayout.mono]
+  /// - [channelGains]: null (unity)
   ///
   /// Example:
   /// ```dart
@@ -85,6 +162,14 @@ class MicAudioConfig extends AudioCaptureConfig {
     this.bitDepth = 16,
     this.gainBoost = 2.5,
     this.inputVolume = 1.0,
+    this.meterRateHz = 30.0,
+    this.backend = CaptureBackend.auto,
+    this.targetLatencyMs,
+    this.deviceId,
+    this.nativeFormat = false,
+    this.sampleFormat = SampleFormat.int16,
+    this.channelLayout = ChannelLayout.mono,
+    this.channelGains,
   });
 
   /// Creates a copy of this configuration with modified values.
@@ -108,6 +193,14 @@ class MicAudioConfig extends AudioCaptureConfig {
     int? bitDepth,
     double? gainBoost,
     double? inputVolume,
+    double? meterRateHz,
+    CaptureBackend? backend,
+    int? targetLatencyMs,
+    String? deviceId,
+    bool? nativeFormat,
+    SampleFormat? sampleFormat,
+    ChannelLayout? channelLayout,
+    List<double>? channelGains,
   }) {
     return MicAudioConfig(
       sampleRate: sampleRate ?? this.sampleRate,
@@ -115,6 +208,14 @@ class MicAudioConfig extends AudioCaptureConfig {
       bitDepth: bitDepth ?? this.bitDepth,
       gainBoost: gainBoost ?? this.gainBoost,
       inputVolume: inputVolume ?? this.inputVolume,
+      meterRateHz: meterRateHz ?? this.meterRateHz,
+      backend: backend ?? this.backend,
+      targetLatencyMs: targetLatencyMs ?? this.targetLatencyMs,
+      deviceId: deviceId ?? this.deviceId,
+      nativeFormat: nativeFormat ?? this.nativeFormat,
+      sampleFormat: sampleFormat ?? this.sampleFormat,
+      channelLayout: channelLayout ?? this.channelLayout,
+      channelGains: channelGains ?? this.channelGains,
     );
   }
 
@@ -126,6 +227,14 @@ class MicAudioConfig extends AudioCaptureConfig {
   /// - `bitDepth`: int
   /// - `gainBoost`: double
   /// - `inputVolume`: double
+  /// - `meterRateHz`: double
+  /// - `backend`: String
+  /// - `targetLatencyMs`: int? (null when unset)
+  /// - `deviceId`: String? (null when unset)
+  /// - `nativeFormat`: bool
+  /// - `sampleFormat`: String
+  /// - `channelLayout`: String
+  /// - `channelGains`: List<double>? (null when unset)
   ///
   /// Example:
   /// ```dart
@@ -134,7 +243,7 @@ class MicAudioConfig extends AudioCaptureConfig {
   ///   channels: 2,
   /// );
   /// final map = config.toMap();
-  /// // map = {'sampleRate': 44100, 'channels': 2, 'bitDepth': 16, 'gainBoost': 2.5, 'inputVolume': 1.0}
+  /// // map = {'sampleRate': 44100, 'channels': 2, 'bitDepth': 16, 'gainBoost': 2.5, 'inputVolume': 1.0, 'meterRateHz': 30.0, 'backend': 'auto', 'targetLatencyMs': null, 'deviceId': null, 'nativeFormat': false, 'sampleFormat': 'int16', 'channelLayout': 'mono', 'channelGains': null}
   /// ```
   Map<String, dynamic> toMap() {
     return {
@@ -143,11 +252,19 @@ class MicAudioConfig extends AudioCaptureConfig {
       'bitDepth': bitDepth,
       'gainBoost': gainBoost,
       'inputVolume': inputVolume,
+      'meterRateHz': meterRateHz,
+      'backend': backend.toString(),
+      'targetLatencyMs': targetLatencyMs,
+      'deviceId': deviceId,
+      'nativeFormat': nativeFormat,
+      'sampleFormat': sampleFormat.toString(),
+      'channelLayout': channelLayout.toString(),
+      'channelGains': channelGains,
     };
   }
 
   @override
   String toString() {
-    return 'MicConfig(sampleRate: $sampleRate, channels: $channels, bitDepth: $bitDepth, gainBoost: $gainBoost, inputVolume: $inputVolume)';
+    return 'MicConfig(sampleRate: $sampleRate, channels: $channels, bitDepth: $bitDepth, gainBoost: $gainBoost, inputVolume: $inputVolume, meterRateHz: $meterRateHz, backend: $backend, targetLatencyMs: $targetLatencyMs, deviceId: $deviceId, nativeFormat: $nativeFormat, sampleFormat: $sampleFormat, channelLayout: $channelLayout, channelGains: $channelGains)';
   }
 }
@@ -6,10 +6,15 @@ export 'package:desktop_audio_capture/config/mic_audio_config.dart';
 
 enum _MicAudioMethod {
   startCapture,
+  armCapture,
   stopCapture,
   requestPermissions,
   hasInputDevice,
   getAvailableInputDevices,
+  switchDevice,
+  pauseCapture,
+  resumeCapture,
+  getStats,
 }
 
 /// Class for capturing audio from microphone input devices.
@@ -71,6 +76,7 @@ class MicAudioCapture extends AudioCapture {
   Stream<MicAudioStatus>? _statusStream;
   Stream<DecibelData>? _decibelStream;
   bool _isRecording = false;
+  bool _isArmed = false;
 
   /// Stream of raw audio data bytes from microphone capture.
   ///
@@ -115,6 +121,9 @@ class MicAudioCapture extends AudioCapture {
   /// Returns a [Stream<MicStatus>] containing:
   /// - `isActive`: bool - whether mic is currently active
   /// - `deviceName`: String? - name of the microphone device (if available)
+  /// - `isStarting`: bool - whether the stream is still being opened (Linux)
+  /// - `isSwitching`: bool - whether [switchDevice] is still opening the new
+  ///   device (Linux)
   ///
   /// Example:
   /// ```dart
@@ -147,6 +156,7 @@ class MicAudioCapture extends AudioCapture {
   /// Returns a [Stream<DecibelData>] containing:
   /// - `decibel`: double - decibel value (-120 to 0 dB)
   /// - `timestamp`: double - Unix timestamp
+  /// - `peakDecibel`, `rms`, `peak`: double? - meter readings, where reported
   ///
   /// The stream is only available while recording is active.
   ///
@@ -297,12 +307,52 @@ class MicAudioCapture extends AudioCapture {
 
       // Status stream is created lazily via getter, no need to recreate here
 
+      _isArmed = false;
       _isRecording = true;
     } catch (e) {
       rethrow;
     }
   }
 
+  /// Prepares a capture session so that [startCapture] starts it at once.
+  ///
+  /// Opens the device, connects the stream corked and starts the capture
+  /// thread with its buffers, without delivering any audio. The next
+  /// [startCapture] then only uncorks the stream, and the time it took is
+  /// reported as `timeToFirstSampleUs` by `getStats`. [stopCapture] releases
+  /// an armed session that was never started.
+  ///
+  /// [config] is optional. If provided, it will update the current
+  /// configuration; a [startCapture] on an armed session keeps the armed
+  /// settings.
+  ///
+  /// Returns false if the session could not be set up. Currently
+  /// implemented on Linux.
+  ///
+  /// Example:
+  /// ```dart
+  /// await capture.armCapture();
+  /// // ... when the user presses record
+  /// await capture.startCapture();
+  /// ```
+  Future<bool> armCapture({MicAudioConfig? config}) async {
+    if (_isRecording || _isArmed) {
+      return _isArmed;
+    }
+
+    if (config != null) {
+      updateConfig(config);
+    }
+
+    await requestPermissions();
+    final armed = await _channel.invokeMethod<bool>(
+      _MicAudioMethod.armCapture.name,
+      _config.toMap(),
+    );
+    _isArmed = armed ?? false;
+    return _isArmed;
+  }
+
   /// Stops capturing microphone audio.
   ///
   /// This method will stop the active capture and close all associated streams.
@@ -320,7 +370,7 @@ class MicAudioCapture extends AudioCapture {
   /// print('Microphone capture stopped');
   /// ```
   Future<void> stopCapture() async {
-    if (!_isRecording) return;
+    if (!_isRecording && !_isArmed) return;
 
     try {
       final stoped = await _channel.invokeMethod<bool>(
@@ -332,6 +382,7 @@ class MicAudioCapture extends AudioCapture {
       }
 
       _isRecording = false;
+      _isArmed = false;
       _audioStream = null;
       _statusStream = null;
       _decibelStream = null;
@@ -419,6 +470,12 @@ class MicAudioCapture extends AudioCapture {
   /// - `type`: [InputDeviceType] - device type (builtIn, bluetooth, external)
   /// - `channelCount`: int - number of audio channels
   /// - `isDefault`: bool - whether the device is the default device
+  /// - `sampleRate`: int - native sample rate, 0 if unknown
+  /// - `isMonitor`: bool - whether the device is an output monitor
+  ///
+  /// On Linux the list comes from a device cache that the plugin keeps in
+  /// sync with the sound server, so calls are cheap. Output monitors are
+  /// only listed when [includeMonitors] is true.
   ///
   /// Example:
   /// ```dart
@@ -438,10 +495,13 @@ class MicAudioCapture extends AudioCapture {
   /// );
   /// print('Using device: ${defaultDevice.name}');
   /// ```
-  Future<List<InputDevice>> getAvailableInputDevices() async {
+  Future<List<InputDevice>> getAvailableInputDevices({
+    bool includeMonitors = false,
+  }) async {
     try {
       final devices = await _channel.invokeMethod<List<dynamic>>(
         _MicAudioMethod.getAvailableInputDevices.name,
+        {'includeMonitors': includeMonitors},
       );
 
       if (devices == null) {
@@ -458,4 +518,90 @@ class MicAudioCapture extends AudioCapture {
       rethrow;
     }
   }
+
+  /// Moves the running capture to another input device without stopping it.
+  ///
+  /// [deviceId] is an [InputDevice.id] from [getAvailableInputDevices]; null
+  /// returns to the system default device and follows it from then on. A
+  /// session started without [MicAudioConfig.deviceId] already follows the
+  /// default device by itself. The audio stream, its listeners and the
+  /// session counters carry on; the few milliseconds missed while switching
+  /// are reported as a [CaptureGap] on [statusStream], which also reports
+  /// `isSwitching` while a Bluetooth headset switches to a recording profile.
+  ///
+  /// Returns false if nothing is being captured or the device could not be
+  /// opened, in which case capture continues on the old device. Currently
+  /// implemented on Linux.
+  ///
+  /// Example:
+  /// ```dart
+  /// final devices = await micCapture.getAvailableInputDevices();
+  /// await micCapture.switchDevice(devices.last.id);
+  /// ```
+  Future<bool> switchDevice(String? deviceId) async {
+    final switched = await _channel.invokeMethod<bool>(
+      _MicAudioMethod.switchDevice.name,
+      {'deviceId': deviceId},
+    );
+    return switched ?? false;
+  }
+
+  /// Pauses the running capture without closing it.
+  ///
+  /// The stream is corked on the sound server and the capture thread sleeps,
+  /// so nothing is emitted while paused. Device, buffers, counters and level
+  /// metering are kept, and [resumeCapture] continues where this left off.
+  /// The pause is reported on [statusStream] with `isPaused` set.
+  ///
+  /// Returns false if nothing is being captured or the stream cannot be
+  /// paused. Currently implemented on Linux.
+  ///
+  /// Example:
+  /// ```dart
+  /// await capture.pauseCapture();
+  /// // ... later
+  /// await capture.resumeCapture();
+  /// ```
+  Future<bool> pauseCapture() async {
+    final paused = await _channel.invokeMethod<bool>(
+      _MicAudioMethod.pauseCapture.name,
+    );
+    return paused ?? false;
+  }
+
+  /// Resumes a capture paused with [pauseCapture].
+  ///
+  /// Takes a single round trip to the sound server. Returns false if nothing
+  /// is being captured or the stream cannot be resumed.
+  Future<bool> resumeCapture() async {
+    final resumed = await _channel.invokeMethod<bool>(
+      _MicAudioMethod.resumeCapture.name,
+    );
+    return resumed ?? false;
+  }
+
+  /// Returns latency and loss accounting for the current or last capture
+  /// session.
+  ///
+  /// Each chunk is timestamped as it moves from the sound server through
+  /// processing to the event channel. The result holds min/avg/p50/p99/max
+  /// per stage, plus overrun, dropped-chunk and queue-depth counters.
+  /// Stamping is cheap enough that it is always on.
+  ///
+  /// Only implemented on Linux; other platforms throw a
+  /// [MissingPluginException] or [PlatformException].
+  ///
+  /// Example:
+  /// ```dart
+  /// final stats = await capture.getStats();
+  /// print('p99 end-to-end: ${stats.total.p99Us} us');
+  /// ```
+  Future<CaptureStats> getStats() async {
+    final stats = await _channel.invokeMethod<Map<dynamic, dynamic>>(
+      _MicAudioMethod.getStats.name,
+    );
+    return CaptureStats.fromMap(
+      Map<String, dynamic>.from(stats ?? const <String, dynamic>{}),
+    );
+  }
 }
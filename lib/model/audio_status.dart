@@ -1,3 +1,5 @@
+import 'package:desktop_audio_capture/model/capture_gap.dart';
+
 abstract class AudioStatus {
   final bool isActive;
 
@@ -21,25 +23,59 @@ abstract class AudioStatus {
 class MicAudioStatus extends AudioStatus {
   final String? deviceName;
 
+  /// Whether the capture stream is still being opened, which includes
+  /// waiting for a Bluetooth headset to switch to a recording profile.
+  /// [isActive] turns true once it is.
+  final bool isStarting;
+
+  /// Whether `switchDevice` is still opening the new device. Capture carries
+  /// on from [deviceName] meanwhile.
+  final bool isSwitching;
+
+  /// Whether the session is paused with `pauseCapture`.
+  final bool isPaused;
+
+  /// Audio missing from the stream, set on the update that reports it.
+  final CaptureGap? gap;
+
   const MicAudioStatus({
     required super.isActive,
     this.deviceName,
+    this.isStarting = false,
+    this.isSwitching = false,
+    this.isPaused = false,
+    this.gap,
   });
 
   MicAudioStatus copyWith({
     bool? isActive,
     String? deviceName,
+    bool? isStarting,
+    bool? isSwitching,
+    bool? isPaused,
+    CaptureGap? gap,
   }) {
     return MicAudioStatus(
       isActive: isActive ?? this.isActive,
       deviceName: deviceName ?? this.deviceName,
+      isStarting: isStarting ?? this.isStarting,
+      isSwitching: isSwitching ?? this.isSwitching,
+      isPaused: isPaused ?? this.isPaused,
+      gap: gap ?? this.gap,
     );
   }
 
   factory MicAudioStatus.fromJson(Map<String, dynamic> json) {
+    final gap = json['gap'];
     return MicAudioStatus(
       isActive: json['isActive'],
       deviceName: json['deviceName'],
+      isStarting: json['isStarting'] == true,
+      isSwitching: json['isSwitching'] == true,
+      isPaused: json['isPaused'] == true,
+      gap: gap is Map
+          ? CaptureGap.fromMap(Map<String, dynamic>.from(gap))
+          : null,
     );
   }
 
@@ -48,44 +84,104 @@ class MicAudioStatus extends AudioStatus {
     return {
       'isActive': isActive,
       'deviceName': deviceName,
+      'isStarting': isStarting,
+      'isSwitching': isSwitching,
+      'isPaused': isPaused,
+      if (gap != null) 'gap': gap!.toMap(),
     };
   }
 
   @override
   String toString() =>
-      '''MicAudioStatus(isActive: $isActive, deviceName: $deviceName)''';
+      '''MicAudioStatus(isActive: $isActive, deviceName: $deviceName, isStarting: $isStarting, isSwitching: $isSwitching, isPaused: $isPaused, gap: $gap)''';
 
   @override
   bool operator ==(Object other) {
     if (identical(this, other)) return true;
 
-    return other is MicAudioStatus && other.deviceName == deviceName;
+    return other is MicAudioStatus &&
+        other.isActive == isActive &&
+        other.deviceName == deviceName &&
+        other.isStarting == isStarting &&
+        other.isSwitching == isSwitching &&
+        other.isPaused == isPaused &&
+        other.gap == gap;
   }
 
   @override
-  int get hashCode => deviceName.hashCode;
+  int get hashCode =>
+      Object.hash(isActive, deviceName, isStarting, isSwitching, isPaused, gap);
 }
 
 class SystemAudioStatus extends AudioStatus {
-  SystemAudioStatus({required super.isActive});
+  /// Whether the capture stream is still being opened. [isActive] turns true
+  /// once it is.
+  final bool isStarting;
+
+  /// Whether the session is paused with `pauseCapture`.
+  final bool isPaused;
+
+  /// Audio missing from the stream, set on the update that reports it.
+  final CaptureGap? gap;
+
+  SystemAudioStatus({
+    required super.isActive,
+    this.isStarting = false,
+    this.isPaused = false,
+    this.gap,
+  });
 
   SystemAudioStatus copyWith({
     bool? isActive,
+    bool? isStarting,
+    bool? isPaused,
+    CaptureGap? gap,
   }) {
-    return SystemAudioStatus(isActive: isActive ?? this.isActive);
+    return SystemAudioStatus(
+      isActive: isActive ?? this.isActive,
+      isStarting: isStarting ?? this.isStarting,
+      isPaused: isPaused ?? this.isPaused,
+      gap: gap ?? this.gap,
+    );
   }
 
   factory SystemAudioStatus.fromJson(Map<String, dynamic> json) {
-    return SystemAudioStatus(isActive: json['isActive']);
+    final gap = json['gap'];
+    return SystemAudioStatus(
+      isActive: json['isActive'],
+      isStarting: json['isStarting'] == true,
+      isPaused: json['isPaused'] == true,
+      gap: gap is Map
+          ? CaptureGap.fromMap(Map<String, dynamic>.from(gap))
+          : null,
+    );
   }
 
   @override
   Map<String, dynamic> toJson() {
     return {
       'isActive': isActive,
+      'isStarting': isStarting,
+      'isPaused': isPaused,
+      if (gap != null) 'gap': gap!.toMap(),
     };
   }
 
   @override
-  String toString() => '''SystemAudioStatus(isActive: $isActive)''';
+  String toString() =>
+      '''SystemAudioStatus(isActive: $isActive, isStarting: $isStarting, isPaused: $isPaused, gap: $gap)''';
+
+  @override
+  bool operator ==(Object other) {
+    if (identical(this, other)) return true;
+
+    return other is SystemAudioStatus &&
+        other.isActive == isActive &&
+        other.isStarting == isStarting &&
+        other.isPaused == isPaused &&
+        other.gap == gap;
+  }
+
+  @override
+  int get hashCode => Object.hash(isActive, isStarting, isPaused, gap);
 }
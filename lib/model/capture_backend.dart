@@ -0,0 +1,40 @@
+/// Sound server API used to capture audio on Linux.
+///
+/// Other platforms have a single native API and ignore this setting.
+///
+/// Example:
+/// ```dart
+/// final config = MicAudioConfig(backend: CaptureBackend.pipewire);
+/// final backend = CaptureBackend.fromString('pulseaudio');
+/// ```
+enum CaptureBackend {
+  /// Native PipeWire when a daemon is running, PulseAudio otherwise.
+  auto,
+
+  /// Native PipeWire only; starting fails if it is unavailable.
+  pipewire,
+
+  /// PulseAudio (or pipewire-pulse) only.
+  pulseaudio;
+
+  /// Creates a [CaptureBackend] from a string.
+  ///
+  /// Accepts: 'auto', 'pipewire', 'pulseaudio' (case-insensitive).
+  /// Returns [CaptureBackend.auto] for unknown values.
+  static CaptureBackend fromString(String backend) {
+    switch (backend.toLowerCase()) {
+      case 'pipewire':
+        return CaptureBackend.pipewire;
+      case 'pulseaudio':
+        return CaptureBackend.pulseaudio;
+      default:
+        return CaptureBackend.auto;
+    }
+  }
+
+  /// Converts this [CaptureBackend] to the name sent to the platform.
+  ///
+  /// Returns: 'auto', 'pipewire', or 'pulseaudio'.
+  @override
+  String toString() => name;
+}
@@ -0,0 +1,92 @@
+/// Why audio is missing from the capture stream.
+enum CaptureGapReason {
+  /// Capture moved to another input device.
+  deviceSwitch,
+
+  /// The sound server or the device went away and capture reconnected.
+  reconnect,
+
+  /// A reason this version of the plugin does not know.
+  unknown;
+
+  /// Creates a [CaptureGapReason] from the name sent by the platform.
+  ///
+  /// Returns [CaptureGapReason.unknown] for unknown values.
+  static CaptureGapReason fromString(String reason) {
+    switch (reason) {
+      case 'deviceSwitch':
+        return CaptureGapReason.deviceSwitch;
+      case 'reconnect':
+        return CaptureGapReason.reconnect;
+      default:
+        return CaptureGapReason.unknown;
+    }
+  }
+
+  @override
+  String toString() => name;
+}
+
+/// A stretch of audio the device captured that never reached the audio
+/// stream, reported on the status stream.
+///
+/// Example:
+/// ```dart
+/// micCapture.statusStream?.listen((status) {
+///   final gap = status.gap;
+///   if (gap != null) {
+///     print('Lost ${gap.lostSamples} samples (${gap.reason})');
+///   }
+/// });
+/// ```
+class CaptureGap {
+  /// Why the audio is missing.
+  final CaptureGapReason reason;
+
+  /// Samples lost, estimated from the capture timestamps on either side of
+  /// the gap.
+  final int lostSamples;
+
+  /// When the gap was detected, in seconds since the epoch.
+  final double timestamp;
+
+  const CaptureGap({
+    required this.reason,
+    required this.lostSamples,
+    required this.timestamp,
+  });
+
+  factory CaptureGap.fromMap(Map<String, dynamic> map) {
+    return CaptureGap(
+      reason: CaptureGapReason.fromString(map['reason'] as String? ?? ''),
+      lostSamples: (map['lostSamples'] as num?)?.toInt() ?? 0,
+      timestamp: (map['timestamp'] as num?)?.toDouble() ?? 0,
+    );
+  }
+
+  Map<String, dynamic> toMap() {
+    return {
+      'reason': reason.toString(),
+      'lostSamples': lostSamples,
+      'timestamp': timestamp,
+    };
+  }
+
+  @override
+  bool operator ==(Object other) {
+    if (identical(this, other)) return true;
+
+    return other is CaptureGap &&
+        other.reason == reason &&
+        other.lostSamples == lostSamples &&
+        other.timestamp == timestamp;
+  }
+
+  @override
+  int get hashCode => Object.hash(reason, lostSamples, timestamp);
+
+  @override
+  String toString() =>
+      'CaptureGap(reason: $reason, lostSamples: $lostSamples, '
+      'timestamp: $timestamp)';
+}
@@ -0,0 +1,238 @@
+/// Latency distribution of one pipeline stage, in microseconds.
+///
+/// Percentiles come from a log-linear histogram and are accurate to within
+/// one eighth of their value.
+class StageLatency {
+  /// Number of chunks that went through the stage.
+  final int count;
+
+  /// Shortest time spent in the stage.
+  final int minUs;
+
+  /// Mean time spent in the stage.
+  final double avgUs;
+
+  /// Median time spent in the stage.
+  final int p50Us;
+
+  /// 99th percentile of the time spent in the stage.
+  final int p99Us;
+
+  /// Longest time spent in the stage.
+  final int maxUs;
+
+  const StageLatency({
+    required this.count,
+    required this.minUs,
+    required this.avgUs,
+    required this.p50Us,
+    required this.p99Us,
+    required this.maxUs,
+  });
+
+  /// An empty stage, used when the platform does not report it.
+  static const StageLatency empty = StageLatency(
+    count: 0,
+    minUs: 0,
+    avgUs: 0,
+    p50Us: 0,
+    p99Us: 0,
+    maxUs: 0,
+  );
+
+  factory StageLatency.fromMap(Map<String, dynamic>? map) {
+    if (map == null) {
+      return empty;
+    }
+    return StageLatency(
+      count: (map['count'] as num?)?.toInt() ?? 0,
+      minUs: (map['minUs'] as num?)?.toInt() ?? 0,
+      avgUs: (map['avgUs'] as num?)?.toDouble() ?? 0,
+      p50Us: (map['p50Us'] as num?)?.toInt() ?? 0,
+      p99Us: (map['p99Us'] as num?)?.toInt() ?? 0,
+      maxUs: (map['maxUs'] as num?)?.toInt() ?? 0,
+    );
+  }
+
+  Map<String, dynamic> toMap() {
+    return {
+      'count': count,
+      'minUs': minUs,
+      'avgUs': avgUs,
+      'p50Us': p50Us,
+      'p99Us': p99Us,
+      'maxUs': maxUs,
+    };
+  }
+
+  @override
+  String toString() =>
+      'StageLatency(count: $count, avg: ${avgUs.toStringAsFixed(0)} us, '
+      'p50: $p50Us us, p99: $p99Us us, max: $maxUs us)';
+}
+
+/// Where audio chunks spend their time between the sound server and Dart,
+/// and what was lost on the way, for the current or last capture session.
+///
+/// Example:
+/// ```dart
+/// final stats = await capture.getStats();
+/// print('End-to-end p99: ${stats.total.p99Us} us');
+/// print('Dropped chunks: ${stats.droppedChunks}');
+/// ```
+class CaptureStats {
+  /// Device and sound server buffering before the audio reached the plugin.
+  final StageLatency capture;
+
+  /// Mixing, metering and chunk assembly on the capture thread.
+  final StageLatency process;
+
+  /// Wait for the platform thread to pick the chunk up.
+  final StageLatency dispatch;
+
+  /// Sending the chunk over the event channel.
+  final StageLatency send;
+
+  /// From capture by the device until sent to Dart.
+  final StageLatency total;
+
+  /// Part of [process] spent resampling from the device's rate. Empty when
+  /// the device already runs at the requested rate.
+  final StageLatency resample;
+
+  /// Rate the device delivered audio at, in Hz. 0 when the platform does
+  /// not report it.
+  final int sourceSampleRate;
+
+  /// Channels the device delivered, before any downmix. 0 when the platform
+  /// does not report it.
+  final int sourceChannels;
+
+  /// Buffering the sound server agreed to between the device and the
+  /// plugin, in microseconds. 0 when the platform does not report it.
+  final int negotiatedLatencyUs;
+
+  /// Times the sound server discarded audio because it was not read in time.
+  final int overruns;
+
+  /// Breaks in the audio stream, such as a switch to another device.
+  final int gaps;
+
+  /// Samples lost in those breaks.
+  final int lostSamples;
+
+  /// Times capture reconnected after the sound server or device went away.
+  final int reconnects;
+
+  /// Chunks dropped because the platform thread fell behind.
+  final int droppedChunks;
+
+  /// Times no chunk buffer was free when one was needed.
+  final int poolMisses;
+
+  /// Chunks waiting for the platform thread when the stats were taken.
+  final int queueDepth;
+
+  /// Most chunks ever waiting for the platform thread.
+  final int maxQueueDepth;
+
+  /// From `startCapture` being called until the first audio arrived, in
+  /// microseconds. 0 until it has.
+  final int timeToFirstSampleUs;
+
+  /// How long the last `stopCapture` took to tear the stream down, in
+  /// microseconds. 0 while capturing.
+  final int timeToStoppedUs;
+
+  const CaptureStats({
+    required this.capture,
+    required this.process,
+    required this.dispatch,
+    required this.send,
+    required this.total,
+    this.resample = StageLatency.empty,
+    this.sourceSampleRate = 0,
+    this.sourceChannels = 0,
+    required this.negotiatedLatencyUs,
+    required this.overruns,
+    this.gaps = 0,
+    this.lostSamples = 0,
+    this.reconnects = 0,
+    required this.droppedChunks,
+    required this.poolMisses,
+    required this.queueDepth,
+    required this.maxQueueDepth,
+    this.timeToFirstSampleUs = 0,
+    this.timeToStoppedUs = 0,
+  });
+
+  factory CaptureStats.fromMap(Map<String, dynamic> map) {
+    final latency = map['latency'] is Map
+        ? Map<String, dynamic>.from(map['latency'] as Map)
+        : const <String, dynamic>{};
+
+    StageLatency stage(String name) {
+      final value = latency[name];
+      return StageLatency.fromMap(
+        value is Map ? Map<String, dynamic>.from(value) : null,
+      );
+    }
+
+    return CaptureStats(
+      capture: stage('capture'),
+      process: stage('process'),
+      dispatch: stage('dispatch'),
+      send: stage('send'),
+      total: stage('total'),
+      resample: stage('resample'),
+      sourceSampleRate: (map['sourceSampleRate'] as num?)?.toInt() ?? 0,
+      sourceChannels: (map['sourceChannels'] as num?)?.toInt() ?? 0,
+      negotiatedLatencyUs: (map['negotiatedLatencyUs'] as num?)?.toInt() ?? 0,
+      overruns: (map['overruns'] as num?)?.toInt() ?? 0,
+      gaps: (map['gaps'] as num?)?.toInt() ?? 0,
+      lostSamples: (map['lostSamples'] as num?)?.toInt() ?? 0,
+      reconnects: (map['reconnects'] as num?)?.toInt() ?? 0,
+      droppedChunks: (map['droppedChunks'] as num?)?.toInt() ?? 0,
+      poolMisses: (map['poolMisses'] as num?)?.toInt() ?? 0,
+      queueDepth: (map['queueDepth'] as num?)?.toInt() ?? 0,
+      maxQueueDepth: (map['maxQueueDepth'] as num?)?.toInt() ?? 0,
+      timeToFirstSampleUs: (map['timeToFirstSampleUs'] as num?)?.toInt() ?? 0,
+      timeToStoppedUs: (map['timeToStoppedUs'] as num?)?.toInt() ?? 0,
+    );
+  }
+
+  Map<String, dynamic> toMap() {
+    return {
+      'latency': {
+        'capture': capture.toMap(),
+        'process': process.toMap(),
+        'dispatch': dispatch.toMap(),
+        'send': send.toMap(),
+        'total': total.toMap(),
+        'resample': resample.toMap(),
+      },
+      'sourceSampleRate': sourceSampleRate,
+      'sourceChannels': sourceChannels,
+      'negotiatedLatencyUs': negotiatedLatencyUs,
+      'overruns': overruns,
+      'gaps': gaps,
+      'lostSamples': lostSamples,
+      'reconnects': reconnects,
+      'droppedChunks': droppedChunks,
+      'poolMisses': poolMisses,
+      'queueDepth': queueDepth,
+      'maxQueueDepth': maxQueueDepth,
+      'timeToFirstSampleUs': timeToFirstSampleUs,
+      'timeToStoppedUs': timeToStoppedUs,
+    };
+  }
+
+  @override
+  String toString() =>
+      'CaptureStats(total: $total, '
+      'negotiatedLatencyUs: $negotiatedLatencyUs, overruns: $overruns, '
+      'gaps: $gaps, lostSamples: $lostSamples, reconnects: $reconnects, '
+      'droppedChunks: $droppedChunks, maxQueueDepth: $maxQueueDepth, '
+      'timeToFirstSampleUs: $timeToFirstSampleUs, '
+      'timeToStoppedUs: $timeToStoppedUs)';
+}
@@ -0,0 +1,46 @@
+/// How the captured channels are laid out in the chunks delivered to the
+/// audio stream.
+///
+/// Currently honoured on Linux; other platforms always deliver [mono].
+///
+/// Example:
+/// ```dart
+/// // Four raw channels from a USB microphone array
+/// final config = MicAudioConfig(
+///   channels: 4,
+///   channelLayout: ChannelLayout.interleaved,
+/// );
+/// final layout = ChannelLayout.fromString('planar');
+/// ```
+enum ChannelLayout {
+  /// Channels downmixed to one. Only the first two channels are recorded.
+  mono,
+
+  /// Every channel, frame by frame: `c0 c1 c2 c0 c1 c2 ...`.
+  interleaved,
+
+  /// Every channel, one after another: a chunk of N frames holds the N
+  /// samples of the first channel, then the N of the second, and so on.
+  planar;
+
+  /// Creates a [ChannelLayout] from a string.
+  ///
+  /// Accepts: 'mono', 'interleaved', 'planar' (case-insensitive).
+  /// Returns [ChannelLayout.mono] for unknown values.
+  static ChannelLayout fromString(String layout) {
+    switch (layout.toLowerCase()) {
+      case 'interleaved':
+        return ChannelLayout.interleaved;
+      case 'planar':
+        return ChannelLayout.planar;
+      default:
+        return ChannelLayout.mono;
+    }
+  }
+
+  /// Converts this [ChannelLayout] to the name sent to the platform.
+  ///
+  /// Returns: 'mono', 'interleaved', or 'planar'.
+  @override
+  String toString() => name;
+}
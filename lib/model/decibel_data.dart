@@ -37,6 +37,21 @@ class DecibelData {
   /// This represents when the decibel reading was taken.
   final double timestamp;
 
+  /// Peak level in dBFS over the metering interval, or null when the platform
+  /// does not report it.
+  final double? peakDecibel;
+
+  /// Linear RMS level (0.0 to 1.0), or null when not reported.
+  final double? rms;
+
+  /// Linear peak level (0.0 to 1.0), or null when not reported.
+  final double? peak;
+
+  /// Level of each channel, in channel order, when the capture keeps its
+  /// channels apart (see `MicAudioConfig.channelLayout`); null when they are
+  /// downmixed. The reading itself then follows the loudest channel.
+  final List<DecibelData>? channels;
+
   /// Creates a new [DecibelData] instance.
   ///
   /// [decibel] should be in the range -120 to 0 dB.
@@ -52,6 +67,10 @@ class DecibelData {
   const DecibelData({
     required this.decibel,
     required this.timestamp,
+    this.peakDecibel,
+    this.rms,
+    this.peak,
+    this.channels,
   });
 
   /// Creates a [DecibelData] instance from a map.
@@ -59,6 +78,8 @@ class DecibelData {
   /// The map should contain:
   /// - `decibel`: num (will be converted to double)
   /// - `timestamp`: num (will be converted to double)
+  /// - `peakDecibel`, `rms`, `peak`: num, optional
+  /// - `channels`: list of maps with the same keys, optional
   ///
   /// If values are missing, defaults to -120.0 dB and current timestamp.
   ///
@@ -71,10 +92,22 @@ class DecibelData {
   /// final data = DecibelData.fromMap(map);
   /// ```
   factory DecibelData.fromMap(Map<String, dynamic> map) {
+    final timestamp = (map['timestamp'] as num?)?.toDouble() ??
+        DateTime.now().millisecondsSinceEpoch / 1000.0;
+    final channels = map['channels'] as List?;
     return DecibelData(
       decibel: (map['decibel'] as num?)?.toDouble() ?? -120.0,
-      timestamp: (map['timestamp'] as num?)?.toDouble() ??
-          DateTime.now().millisecondsSinceEpoch / 1000.0,
+      timestamp: timestamp,
+      peakDecibel: (map['peakDecibel'] as num?)?.toDouble(),
+      rms: (map['rms'] as num?)?.toDouble(),
+      peak: (map['peak'] as num?)?.toDouble(),
+      // Channel readings share the timestamp of the reading they belong to.
+      channels: channels
+          ?.map((channel) => DecibelData.fromMap({
+                ...Map<String, dynamic>.from(channel as Map),
+                'timestamp': timestamp,
+              }))
+          .toList(),
     );
   }
 
@@ -83,6 +116,8 @@ class DecibelData {
   /// Returns a map containing:
   /// - `decibel`: double
   /// - `timestamp`: double
+  /// - `peakDecibel`, `rms`, `peak`: double, only when set
+  /// - `channels`: list of maps, only when set
   ///
   /// Example:
   /// ```dart
@@ -97,6 +132,11 @@ class DecibelData {
     return {
       'decibel': decibel,
       'timestamp': timestamp,
+      if (peakDecibel != null) 'peakDecibel': peakDecibel,
+      if (rms != null) 'rms': rms,
+      if (peak != null) 'peak': peak,
+      if (channels != null)
+        'channels': channels!.map((channel) => channel.toMap()).toList(),
     };
   }
 
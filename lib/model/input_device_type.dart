@@ -120,9 +120,17 @@ class InputDevice {
   /// Whether this device is the system default input device.
   final bool isDefault;
 
+  /// Native sample rate of the device in Hz, or 0 if the platform does not
+  /// report it.
+  final int sampleRate;
+
+  /// Whether this device records what an output device plays (a sink
+  /// monitor on Linux) rather than a physical input.
+  final bool isMonitor;
+
   /// Creates a new [InputDevice] instance.
   ///
-  /// All parameters are required.
+  /// All parameters except [sampleRate] and [isMonitor] are required.
   ///
   /// Example:
   /// ```dart
@@ -140,6 +148,8 @@ class InputDevice {
     required this.type,
     required this.channelCount,
     required this.isDefault,
+    this.sampleRate = 0,
+    this.isMonitor = false,
   });
 
   /// Creates an [InputDevice] instance from a map.
@@ -150,6 +160,8 @@ class InputDevice {
   /// - `type`: String (converted via [InputDeviceType.fromString], defaults to external)
   /// - `channelCount`: int (defaults to 0 if missing)
   /// - `isDefault`: bool (defaults to false if missing)
+  /// - `sampleRate`: int (defaults to 0 if missing)
+  /// - `isMonitor`: bool (defaults to false if missing)
   ///
   /// Example:
   /// ```dart
@@ -169,6 +181,8 @@ class InputDevice {
       type: InputDeviceType.fromString(map['type'] as String? ?? 'external'),
       channelCount: map['channelCount'] as int? ?? 0,
       isDefault: map['isDefault'] as bool? ?? false,
+      sampleRate: map['sampleRate'] as int? ?? 0,
+      isMonitor: map['isMonitor'] as bool? ?? false,
     );
   }
 
@@ -180,6 +194,8 @@ class InputDevice {
   /// - `type`: String (from [InputDeviceType.toString])
   /// - `channelCount`: int
   /// - `isDefault`: bool
+  /// - `sampleRate`: int
+  /// - `isMonitor`: bool
   ///
   /// Example:
   /// ```dart
@@ -199,13 +215,16 @@ class InputDevice {
       'type': type.toString(),
       'channelCount': channelCount,
       'isDefault': isDefault,
+      'sampleRate': sampleRate,
+      'isMonitor': isMonitor,
     };
   }
 
   @override
   String toString() {
     return 'InputDevice(id: $id, name: $name, type: ${type.toString()}, '
-        'channelCount: $channelCount, isDefault: $isDefault)';
+        'channelCount: $channelCount, sampleRate: $sampleRate, '
+        'isMonitor: $isMonitor, isDefault: $isDefault)';
   }
 
   @override
@@ -0,0 +1,47 @@
+/// Encoding of the samples in the chunks delivered to the audio stream.
+///
+/// Samples are mono and little-endian. Anything but [int16] is captured and
+/// processed in 32-bit float, so the gain boost does not clip until the
+/// final conversion, or at all for [float32]. Currently honoured on Linux;
+/// other platforms always deliver [int16].
+///
+/// Example:
+/// ```dart
+/// final config = MicAudioConfig(sampleFormat: SampleFormat.float32);
+/// final format = SampleFormat.fromString('int32');
+/// ```
+enum SampleFormat {
+  /// Signed 16-bit integers.
+  int16,
+
+  /// Signed 32-bit integers, full scale at 2^31.
+  int32,
+
+  /// 32-bit floats, full scale at 1.0. Samples the gain boost pushes past
+  /// full scale are left unclipped.
+  float32;
+
+  /// Creates a [SampleFormat] from a string.
+  ///
+  /// Accepts: 'int16', 'int32', 'float32' (case-insensitive).
+  /// Returns [SampleFormat.int16] for unknown values.
+  static SampleFormat fromString(String format) {
+    switch (format.toLowerCase()) {
+      case 'int32':
+        return SampleFormat.int32;
+      case 'float32':
+        return SampleFormat.float32;
+      default:
+        return SampleFormat.int16;
+    }
+  }
+
+  /// Size of one sample in bytes.
+  int get bytesPerSample => this == SampleFormat.int16 ? 2 : 4;
+
+  /// Converts this [SampleFormat] to the name sent to the platform.
+  ///
+  /// Returns: 'int16', 'int32', or 'float32'.
+  @override
+  String toString() => name;
+}
@@ -7,8 +7,12 @@ export 'package:desktop_audio_capture/config/system_adudio_config.dart';
 
 enum _SystemAudioMethod {
   startCapture,
+  armCapture,
   stopCapture,
   requestPermissions,
+  pauseCapture,
+  resumeCapture,
+  getStats,
 }
 
 /// Class for capturing system audio (audio output from the device).
@@ -60,6 +64,7 @@ class SystemAudioCapture extends AudioCapture {
   Stream<SystemAudioStatus>? _statusStream;
   Stream<DecibelData>? _decibelStream;
   bool _isRecording = false;
+  bool _isArmed = false;
 
   /// Stream of raw audio data bytes from system audio capture.
   ///
@@ -82,6 +87,7 @@ class SystemAudioCapture extends AudioCapture {
   ///
   /// Returns a [Stream<SystemAudioStatus>] containing status information:
   /// - [SystemAudioStatus.isActive]: bool - whether system audio capture is currently active
+  /// - [SystemAudioStatus.isStarting]: bool - whether the stream is still being opened (Linux)
   ///
   /// Example:
   /// ```dart
@@ -111,6 +117,7 @@ class SystemAudioCapture extends AudioCapture {
   /// Returns a [Stream<DecibelData>] containing:
   /// - `decibel`: double - decibel value (-120 to 0 dB)
   /// - `timestamp`: double - Unix timestamp
+  /// - `peakDecibel`, `rms`, `peak`: double? - meter readings, where reported
   ///
   /// The stream is only available while recording is active.
   ///
@@ -246,12 +253,52 @@ class SystemAudioCapture extends AudioCapture {
 
       // Status stream is created lazily via getter, no need to recreate here
 
+      _isArmed = false;
       _isRecording = true;
     } catch (e) {
       rethrow;
     }
   }
 
+  /// Prepares a capture session so that [startCapture] starts it at once.
+  ///
+  /// Opens the device, connects the stream corked and starts the capture
+  /// thread with its buffers, without delivering any audio. The next
+  /// [startCapture] then only uncorks the stream, and the time it took is
+  /// reported as `timeToFirstSampleUs` by `getStats`. [stopCapture] releases
+  /// an armed session that was never started.
+  ///
+  /// [config] is optional. If provided, it will update the current
+  /// configuration; a [startCapture] on an armed session keeps the armed
+  /// settings.
+  ///
+  /// Returns false if the session could not be set up. Currently
+  /// implemented on Linux.
+  ///
+  /// Example:
+  /// ```dart
+  /// await capture.armCapture();
+  /// // ... when the user presses record
+  /// await capture.startCapture();
+  /// ```
+  Future<bool> armCapture({SystemAudioConfig? config}) async {
+    if (_isRecording || _isArmed) {
+      return _isArmed;
+    }
+
+    if (config != null) {
+      updateConfig(config);
+    }
+
+    await requestPermissions();
+    final armed = await _channel.invokeMethod<bool>(
+      _SystemAudioMethod.armCapture.name,
+      _config.toMap(),
+    );
+    _isArmed = armed ?? false;
+    return _isArmed;
+  }
+
   /// Stops capturing system audio.
   ///
   /// This method will stop the active capture and close all associated streams.
@@ -269,7 +316,7 @@ class SystemAudioCapture extends AudioCapture {
   /// print('System audio capture stopped');
   /// ```
   Future<void> stopCapture() async {
-    if (!_isRecording) return;
+    if (!_isRecording && !_isArmed) return;
 
     try {
       final stopped = await _channel.invokeMethod<bool>(
@@ -281,6 +328,7 @@ class SystemAudioCapture extends AudioCapture {
       }
 
       _isRecording = false;
+      _isArmed = false;
       _audioStream = null;
       _statusStream = null;
       _decibelStream = null;
@@ -333,4 +381,63 @@ class SystemAudioCapture extends AudioCapture {
     }
     return true;
   }
+
+  /// Pauses the running capture without closing it.
+  ///
+  /// The stream is corked on the sound server and the capture thread sleeps,
+  /// so nothing is emitted while paused. Device, buffers, counters and level
+  /// metering are kept, and [resumeCapture] continues where this left off.
+  /// The pause is reported on [statusStream] with `isPaused` set.
+  ///
+  /// Returns false if nothing is being captured or the stream cannot be
+  /// paused. Currently implemented on Linux.
+  ///
+  /// Example:
+  /// ```dart
+  /// await capture.pauseCapture();
+  /// // ... later
+  /// await capture.resumeCapture();
+  /// ```
+  Future<bool> pauseCapture() async {
+    final paused = await _channel.invokeMethod<bool>(
+      _SystemAudioMethod.pauseCapture.name,
+    );
+    return paused ?? false;
+  }
+
+  /// Resumes a capture paused with [pauseCapture].
+  ///
+  /// Takes a single round trip to the sound server. Returns false if nothing
+  /// is being captured or the stream cannot be resumed.
+  Future<bool> resumeCapture() async {
+    final resumed = await _channel.invokeMethod<bool>(
+      _SystemAudioMethod.resumeCapture.name,
+    );
+    return resumed ?? false;
+  }
+
+  /// Returns latency and loss accounting for the current or last capture
+  /// session.
+  ///
+  /// Each chunk is timestamped as it moves from the sound server through
+  /// processing to the event channel. The result holds min/avg/p50/p99/max
+  /// per stage, plus overrun, dropped-chunk and queue-depth counters.
+  /// Stamping is cheap enough that it is always on.
+  ///
+  /// Only implemented on Linux; other platforms throw a
+  /// [MissingPluginException] or [PlatformException].
+  ///
+  /// Example:
+  /// ```dart
+  /// final stats = await capture.getStats();
+  /// print('p99 end-to-end: ${stats.total.p99Us} us');
+  /// ```
+  Future<CaptureStats> getStats() async {
+    final stats = await _channel.invokeMethod<Map<dynamic, dynamic>>(
+      _SystemAudioMethod.getStats.name,
+    );
+    return CaptureStats.fromMap(
+      Map<String, dynamic>.from(stats ?? const <String, dynamic>{}),
+    );
+  }
 }
@@ -0,0 +1,415 @@
+#include <benchmark/benchmark.h>
+#include <poll.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "audio_kernels.h"
+#include "capture_engine.h"
+#include "level_meter.h"
+#include "resampler.h"
+#include "sample_converter.h"
+
+// Throughput of the sample processing kernels, per instruction set.
+//
+// Every benchmark reports two counters besides wall time:
+//   samples/s    input samples (frames x channels) processed per second.
+//   time/sample  seconds spent per input sample; "n" in the output is ns.
+//
+// Build with -DCMAKE_BUILD_TYPE=Release and compare runs with
+// tools/compare.py from Google Benchmark to catch regressions.
+
+namespace audio_capture {
+namespace benchmark_kernels {
+
+namespace {
+
+constexpr float kGainBoost = 2.5f;
+constexpr float kAttenuatedVolume = 0.73f;
+
+// Chunk sizes in frames: a 10 ms PulseAudio fragment at 16 kHz, 20 ms at
+// 48 kHz, the mic plugin chunk and one second at 16 kHz.
+const int64_t kChunkFrames[] = {160, 960, 4096, 16000};
+
+std::vector<int16_t> NoiseSamples(size_t count) {
+  std::mt19937 engine(42);
+  std::uniform_int_distribution<int> distribution(-32768, 32767);
+  std::vector<int16_t> samples(count);
+  for (int16_t& sample : samples) {
+    sample = static_cast<int16_t>(distribution(engine));
+  }
+  return samples;
+}
+
+void SetSampleCounters(benchmark::State& state, int64_t samples) {
+  state.counters["samples/s"] =
+      benchmark::Counter(static_cast<double>(samples),
+                         benchmark::Counter::kIsIterationInvariantRate);
+  state.counters["time/sample"] = benchmark::Counter(
+      static_cast<double>(samples),
+      benchmark::Counter::kIsIterationInvariantRate |
+          benchmark::Counter::kInvert);
+}
+
+void ChunkAndChannelArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"frames", "channels"});
+  for (int64_t frames : kChunkFrames) {
+    for (int64_t channels : {1, 2, 4}) {
+      benchmark->Args({frames, channels});
+    }
+  }
+}
+
+// Gain boost and downmix to mono, optionally with input volume below 1 and
+// level accumulation.
+void BM_MixToMono(benchmark::State& state, KernelIsa isa, float input_volume,
+                  bool metered) {
+  const MixToMonoFunction kernel = GetMixToMonoKernel(isa);
+  if (kernel == nullptr) {
+    state.SkipWithError("instruction set not available");
+    return;
+  }
+
+  const size_t frames = static_cast<size_t>(state.range(0));
+  const int channels = static_cast<int>(state.range(1));
+  const std::vector<int16_t> input = NoiseSamples(frames * channels);
+  std::vector<int16_t> output(frames);
+  LevelAccumulator levels{0, 0, 0};
+
+  for (auto _ : state) {
+    kernel(input.data(), output.data(), frames, channels, input_volume,
+           kGainBoost, metered ? &levels : nullptr);
+    benchmark::DoNotOptimize(output.data());
+    benchmark::ClobberMemory();
+  }
+  benchmark::DoNotOptimize(levels);
+  SetSampleCounters(state, static_cast<int64_t>(frames) * channels);
+}
+
+// Splitting interleaved float frames into gain-scaled channel planes and
+// interleaving them back, as sessions that keep their channels apart do.
+// Two and four channels take the SIMD shuffles, the others the scalar loop.
+void BM_SplitChannels(benchmark::State& state) {
+  const size_t frames = static_cast<size_t>(state.range(0));
+  const int channels = static_cast<int>(state.range(1));
+  const std::vector<int16_t> noise = NoiseSamples(frames * channels);
+  std::vector<float> input(noise.size());
+  Int16ToFloat(noise.data(), input.data(), noise.size());
+  const std::vector<float> gains(channels, kGainBoost);
+  std::vector<float> plane_buffer(frames * channels);
+  std::vector<float*> planes;
+  for (int channel = 0; channel < channels; ++channel) {
+    planes.push_back(plane_buffer.data() + channel * frames);
+  }
+  const std::vector<const float*> const_planes(planes.begin(), planes.end());
+  std::vector<float> output(frames * channels);
+
+  for (auto _ : state) {
+    DeinterleaveFloat(input.data(), frames, channels, gains.data(),
+                      planes.data());
+    InterleaveFloat(const_planes.data(), frames, channels, output.data());
+    benchmark::DoNotOptimize(output.data());
+    benchmark::ClobberMemory();
+  }
+  SetSampleCounters(state, static_cast<int64_t>(frames) * channels);
+}
+
+// One resampler output frame: the dot product of |taps| history samples and
+// a phase of the filter.
+void BM_DotProduct(benchmark::State& state, KernelIsa isa) {
+  const DotProductFunction kernel = GetDotProductKernel(isa);
+  if (kernel == nullptr) {
+    state.SkipWithError("instruction set not available on this CPU");
+    return;
+  }
+  const size_t taps = static_cast<size_t>(state.range(0));
+  const std::vector<int16_t> noise = NoiseSamples(taps * 2);
+  std::vector<float> values(noise.size());
+  Int16ToFloat(noise.data(), values.data(), noise.size());
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(kernel(values.data(), values.data() + taps, taps));
+  }
+  SetSampleCounters(state, static_cast<int64_t>(taps));
+}
+
+// Streaming mono float audio through a Resampler in 20 ms fragments.
+void BM_Resampler(benchmark::State& state, ResamplerQuality quality) {
+  const int input_rate = static_cast<int>(state.range(0));
+  const int output_rate = static_cast<int>(state.range(1));
+  const size_t frames = static_cast<size_t>(input_rate / 50);
+  Resampler resampler(input_rate, output_rate, quality);
+  const std::vector<int16_t> noise = NoiseSamples(frames);
+  std::vector<float> input(frames);
+  Int16ToFloat(noise.data(), input.data(), frames);
+  std::vector<float> output(resampler.MaxOutputFrames(frames));
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        resampler.Process(input.data(), frames, output.data()));
+    benchmark::ClobberMemory();
+  }
+  state.counters["taps"] = resampler.taps();
+  SetSampleCounters(state, static_cast<int64_t>(frames));
+}
+
+void RatePairArgs(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"from", "to"});
+  const int64_t pairs[][2] = {
+      {48000, 16000}, {44100, 16000}, {44100, 48000}, {16000, 48000}};
+  for (const auto& pair : pairs) {
+    benchmark->Args({pair[0], pair[1]});
+  }
+}
+
+// |count| samples of |format| made from noise, floats kept in range so they
+// do not decode to denormals.
+std::vector<uint8_t> EncodedNoise(PcmFormat format, size_t count) {
+  const std::vector<int16_t> noise =
+      NoiseSamples(count * PcmBytesPerSample(format.encoding));
+  std::vector<uint8_t> encoded(count * PcmBytesPerSample(format.encoding));
+  if (format.encoding == PcmEncoding::kF32) {
+    Int16ToFloat(noise.data(), reinterpret_cast<float*>(encoded.data()),
+                 count);
+  } else {
+    std::memcpy(encoded.data(), noise.data(), encoded.size());
+  }
+  if (format.big_endian) {
+    const size_t bytes = PcmBytesPerSample(format.encoding);
+    for (size_t offset = 0; offset < encoded.size(); offset += bytes) {
+      std::reverse(encoded.begin() + offset, encoded.begin() + offset + bytes);
+    }
+  }
+  return encoded;
+}
+
+// Decoding a device's samples ahead of the mixdown, to int16 or float.
+void BM_ConvertToInt16(benchmark::State& state, PcmFormat format) {
+  const size_t count = static_cast<size_t>(state.range(0));
+  const std::vector<uint8_t> input = EncodedNoise(format, count);
+  std::vector<int16_t> output(count);
+
+  for (auto _ : state) {
+    ConvertToInt16(input.data(), format, count, output.data());
+    benchmark::DoNotOptimize(output.data());
+    benchmark::ClobberMemory();
+  }
+  SetSampleCounters(state, static_cast<int64_t>(count));
+}
+
+void BM_ConvertToFloat(benchmark::State& state, PcmFormat format) {
+  const size_t count = static_cast<size_t>(state.range(0));
+  const std::vector<uint8_t> input = EncodedNoise(format, count);
+  std::vector<float> output(count);
+
+  for (auto _ : state) {
+    ConvertToFloat(input.data(), format, count, output.data());
+    benchmark::DoNotOptimize(output.data());
+    benchmark::ClobberMemory();
+  }
+  SetSampleCounters(state, static_cast<int64_t>(count));
+}
+
+// Metering at the meter rate, split the way the capture thread splits
+// fragments at interval boundaries, including the dB conversion and
+// ballistics of every reading.
+void BM_LevelMeter(benchmark::State& state) {
+  const int sample_rate = static_cast<int>(state.range(0));
+  const double rate_hz = static_cast<double>(state.range(1));
+  // One second of mono audio per iteration.
+  const size_t frames = static_cast<size_t>(sample_rate);
+  const std::vector<int16_t> input = NoiseSamples(frames);
+  std::vector<int16_t> output(frames);
+  LevelMeter meter(sample_rate, rate_hz);
+
+  for (auto _ : state) {
+    size_t offset = 0;
+    while (offset < frames) {
+      const size_t count =
+          std::min(frames - offset, meter.frames_until_reading());
+      MixToMono(input.data() + offset, output.data() + offset, count, 1, 1.0f,
+                kGainBoost, meter.levels());
+      LevelReading reading;
+      if (meter.TakeReading(&reading)) {
+        benchmark::DoNotOptimize(reading);
+      }
+      offset += count;
+    }
+    benchmark::ClobberMemory();
+  }
+  SetSampleCounters(state, static_cast<int64_t>(frames));
+}
+
+// Replays a fixed buffer in 20 ms fragments, then ends the session.
+class ReplaySource : public CaptureSource {
+ public:
+  ReplaySource(const std::vector<int16_t>* samples, size_t fragment_samples)
+      : samples_(samples), fragment_samples_(fragment_samples), position_(0) {}
+
+  CaptureReadStatus Acquire(const uint8_t** data, size_t* bytes) override {
+    if (position_ >= samples_->size()) {
+      return CaptureReadStatus::kError;
+    }
+    const size_t count =
+        std::min(fragment_samples_, samples_->size() - position_);
+    *data = reinterpret_cast<const uint8_t*>(samples_->data() + position_);
+    *bytes = count * sizeof(int16_t);
+    position_ += count;
+    return CaptureReadStatus::kOk;
+  }
+
+  void Release() override {}
+
+ private:
+  const std::vector<int16_t>* samples_;
+  const size_t fragment_samples_;
+  size_t position_;
+};
+
+// The whole capture pipeline without a sound server: fragment intake, mixing,
+// metering, chunk assembly and the hand-off to the consumer thread.
+void BM_CaptureEngine(benchmark::State& state) {
+  const int sample_rate = static_cast<int>(state.range(0));
+  const int channels = static_cast<int>(state.range(1));
+  constexpr int kSeconds = 8;
+  const std::vector<int16_t> input =
+      NoiseSamples(static_cast<size_t>(sample_rate) * channels * kSeconds);
+
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  if (engine == nullptr) {
+    state.SkipWithError("failed to create capture engine");
+    return;
+  }
+  engine->set_metering(true);
+
+  CaptureEngineConfig config;
+  config.sample_rate = sample_rate;
+  config.channels = channels;
+  config.chunk_frames = static_cast<size_t>(sample_rate);
+  config.gain_boost = kGainBoost;
+  config.input_volume = 1.0f;
+  config.meter_rate_hz = LevelMeter::kDefaultRateHz;
+
+  const size_t fragment_samples =
+      static_cast<size_t>(sample_rate / 50) * channels;
+  pollfd wakeup{engine->wakeup_fd(), POLLIN, 0};
+  int64_t chunks = 0;
+
+  for (auto _ : state) {
+    engine->Start(std::unique_ptr<CaptureSource>(
+                      new ReplaySource(&input, fragment_samples)),
+                  config);
+    while (!engine->finished()) {
+      poll(&wakeup, 1, -1);
+      engine->Drain(
+          [&chunks](uint8_t* buffer, size_t bytes) {
+            benchmark::DoNotOptimize(bytes);
+            ++chunks;
+            CaptureEngine::ReleaseChunk(buffer);
+          },
+          nullptr);
+    }
+    engine->Stop();
+    engine->Drain(nullptr, nullptr);
+  }
+  state.counters["dropped"] = static_cast<double>(engine->dropped_chunks());
+  benchmark::DoNotOptimize(chunks);
+  SetSampleCounters(state, static_cast<int64_t>(input.size()));
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(BM_MixToMono, scalar, KernelIsa::kScalar, 1.0f, false)
+    ->Apply(ChunkAndChannelArgs);
+BENCHMARK_CAPTURE(BM_MixToMono, sse2, KernelIsa::kSse2, 1.0f, false)
+    ->Apply(ChunkAndChannelArgs);
+BENCHMARK_CAPTURE(BM_MixToMono, avx2, KernelIsa::kAvx2, 1.0f, false)
+    ->Apply(ChunkAndChannelArgs);
+BENCHMARK_CAPTURE(BM_MixToMono, neon, KernelIsa::kNeon, 1.0f, false)
+    ->Apply(ChunkAndChannelArgs);
+
+// Input volume below 1 adds the attenuate-and-truncate step.
+BENCHMARK_CAPTURE(BM_MixToMono, volume_scalar, KernelIsa::kScalar,
+                  kAttenuatedVolume, false)
+    ->Apply(ChunkAndChannelArgs);
+BENCHMARK_CAPTURE(BM_MixToMono, volume_active, ActiveKernelIsa(),
+                  kAttenuatedVolume, false)
+    ->Apply(ChunkAndChannelArgs);
+
+// Level accumulation fused into the mix pass.
+BENCHMARK_CAPTURE(BM_MixToMono, metered_scalar, KernelIsa::kScalar, 1.0f,
+                  true)
+    ->Apply(ChunkAndChannelArgs);
+BENCHMARK_CAPTURE(BM_MixToMono, metered_active, ActiveKernelIsa(), 1.0f,
+                  true)
+    ->Apply(ChunkAndChannelArgs);
+
+BENCHMARK(BM_SplitChannels)
+    ->ArgNames({"frames", "channels"})
+    ->ArgsProduct({{960, 4096}, {2, 3, 4, 8}});
+
+// Filter lengths of the resampler's quality tiers, plain and decimating.
+BENCHMARK_CAPTURE(BM_DotProduct, scalar, KernelIsa::kScalar)
+    ->ArgName("taps")
+    ->Arg(16)->Arg(32)->Arg(64)->Arg(96)->Arg(192);
+BENCHMARK_CAPTURE(BM_DotProduct, active, ActiveKernelIsa())
+    ->ArgName("taps")
+    ->Arg(16)->Arg(32)->Arg(64)->Arg(96)->Arg(192);
+
+BENCHMARK_CAPTURE(BM_Resampler, low, ResamplerQuality::kLow)
+    ->Apply(RatePairArgs);
+BENCHMARK_CAPTURE(BM_Resampler, medium, ResamplerQuality::kMedium)
+    ->Apply(RatePairArgs);
+BENCHMARK_CAPTURE(BM_Resampler, high, ResamplerQuality::kHigh)
+    ->Apply(RatePairArgs);
+
+// The encodings WASAPI mix formats and PulseAudio sample specs come in.
+BENCHMARK_CAPTURE(BM_ConvertToInt16, s24le,
+                  PcmFormat{PcmEncoding::kS24, false})
+    ->Arg(4096);
+BENCHMARK_CAPTURE(BM_ConvertToInt16, s24be,
+                  PcmFormat{PcmEncoding::kS24, true})
+    ->Arg(4096);
+BENCHMARK_CAPTURE(BM_ConvertToInt16, s24_32le,
+                  PcmFormat{PcmEncoding::kS24In32, false})
+    ->Arg(4096);
+BENCHMARK_CAPTURE(BM_ConvertToInt16, s32le,
+                  PcmFormat{PcmEncoding::kS32, false})
+    ->Arg(4096);
+BENCHMARK_CAPTURE(BM_ConvertToInt16, f32le,
+                  PcmFormat{PcmEncoding::kF32, false})
+    ->Arg(4096);
+BENCHMARK_CAPTURE(BM_ConvertToInt16, f32be,
+                  PcmFormat{PcmEncoding::kF32, true})
+    ->Arg(4096);
+BENCHMARK_CAPTURE(BM_ConvertToFloat, s16le,
+                  PcmFormat{PcmEncoding::kS16, false})
+    ->Arg(4096);
+BENCHMARK_CAPTURE(BM_ConvertToFloat, s16be,
+                  PcmFormat{PcmEncoding::kS16, true})
+    ->Arg(4096);
+BENCHMARK_CAPTURE(BM_ConvertToFloat, s24le,
+                  PcmFormat{PcmEncoding::kS24, false})
+    ->Arg(4096);
+BENCHMARK_CAPTURE(BM_ConvertToFloat, s32be,
+                  PcmFormat{PcmEncoding::kS32, true})
+    ->Arg(4096);
+
+BENCHMARK(BM_LevelMeter)
+    ->ArgNames({"rate", "meter_hz"})
+    ->ArgsProduct({{16000, 44100, 48000}, {30, 120}});
+
+BENCHMARK(BM_CaptureEngine)
+    ->ArgNames({"rate", "channels"})
+    ->ArgsProduct({{16000, 44100, 48000}, {1, 2}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+}  // namespace benchmark_kernels
+}  // namespace audio_capture
+
+BENCHMARK_MAIN();
@@ -0,0 +1,161 @@
+#include "capture_backend.h"
+
+#include <glib.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+#include "pulse_capture_source.h"
+
+#if defined(HAVE_PIPEWIRE)
+#include "pipewire_capture_source.h"
+#endif
+
+namespace audio_capture {
+
+namespace {
+
+struct AsyncOpen {
+  GMainContext* context;
+  std::function<CaptureSourceOpening()> open;
+  std::function<void(CaptureSourceOpening)> done;
+  CaptureSourceOpening result;
+};
+
+gboolean FinishAsyncOpen(gpointer data) {
+  AsyncOpen* job = static_cast<AsyncOpen*>(data);
+  job->done(std::move(job->result));
+  return G_SOURCE_REMOVE;
+}
+
+void DeleteAsyncOpen(gpointer data) {
+  AsyncOpen* job = static_cast<AsyncOpen*>(data);
+  g_main_context_unref(job->context);
+  delete job;
+}
+
+// An idle source rather than g_main_context_invoke(), which would run |done|
+// right away when called on the context's own thread.
+void PostAsyncOpen(AsyncOpen* job) {
+  GSource* source = g_idle_source_new();
+  g_source_set_callback(source, FinishAsyncOpen, job, DeleteAsyncOpen);
+  g_source_attach(source, job->context);
+  g_source_unref(source);
+}
+
+gpointer RunAsyncOpen(gpointer data) {
+  AsyncOpen* job = static_cast<AsyncOpen*>(data);
+  job->result = job->open();
+  PostAsyncOpen(job);
+  return nullptr;
+}
+
+}  // namespace
+
+bool ParseCaptureBackend(const std::string& name, CaptureBackend* backend) {
+  if (name == "auto") {
+    *backend = CaptureBackend::kAuto;
+  } else if (name == "pipewire") {
+    *backend = CaptureBackend::kPipeWire;
+  } else if (name == "pulseaudio") {
+    *backend = CaptureBackend::kPulseAudio;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* CaptureBackendName(CaptureBackend backend) {
+  switch (backend) {
+    case CaptureBackend::kAuto:
+      return "auto";
+    case CaptureBackend::kPipeWire:
+      return "pipewire";
+    case CaptureBackend::kPulseAudio:
+      return "pulseaudio";
+  }
+  return "auto";
+}
+
+std::unique_ptr<CaptureSource> OpenCaptureSource(
+    CaptureBackend backend, const CaptureSourceConfig& config,
+    CaptureBackend* opened, std::string* error_message) {
+  if (backend != CaptureBackend::kPulseAudio) {
+#if defined(HAVE_PIPEWIRE)
+    std::unique_ptr<CaptureSource> source =
+        PipeWireStreamSource::Open(config, error_message);
+    if (source != nullptr) {
+      *opened = CaptureBackend::kPipeWire;
+      return source;
+    }
+#else
+    *error_message = "built without PipeWire support";
+#endif
+    if (backend == CaptureBackend::kPipeWire) {
+      return nullptr;
+    }
+    g_debug("PipeWire capture unavailable (%s), falling back to PulseAudio",
+            error_message->c_str());
+  }
+
+  std::unique_ptr<CaptureSource> source =
+      OpenPulseCaptureSource(config, error_message);
+  if (source != nullptr) {
+    *opened = CaptureBackend::kPulseAudio;
+  }
+  return source;
+}
+
+bool UseNativeFormat(const AudioDeviceInfo& device, bool keep_channels,
+                     CaptureSourceConfig* config) {
+  if (device.sample_rate <= 0 || device.channels <= 0 ||
+      config->sample_rate <= 0 || config->channels <= 0) {
+    return false;
+  }
+  const int channels = keep_channels ? config->channels : device.channels;
+  const auto scale = [&](size_t bytes) {
+    const uint64_t scaled = static_cast<uint64_t>(bytes) *
+                            device.sample_rate * channels /
+                            (static_cast<uint64_t>(config->sample_rate) *
+                             config->channels);
+    const size_t frame_size = BytesPerSample(config->format) * channels;
+    return std::max<size_t>(scaled / frame_size, 1) * frame_size;
+  };
+  config->fragment_bytes = scale(config->fragment_bytes);
+  config->max_buffer_bytes = scale(config->max_buffer_bytes);
+  config->sample_rate = device.sample_rate;
+  config->channels = channels;
+  // The device's map only describes its own channel count.
+  config->channel_map =
+      channels == device.channels ? device.channel_map : std::string();
+  return true;
+}
+
+void OpenCaptureSourceAsync(
+    GMainContext* context, std::function<CaptureSourceOpening()> open,
+    std::function<void(CaptureSourceOpening)> done) {
+  AsyncOpen* job = new AsyncOpen{g_main_context_ref(context), std::move(open),
+                                 std::move(done), CaptureSourceOpening()};
+
+  g_autoptr(GError) error = nullptr;
+  GThread* thread =
+      g_thread_try_new("voxa-capture-open", RunAsyncOpen, job, &error);
+  if (thread == nullptr) {
+    job->result.error_message =
+        std::string("Failed to start open thread: ") + error->message;
+    PostAsyncOpen(job);
+    return;
+  }
+  g_thread_unref(thread);
+}
+
+CaptureSourceFactory MakeCaptureSourceFactory(
+    CaptureBackend backend, const CaptureSourceConfig& config) {
+  return [backend, config](std::string* error_message) {
+    CaptureBackend opened = backend;
+    return OpenCaptureSource(backend, config, &opened, error_message);
+  };
+}
+
+}  // namespace audio_capture
@@ -0,0 +1,74 @@
+#ifndef FLUTTER_PLUGIN_CAPTURE_BACKEND_H_
+#define FLUTTER_PLUGIN_CAPTURE_BACKEND_H_
+
+#include <glib.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "capture_source.h"
+#include "pulse_device_monitor.h"
+
+namespace audio_capture {
+
+enum class CaptureBackend {
+  // Native PipeWire when a daemon answers, PulseAudio otherwise.
+  kAuto,
+  kPipeWire,
+  kPulseAudio,
+};
+
+// Parses the "backend" startCapture argument ("auto", "pipewire" or
+// "pulseaudio"). Returns false for anything else.
+bool ParseCaptureBackend(const std::string& name, CaptureBackend* backend);
+
+const char* CaptureBackendName(CaptureBackend backend);
+
+// Opens a capture source on |backend|. kAuto tries PipeWire first and falls
+// back to PulseAudio, which PipeWire systems also serve through
+// pipewire-pulse; an explicit backend never falls back. On success |*opened|
+// is set to the backend actually in use.
+std::unique_ptr<CaptureSource> OpenCaptureSource(
+    CaptureBackend backend, const CaptureSourceConfig& config,
+    CaptureBackend* opened, std::string* error_message);
+
+// Switches |config| to the sample rate, channel count and channel map
+// |device| runs at, so the server passes its audio through unconverted.
+// With |keep_channels| only the rate is switched and the server remixes to
+// the channel count already in |config|, e.g. because the caller asked for
+// that many channels kept apart. Fragment and buffer sizes keep their
+// duration. Returns false, leaving |config| as it is, when the device's
+// format is unknown.
+bool UseNativeFormat(const AudioDeviceInfo& device, bool keep_channels,
+                     CaptureSourceConfig* config);
+
+// What an open run by OpenCaptureSourceAsync() produced.
+struct CaptureSourceOpening {
+  // nullptr if the open failed, with |error_message| saying why.
+  std::unique_ptr<CaptureSource> source;
+  // The config |source| was opened with, e.g. switched to the device's own
+  // format.
+  CaptureSourceConfig config;
+  // The backend actually in use.
+  CaptureBackend backend = CaptureBackend::kAuto;
+  std::string error_message;
+};
+
+// Runs |open| on a worker thread, so connect timeouts and the kAuto fallback
+// do not stall the caller, and hands what it produced to |done| on
+// |context|. |done| always runs, and never from within this call. |open|
+// must only touch thread-safe state.
+void OpenCaptureSourceAsync(
+    GMainContext* context, std::function<CaptureSourceOpening()> open,
+    std::function<void(CaptureSourceOpening)> done);
+
+// Returns a factory that opens |config| on |backend| again, for reconnecting
+// a session after its source was disconnected. Pass the backend the session
+// actually opened so a reconnect does not change backends.
+CaptureSourceFactory MakeCaptureSourceFactory(
+    CaptureBackend backend, const CaptureSourceConfig& config);
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_CAPTURE_BACKEND_H_
@@ -0,0 +1,987 @@
+#include "capture_engine.h"
+
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+#include "audio_kernels.h"
+#include "resampler.h"
+
+namespace audio_capture {
+
+namespace {
+
+// Linux thread names are limited to 15 characters plus the terminator.
+constexpr size_t kMaxThreadNameLength = 15;
+
+// One buffer per queue slot, plus the one being filled and the one being
+// emitted.
+constexpr size_t kChunkPoolSize = CaptureEngine::kChunkQueueCapacity + 2;
+
+// Source frames converted, downmixed and resampled at a time when they cannot
+// be mixed straight into the chunk. Bounds the scratch buffers that needs.
+constexpr size_t kProcessBlockFrames = 1024;
+
+int64_t RealTimeMicroseconds() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+int64_t MonotonicMicroseconds() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Writes |count| processed samples into a chunk in |format|. The int16 mix is
+// normally only used when chunks are int16 too, but wider formats are filled
+// correctly rather than with half the bytes.
+void WriteSamples(const int16_t* samples, size_t count, SampleFormat format,
+                  uint8_t* output) {
+  switch (format) {
+    case SampleFormat::kS16:
+      std::memcpy(output, samples, count * sizeof(int16_t));
+      break;
+    case SampleFormat::kS32: {
+      int32_t* wide = reinterpret_cast<int32_t*>(output);
+      for (size_t i = 0; i < count; ++i) {
+        wide[i] = static_cast<int32_t>(samples[i]) * 65536;
+      }
+      break;
+    }
+    case SampleFormat::kF32:
+      Int16ToFloat(samples, reinterpret_cast<float*>(output), count);
+      break;
+  }
+}
+
+void WriteSamples(const float* samples, size_t count, SampleFormat format,
+                  uint8_t* output) {
+  switch (format) {
+    case SampleFormat::kS16:
+      FloatToInt16(samples, reinterpret_cast<int16_t*>(output), count);
+      break;
+    case SampleFormat::kS32:
+      FloatToInt32(samples, reinterpret_cast<int32_t*>(output), count);
+      break;
+    case SampleFormat::kF32:
+      std::memcpy(output, samples, count * sizeof(float));
+      break;
+  }
+}
+
+void ResetStats(CaptureStats* stats) {
+  stats->capture.Reset();
+  stats->process.Reset();
+  stats->dispatch.Reset();
+  stats->send.Reset();
+  stats->total.Reset();
+  stats->resample.Reset();
+  stats->source_sample_rate = 0;
+  stats->source_channels = 0;
+  stats->negotiated_latency_us = 0;
+  stats->overruns = 0;
+  stats->gaps = 0;
+  stats->lost_frames = 0;
+  stats->reconnects = 0;
+  stats->dropped_chunks = 0;
+  stats->pool_misses = 0;
+  stats->queue_depth = 0;
+  stats->max_queue_depth = 0;
+  stats->time_to_first_sample_us = 0;
+  stats->time_to_stopped_us = 0;
+}
+
+}  // namespace
+
+bool ParseChannelLayout(const std::string& name, ChannelLayout* layout) {
+  if (name == "mono") {
+    *layout = ChannelLayout::kMono;
+  } else if (name == "interleaved") {
+    *layout = ChannelLayout::kInterleaved;
+  } else if (name == "planar") {
+    *layout = ChannelLayout::kPlanar;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* ChannelLayoutName(ChannelLayout layout) {
+  switch (layout) {
+    case ChannelLayout::kMono:
+      return "mono";
+    case ChannelLayout::kInterleaved:
+      return "interleaved";
+    case ChannelLayout::kPlanar:
+      return "planar";
+  }
+  return "mono";
+}
+
+constexpr size_t CaptureEngine::kChunkQueueCapacity;
+constexpr size_t CaptureEngine::kLevelQueueCapacity;
+constexpr size_t CaptureEngine::kGapQueueCapacity;
+
+std::unique_ptr<CaptureEngine> CaptureEngine::Create() {
+  const int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  return std::unique_ptr<CaptureEngine>(new CaptureEngine(fd));
+}
+
+CaptureEngine::CaptureEngine(int wakeup_fd) : wakeup_fd_(wakeup_fd) {
+  ResetStats(&stats_);
+}
+
+CaptureEngine::~CaptureEngine() {
+  Stop();
+  DestroyQueues();
+  close(wakeup_fd_);
+}
+
+bool CaptureEngine::Start(std::unique_ptr<CaptureSource> source,
+                          const CaptureEngineConfig& config) {
+  if (running()) {
+    return false;
+  }
+
+  DestroyQueues();
+  last_error_.clear();
+
+  if (config.source_format == SampleFormat::kS32) {
+    last_error_ = "Unsupported source sample format";
+    return false;
+  }
+  const bool downmix = config.layout == ChannelLayout::kMono;
+  if (!downmix && config.channels > kMaxCaptureChannels) {
+    last_error_ = "Too many channels to deliver without downmixing";
+    return false;
+  }
+  const size_t output_channels =
+      downmix ? 1 : static_cast<size_t>(config.channels);
+  chunk_pool_ = BufferPool::Create(
+      kChunkPoolSize, config.chunk_frames * output_channels *
+                          BytesPerSample(config.output_format));
+  if (chunk_pool_ == nullptr) {
+    last_error_ = "Failed to allocate audio chunk pool";
+    return false;
+  }
+  chunk_queue_.reset(new SpscRing<ChunkFrame>(
+      kChunkQueueCapacity, ChunkFrame{nullptr, 0, ChunkTiming{0, 0, 0, -1}}));
+  level_queue_.reset(new SpscRing<LevelFrame>(
+      kLevelQueueCapacity,
+      LevelFrame{{0.0, 0.0, -120.0, -120.0}, ChannelLevels{}, 0}));
+  gap_queue_.reset(new SpscRing<CaptureGap>(
+      kGapQueueCapacity, CaptureGap{CaptureGapReason::kSourceSwitch, 0, 0}));
+
+  stop_requested_.store(false);
+  finished_.store(false);
+  wakeup_pending_.store(false);
+  dropped_chunks_.store(0);
+  overruns_.store(0);
+  gaps_.store(0);
+  lost_frames_.store(0);
+  reconnects_.store(0);
+  negotiated_latency_us_.store(0);
+  source_sample_rate_.store(config.source_sample_rate > 0
+                                ? config.source_sample_rate
+                                : config.sample_rate);
+  source_channels_.store(config.channels);
+  max_queue_depth_.store(0);
+  time_to_first_sample_us_.store(0);
+  time_to_stopped_us_ = 0;
+  ResetStats(&stats_);
+  requested_us_.store(config.requested_us != 0 ? config.requested_us
+                                              : MonotonicMicroseconds());
+
+  // An armed session must not capture anything before Resume(), so a source
+  // that cannot pause fails it here rather than streaming early.
+  if (config.start_paused &&
+      (source == nullptr || !source->SetPaused(true))) {
+    last_error_ = "The capture source cannot start paused";
+    DestroyQueues();
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    reopen_source_ = config.reopen_source;
+    paused_ = config.start_paused;
+    active_source_ = source.get();
+  }
+
+  try {
+    thread_ = std::thread(&CaptureEngine::Run, this, std::move(source),
+                          config);
+  } catch (const std::system_error& error) {
+    last_error_ = std::string("Failed to create capture thread: ") +
+                  error.what();
+    {
+      std::lock_guard<std::mutex> lock(pending_mutex_);
+      active_source_ = nullptr;
+      paused_ = false;
+    }
+    DestroyQueues();
+    return false;
+  }
+  return true;
+}
+
+void CaptureEngine::Stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  const int64_t stop_started_us = MonotonicMicroseconds();
+  {
+    // Under the lock, so a reconnect backoff cannot miss the wakeup and the
+    // active source cannot go away while being interrupted.
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    stop_requested_.store(true);
+    if (active_source_ != nullptr) {
+      active_source_->Interrupt();
+    }
+  }
+  wake_.notify_all();
+  thread_.join();
+  // The session is over; a pending exit wakeup must not finish it again.
+  finished_.store(false);
+  TakePendingSource();
+  time_to_stopped_us_ = MonotonicMicroseconds() - stop_started_us;
+}
+
+bool CaptureEngine::SwitchSource(std::unique_ptr<CaptureSource> source,
+                                 CaptureSourceFactory reopen_source) {
+  if (source == nullptr || !running() || finished()) {
+    return false;
+  }
+  // A source handed over earlier but never taken is simply replaced.
+  std::unique_ptr<CaptureSource> replaced;
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    replaced = std::move(pending_source_);
+    pending_source_ = std::move(source);
+    if (reopen_source) {
+      reopen_source_ = std::move(reopen_source);
+    }
+    source_pending_.store(true, std::memory_order_release);
+    // Take over now rather than after the read in progress.
+    if (active_source_ != nullptr) {
+      active_source_->Interrupt();
+    }
+  }
+  wake_.notify_all();
+  return true;
+}
+
+std::unique_ptr<CaptureSource> CaptureEngine::TakePendingSource() {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  source_pending_.store(false, std::memory_order_relaxed);
+  return std::move(pending_source_);
+}
+
+void CaptureEngine::SetActiveSource(CaptureSource* source) {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  active_source_ = source;
+  if (source == nullptr) {
+    return;
+  }
+  if (stop_requested_.load() || source_pending_.load()) {
+    source->Interrupt();
+  } else if (paused_ && !source->SetPaused(true)) {
+    // Not fatal: the session then keeps capturing until resumed.
+    paused_ = false;
+  }
+}
+
+bool CaptureEngine::SetPaused(bool paused) {
+  if (!running() || finished()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  if (paused_ == paused) {
+    return true;
+  }
+  // Resuming an armed session is what starts it, as far as time to first
+  // sample is concerned. Stamped first, as the source may deliver at once.
+  if (!paused && time_to_first_sample_us_.load() == 0) {
+    requested_us_.store(MonotonicMicroseconds());
+  }
+  // Without an active source the session is reconnecting; the new source is
+  // paused as it becomes active.
+  if (active_source_ != nullptr && !active_source_->SetPaused(paused)) {
+    return false;
+  }
+  paused_ = paused;
+  return true;
+}
+
+bool CaptureEngine::paused() const {
+  if (!running()) {
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  return paused_;
+}
+
+void CaptureEngine::Drain(const ChunkHandler& on_chunk,
+                          const LevelHandler& on_level,
+                          const GapHandler& on_gap) {
+  // Clear the eventfd counter. Failing with EAGAIN just means an earlier
+  // drain already did.
+  uint64_t value = 0;
+  const ssize_t cleared = read(wakeup_fd_, &value, sizeof(value));
+  (void)cleared;
+
+  // Re-arm before draining so frames committed meanwhile trigger a new wakeup.
+  wakeup_pending_.store(false);
+
+  if (chunk_queue_ == nullptr) {
+    return;
+  }
+
+  ChunkFrame* frame = nullptr;
+  while ((frame = chunk_queue_->BeginRead()) != nullptr) {
+    const ChunkTiming timing = frame->timing;
+    const int64_t dispatched_us = MonotonicMicroseconds();
+    stats_.capture.Record(timing.acquired_us - timing.captured_us);
+    stats_.process.Record(timing.processed_us - timing.acquired_us);
+    stats_.dispatch.Record(dispatched_us - timing.processed_us);
+    if (timing.resample_us >= 0) {
+      stats_.resample.Record(timing.resample_us);
+    }
+
+    const size_t bytes = frame->bytes;
+    if (on_chunk && bytes > 0) {
+      on_chunk(frame->buffer, bytes);
+      const int64_t sent_us = MonotonicMicroseconds();
+      stats_.send.Record(sent_us - dispatched_us);
+      stats_.total.Record(sent_us - timing.captured_us);
+    } else {
+      ReleaseChunk(frame->buffer);
+    }
+    chunk_queue_->CommitRead();
+  }
+
+  LevelFrame* level = nullptr;
+  while ((level = level_queue_->BeginRead()) != nullptr) {
+    if (on_level) {
+      on_level(level->reading, level->channels, level->timestamp_us);
+    }
+    level_queue_->CommitRead();
+  }
+
+  CaptureGap* gap = nullptr;
+  while ((gap = gap_queue_->BeginRead()) != nullptr) {
+    if (on_gap) {
+      on_gap(*gap);
+    }
+    gap_queue_->CommitRead();
+  }
+}
+
+void CaptureEngine::Run(std::unique_ptr<CaptureSource> source,
+                        CaptureEngineConfig config) {
+  if (!config.thread_name.empty()) {
+    pthread_setname_np(
+        pthread_self(),
+        config.thread_name.substr(0, kMaxThreadNameLength).c_str());
+  }
+
+  const size_t frame_size =
+      BytesPerSample(config.source_format) * config.channels;
+  const bool downmix = config.layout == ChannelLayout::kMono;
+  const size_t output_channels =
+      downmix ? 1 : static_cast<size_t>(config.channels);
+  const size_t output_sample_bytes = BytesPerSample(config.output_format);
+  const size_t output_frame_bytes = output_sample_bytes * output_channels;
+  // Channels kept apart, and audio that comes in or goes out as anything but
+  // int16, are processed in float, so gain and resampling lose nothing to
+  // intermediate rounding.
+  const bool float_path = !downmix ||
+                          config.source_format != SampleFormat::kS16 ||
+                          config.output_format != SampleFormat::kS16;
+  const int source_rate = config.source_sample_rate > 0
+                              ? config.source_sample_rate
+                              : config.sample_rate;
+
+  // Chunk length in processed (mono) frames. Fragments from the source are
+  // processed as they arrive and appended until a full chunk is assembled.
+  const size_t output_frame_count = config.chunk_frames;
+  size_t output_fill = 0;
+
+  // Pool buffer currently being filled. When the pool is exhausted the chunk
+  // is assembled in |overflow_buffer| and dropped.
+  uint8_t* chunk = nullptr;
+  std::vector<uint8_t> overflow_buffer(output_frame_count *
+                                       output_frame_bytes);
+
+  // Fragments are downmixed straight into the chunk when it holds the mix's
+  // own sample type and nothing needs resampling; otherwise they go through
+  // scratch buffers, a block at a time. Channels kept apart are split into
+  // planes and resampled each on their own.
+  std::vector<std::unique_ptr<Resampler>> resamplers;
+  if (source_rate != config.sample_rate) {
+    for (size_t channel = 0; channel < output_channels; ++channel) {
+      resamplers.emplace_back(new Resampler(source_rate, config.sample_rate));
+    }
+  }
+  Resampler* resampler = resamplers.empty() ? nullptr : resamplers[0].get();
+  int64_t chunk_resample_us = 0;
+  const bool mix_into_chunk =
+      downmix && resampler == nullptr &&
+      (!float_path || config.output_format == SampleFormat::kF32);
+  const size_t resampled_block_frames =
+      resampler != nullptr ? resampler->MaxOutputFrames(kProcessBlockFrames)
+                           : 0;
+  std::vector<int16_t> mixed_buffer;
+  std::vector<int16_t> resampled_buffer;
+  std::vector<float> float_input_buffer;
+  std::vector<float> float_mixed_buffer;
+  std::vector<float> float_resampled_buffer;
+  if (!downmix) {
+    float_mixed_buffer.resize(kProcessBlockFrames * output_channels);
+    float_resampled_buffer.resize(resampled_block_frames * output_channels);
+  } else if (!mix_into_chunk && float_path) {
+    float_mixed_buffer.resize(kProcessBlockFrames);
+    float_resampled_buffer.resize(resampled_block_frames);
+  } else if (!mix_into_chunk) {
+    mixed_buffer.resize(kProcessBlockFrames);
+    resampled_buffer.resize(resampled_block_frames);
+  }
+  if (float_path && config.source_format == SampleFormat::kS16) {
+    float_input_buffer.resize(kProcessBlockFrames * config.channels);
+  }
+  const bool blocked = !mix_into_chunk || !float_input_buffer.empty();
+
+  // Planes of the channels kept apart, before and after resampling, and
+  // the frames interleaved from them before conversion to the output format.
+  std::vector<float*> planes;
+  std::vector<float*> resampled_planes;
+  std::vector<const float*> interleave_planes(output_channels);
+  std::vector<float> interleave_buffer;
+  std::vector<float> channel_gains;
+  if (!downmix) {
+    const float scale = std::min(config.input_volume, 1.0f) * config.gain_boost;
+    for (size_t channel = 0; channel < output_channels; ++channel) {
+      planes.push_back(&float_mixed_buffer[channel * kProcessBlockFrames]);
+      resampled_planes.push_back(
+          float_resampled_buffer.data() + channel * resampled_block_frames);
+      channel_gains.push_back(channel < config.channel_gains.size()
+                                  ? scale * config.channel_gains[channel]
+                                  : scale);
+    }
+    if (config.layout == ChannelLayout::kInterleaved &&
+        config.output_format != SampleFormat::kF32) {
+      interleave_buffer.resize(
+          std::max(kProcessBlockFrames, resampled_block_frames) *
+          output_channels);
+    }
+  }
+
+  // Levels are metered before resampling, at the source's rate: the downmix
+  // on one meter, channels kept apart on one each.
+  std::vector<std::unique_ptr<LevelMeter>> meters;
+  for (size_t channel = 0; channel < output_channels; ++channel) {
+    meters.emplace_back(new LevelMeter(source_rate, config.meter_rate_hz));
+  }
+  LevelMeter& meter = *meters.front();
+
+  // Capture and acquire time of the newest frame handed out so far, and
+  // whether the source changed since. The first two size the gap a switch
+  // leaves.
+  int64_t previous_captured_us = 0;
+  int64_t previous_acquired_us = 0;
+  bool source_switched = false;
+  CaptureGapReason switch_reason = CaptureGapReason::kSourceSwitch;
+
+  // Hands the chunk being filled to the consumer, or drops it when the pool
+  // or the queue is exhausted because the consumer is behind.
+  auto emit_chunk = [&](int64_t captured_us, int64_t acquired_us) {
+    const bool pooled = chunk != overflow_buffer.data();
+    ChunkFrame* frame = pooled ? chunk_queue_->BeginWrite() : nullptr;
+
+    if (frame == nullptr) {
+      if (pooled) {
+        ReleaseChunk(chunk);
+      }
+      dropped_chunks_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+      if (config.layout == ChannelLayout::kPlanar &&
+          output_fill < output_frame_count) {
+        // Planes of a short chunk are moved up to follow each other.
+        for (size_t channel = 1; channel < output_channels; ++channel) {
+          std::memmove(
+              chunk + channel * output_fill * output_sample_bytes,
+              chunk + channel * output_frame_count * output_sample_bytes,
+              output_fill * output_sample_bytes);
+        }
+      }
+      frame->buffer = chunk;
+      frame->bytes = output_fill * output_frame_bytes;
+      frame->timing =
+          ChunkTiming{captured_us, acquired_us, MonotonicMicroseconds(),
+                      resampler != nullptr ? chunk_resample_us : -1};
+      // Counted before committing, so the consumer cannot have taken this
+      // chunk already.
+      const size_t depth = chunk_queue_->size() + 1;
+      chunk_queue_->CommitWrite();
+      Notify();
+
+      if (depth > max_queue_depth_.load(std::memory_order_relaxed)) {
+        max_queue_depth_.store(depth, std::memory_order_relaxed);
+      }
+    }
+
+    chunk = nullptr;
+    output_fill = 0;
+    chunk_resample_us = 0;
+  };
+
+  auto acquire_chunk = [&]() {
+    if (chunk == nullptr) {
+      chunk = chunk_pool_->Acquire();
+      if (chunk == nullptr) {
+        chunk = overflow_buffer.data();
+      }
+    }
+  };
+
+  // Appends processed samples to the chunks, converting them to the output
+  // format, and emits every chunk they complete.
+  auto append = [&](const auto* samples, size_t frame_count,
+                    int64_t captured_us, int64_t acquired_us) {
+    while (frame_count > 0) {
+      acquire_chunk();
+      const size_t frames =
+          std::min(frame_count, output_frame_count - output_fill);
+      WriteSamples(samples, frames, config.output_format,
+                   chunk + output_fill * output_sample_bytes);
+      samples += frames;
+      frame_count -= frames;
+      output_fill += frames;
+      if (output_fill == output_frame_count) {
+        emit_chunk(captured_us, acquired_us);
+      }
+    }
+  };
+
+  // Same for channels kept apart, from one plane per channel.
+  auto append_channels = [&](float* const* channel_planes, size_t frame_count,
+                             int64_t captured_us, int64_t acquired_us) {
+    size_t offset = 0;
+    while (offset < frame_count) {
+      acquire_chunk();
+      const size_t frames =
+          std::min(frame_count - offset, output_frame_count - output_fill);
+      if (config.layout == ChannelLayout::kPlanar) {
+        for (size_t channel = 0; channel < output_channels; ++channel) {
+          WriteSamples(channel_planes[channel] + offset, frames,
+                       config.output_format,
+                       chunk + (channel * output_frame_count + output_fill) *
+                                   output_sample_bytes);
+        }
+      } else {
+        for (size_t channel = 0; channel < output_channels; ++channel) {
+          interleave_planes[channel] = channel_planes[channel] + offset;
+        }
+        uint8_t* destination = chunk + output_fill * output_frame_bytes;
+        if (interleave_buffer.empty()) {
+          InterleaveFloat(interleave_planes.data(), frames, config.channels,
+                          reinterpret_cast<float*>(destination));
+        } else {
+          InterleaveFloat(interleave_planes.data(), frames, config.channels,
+                          interleave_buffer.data());
+          WriteSamples(interleave_buffer.data(), frames * output_channels,
+                       config.output_format, destination);
+        }
+      }
+      offset += frames;
+      output_fill += frames;
+      if (output_fill == output_frame_count) {
+        emit_chunk(captured_us, acquired_us);
+      }
+    }
+  };
+
+  // Splits |frame_count| source frames into gain-scaled channel planes,
+  // meters and resamples each, and appends them to the chunks.
+  auto split_channels = [&](const uint8_t* input, size_t frame_count,
+                            bool metering, int64_t captured_us,
+                            int64_t acquired_us) {
+    const float* samples = reinterpret_cast<const float*>(input);
+    if (!float_input_buffer.empty()) {
+      Int16ToFloat(reinterpret_cast<const int16_t*>(input),
+                   float_input_buffer.data(), frame_count * config.channels);
+      samples = float_input_buffer.data();
+    }
+    DeinterleaveFloat(samples, frame_count, config.channels,
+                      channel_gains.data(), planes.data());
+    if (metering) {
+      for (size_t channel = 0; channel < output_channels; ++channel) {
+        MeterFloat(planes[channel], frame_count, meters[channel]->levels());
+      }
+    }
+    if (resampler == nullptr) {
+      append_channels(planes.data(), frame_count, captured_us, acquired_us);
+      return;
+    }
+
+    const int64_t resample_started_us = MonotonicMicroseconds();
+    size_t resampled_frames = 0;
+    for (size_t channel = 0; channel < output_channels; ++channel) {
+      // Every channel's resampler is in the same state, so all produce as
+      // many frames.
+      resampled_frames = resamplers[channel]->Process(
+          planes[channel], frame_count, resampled_planes[channel]);
+    }
+    chunk_resample_us += MonotonicMicroseconds() - resample_started_us;
+    append_channels(resampled_planes.data(), resampled_frames, captured_us,
+                    acquired_us);
+  };
+
+  while (!stop_requested_.load(std::memory_order_relaxed)) {
+    if (source_pending_.load(std::memory_order_acquire)) {
+      std::unique_ptr<CaptureSource> next = TakePendingSource();
+      SetActiveSource(next.get());
+      source = std::move(next);
+      source_switched = true;
+      switch_reason = CaptureGapReason::kSourceSwitch;
+    }
+    if (source == nullptr) {
+      break;
+    }
+
+    const uint8_t* fragment = nullptr;
+    size_t fragment_bytes = 0;
+    const CaptureReadStatus status =
+        source->Acquire(&fragment, &fragment_bytes);
+    if (status != CaptureReadStatus::kOk) {
+      if (source_pending_.load(std::memory_order_acquire)) {
+        continue;  // The replacement takes over from the failed source.
+      }
+      if (stop_requested_.load(std::memory_order_relaxed)) {
+        break;
+      }
+      std::string error_message = source->last_error();
+      if (status == CaptureReadStatus::kDisconnected &&
+          config.max_reconnect_attempts > 0) {
+        // Let go of the dead connection before opening a new one.
+        SetActiveSource(nullptr);
+        source.reset();
+        source = Reconnect(config, &error_message);
+        SetActiveSource(source.get());
+        if (source != nullptr) {
+          source_switched = true;
+          switch_reason = CaptureGapReason::kReconnect;
+          continue;
+        }
+        if (source_pending_.load(std::memory_order_acquire)) {
+          continue;
+        }
+      }
+      last_error_ = error_message;
+      break;
+    }
+    const int64_t acquired_us = MonotonicMicroseconds();
+    const int64_t captured_us = acquired_us - source->fragment_latency_us();
+    if (time_to_first_sample_us_.load(std::memory_order_relaxed) == 0) {
+      time_to_first_sample_us_.store(
+          std::max<int64_t>(acquired_us - requested_us_.load(), 1),
+          std::memory_order_relaxed);
+    }
+    overruns_.store(source->overrun_count(), std::memory_order_relaxed);
+    negotiated_latency_us_.store(source->negotiated_latency_us(),
+                                 std::memory_order_relaxed);
+
+    if (stop_requested_.load(std::memory_order_relaxed)) {
+      source->Release();
+      break;
+    }
+
+    const uint8_t* input = fragment;
+    size_t input_frame_count = fragment_bytes / frame_size;
+
+    if (source_switched) {
+      source_switched = false;
+      // The first frame of this fragment should have followed the last one
+      // from the previous source; anything in between was never captured.
+      const int64_t first_captured_us =
+          captured_us - static_cast<int64_t>(input_frame_count) * 1000000 /
+                            source_rate;
+      const int64_t missing_us = first_captured_us - previous_captured_us;
+      PublishGap(switch_reason,
+                 previous_captured_us > 0 && missing_us > 0
+                     ? static_cast<uint64_t>(missing_us * config.sample_rate /
+                                             1000000)
+                     : 0);
+    }
+    previous_captured_us = captured_us;
+    previous_acquired_us = acquired_us;
+
+    // Levels are only metered while someone listens for them.
+    const bool metering = metering_.load(std::memory_order_relaxed);
+    if (!metering) {
+      for (const std::unique_ptr<LevelMeter>& channel_meter : meters) {
+        channel_meter->Reset();
+      }
+    }
+
+    while (input_frame_count > 0) {
+      size_t frames_to_process = input_frame_count;
+      if (mix_into_chunk) {
+        acquire_chunk();
+        frames_to_process =
+            std::min(frames_to_process, output_frame_count - output_fill);
+      }
+      if (blocked) {
+        frames_to_process = std::min(frames_to_process, kProcessBlockFrames);
+      }
+      if (metering) {
+        // Stop at the end of the metering interval so readings keep their
+        // own rate.
+        frames_to_process =
+            std::min(frames_to_process, meter.frames_until_reading());
+      }
+
+      if (!downmix) {
+        split_channels(input, frames_to_process, metering, captured_us,
+                       acquired_us);
+        if (metering) {
+          PublishLevels(meters, false);
+        }
+        input += frames_to_process * frame_size;
+        input_frame_count -= frames_to_process;
+        continue;
+      }
+
+      // Apply input volume, convert to mono and apply gain boost
+      int16_t* mixed = nullptr;
+      float* mixed_float = nullptr;
+      if (!float_path) {
+        mixed = mix_into_chunk ? reinterpret_cast<int16_t*>(chunk) + output_fill
+                               : mixed_buffer.data();
+        MixToMono(reinterpret_cast<const int16_t*>(input), mixed,
+                  frames_to_process, config.channels, config.input_volume,
+                  config.gain_boost, metering ? meter.levels() : nullptr);
+      } else {
+        const float* samples = reinterpret_cast<const float*>(input);
+        if (!float_input_buffer.empty()) {
+          Int16ToFloat(reinterpret_cast<const int16_t*>(input),
+                       float_input_buffer.data(),
+                       frames_to_process * config.channels);
+          samples = float_input_buffer.data();
+        }
+        mixed_float = mix_into_chunk
+                          ? reinterpret_cast<float*>(chunk) + output_fill
+                          : float_mixed_buffer.data();
+        MixToMonoFloat(samples, mixed_float, frames_to_process,
+                       config.channels, config.input_volume, config.gain_boost,
+                       metering ? meter.levels() : nullptr);
+      }
+      if (metering) {
+        PublishLevels(meters, true);
+      }
+
+      input += frames_to_process * frame_size;
+      input_frame_count -= frames_to_process;
+
+      if (mix_into_chunk) {
+        output_fill += frames_to_process;
+        if (output_fill == output_frame_count) {
+          emit_chunk(captured_us, acquired_us);
+        }
+        continue;
+      }
+      if (resampler == nullptr) {
+        append(mixed_float, frames_to_process, captured_us, acquired_us);
+        continue;
+      }
+
+      const int64_t resample_started_us = MonotonicMicroseconds();
+      if (float_path) {
+        const size_t resampled_frames =
+            resampler->Process(mixed_float, frames_to_process,
+                               float_resampled_buffer.data());
+        chunk_resample_us += MonotonicMicroseconds() - resample_started_us;
+        append(float_resampled_buffer.data(), resampled_frames, captured_us,
+               acquired_us);
+      } else {
+        const size_t resampled_frames = resampler->Process(
+            mixed, frames_to_process, resampled_buffer.data());
+        chunk_resample_us += MonotonicMicroseconds() - resample_started_us;
+        append(resampled_buffer.data(), resampled_frames, captured_us,
+               acquired_us);
+      }
+    }
+
+    source->Release();
+  }
+
+  // Audio already captured is not thrown away on a requested stop; the
+  // consumer gets it as a final, shorter chunk.
+  if (stop_requested_.load() && output_fill > 0 &&
+      chunk != overflow_buffer.data()) {
+    emit_chunk(previous_captured_us, previous_acquired_us);
+  }
+  if (chunk != nullptr && chunk != overflow_buffer.data()) {
+    ReleaseChunk(chunk);
+  }
+
+  SetActiveSource(nullptr);
+  source.reset();
+
+  // Tell the consumer when the session ended without being asked to.
+  if (!stop_requested_.load()) {
+    finished_.store(true, std::memory_order_release);
+    Notify();
+  }
+}
+
+std::unique_ptr<CaptureSource> CaptureEngine::Reconnect(
+    const CaptureEngineConfig& config, std::string* error_message) {
+  int delay_ms = std::max(config.reconnect_delay_ms, 1);
+  for (int attempt = 1; attempt <= config.max_reconnect_attempts; ++attempt) {
+    CaptureSourceFactory reopen_source;
+    {
+      std::unique_lock<std::mutex> lock(pending_mutex_);
+      if (wake_.wait_for(lock, std::chrono::milliseconds(delay_ms), [this] {
+            return stop_requested_.load() || source_pending_.load();
+          })) {
+        return nullptr;
+      }
+      reopen_source = reopen_source_;
+    }
+    if (!reopen_source) {
+      break;
+    }
+
+    std::string attempt_error;
+    std::unique_ptr<CaptureSource> source = reopen_source(&attempt_error);
+    if (source != nullptr) {
+      reconnects_.fetch_add(1, std::memory_order_relaxed);
+      return source;
+    }
+    if (!attempt_error.empty()) {
+      *error_message = attempt_error;
+    }
+    delay_ms = std::min(delay_ms * 2, config.max_reconnect_delay_ms);
+  }
+
+  *error_message += " (gave up reconnecting after " +
+                    std::to_string(config.max_reconnect_attempts) +
+                    " attempts)";
+  return nullptr;
+}
+
+CaptureStats CaptureEngine::stats() const {
+  CaptureStats stats = stats_;
+  stats.negotiated_latency_us =
+      negotiated_latency_us_.load(std::memory_order_relaxed);
+  stats.source_sample_rate = source_sample_rate_.load();
+  stats.source_channels = source_channels_.load();
+  stats.overruns = overruns_.load(std::memory_order_relaxed);
+  stats.gaps = gaps_.load(std::memory_order_relaxed);
+  stats.lost_frames = lost_frames_.load(std::memory_order_relaxed);
+  stats.reconnects = reconnects_.load(std::memory_order_relaxed);
+  stats.dropped_chunks = dropped_chunks();
+  stats.pool_misses = pool_misses();
+  stats.queue_depth = chunk_queue_ != nullptr ? chunk_queue_->size() : 0;
+  stats.max_queue_depth = max_queue_depth_.load(std::memory_order_relaxed);
+  stats.time_to_first_sample_us =
+      time_to_first_sample_us_.load(std::memory_order_relaxed);
+  stats.time_to_stopped_us = time_to_stopped_us_;
+  return stats;
+}
+
+void CaptureEngine::PublishLevels(
+    const std::vector<std::unique_ptr<LevelMeter>>& meters, bool downmix) {
+  LevelReading reading;
+  if (!meters.front()->TakeReading(&reading)) {
+    return;
+  }
+  // Every meter was fed as many frames, so they are all due together.
+  ChannelLevels channels{};
+  if (!downmix) {
+    channels.count = static_cast<int>(meters.size());
+    channels.readings[0] = reading;
+    for (size_t channel = 1; channel < meters.size(); ++channel) {
+      LevelReading& level = channels.readings[channel];
+      meters[channel]->TakeReading(&level);
+      reading.rms = std::max(reading.rms, level.rms);
+      reading.peak = std::max(reading.peak, level.peak);
+      reading.decibel = std::max(reading.decibel, level.decibel);
+      reading.peak_decibel = std::max(reading.peak_decibel, level.peak_decibel);
+    }
+  }
+
+  // When the consumer is this far behind, the reading is stale anyway.
+  LevelFrame* frame = level_queue_->BeginWrite();
+  if (frame == nullptr) {
+    return;
+  }
+  frame->reading = reading;
+  frame->channels = channels;
+  frame->timestamp_us = RealTimeMicroseconds();
+  level_queue_->CommitWrite();
+  Notify();
+}
+
+void CaptureEngine::PublishGap(CaptureGapReason reason,
+                               uint64_t lost_frames) {
+  gaps_.fetch_add(1, std::memory_order_relaxed);
+  lost_frames_.fetch_add(lost_frames, std::memory_order_relaxed);
+
+  // Gaps are rare; if the consumer is this far behind, the counters above
+  // still account for the dropped report.
+  CaptureGap* gap = gap_queue_->BeginWrite();
+  if (gap == nullptr) {
+    return;
+  }
+  gap->reason = reason;
+  gap->lost_frames = lost_frames;
+  gap->timestamp_us = RealTimeMicroseconds();
+  gap_queue_->CommitWrite();
+  Notify();
+}
+
+void CaptureEngine::Notify() {
+  bool expected = false;
+  if (!wakeup_pending_.compare_exchange_strong(expected, true)) {
+    return;  // A wakeup is already on its way.
+  }
+  const uint64_t value = 1;
+  if (write(wakeup_fd_, &value, sizeof(value)) < 0) {
+    wakeup_pending_.store(false);
+  }
+}
+
+void CaptureEngine::DestroyQueues() {
+  if (chunk_queue_ != nullptr) {
+    // Return chunks that were never drained.
+    ChunkFrame* frame = nullptr;
+    while ((frame = chunk_queue_->BeginRead()) != nullptr) {
+      ReleaseChunk(frame->buffer);
+      chunk_queue_->CommitRead();
+    }
+    chunk_queue_.reset();
+  }
+
+  level_queue_.reset();
+  gap_queue_.reset();
+
+  if (chunk_pool_ != nullptr) {
+    chunk_pool_->Unref();
+    chunk_pool_ = nullptr;
+  }
+}
+
+}  // namespace audio_capture
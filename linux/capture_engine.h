@@ -0,0 +1,373 @@
+#ifndef FLUTTER_PLUGIN_CAPTURE_ENGINE_H_
+#define FLUTTER_PLUGIN_CAPTURE_ENGINE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "capture_source.h"
+#include "latency_histogram.h"
+#include "level_meter.h"
+#include "spsc_ring.h"
+
+namespace audio_capture {
+
+// Most channels a session delivers without downmixing.
+constexpr int kMaxCaptureChannels = 8;
+
+// How the session's channels are laid out in the emitted chunks.
+enum class ChannelLayout {
+  // Downmixed to a single channel.
+  kMono,
+  // Every source channel, frame by frame.
+  kInterleaved,
+  // Every source channel, one after another: a chunk of N frames holds the
+  // N samples of the first channel, then the N of the second, and so on.
+  kPlanar,
+};
+
+// Parses the "channelLayout" startCapture argument ("mono", "interleaved" or
+// "planar"). Returns false for anything else.
+bool ParseChannelLayout(const std::string& name, ChannelLayout* layout);
+const char* ChannelLayoutName(ChannelLayout layout);
+
+// Levels of each channel of a session that is not downmixed.
+struct ChannelLevels {
+  // 0 when the session is downmixed.
+  int count;
+  LevelReading readings[kMaxCaptureChannels];
+};
+
+struct CaptureEngineConfig {
+  // Rate of the emitted chunks.
+  int sample_rate;
+  // Rate the source delivers at; 0 when it delivers |sample_rate|. Anything
+  // else is resampled on the capture thread after the downmix.
+  int source_sample_rate = 0;
+  // Channels delivered by the source. Chunks have as many unless |layout|
+  // downmixes them to mono; at most kMaxCaptureChannels then.
+  int channels;
+  ChannelLayout layout = ChannelLayout::kMono;
+  // Gain for each source channel, applied on top of |gain_boost| when the
+  // channels are kept apart. Missing entries are 1.
+  std::vector<float> channel_gains;
+  // Encoding the source delivers, kS16 or kF32.
+  SampleFormat source_format = SampleFormat::kS16;
+  // Encoding of the emitted chunks. Unless both this and |source_format| are
+  // kS16, audio is mixed, resampled and gain-boosted in float and only
+  // converted, and clipped if need be, when written into a chunk.
+  SampleFormat output_format = SampleFormat::kS16;
+  // Length of one emitted chunk, in frames of the output channels.
+  size_t chunk_frames;
+  float gain_boost;
+  float input_volume;
+  double meter_rate_hz;
+  // Name of the capture thread, truncated to what the kernel accepts.
+  std::string thread_name;
+
+  // Reopens the source when it reports kDisconnected, on the capture thread.
+  // Without one a disconnect ends the session.
+  CaptureSourceFactory reopen_source;
+  // Attempts before the session gives up, waiting |reconnect_delay_ms| before
+  // the first and twice as long before each following one, up to
+  // |max_reconnect_delay_ms|.
+  int max_reconnect_attempts = 0;
+  int reconnect_delay_ms = 50;
+  int max_reconnect_delay_ms = 2000;
+
+  // Steady-clock time, in microseconds, the caller began setting the session
+  // up, typically before opening the source. Time to first sample counts
+  // from here; 0 counts from Start().
+  int64_t requested_us = 0;
+
+  // Arms the session instead of starting it: the source is paused before the
+  // capture thread first reads, so everything is set up and Resume() starts
+  // the flow of audio. Time to first sample then counts from Resume().
+  bool start_paused = false;
+};
+
+// Why audio is missing from the chunk stream.
+enum class CaptureGapReason {
+  // The session moved to another source.
+  kSourceSwitch,
+  // The source was disconnected and has been reopened.
+  kReconnect,
+};
+
+// A stretch of audio the device captured that never made it into a chunk.
+struct CaptureGap {
+  CaptureGapReason reason;
+  // Mono frames lost, estimated from the capture timestamps on either side.
+  uint64_t lost_frames;
+  // Wall-clock time the gap was detected, in microseconds.
+  int64_t timestamp_us;
+};
+
+// Where chunks spend their time between the device and the consumer, and what
+// was lost on the way. Each histogram holds one duration per chunk, in
+// microseconds.
+struct CaptureStats {
+  // Device and sound server buffering, up to the fragment that completed the
+  // chunk being acquired.
+  LatencyHistogram capture;
+  // Acquired until mixed, metered and queued for the consumer.
+  LatencyHistogram process;
+  // Queued until the consumer picked the chunk up.
+  LatencyHistogram dispatch;
+  // Time the ChunkHandler took to deliver the chunk.
+  LatencyHistogram send;
+  // Captured until delivered.
+  LatencyHistogram total;
+  // Part of |process| spent resampling the chunk's audio. Empty when the
+  // source delivers the session's rate.
+  LatencyHistogram resample;
+
+  // Rate the source delivers at, which chunks are resampled from when it is
+  // not the session's.
+  int source_sample_rate;
+  // Channels the source delivers, before any downmix.
+  int source_channels;
+
+  // Buffering the source negotiated with the sound server.
+  int64_t negotiated_latency_us;
+  uint64_t overruns;
+  // Gaps in the chunk stream and the mono frames lost in them.
+  uint64_t gaps;
+  uint64_t lost_frames;
+  // Times a disconnected source was reopened.
+  uint64_t reconnects;
+  uint64_t dropped_chunks;
+  uint64_t pool_misses;
+  // Chunks waiting for the consumer now, and the most ever waiting.
+  size_t queue_depth;
+  size_t max_queue_depth;
+
+  // From the session being requested until the source delivered its first
+  // fragment; 0 until it has.
+  int64_t time_to_first_sample_us;
+  // How long the last Stop() took until the stream was torn down; 0 while
+  // the session runs.
+  int64_t time_to_stopped_us;
+};
+
+// The capture pipeline shared by the Linux plugins, free of any GLib or
+// Flutter dependency.
+//
+// A capture thread pulls fragments from a CaptureSource, mixes them to mono
+// or splits them into channels, meters them, resamples them when the source
+// runs at another rate and assembles fixed-size chunks in the requested
+// sample format and channel layout. Chunks and meter readings are handed to
+// the consumer thread through lock-free rings; wakeup_fd() becomes readable
+// whenever there is something to Drain(), and once more when the capture
+// thread exits on its own.
+//
+// A source that reports kDisconnected is reopened through the configured
+// factory with exponential backoff; the session, its counters and queues
+// live on and the outage is reported as a gap.
+//
+// Every method must be called from the consumer thread.
+class CaptureEngine {
+ public:
+  static constexpr size_t kChunkQueueCapacity = 16;
+  static constexpr size_t kLevelQueueCapacity = 16;
+  static constexpr size_t kGapQueueCapacity = 8;
+
+  // Receives ownership of a chunk of |bytes| bytes of audio in the session's
+  // output format and channel layout, which must eventually be returned with
+  // ReleaseChunk().
+  using ChunkHandler = std::function<void(uint8_t* buffer, size_t bytes)>;
+  // |reading| is the level of the downmix, or of the loudest channel when
+  // the channels are kept apart; |channels| then has each channel's level.
+  using LevelHandler =
+      std::function<void(const LevelReading& reading,
+                         const ChannelLevels& channels, int64_t timestamp_us)>;
+  using GapHandler = std::function<void(const CaptureGap& gap)>;
+
+  // Returns nullptr when the wakeup eventfd cannot be created.
+  static std::unique_ptr<CaptureEngine> Create();
+
+  ~CaptureEngine();
+
+  CaptureEngine(const CaptureEngine&) = delete;
+  CaptureEngine& operator=(const CaptureEngine&) = delete;
+
+  // Starts capturing from |source|. Whatever the previous session left
+  // undrained is discarded. Returns false when a session is already running,
+  // or with last_error() set when the session cannot be set up.
+  bool Start(std::unique_ptr<CaptureSource> source,
+             const CaptureEngineConfig& config);
+
+  // Stops the capture thread and waits for it. A read in progress is
+  // interrupted rather than waited out, and the partial chunk assembled so
+  // far is queued as a final, shorter chunk. Chunks queued before exiting
+  // can still be drained afterwards.
+  void Stop();
+
+  // Hands the running session a new source with the same format. The capture
+  // thread takes it over once the fragment in flight is done, or as soon as
+  // the old source fails; chunk assembly, counters and queues carry on, and
+  // whatever the old source never delivered is reported as a gap. Returns
+  // false when no session is running.
+  // A non-empty |reopen_source| replaces the factory used to reconnect from
+  // then on, so a disconnect reopens the new device rather than the old one.
+  bool SwitchSource(
+      std::unique_ptr<CaptureSource> source,
+      CaptureSourceFactory reopen_source = CaptureSourceFactory());
+
+  // Stops the flow of audio without tearing the session down: the source is
+  // corked and the capture thread sleeps in its read. Chunk assembly,
+  // metering and counters carry on from where they were on Resume(), and the
+  // pause is not reported as a gap. Returns false when no session is running
+  // or the source cannot pause.
+  bool Pause() { return SetPaused(true); }
+  bool Resume() { return SetPaused(false); }
+
+  // True while a running session is paused.
+  bool paused() const;
+
+  // Delivers every queued chunk, reading and gap. Without an |on_chunk|
+  // handler chunks are released straight away; without |on_level| or
+  // |on_gap| readings and gaps are dropped.
+  void Drain(const ChunkHandler& on_chunk, const LevelHandler& on_level,
+             const GapHandler& on_gap = GapHandler());
+
+  // Returns a chunk given to a ChunkHandler. Has the signature of a
+  // GDestroyNotify so it can be handed to GLib directly.
+  static void ReleaseChunk(void* buffer) { BufferPool::ReleaseBuffer(buffer); }
+
+  int wakeup_fd() const { return wakeup_fd_; }
+
+  // Levels are only metered while enabled. Takes effect at the next fragment.
+  void set_metering(bool enabled) {
+    metering_.store(enabled, std::memory_order_relaxed);
+  }
+
+  // True while a session is started and not yet stopped.
+  bool running() const { return thread_.joinable(); }
+
+  // True once the capture thread has exited on its own, typically because the
+  // source failed. The session still has to be Stop()ped.
+  bool finished() const { return finished_.load(std::memory_order_acquire); }
+
+  // Reason the last session failed to start or ended on its own. Only valid
+  // when not running(), or once finished().
+  const std::string& last_error() const { return last_error_; }
+
+  // Chunks dropped in the current or last session because the consumer fell
+  // behind.
+  uint64_t dropped_chunks() const {
+    return dropped_chunks_.load(std::memory_order_relaxed);
+  }
+  uint64_t pool_misses() const {
+    return chunk_pool_ != nullptr ? chunk_pool_->exhausted_count() : 0;
+  }
+
+  // Latency and loss accounting of the current or last session. Stamping
+  // costs a few clock reads per chunk, so it is always on.
+  CaptureStats stats() const;
+
+ private:
+  // Monotonic timestamps of one chunk, in microseconds.
+  struct ChunkTiming {
+    int64_t captured_us;
+    int64_t acquired_us;
+    int64_t processed_us;
+    // Time spent resampling the chunk, or -1 when it was not resampled.
+    int64_t resample_us;
+  };
+
+  // One processed chunk. |buffer| comes from the session's chunk pool and
+  // goes back to it once the consumer is done with the chunk.
+  struct ChunkFrame {
+    uint8_t* buffer;
+    size_t bytes;
+    ChunkTiming timing;
+  };
+
+  // One meter reading. Readings are published at the meter rate, independent
+  // of the chunk size.
+  struct LevelFrame {
+    LevelReading reading;
+    ChannelLevels channels;
+    int64_t timestamp_us;
+  };
+
+  explicit CaptureEngine(int wakeup_fd);
+
+  void Run(std::unique_ptr<CaptureSource> source, CaptureEngineConfig config);
+  std::unique_ptr<CaptureSource> TakePendingSource();
+  // Makes |source| the one Stop() and SwitchSource() interrupt, interrupting
+  // it straight away if either already happened.
+  void SetActiveSource(CaptureSource* source);
+  bool SetPaused(bool paused);
+  // Reopens the source with backoff. Returns nullptr with |error_message|
+  // set once the attempts run out, or early when the session is stopped or
+  // handed a new source.
+  std::unique_ptr<CaptureSource> Reconnect(const CaptureEngineConfig& config,
+                                           std::string* error_message);
+  // Publishes a reading once |meters|, one per output channel and fed in
+  // lockstep, complete their interval.
+  void PublishLevels(const std::vector<std::unique_ptr<LevelMeter>>& meters,
+                     bool downmix);
+  void PublishGap(CaptureGapReason reason, uint64_t lost_frames);
+  void Notify();
+  void DestroyQueues();
+
+  const int wakeup_fd_;
+
+  std::thread thread_;
+  std::atomic<bool> stop_requested_{false};
+  std::atomic<bool> finished_{false};
+  std::atomic<bool> metering_{false};
+  std::atomic<bool> wakeup_pending_{false};
+  std::atomic<uint64_t> dropped_chunks_{0};
+  std::atomic<uint64_t> overruns_{0};
+  std::atomic<uint64_t> gaps_{0};
+  std::atomic<uint64_t> lost_frames_{0};
+  std::atomic<uint64_t> reconnects_{0};
+  std::atomic<int64_t> negotiated_latency_us_{0};
+  std::atomic<int> source_sample_rate_{0};
+  std::atomic<int> source_channels_{0};
+  std::atomic<size_t> max_queue_depth_{0};
+  std::atomic<int64_t> time_to_first_sample_us_{0};
+  // When the session was requested, or resumed from being armed.
+  std::atomic<int64_t> requested_us_{0};
+  // Written by Stop() only.
+  int64_t time_to_stopped_us_ = 0;
+
+  std::unique_ptr<SpscRing<ChunkFrame>> chunk_queue_;
+  std::unique_ptr<SpscRing<LevelFrame>> level_queue_;
+  std::unique_ptr<SpscRing<CaptureGap>> gap_queue_;
+  BufferPool* chunk_pool_ = nullptr;
+
+  // Source handed over by SwitchSource() and not yet taken by the capture
+  // thread, and the factory reconnects go through. |wake_| interrupts a
+  // reconnect backoff for a stop or a new source. |active_source_| is the
+  // source the capture thread reads from, owned by that thread.
+  // Also guards |paused_|.
+  mutable std::mutex pending_mutex_;
+  std::condition_variable wake_;
+  std::unique_ptr<CaptureSource> pending_source_;
+  CaptureSource* active_source_ = nullptr;
+  // Applied to every source that becomes active.
+  bool paused_ = false;
+  CaptureSourceFactory reopen_source_;
+  std::atomic<bool> source_pending_{false};
+
+  // Written by Drain() only.
+  CaptureStats stats_;
+
+  std::string last_error_;
+};
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_CAPTURE_ENGINE_H_
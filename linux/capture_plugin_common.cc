@@ -0,0 +1,611 @@
+#include "capture_plugin_common.h"
+
+#include <glib-object.h>
+#include <glib-unix.h>
+
+#include <algorithm>
+#include <cinttypes>
+#include <utility>
+
+#include "capture_stats_value.h"
+
+namespace audio_capture {
+
+namespace {
+
+constexpr double kMaxMeterRateHz = 120.0;
+constexpr int kFragmentDurationMs = 20;
+constexpr int kMinTargetLatencyMs = 5;
+constexpr int kMaxTargetLatencyMs = 500;
+// With the engine's backoff this keeps retrying for about 15 s, long enough
+// for the sound server to restart.
+constexpr int kMaxReconnectAttempts = 12;
+
+}  // namespace
+
+CaptureArguments ParseCaptureArguments(FlValue* args) {
+  CaptureArguments arguments;
+
+  if (args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    FlValue* value = nullptr;
+
+    value = fl_value_lookup_string(args, "sampleRate");
+    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_INT) {
+      arguments.sample_rate = fl_value_get_int(value);
+    }
+
+    value = fl_value_lookup_string(args, "channels");
+    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_INT) {
+      arguments.channels = fl_value_get_int(value);
+    }
+
+    value = fl_value_lookup_string(args, "chunkDurationMs");
+    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_INT) {
+      arguments.chunk_duration_ms = fl_value_get_int(value);
+    }
+
+    value = fl_value_lookup_string(args, "gainBoost");
+    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_FLOAT) {
+      arguments.gain_boost = fl_value_get_float(value);
+    }
+
+    value = fl_value_lookup_string(args, "inputVolume");
+    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_FLOAT) {
+      arguments.input_volume = fl_value_get_float(value);
+    }
+
+    value = fl_value_lookup_string(args, "meterRateHz");
+    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_FLOAT) {
+      arguments.meter_rate_hz = fl_value_get_float(value);
+    } else if (value != nullptr &&
+               fl_value_get_type(value) == FL_VALUE_TYPE_INT) {
+      arguments.meter_rate_hz = static_cast<double>(fl_value_get_int(value));
+    }
+
+    value = fl_value_lookup_string(args, "targetLatencyMs");
+    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_INT) {
+      arguments.target_latency_ms = fl_value_get_int(value);
+    }
+
+    value = fl_value_lookup_string(args, "backend");
+    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_STRING &&
+        !ParseCaptureBackend(fl_value_get_string(value), &arguments.backend)) {
+      g_warning("Unknown capture backend '%s', using auto",
+                fl_value_get_string(value));
+    }
+
+    value = fl_value_lookup_string(args, "deviceId");
+    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_STRING) {
+      arguments.device_id = fl_value_get_string(value);
+    }
+
+    value = fl_value_lookup_string(args, "nativeFormat");
+    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_BOOL) {
+      arguments.native_format = fl_value_get_bool(value);
+    }
+
+    value = fl_value_lookup_string(args, "sampleFormat");
+    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_STRING &&
+        !ParseSampleFormat(fl_value_get_string(value),
+                           &arguments.sample_format)) {
+      g_warning("Unknown sample format '%s', using int16",
+                fl_value_get_string(value));
+    }
+
+    value = fl_value_lookup_string(args, "channelLayout");
+    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_STRING &&
+        !ParseChannelLayout(fl_value_get_string(value),
+                            &arguments.channel_layout)) {
+      g_warning("Unknown channel layout '%s', using mono",
+                fl_value_get_string(value));
+    }
+
+    arguments.channel_gains =
+        ChannelGainsFromValue(fl_value_lookup_string(args, "channelGains"));
+  }
+
+  arguments.sample_rate = std::max(arguments.sample_rate, 8000);
+  // The downmix only uses the first two channels, so more are not recorded.
+  arguments.channels = std::max(
+      1, std::min(arguments.channels,
+                  arguments.channel_layout == ChannelLayout::kMono
+                      ? 2
+                      : kMaxCaptureChannels));
+  arguments.capture_format = arguments.sample_format == SampleFormat::kS16
+                                 ? SampleFormat::kS16
+                                 : SampleFormat::kF32;
+  arguments.chunk_duration_ms = std::max(arguments.chunk_duration_ms, 10);
+  arguments.gain_boost = std::max(0.1f, std::min(10.0f, arguments.gain_boost));
+  arguments.input_volume =
+      std::max(0.0f, std::min(1.0f, arguments.input_volume));
+  arguments.meter_rate_hz =
+      std::max(1.0, std::min(kMaxMeterRateHz, arguments.meter_rate_hz));
+  if (arguments.target_latency_ms > 0) {
+    arguments.target_latency_ms =
+        std::max(kMinTargetLatencyMs,
+                 std::min(kMaxTargetLatencyMs, arguments.target_latency_ms));
+  }
+  return arguments;
+}
+
+void ConfigureCapture(const CaptureArguments& arguments, size_t chunk_frames,
+                      CaptureSourceConfig* source_config,
+                      CaptureEngineConfig* engine_config) {
+  const size_t frame_size = BytesPerSample(arguments.capture_format) *
+                            static_cast<size_t>(arguments.channels);
+  // A latency target shrinks the server's transfers and device buffering;
+  // chunks sent to Dart keep their own size either way.
+  const int fragment_duration_ms = arguments.target_latency_ms > 0
+                                       ? arguments.target_latency_ms
+                                       : kFragmentDurationMs;
+  const size_t fragment_frames = std::max<size_t>(
+      static_cast<size_t>(arguments.sample_rate) * fragment_duration_ms / 1000,
+      1);
+
+  source_config->sample_rate = arguments.sample_rate;
+  source_config->channels = arguments.channels;
+  source_config->format = arguments.capture_format;
+  source_config->fragment_bytes =
+      std::min(fragment_frames, chunk_frames) * frame_size;
+  source_config->max_buffer_bytes = chunk_frames * frame_size * 4;
+  source_config->adjust_latency = arguments.target_latency_ms > 0;
+
+  engine_config->sample_rate = arguments.sample_rate;
+  engine_config->source_format = arguments.capture_format;
+  engine_config->output_format = arguments.sample_format;
+  engine_config->layout = arguments.channel_layout;
+  engine_config->channel_gains = arguments.channel_gains;
+  engine_config->chunk_frames = chunk_frames;
+  engine_config->gain_boost = arguments.gain_boost;
+  engine_config->input_volume = arguments.input_volume;
+  engine_config->meter_rate_hz = arguments.meter_rate_hz;
+  engine_config->max_reconnect_attempts = kMaxReconnectAttempts;
+}
+
+void RespondBool(FlMethodCall* method_call, bool result) {
+  g_autoptr(FlValue) value = fl_value_new_bool(result);
+  g_autoptr(FlMethodResponse) response =
+      FL_METHOD_RESPONSE(fl_method_success_response_new(value));
+  g_autoptr(GError) error = nullptr;
+  if (!fl_method_call_respond(method_call, response, &error)) {
+    g_warning("Failed to send method call response: %s", error->message);
+  }
+}
+
+CaptureSession::CaptureSession(GObject* owner, GMainContext* context)
+    : owner_(owner),
+      main_context_(g_main_context_ref(context)),
+      engine_(CaptureEngine::Create()) {
+  if (engine_ == nullptr) {
+    g_warning("Failed to create capture engine");
+    return;
+  }
+
+  // The source is destroyed with the session, so it does not need to hold a
+  // reference.
+  engine_source_ = g_unix_fd_source_new(engine_->wakeup_fd(), G_IO_IN);
+  g_source_set_callback(engine_source_, G_SOURCE_FUNC(OnEngineReady), this,
+                        nullptr);
+  g_source_attach(engine_source_, main_context_);
+}
+
+CaptureSession::~CaptureSession() {
+  if (engine_source_ != nullptr) {
+    g_source_destroy(engine_source_);
+    g_source_unref(engine_source_);
+    engine_source_ = nullptr;
+  }
+  engine_.reset();
+
+  for (FlEventChannel** channel :
+       {&audio_channel_, &status_channel_, &decibel_channel_}) {
+    if (*channel != nullptr) {
+      fl_event_channel_set_stream_handlers(*channel, nullptr, nullptr, nullptr,
+                                           nullptr);
+      g_clear_object(channel);
+    }
+  }
+
+  g_main_context_unref(main_context_);
+}
+
+void CaptureSession::RegisterChannels(FlBinaryMessenger* messenger,
+                                      FlMethodCodec* codec,
+                                      const char* audio_name,
+                                      const char* status_name,
+                                      const char* decibel_name) {
+  // The handlers are detached before the session goes away, so they do not
+  // need to hold a reference.
+  audio_channel_ = fl_event_channel_new(messenger, audio_name, codec);
+  fl_event_channel_set_stream_handlers(audio_channel_, OnAudioListen,
+                                       OnAudioCancel, this, nullptr);
+
+  status_channel_ = fl_event_channel_new(messenger, status_name, codec);
+  fl_event_channel_set_stream_handlers(status_channel_, OnStatusListen,
+                                       OnStatusCancel, this, nullptr);
+
+  decibel_channel_ = fl_event_channel_new(messenger, decibel_name, codec);
+  fl_event_channel_set_stream_handlers(decibel_channel_, OnDecibelListen,
+                                       OnDecibelCancel, this, nullptr);
+}
+
+bool CaptureSession::StartWithoutOpening(FlMethodCall* method_call,
+                                         bool armed) {
+  if (engine_ == nullptr) {
+    g_warning("Capture engine is unavailable");
+    RespondBool(method_call, false);
+    return true;
+  }
+  if (!armed && is_armed_ && is_starting_) {
+    // Uncorked as soon as the armed session is up.
+    is_armed_ = false;
+    pending_start_call_ = static_cast<FlMethodCall*>(g_object_ref(method_call));
+    return true;
+  }
+  if (!armed && is_armed_ && engine_->running()) {
+    RespondBool(method_call, StartArmedCapture());
+    return true;
+  }
+  return false;
+}
+
+void CaptureSession::Open(FlMethodCall* method_call, bool armed,
+                          CaptureEngineConfig config, CaptureBackend backend,
+                          std::function<CaptureSourceOpening()> open,
+                          ReopenFactoryMaker make_reopen,
+                          StartedHandler on_started) {
+  if (is_capturing_) {
+    RespondBool(method_call, false);
+    return;
+  }
+  is_capturing_ = true;
+  is_starting_ = true;
+  is_armed_ = armed;
+  const guint generation = ++start_generation_;
+  SendStatus();
+
+  OpenCaptureSourceAsync(
+      main_context_, std::move(open),
+      [this, owner = G_OBJECT(g_object_ref(owner_)), generation,
+       call = static_cast<FlMethodCall*>(g_object_ref(method_call)), config,
+       backend, make_reopen,
+       on_started](CaptureSourceOpening opening) {
+        FinishOpen(generation, call, config, backend, std::move(opening),
+                   make_reopen, on_started);
+        g_object_unref(owner);
+      });
+}
+
+void CaptureSession::FinishOpen(guint generation, FlMethodCall* method_call,
+                                CaptureEngineConfig config,
+                                CaptureBackend backend,
+                                CaptureSourceOpening opening,
+                                const ReopenFactoryMaker& make_reopen,
+                                const StartedHandler& on_started) {
+  if (generation != start_generation_) {
+    // Stopped or restarted while opening; dropping the source closes the
+    // stream.
+    RespondBool(method_call, false);
+    g_object_unref(method_call);
+    return;
+  }
+  is_starting_ = false;
+  FlMethodCall* start_call = pending_start_call_;
+  pending_start_call_ = nullptr;
+
+  // Only the first stream of an armed session connects corked; reopened ones
+  // follow the session's state.
+  CaptureSourceConfig reopen_config = opening.config;
+  reopen_config.start_paused = false;
+
+  bool started = opening.source != nullptr;
+  if (!started) {
+    g_warning("Failed to open %s capture stream: %s",
+              CaptureBackendName(backend), opening.error_message.c_str());
+  } else {
+    g_debug("Capturing through %s at %d Hz, %d channels, as %s %s",
+            CaptureBackendName(opening.backend), opening.config.sample_rate,
+            opening.config.channels, ChannelLayoutName(config.layout),
+            SampleFormatName(config.output_format));
+
+    config.source_sample_rate = opening.config.sample_rate;
+    config.channels = opening.config.channels;
+    config.start_paused = opening.config.start_paused;
+    config.reopen_source = make_reopen(opening.backend, reopen_config);
+
+    started = engine_->Start(std::move(opening.source), config);
+    if (!started) {
+      g_warning("Failed to start capture: %s", engine_->last_error().c_str());
+    }
+  }
+
+  if (!started) {
+    is_capturing_ = false;
+    is_armed_ = false;
+    if (on_end_) {
+      on_end_();
+    }
+    SendStatus();
+  } else {
+    backend_ = opening.backend;
+    if (on_started) {
+      on_started(reopen_config);
+    }
+    if (is_armed_) {
+      g_debug("Capture armed");
+      SendStatus();
+    } else if (config.start_paused) {
+      // A startCapture came in while the armed session was opening. The
+      // armCapture itself still succeeded.
+      RespondBool(method_call, true);
+      g_object_unref(method_call);
+      method_call = start_call;
+      start_call = nullptr;
+      started = StartArmedCapture();
+    } else {
+      SendStatus();
+    }
+  }
+
+  RespondBool(method_call, started);
+  g_object_unref(method_call);
+  if (start_call != nullptr) {
+    RespondBool(start_call, false);
+    g_object_unref(start_call);
+  }
+}
+
+bool CaptureSession::StartArmedCapture() {
+  is_armed_ = false;
+  if (!engine_->Resume()) {
+    g_warning("Failed to start armed capture");
+    EndCapture();
+    if (on_end_) {
+      on_end_();
+    }
+    SendStatus();
+    return false;
+  }
+  SendStatus();
+  return true;
+}
+
+bool CaptureSession::SetPaused(bool paused) {
+  if (engine_ == nullptr || !engine_->running()) {
+    g_warning("Cannot %s capture: not capturing", paused ? "pause" : "resume");
+    return false;
+  }
+  if (!(paused ? engine_->Pause() : engine_->Resume())) {
+    g_warning("Failed to %s capture", paused ? "pause" : "resume");
+    return false;
+  }
+  SendStatus();
+  return true;
+}
+
+bool CaptureSession::Stop() {
+  if (!is_capturing_) {
+    return false;
+  }
+
+  if (is_starting_) {
+    // Nothing is running yet; the open in flight is dropped when it lands.
+    start_generation_++;
+    is_starting_ = false;
+    RespondPendingStart(false);
+    is_capturing_ = false;
+    is_armed_ = false;
+  } else {
+    // EndCapture() returns once the stream is torn down; the engine's stats
+    // report how long that took.
+    EndCapture();
+  }
+
+  if (on_end_) {
+    on_end_();
+  }
+  SendStatus();
+  return true;
+}
+
+void CaptureSession::RespondPendingStart(bool result) {
+  if (pending_start_call_ != nullptr) {
+    RespondBool(pending_start_call_, result);
+    g_clear_object(&pending_start_call_);
+  }
+}
+
+void CaptureSession::SendStatus(FlValue* gap) {
+  g_autoptr(FlValue) gap_value = gap;
+  if (!has_status_listener_ || status_channel_ == nullptr) {
+    return;
+  }
+
+  g_autoptr(FlValue) status_map = fl_value_new_map();
+  fl_value_set_string_take(
+      status_map, "isActive",
+      fl_value_new_bool(is_capturing_ && !is_armed_ && !is_starting_));
+  fl_value_set_string_take(status_map, "isStarting",
+                           fl_value_new_bool(is_starting_));
+  fl_value_set_string_take(
+      status_map, "isPaused",
+      fl_value_new_bool(engine_ != nullptr && engine_->paused()));
+  fl_value_set_string_take(status_map, "timestamp",
+                           fl_value_new_float(g_get_real_time() / 1000000.0));
+  if (extend_status_) {
+    extend_status_(status_map);
+  }
+  if (gap_value != nullptr) {
+    fl_value_set_string_take(status_map, "gap", g_steal_pointer(&gap_value));
+  }
+
+  g_autoptr(GError) error = nullptr;
+  fl_event_channel_send(status_channel_, status_map, nullptr, &error);
+}
+
+void CaptureSession::Drain() {
+  CaptureEngine::ChunkHandler on_chunk;
+  if (audio_channel_ != nullptr && has_audio_listener_) {
+    on_chunk = [this](uint8_t* buffer, size_t length) {
+      // The pooled buffer is returned when the last reference is dropped.
+      g_autoptr(GBytes) bytes = g_bytes_new_with_free_func(
+          buffer, length, CaptureEngine::ReleaseChunk, buffer);
+      g_autoptr(FlValue) value = fl_value_new_uint8_list_from_bytes(bytes);
+      g_autoptr(GError) error = nullptr;
+
+      if (!fl_event_channel_send(audio_channel_, value, nullptr, &error)) {
+        g_warning("Failed to send audio chunk: %s",
+                  error != nullptr ? error->message : "unknown error");
+      }
+    };
+  }
+
+  CaptureEngine::LevelHandler on_level;
+  if (decibel_channel_ != nullptr && has_decibel_listener_) {
+    on_level = [this](const LevelReading& reading,
+                      const ChannelLevels& channels, int64_t timestamp_us) {
+      g_autoptr(FlValue) decibel_map = fl_value_new_map();
+      fl_value_set_string_take(decibel_map, "decibel",
+                               fl_value_new_float(reading.decibel));
+      fl_value_set_string_take(decibel_map, "peakDecibel",
+                               fl_value_new_float(reading.peak_decibel));
+      fl_value_set_string_take(decibel_map, "rms",
+                               fl_value_new_float(reading.rms));
+      fl_value_set_string_take(decibel_map, "peak",
+                               fl_value_new_float(reading.peak));
+      fl_value_set_string_take(decibel_map, "timestamp",
+                               fl_value_new_float(timestamp_us / 1000000.0));
+      if (channels.count > 0) {
+        fl_value_set_string_take(decibel_map, "channels",
+                                 ChannelLevelsToValue(channels));
+      }
+
+      g_autoptr(GError) error = nullptr;
+      if (!fl_event_channel_send(decibel_channel_, decibel_map, nullptr,
+                                 &error)) {
+        g_warning("Failed to send decibel data: %s",
+                  error != nullptr ? error->message : "unknown error");
+      }
+    };
+  }
+
+  engine_->Drain(on_chunk, on_level, [this](const CaptureGap& gap) {
+    g_debug("Audio gap of %" PRIu64 " samples", gap.lost_frames);
+    SendStatus(CaptureGapToValue(gap));
+  });
+}
+
+void CaptureSession::EndCapture() {
+  engine_->Stop();
+  Drain();
+
+  const uint64_t dropped_chunks = engine_->dropped_chunks();
+  if (dropped_chunks > 0) {
+    g_warning("Dropped %" PRIu64 " audio chunks: main thread fell behind "
+              "(%" PRIu64 " chunk pool misses)",
+              dropped_chunks, engine_->pool_misses());
+  }
+
+  is_capturing_ = false;
+  is_armed_ = false;
+}
+
+void CaptureSession::FinishCapture() {
+  EndCapture();
+  g_warning("Capture read error (%s): %s", CaptureBackendName(backend_),
+            engine_->last_error().c_str());
+
+  if (on_end_) {
+    on_end_();
+  }
+  SendStatus();
+}
+
+// static
+gboolean CaptureSession::OnEngineReady(gint fd, GIOCondition condition,
+                                       gpointer user_data) {
+  auto* session = static_cast<CaptureSession*>(user_data);
+  (void)fd;
+  (void)condition;
+
+  session->Drain();
+  if (session->engine_->finished()) {
+    session->FinishCapture();
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+// static
+FlMethodErrorResponse* CaptureSession::OnAudioListen(FlEventChannel* channel,
+                                                     FlValue* arguments,
+                                                     gpointer user_data) {
+  (void)channel;
+  (void)arguments;
+  static_cast<CaptureSession*>(user_data)->has_audio_listener_ = true;
+  return nullptr;
+}
+
+// static
+FlMethodErrorResponse* CaptureSession::OnAudioCancel(FlEventChannel* channel,
+                                                     FlValue* arguments,
+                                                     gpointer user_data) {
+  (void)channel;
+  (void)arguments;
+  static_cast<CaptureSession*>(user_data)->has_audio_listener_ = false;
+  return nullptr;
+}
+
+// static
+FlMethodErrorResponse* CaptureSession::OnStatusListen(FlEventChannel* channel,
+                                                      FlValue* arguments,
+                                                      gpointer user_data) {
+  auto* session = static_cast<CaptureSession*>(user_data);
+  (void)channel;
+  (void)arguments;
+  session->has_status_listener_ = true;
+
+  // Send current status immediately
+  session->SendStatus();
+  return nullptr;
+}
+
+// static
+FlMethodErrorResponse* CaptureSession::OnStatusCancel(FlEventChannel* channel,
+                                                      FlValue* arguments,
+                                                      gpointer user_data) {
+  (void)channel;
+  (void)arguments;
+  static_cast<CaptureSession*>(user_data)->has_status_listener_ = false;
+  return nullptr;
+}
+
+// static
+FlMethodErrorResponse* CaptureSession::OnDecibelListen(FlEventChannel* channel,
+                                                       FlValue* arguments,
+                                                       gpointer user_data) {
+  auto* session = static_cast<CaptureSession*>(user_data);
+  (void)channel;
+  (void)arguments;
+  session->has_decibel_listener_ = true;
+  if (session->engine_ != nullptr) {
+    session->engine_->set_metering(true);
+  }
+  return nullptr;
+}
+
+// static
+FlMethodErrorResponse* CaptureSession::OnDecibelCancel(FlEventChannel* channel,
+                                                       FlValue* arguments,
+                                                       gpointer user_data) {
+  auto* session = static_cast<CaptureSession*>(user_data);
+  (void)channel;
+  (void)arguments;
+  session->has_decibel_listener_ = false;
+  if (session->engine_ != nullptr) {
+    session->engine_->set_metering(false);
+  }
+  return nullptr;
+}
+
+}  // namespace audio_capture
@@ -0,0 +1,211 @@
+#ifndef FLUTTER_PLUGIN_CAPTURE_PLUGIN_COMMON_H_
+#define FLUTTER_PLUGIN_CAPTURE_PLUGIN_COMMON_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <glib.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "capture_backend.h"
+#include "capture_engine.h"
+#include "level_meter.h"
+
+namespace audio_capture {
+
+// The startCapture and armCapture arguments both plugins accept, clamped to
+// what the engine supports.
+struct CaptureArguments {
+  // Rate of the chunks sent to Dart.
+  int sample_rate = 16000;
+  // Channels recorded; only the first two feed the downmix.
+  int channels = 1;
+  // Audio per chunk. The microphone plugin uses fixed-size chunks instead.
+  int chunk_duration_ms = 1000;
+  float gain_boost = 2.5f;
+  float input_volume = 1.0f;
+  double meter_rate_hz = LevelMeter::kDefaultRateHz;
+  CaptureBackend backend = CaptureBackend::kAuto;
+  // 0 keeps the server's default buffering.
+  int target_latency_ms = 0;
+  // Empty records the plugin's default device.
+  std::string device_id;
+  // Have the server deliver the device's own format and convert here.
+  bool native_format = false;
+  // Encoding of the chunks sent to Dart.
+  SampleFormat sample_format = SampleFormat::kS16;
+  // Encoding recorded and processed in: anything but int16 output is
+  // recorded in float, keeping the server's precision and the gain boost's
+  // headroom.
+  SampleFormat capture_format = SampleFormat::kS16;
+  // Downmix to mono unless asked to keep the channels apart.
+  ChannelLayout channel_layout = ChannelLayout::kMono;
+  std::vector<float> channel_gains;
+};
+
+// Reads the argument map of a startCapture or armCapture call. Anything
+// missing or of the wrong type keeps its default.
+CaptureArguments ParseCaptureArguments(FlValue* args);
+
+// Fills in what |arguments| say about the stream to open and the pipeline
+// to run, for chunks of |chunk_frames| frames. The engine's source rate,
+// channels and reopen factory are only known once the stream is open.
+void ConfigureCapture(const CaptureArguments& arguments, size_t chunk_frames,
+                      CaptureSourceConfig* source_config,
+                      CaptureEngineConfig* engine_config);
+
+void RespondBool(FlMethodCall* method_call, bool result);
+
+// The Flutter side both capture plugins share: the audio, status and decibel
+// event channels, the engine whose chunks, levels and gaps they carry, and a
+// session's start, arm, pause and stop, with its stream opened off the main
+// thread. Each plugin adds what is its own, such as device selection,
+// through the hooks below. Used on the main thread only.
+class CaptureSession {
+ public:
+  // Adds the plugin's own fields to |status|, a status event map.
+  using StatusExtender = std::function<void(FlValue* status)>;
+  // Called whenever a session ends, before its status is sent.
+  using EndHandler = std::function<void()>;
+  // Returns the factory that reopens the stream described by |config| on
+  // |backend| after a disconnect.
+  using ReopenFactoryMaker = std::function<CaptureSourceFactory(
+      CaptureBackend backend, const CaptureSourceConfig& config)>;
+  // Called once a session has started on |config|, before its status is
+  // sent.
+  using StartedHandler =
+      std::function<void(const CaptureSourceConfig& config)>;
+
+  // Creates the engine and drains it on |context|. Without an engine every
+  // start fails. |owner|, the plugin, is kept alive while a stream is being
+  // opened for it, as the opens use its device monitor.
+  CaptureSession(GObject* owner, GMainContext* context);
+  ~CaptureSession();
+
+  CaptureSession(const CaptureSession&) = delete;
+  CaptureSession& operator=(const CaptureSession&) = delete;
+
+  // Creates the event channels named |audio_name|, |status_name| and
+  // |decibel_name| and starts tracking their listeners.
+  void RegisterChannels(FlBinaryMessenger* messenger, FlMethodCodec* codec,
+                        const char* audio_name, const char* status_name,
+                        const char* decibel_name);
+
+  void set_status_extender(StatusExtender extender) {
+    extend_status_ = std::move(extender);
+  }
+  void set_end_handler(EndHandler handler) { on_end_ = std::move(handler); }
+
+  // Null if it could not be created.
+  CaptureEngine* engine() const { return engine_.get(); }
+  // Whether a session is started, starting or armed.
+  bool capturing() const { return is_capturing_; }
+  // Backend the running or last session opened its stream on.
+  CaptureBackend backend() const { return backend_; }
+
+  // Answers a start that needs no new stream: the engine is missing, or an
+  // armed session is waiting to be uncorked or still opening. Returns false
+  // if the caller should go on to Open() one.
+  bool StartWithoutOpening(FlMethodCall* method_call, bool armed);
+
+  // Starts a session on the stream |open| returns, run off the main thread,
+  // and answers |method_call| once it is up. |config| is completed with the
+  // rate and channels the stream was opened with and a reopen factory from
+  // |make_reopen|. With |armed| the stream connects corked and the next
+  // startCapture merely uncorks it. Fails if a session is already capturing.
+  void Open(FlMethodCall* method_call, bool armed, CaptureEngineConfig config,
+            CaptureBackend backend,
+            std::function<CaptureSourceOpening()> open,
+            ReopenFactoryMaker make_reopen, StartedHandler on_started);
+
+  // Corks or uncorks the running session's stream without tearing it down.
+  bool SetPaused(bool paused);
+
+  // Ends the session, delivering whatever the capture thread queued before
+  // it exited, or drops the stream still being opened for it. Returns false
+  // if nothing was capturing.
+  bool Stop();
+
+  // Tells Dart whether the session is live, still starting and paused,
+  // along with the plugin's own fields and optionally a |gap| in the audio
+  // stream (consumed). Every status event is built here so none of them
+  // leaves a field out.
+  void SendStatus(FlValue* gap = nullptr);
+
+ private:
+  static gboolean OnEngineReady(gint fd, GIOCondition condition,
+                                gpointer user_data);
+  static FlMethodErrorResponse* OnAudioListen(FlEventChannel* channel,
+                                              FlValue* arguments,
+                                              gpointer user_data);
+  static FlMethodErrorResponse* OnAudioCancel(FlEventChannel* channel,
+                                              FlValue* arguments,
+                                              gpointer user_data);
+  static FlMethodErrorResponse* OnStatusListen(FlEventChannel* channel,
+                                               FlValue* arguments,
+                                               gpointer user_data);
+  static FlMethodErrorResponse* OnStatusCancel(FlEventChannel* channel,
+                                               FlValue* arguments,
+                                               gpointer user_data);
+  static FlMethodErrorResponse* OnDecibelListen(FlEventChannel* channel,
+                                                FlValue* arguments,
+                                                gpointer user_data);
+  static FlMethodErrorResponse* OnDecibelCancel(FlEventChannel* channel,
+                                                FlValue* arguments,
+                                                gpointer user_data);
+
+  void Drain();
+  // Stops the engine, drains it and forgets the session.
+  void EndCapture();
+  // The capture thread exited on its own, typically because the device went
+  // away.
+  void FinishCapture();
+  // Uncorks the armed session. The stream, the capture thread and the
+  // buffers are already in place, so this is a single server round trip.
+  bool StartArmedCapture();
+  // Takes over from Open() once the stream for start |generation| is open,
+  // or failed to open, and answers |method_call|.
+  void FinishOpen(guint generation, FlMethodCall* method_call,
+                  CaptureEngineConfig config, CaptureBackend backend,
+                  CaptureSourceOpening opening,
+                  const ReopenFactoryMaker& make_reopen,
+                  const StartedHandler& on_started);
+  // Answers the startCapture that came in while arming, if any.
+  void RespondPendingStart(bool result);
+
+  GObject* owner_;
+  GMainContext* main_context_;
+  std::unique_ptr<CaptureEngine> engine_;
+  // Drains the engine on the main thread whenever its wakeup fd fires.
+  GSource* engine_source_ = nullptr;
+
+  FlEventChannel* audio_channel_ = nullptr;
+  FlEventChannel* status_channel_ = nullptr;
+  FlEventChannel* decibel_channel_ = nullptr;
+  bool has_audio_listener_ = false;
+  bool has_status_listener_ = false;
+  bool has_decibel_listener_ = false;
+
+  bool is_capturing_ = false;
+  // Set up by armCapture and waiting, corked, for startCapture.
+  bool is_armed_ = false;
+  // Opening its stream off the main thread; capturing, but not yet active.
+  bool is_starting_ = false;
+  // Bumped by every start and stop, so an open that lands after its start
+  // was stopped is dropped.
+  guint start_generation_ = 0;
+  // A startCapture that came in while an armCapture was still opening,
+  // answered once the session is up.
+  FlMethodCall* pending_start_call_ = nullptr;
+  CaptureBackend backend_ = CaptureBackend::kAuto;
+
+  StatusExtender extend_status_;
+  EndHandler on_end_;
+};
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_CAPTURE_PLUGIN_COMMON_H_
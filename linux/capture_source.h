@@ -0,0 +1,113 @@
+#ifndef FLUTTER_PLUGIN_CAPTURE_SOURCE_H_
+#define FLUTTER_PLUGIN_CAPTURE_SOURCE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "sample_format.h"
+
+namespace audio_capture {
+
+// What to record and how the sound server should deliver it. Shared by every
+// backend so callers can switch between them without translating settings.
+struct CaptureSourceConfig {
+  // Backend-specific name of the device to record from. Empty selects the
+  // server's default input, or its default output when |monitor| is set.
+  std::string device;
+  // Record what the default output is playing instead of the default input.
+  bool monitor = false;
+  std::string stream_name;
+  int sample_rate = 0;
+  int channels = 0;
+  // Sample encoding to record in: kS16, or kF32 to keep the server's own
+  // precision and headroom.
+  SampleFormat format = SampleFormat::kS16;
+  // Channel positions in PulseAudio's notation, e.g. "front-left,front-right"
+  // as reported for the device. Empty uses the default layout for
+  // |channels|; recording in the device's own map spares the server a remix.
+  // PipeWire streams keep their default positions.
+  std::string channel_map;
+  // Preferred transfer size from the server. Kept well below the chunk size
+  // so data is processed as it arrives instead of once per chunk.
+  size_t fragment_bytes = 0;
+  // Upper bound for the server-side record buffer.
+  size_t max_buffer_bytes = 0;
+  // Have the server size the device buffering to |fragment_bytes| too, not
+  // just its transfers, for the lowest capture latency it can provide.
+  bool adjust_latency = false;
+  // Connect the stream paused (corked), so nothing is recorded until
+  // SetPaused(false).
+  bool start_paused = false;
+};
+
+enum class CaptureReadStatus {
+  kOk,
+  // The sound server, the connection to it or the device went away. Opening
+  // the source again may succeed once it is back.
+  kDisconnected,
+  // Anything reopening would not fix.
+  kError,
+  // Interrupt() was called.
+  kInterrupted,
+};
+
+// A device that delivers interleaved audio in the configured sample format, in
+// whatever fragment sizes the sound server hands out. Chunking is left to the
+// caller, so a source never has to wait for a full chunk before returning
+// data.
+class CaptureSource {
+ public:
+  virtual ~CaptureSource() = default;
+
+  // Blocks until at least one fragment is available. On kOk, |*data| points at
+  // |*bytes| bytes (always a whole number of frames) that stay valid until
+  // Release() is called.
+  virtual CaptureReadStatus Acquire(const uint8_t** data, size_t* bytes) = 0;
+
+  // Returns the fragment obtained by the last successful Acquire().
+  virtual void Release() = 0;
+
+  // Makes a blocked Acquire(), and every later one, return kInterrupted right
+  // away. Called from another thread. Sources whose reads cannot be woken
+  // keep them short instead.
+  virtual void Interrupt() {}
+
+  // Stops (|paused| true) or restarts the flow of audio without closing the
+  // stream, e.g. by corking it; a blocked Acquire() simply keeps waiting.
+  // Called from another thread. Returns false when the source cannot pause
+  // or the server refused.
+  virtual bool SetPaused(bool paused) {
+    (void)paused;
+    return false;
+  }
+
+  // How long before the last successful Acquire() the newest frame of its
+  // fragment was captured by the device, including everything still buffered
+  // in the sound server. 0 when the source cannot tell.
+  virtual int64_t fragment_latency_us() const { return 0; }
+
+  // Buffering the server agreed to between the device and this source, once
+  // known. 0 when the source cannot tell.
+  virtual int64_t negotiated_latency_us() const { return 0; }
+
+  // Times captured audio was lost because it was not read fast enough.
+  virtual uint64_t overrun_count() const { return 0; }
+
+  // Human-readable reason for the last kDisconnected or kError.
+  const std::string& last_error() const { return last_error_; }
+
+ protected:
+  std::string last_error_;
+};
+
+// Opens a fresh source, e.g. in place of one that was disconnected. Returns
+// nullptr with |error_message| set when the attempt fails.
+using CaptureSourceFactory = std::function<std::unique_ptr<CaptureSource>(
+    std::string* error_message)>;
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_CAPTURE_SOURCE_H_
@@ -0,0 +1,142 @@
+#include "capture_stats_value.h"
+
+#include <algorithm>
+
+namespace audio_capture {
+
+namespace {
+
+FlValue* HistogramToValue(const LatencyHistogram& histogram) {
+  FlValue* map = fl_value_new_map();
+  fl_value_set_string_take(
+      map, "count", fl_value_new_int(static_cast<int64_t>(histogram.count())));
+  fl_value_set_string_take(map, "minUs", fl_value_new_int(histogram.min()));
+  fl_value_set_string_take(map, "avgUs", fl_value_new_float(histogram.mean()));
+  fl_value_set_string_take(map, "p50Us",
+                           fl_value_new_int(histogram.Percentile(50)));
+  fl_value_set_string_take(map, "p99Us",
+                           fl_value_new_int(histogram.Percentile(99)));
+  fl_value_set_string_take(map, "maxUs", fl_value_new_int(histogram.max()));
+  return map;
+}
+
+const char* GapReasonName(CaptureGapReason reason) {
+  switch (reason) {
+    case CaptureGapReason::kSourceSwitch:
+      return "deviceSwitch";
+    case CaptureGapReason::kReconnect:
+      return "reconnect";
+  }
+  return "unknown";
+}
+
+}  // namespace
+
+FlValue* CaptureStatsToValue(const CaptureStats& stats) {
+  FlValue* latency = fl_value_new_map();
+  fl_value_set_string_take(latency, "capture", HistogramToValue(stats.capture));
+  fl_value_set_string_take(latency, "process", HistogramToValue(stats.process));
+  fl_value_set_string_take(latency, "dispatch",
+                           HistogramToValue(stats.dispatch));
+  fl_value_set_string_take(latency, "send", HistogramToValue(stats.send));
+  fl_value_set_string_take(latency, "total", HistogramToValue(stats.total));
+  fl_value_set_string_take(latency, "resample",
+                           HistogramToValue(stats.resample));
+
+  FlValue* map = fl_value_new_map();
+  fl_value_set_string_take(map, "latency", latency);
+  fl_value_set_string_take(map, "sourceSampleRate",
+                           fl_value_new_int(stats.source_sample_rate));
+  fl_value_set_string_take(map, "sourceChannels",
+                           fl_value_new_int(stats.source_channels));
+  fl_value_set_string_take(map, "negotiatedLatencyUs",
+                           fl_value_new_int(stats.negotiated_latency_us));
+  fl_value_set_string_take(
+      map, "overruns", fl_value_new_int(static_cast<int64_t>(stats.overruns)));
+  fl_value_set_string_take(
+      map, "gaps", fl_value_new_int(static_cast<int64_t>(stats.gaps)));
+  fl_value_set_string_take(
+      map, "lostSamples",
+      fl_value_new_int(static_cast<int64_t>(stats.lost_frames)));
+  fl_value_set_string_take(
+      map, "reconnects",
+      fl_value_new_int(static_cast<int64_t>(stats.reconnects)));
+  fl_value_set_string_take(
+      map, "droppedChunks",
+      fl_value_new_int(static_cast<int64_t>(stats.dropped_chunks)));
+  fl_value_set_string_take(
+      map, "poolMisses",
+      fl_value_new_int(static_cast<int64_t>(stats.pool_misses)));
+  fl_value_set_string_take(
+      map, "queueDepth",
+      fl_value_new_int(static_cast<int64_t>(stats.queue_depth)));
+  fl_value_set_string_take(
+      map, "maxQueueDepth",
+      fl_value_new_int(static_cast<int64_t>(stats.max_queue_depth)));
+  fl_value_set_string_take(map, "timeToFirstSampleUs",
+                           fl_value_new_int(stats.time_to_first_sample_us));
+  fl_value_set_string_take(map, "timeToStoppedUs",
+                           fl_value_new_int(stats.time_to_stopped_us));
+  return map;
+}
+
+FlValue* CaptureGapToValue(const CaptureGap& gap) {
+  FlValue* map = fl_value_new_map();
+  fl_value_set_string_take(map, "reason",
+                           fl_value_new_string(GapReasonName(gap.reason)));
+  fl_value_set_string_take(
+      map, "lostSamples",
+      fl_value_new_int(static_cast<int64_t>(gap.lost_frames)));
+  fl_value_set_string_take(map, "timestamp",
+                           fl_value_new_float(gap.timestamp_us / 1000000.0));
+  return map;
+}
+
+FlValue* ChannelLevelsToValue(const ChannelLevels& channels) {
+  FlValue* list = fl_value_new_list();
+  for (int channel = 0; channel < channels.count; ++channel) {
+    const LevelReading& reading = channels.readings[channel];
+    FlValue* map = fl_value_new_map();
+    fl_value_set_string_take(map, "decibel",
+                             fl_value_new_float(reading.decibel));
+    fl_value_set_string_take(map, "peakDecibel",
+                             fl_value_new_float(reading.peak_decibel));
+    fl_value_set_string_take(map, "rms", fl_value_new_float(reading.rms));
+    fl_value_set_string_take(map, "peak", fl_value_new_float(reading.peak));
+    fl_value_append_take(list, map);
+  }
+  return list;
+}
+
+std::vector<float> ChannelGainsFromValue(FlValue* value) {
+  std::vector<float> gains;
+  if (value == nullptr) {
+    return gains;
+  }
+  if (fl_value_get_type(value) == FL_VALUE_TYPE_FLOAT_LIST) {
+    const double* values = fl_value_get_float_list(value);
+    for (size_t i = 0; i < fl_value_get_length(value); ++i) {
+      gains.push_back(static_cast<float>(values[i]));
+    }
+  } else if (fl_value_get_type(value) == FL_VALUE_TYPE_LIST) {
+    for (size_t i = 0; i < fl_value_get_length(value); ++i) {
+      FlValue* gain = fl_value_get_list_value(value, i);
+      if (fl_value_get_type(gain) == FL_VALUE_TYPE_FLOAT) {
+        gains.push_back(static_cast<float>(fl_value_get_float(gain)));
+      } else if (fl_value_get_type(gain) == FL_VALUE_TYPE_INT) {
+        gains.push_back(static_cast<float>(fl_value_get_int(gain)));
+      } else {
+        gains.push_back(1.0f);
+      }
+    }
+  }
+  if (gains.size() > static_cast<size_t>(kMaxCaptureChannels)) {
+    gains.resize(kMaxCaptureChannels);
+  }
+  for (float& gain : gains) {
+    gain = std::max(0.0f, std::min(10.0f, gain));
+  }
+  return gains;
+}
+
+}  // namespace audio_capture
@@ -0,0 +1,38 @@
+#ifndef FLUTTER_PLUGIN_CAPTURE_STATS_VALUE_H_
+#define FLUTTER_PLUGIN_CAPTURE_STATS_VALUE_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <vector>
+
+#include "capture_engine.h"
+
+namespace audio_capture {
+
+// Encodes |stats| as the map returned by the getStats method:
+//
+//   latency: {capture|process|dispatch|send|total:
+//                {count, minUs, avgUs, p50Us, p99Us, maxUs}}
+//   negotiatedLatencyUs, overruns, gaps, lostSamples, reconnects,
+//   droppedChunks, poolMisses, queueDepth, maxQueueDepth
+FlValue* CaptureStatsToValue(const CaptureStats& stats);
+
+// Encodes |gap| as the map sent on the status channel:
+//
+//   {reason, lostSamples, timestamp}
+//
+// where |reason| is "deviceSwitch" or "reconnect" and |timestamp| is in
+// seconds.
+FlValue* CaptureGapToValue(const CaptureGap& gap);
+
+// Encodes |channels| as the "channels" list of a decibel event, one
+// {decibel, peakDecibel, rms, peak} map per channel.
+FlValue* ChannelLevelsToValue(const ChannelLevels& channels);
+
+// Decodes the "channelGains" startCapture argument, a list of numbers, into
+// at most kMaxCaptureChannels gains. Anything else yields no gains.
+std::vector<float> ChannelGainsFromValue(FlValue* value);
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_CAPTURE_STATS_VALUE_H_
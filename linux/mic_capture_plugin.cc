@@ -3,16 +3,18 @@
 #include <flutter_linux/flutter_linux.h>
 #include <glib-object.h>
 #include <glib.h>
-#include <pulse/error.h>
-#include <pulse/simple.h>
-#include <pulse/pulseaudio.h>
 
-#include <algorithm>
-#include <cmath>
+#include <chrono>
+#include <cinttypes>
 #include <cstdint>
 #include <memory>
 #include <string>
-#include <vector>
+
+#include "capture_backend.h"
+#include "capture_engine.h"
+#include "capture_plugin_common.h"
+#include "capture_stats_value.h"
+#include "pulse_device_monitor.h"
 
 namespace {
 
@@ -21,42 +23,14 @@ constexpr char kEventChannelName[] = "com.mic_audio_transcriber/mic_stream";
 constexpr char kStatusEventChannelName[] = "com.mic_audio_transcriber/mic_status";
 constexpr char kDecibelEventChannelName[] = "com.mic_audio_transcriber/mic_decibel";
 
-constexpr int kDefaultSampleRate = 16000;
-constexpr int kDefaultChannels = 1;
-constexpr int kDefaultBitsPerSample = 16;
-constexpr float kDefaultGainBoost = 2.5f;
-constexpr float kDefaultInputVolume = 1.0f;
 constexpr size_t kBufferSizeFrames = 4096;
+// Bluetooth headsets usually finish switching to a headset profile well
+// within this.
+constexpr auto kBluetoothProfileTimeout = std::chrono::seconds(3);
 
-struct AudioChunkPayload {
-  AudioChunkPayload(MicCapturePlugin* plugin, GBytes* bytes, double decibel)
-      : plugin(plugin), bytes(bytes), decibel(decibel) {}
-
-  MicCapturePlugin* plugin;
-  GBytes* bytes;
-  double decibel;
-};
-
-struct CaptureThreadContext {
-  MicCapturePlugin* plugin;
-  pa_simple* stream;
-  size_t chunk_size;
-  int sample_rate;
-  int channels;
-  int bits_per_sample;
-  float gain_boost;
-  float input_volume;
-};
-
-gboolean EmitAudioOnMainThread(gpointer user_data);
-gpointer CaptureThread(gpointer user_data);
-double CalculateDecibel(const int16_t* samples, size_t sample_count);
-std::string GetCurrentDeviceName();
-bool IsBluetoothDevice();
-void CleanupExistingCapture(MicCapturePlugin* plugin);
-bool OpenPulseStreamWithRetry(int sample_rate, int channels, int bits_per_sample,
-                               size_t chunk_size, bool is_bluetooth,
-                               pa_simple** out_stream, std::string* error_message);
+std::string GetCurrentDeviceName(MicCapturePlugin* plugin,
+                                 const std::string& device_id);
+gboolean OnDefaultSourceChanged(gpointer user_data);
 
 }  // namespace
 
@@ -64,667 +38,459 @@ struct _MicCapturePlugin {
   GObject parent_instance;
 
   FlMethodChannel* method_channel;
-  FlEventChannel* event_channel;
-  FlEventChannel* status_event_channel;
-  FlEventChannel* decibel_event_channel;
   GMainContext* main_context;
 
   GMutex lock;
-  gint should_stop;
-  gboolean is_capturing;
-  gboolean has_listener;
-  gboolean has_status_listener;
-  gboolean has_decibel_listener;
-
-  GThread* capture_thread;
   gchar* current_device_name;
+
+  // The event channels, the engine draining into them and the session's
+  // start, pause and stop.
+  audio_capture::CaptureSession* session;
+
+  // Cached, subscription-driven view of the server's sources.
+  audio_capture::PulseDeviceMonitor* device_monitor;
+
+  // How the running session's source was opened, so another device can be
+  // swapped in underneath it. Null while not capturing.
+  audio_capture::CaptureSourceConfig* session_source_config;
+  // Whether the session moves along when the default source changes, i.e. it
+  // was neither started on nor switched to a specific device.
+  gboolean follow_default_device;
+
+  // Whether a device switch is opening the new device off the main thread.
+  gboolean is_switching;
+  // Bumped by every switch and stop, so an open that lands after its switch
+  // was stopped or overtaken is dropped.
+  guint switch_generation;
 };
 
 G_DEFINE_TYPE(MicCapturePlugin, mic_capture_plugin, G_TYPE_OBJECT)
 
 namespace {
 
-bool CheckMicSupport() {
-  pa_simple* stream = nullptr;
-  pa_sample_spec spec;
-  spec.rate = kDefaultSampleRate;
-  spec.channels = static_cast<uint8_t>(kDefaultChannels);
-  spec.format = PA_SAMPLE_S16LE;
-
-  pa_buffer_attr attr;
-  attr.maxlength = static_cast<uint32_t>(-1);
-  attr.tlength = static_cast<uint32_t>(-1);
-  attr.prebuf = static_cast<uint32_t>(-1);
-  attr.minreq = static_cast<uint32_t>(-1);
-  attr.fragsize = static_cast<uint32_t>(-1);
-
-  int error = 0;
-  // Try to open default source (microphone)
-  stream = pa_simple_new(nullptr, "Voxa", PA_STREAM_RECORD, nullptr,
-                         "Mic Check", &spec, nullptr, &attr, &error);
-
-  if (stream == nullptr) {
-    return false;
+// Name of |device_id|, or of the default source when |device_id| is empty.
+std::string GetCurrentDeviceName(MicCapturePlugin* plugin,
+                                 const std::string& device_id) {
+  audio_capture::AudioDeviceInfo device;
+  if (plugin->device_monitor != nullptr) {
+    const bool found =
+        device_id.empty()
+            ? plugin->device_monitor->DefaultSource(&device)
+            : plugin->device_monitor->FindSource(device_id, &device);
+    if (found) {
+      return device.name;
+    }
   }
-
-  pa_simple_free(stream);
-  return true;
+  return device_id.empty() ? "Default Microphone" : device_id;
 }
 
-size_t CalculateChunkSize(int sample_rate, int channels, int bits_per_sample) {
-  const int bytes_per_sample = std::max(bits_per_sample / 8, 1);
-  const size_t frame_size = static_cast<size_t>(channels) * bytes_per_sample;
-  return kBufferSizeFrames * frame_size;
-}
-
-bool OpenPulseStream(int sample_rate, int channels, int bits_per_sample,
-                     size_t chunk_size, pa_simple** out_stream,
-                     std::string* error_message) {
-  pa_sample_spec spec;
-  spec.rate = sample_rate;
-  spec.channels = static_cast<uint8_t>(channels);
-  if (bits_per_sample == 16) {
-    spec.format = PA_SAMPLE_S16LE;
-  } else {
-    spec.format = PA_SAMPLE_S16LE;
+// Records |device_id|, or the default source when it is empty, in the format
+// the device runs at; the engine then resamples and downmixes in-process.
+// With |keep_channels| the channel count in |config| is kept.
+void UseDeviceFormat(audio_capture::PulseDeviceMonitor* monitor,
+                     const std::string& device_id, bool keep_channels,
+                     audio_capture::CaptureSourceConfig* config) {
+  audio_capture::AudioDeviceInfo device;
+  const bool found =
+      monitor != nullptr &&
+      (device_id.empty() ? monitor->DefaultSource(&device)
+                         : monitor->FindSource(device_id, &device));
+  if (!found ||
+      !audio_capture::UseNativeFormat(device, keep_channels, config)) {
+    g_warning("Native format of %s is unknown, letting the server convert",
+              device_id.empty() ? "the default source" : device_id.c_str());
   }
+}
 
-  pa_buffer_attr attr;
-  attr.maxlength = static_cast<uint32_t>(chunk_size * 4);
-  attr.tlength = static_cast<uint32_t>(-1);
-  attr.prebuf = static_cast<uint32_t>(-1);
-  attr.minreq = static_cast<uint32_t>(-1);
-  attr.fragsize = static_cast<uint32_t>(chunk_size);
-
-  int error = 0;
-  // Use nullptr to get default source (microphone)
-  pa_simple* stream = pa_simple_new(nullptr, "Voxa", PA_STREAM_RECORD, nullptr,
-                                     "Mic Capture", &spec, nullptr, &attr, &error);
-
-  if (stream == nullptr) {
-    if (error_message != nullptr) {
-      *error_message = pa_strerror(error);
-    }
+// Holds off until a Bluetooth |device_id|, or the default source when it is
+// empty, runs a card profile that records. Wired sources are ready as soon
+// as they exist, so they pass straight through. An explicit |device_id| that
+// is not listed is waited for as well: a headset still in a playback-only
+// profile has no input source until it switches. Blocks for up to
+// |kBluetoothProfileTimeout|, so it runs off the main thread. Returns false
+// if |device_id| never showed up.
+bool WaitForCaptureTransport(audio_capture::PulseDeviceMonitor* monitor,
+                             const std::string& device_id) {
+  if (monitor == nullptr) {
+    return true;
+  }
+  audio_capture::AudioDeviceInfo device;
+  const bool found = device_id.empty()
+                         ? monitor->DefaultSource(&device)
+                         : monitor->FindSource(device_id, &device);
+  if (found ? !device.is_bluetooth() || device.transport_ready
+            : device_id.empty()) {
+    return true;
+  }
+
+  const int64_t started_us = g_get_monotonic_time();
+  if (monitor->WaitForReadySource(device_id, kBluetoothProfileTimeout,
+                                  &device)) {
+    g_debug("Source %s ready with profile %s after %" PRId64 " ms",
+            device.id.c_str(), device.card_profile.c_str(),
+            (g_get_monotonic_time() - started_us) / 1000);
+  } else if (device.id.empty()) {
     return false;
+  } else {
+    g_warning("Bluetooth source %s still has no recording profile (%s)",
+              device.id.c_str(), device.card_profile.c_str());
   }
-
-  *out_stream = stream;
   return true;
 }
 
-std::string GetCurrentDeviceName() {
-  // Try to get device name from PulseAudio
-  // For simplicity, we'll use a default name
-  // In a full implementation, you could use pa_context to query source info
-  return "Default Microphone";
-}
-
-bool IsBluetoothDevice() {
-  // Check device name for Bluetooth keywords
-  std::string device_name = GetCurrentDeviceName();
-  std::transform(device_name.begin(), device_name.end(), device_name.begin(), ::tolower);
-  
-  const char* bluetooth_keywords[] = {
-    "bluetooth", "airpods", "beats", "jabra", "sony", "bose", "jbl", "bluez"
-  };
-  
-  for (size_t i = 0; i < sizeof(bluetooth_keywords) / sizeof(bluetooth_keywords[0]); ++i) {
-    if (device_name.find(bluetooth_keywords[i]) != std::string::npos) {
-      g_debug("🔵 Detected Bluetooth device via name: %s", device_name.c_str());
-      return true;
-    }
+// Reopens the session's source after a disconnect. A session that follows
+// the default device reopens on whatever the default is by then.
+audio_capture::CaptureSourceFactory MakeReopenFactory(
+    audio_capture::CaptureBackend backend,
+    audio_capture::CaptureSourceConfig config, bool follow_default) {
+  if (follow_default) {
+    config.device.clear();
+    config.monitor = false;
   }
-  
-  return false;
+  return audio_capture::MakeCaptureSourceFactory(backend, config);
 }
 
-void CleanupExistingCapture(MicCapturePlugin* plugin) {
+// Reports |device_id|, or the default source when it is empty, as the device
+// being captured from.
+void SetDeviceName(MicCapturePlugin* plugin, const std::string& device_id) {
+  const std::string device_name = GetCurrentDeviceName(plugin, device_id);
   g_mutex_lock(&plugin->lock);
-  
-  if (plugin->is_capturing && plugin->capture_thread != nullptr) {
-    // Signal stop
-    g_atomic_int_set(&plugin->should_stop, 1);
-    GThread* thread = plugin->capture_thread;
-    g_mutex_unlock(&plugin->lock);
-    
-    // Wait for thread to finish
-    if (thread != nullptr) {
-      g_thread_join(thread);
-    }
-    
-    g_mutex_lock(&plugin->lock);
-    plugin->capture_thread = nullptr;
-    plugin->is_capturing = FALSE;
-  }
-  
-  // Clear device name
-  if (plugin->current_device_name != nullptr) {
-    g_free(plugin->current_device_name);
-    plugin->current_device_name = nullptr;
-  }
-  
+  g_free(plugin->current_device_name);
+  plugin->current_device_name = g_strdup(device_name.c_str());
   g_mutex_unlock(&plugin->lock);
-  
-  // Small delay for cleanup to complete
-  g_usleep(500000);  // 0.5 seconds
-}
-
-bool OpenPulseStreamWithRetry(int sample_rate, int channels, int bits_per_sample,
-                               size_t chunk_size, bool is_bluetooth,
-                               pa_simple** out_stream, std::string* error_message) {
-  const int max_retries = is_bluetooth ? 5 : 3;
-  const double initial_wait = is_bluetooth ? 1.5 : 0.3;
-  const double retry_delays_bluetooth[] = {0.5, 1.0, 1.5, 2.0, 2.5};
-  const double retry_delays_normal[] = {0.3, 0.6, 1.0, 0.0, 0.0};
-  const double* retry_delays = is_bluetooth ? retry_delays_bluetooth : retry_delays_normal;
-  
-  if (is_bluetooth) {
-    g_debug("🔵 Bluetooth device detected - using extended wait times");
-  }
-  
-  // Initial wait for device to be ready
-  g_debug("⏳ Waiting %.1fs for device to be ready...", initial_wait);
-  g_usleep(static_cast<guint64>(initial_wait * 1000000));
-  
-  for (int attempt = 1; attempt <= max_retries; ++attempt) {
-    if (OpenPulseStream(sample_rate, channels, bits_per_sample, chunk_size,
-                       out_stream, error_message)) {
-      g_debug("✅ PulseAudio stream opened successfully on attempt %d", attempt);
-      return true;
-    }
-    
-    if (attempt < max_retries) {
-      double wait_time = retry_delays[attempt - 1];
-      if (wait_time > 0.0) {
-        g_debug("⚠️ Attempt %d/%d failed: %s", attempt, max_retries,
-                error_message != nullptr ? error_message->c_str() : "unknown error");
-        g_debug("   ⏳ Waiting %.1fs before retry...", wait_time);
-        g_usleep(static_cast<guint64>(wait_time * 1000000));
-      }
-    }
-  }
-  
-  g_warning("❌ Failed to open PulseAudio stream after %d attempts", max_retries);
-  return false;
-}
-
-void ApplyGainBoostAndConvertToMono(const int16_t* input, int16_t* output,
-                                    size_t frame_count, int input_channels,
-                                    float gain_boost) {
-  const float max_value = 32767.0f;
-  const float min_value = -32768.0f;
-
-  if (input_channels == 1) {
-    // Mono: just apply gain boost
-    for (size_t i = 0; i < frame_count; ++i) {
-      float sample = static_cast<float>(input[i]) * gain_boost;
-      sample = std::max(min_value, std::min(max_value, sample));
-      output[i] = static_cast<int16_t>(sample);
-    }
-  } else {
-    // Stereo: convert to mono and apply gain boost
-    for (size_t i = 0; i < frame_count; ++i) {
-      float left = static_cast<float>(input[i * 2]);
-      float right = static_cast<float>(input[i * 2 + 1]);
-      float mono = (left + right) / 2.0f * gain_boost;
-      mono = std::max(min_value, std::min(max_value, mono));
-      output[i] = static_cast<int16_t>(mono);
-    }
-  }
-}
-
-double CalculateDecibel(const int16_t* samples, size_t sample_count) {
-  if (sample_count == 0) {
-    return -120.0;
-  }
-
-  // Calculate RMS (Root Mean Square)
-  double sum_of_squares = 0.0;
-  for (size_t i = 0; i < sample_count; ++i) {
-    double value = static_cast<double>(samples[i]);
-    sum_of_squares += value * value;
-  }
-  double mean_square = sum_of_squares / static_cast<double>(sample_count);
-  double rms = sqrt(mean_square);
-
-  // Calculate decibel: dB = 20 * log10(RMS / max_value)
-  // For Int16, max_value is 32767.0
-  const double max_value = 32767.0;
-  if (rms <= 0.0) {
-    return -120.0;  // Avoid log(0)
-  }
-
-  double decibel = 20.0 * log10(rms / max_value);
-
-  // Clamp to reasonable range (-120 dB to 0 dB)
-  return std::max(-120.0, std::min(0.0, decibel));
 }
 
-gboolean EmitAudioOnMainThread(gpointer user_data) {
-  std::unique_ptr<AudioChunkPayload> payload(
-      static_cast<AudioChunkPayload*>(user_data));
-  MicCapturePlugin* plugin = payload->plugin;
-
-  gsize length = 0;
-  const guint8* data =
-      static_cast<const guint8*>(g_bytes_get_data(payload->bytes, &length));
-
+// Clears the device name reported while capturing.
+void ClearDeviceName(MicCapturePlugin* plugin) {
   g_mutex_lock(&plugin->lock);
-  const gboolean can_emit =
-      plugin->event_channel != nullptr && plugin->has_listener;
-  const gboolean can_emit_decibel =
-      plugin->decibel_event_channel != nullptr && plugin->has_decibel_listener;
+  g_free(plugin->current_device_name);
+  plugin->current_device_name = nullptr;
   g_mutex_unlock(&plugin->lock);
-
-  if (can_emit && length > 0) {
-    g_autoptr(FlValue) value = fl_value_new_uint8_list(data, length);
-    g_autoptr(GError) error = nullptr;
-
-    if (!fl_event_channel_send(plugin->event_channel, value, nullptr, &error)) {
-      g_warning("Failed to send audio chunk: %s",
-                error != nullptr ? error->message : "unknown error");
-    }
-  }
-
-  // Send decibel data
-  if (can_emit_decibel) {
-    g_autoptr(FlValue) decibel_map = fl_value_new_map();
-    fl_value_set_string_take(decibel_map, "decibel", fl_value_new_float(payload->decibel));
-    fl_value_set_string_take(decibel_map, "timestamp", fl_value_new_float(g_get_real_time() / 1000000.0));
-    
-    g_autoptr(GError) error = nullptr;
-    if (!fl_event_channel_send(plugin->decibel_event_channel, decibel_map, nullptr, &error)) {
-      g_warning("Failed to send decibel data: %s",
-                error != nullptr ? error->message : "unknown error");
-    }
-  }
-
-  g_bytes_unref(payload->bytes);
-  g_object_unref(plugin);
-
-  return G_SOURCE_REMOVE;
 }
 
-gpointer CaptureThread(gpointer user_data) {
-  std::unique_ptr<CaptureThreadContext> context(
-      static_cast<CaptureThreadContext*>(user_data));
-  MicCapturePlugin* plugin = context->plugin;
-
-  // Read raw audio from PulseAudio
-  const size_t raw_chunk_size = CalculateChunkSize(
-      context->sample_rate, context->channels, context->bits_per_sample);
-  std::vector<uint8_t> raw_buffer(raw_chunk_size);
-
-  // Output buffer for processed audio (mono)
-  const size_t output_frame_count = kBufferSizeFrames;
-  std::vector<int16_t> output_buffer(output_frame_count);
-
-  while (!g_atomic_int_get(&plugin->should_stop)) {
-    int error = 0;
-    if (pa_simple_read(context->stream, raw_buffer.data(), raw_buffer.size(),
-                       &error) < 0) {
-      g_warning("PulseAudio read error: %s", pa_strerror(error));
-      break;
-    }
-
-    if (g_atomic_int_get(&plugin->should_stop)) {
-      break;
-    }
-
-    // Apply input volume
-    if (context->input_volume < 1.0f) {
-      int16_t* samples = reinterpret_cast<int16_t*>(raw_buffer.data());
-      const size_t sample_count = raw_buffer.size() / sizeof(int16_t);
-      for (size_t i = 0; i < sample_count; ++i) {
-        samples[i] = static_cast<int16_t>(
-            static_cast<float>(samples[i]) * context->input_volume);
-      }
-    }
-
-    // Convert to mono and apply gain boost
-    const int16_t* input_samples =
-        reinterpret_cast<const int16_t*>(raw_buffer.data());
-    const size_t input_frame_count =
-        raw_buffer.size() / (sizeof(int16_t) * context->channels);
-    const size_t frames_to_process =
-        std::min(input_frame_count, output_frame_count);
-
-    ApplyGainBoostAndConvertToMono(input_samples, output_buffer.data(),
-                                    frames_to_process, context->channels,
-                                    context->gain_boost);
-
-    // Create output bytes
-    const size_t output_bytes = frames_to_process * sizeof(int16_t);
-    
-    // Calculate decibel from output buffer
-    double decibel = CalculateDecibel(output_buffer.data(), frames_to_process);
-    
-    GBytes* bytes = g_bytes_new(output_buffer.data(), output_bytes);
-    auto* payload = new AudioChunkPayload(plugin, bytes, decibel);
-    g_object_ref(plugin);
-
-    g_main_context_invoke_full(plugin->main_context, G_PRIORITY_DEFAULT,
-                               EmitAudioOnMainThread, payload, nullptr);
-  }
-
-  pa_simple_free(context->stream);
-
+// Adds whether the session is switching devices, and on which device it
+// captures, to a status event.
+void AddDeviceStatus(MicCapturePlugin* plugin, FlValue* status_map) {
   g_mutex_lock(&plugin->lock);
-  plugin->is_capturing = FALSE;
-  plugin->capture_thread = nullptr;
+  g_autofree gchar* device_name = g_strdup(plugin->current_device_name);
   g_mutex_unlock(&plugin->lock);
 
-  // Send status update
-  g_mutex_lock(&plugin->lock);
-  const gboolean has_status_listener = plugin->has_status_listener;
-  g_mutex_unlock(&plugin->lock);
-  
-  if (has_status_listener && plugin->status_event_channel != nullptr) {
-    g_autoptr(FlValue) status_map = fl_value_new_map();
-    fl_value_set_string_take(status_map, "isActive", fl_value_new_bool(FALSE));
-    fl_value_set_string_take(status_map, "timestamp", fl_value_new_float(g_get_real_time() / 1000000.0));
-    
-    g_autoptr(GError) error = nullptr;
-    fl_event_channel_send(plugin->status_event_channel, status_map, nullptr, &error);
+  fl_value_set_string_take(status_map, "isSwitching",
+                           fl_value_new_bool(plugin->is_switching));
+  if (device_name != nullptr) {
+    fl_value_set_string_take(status_map, "deviceName",
+                             fl_value_new_string(device_name));
   }
-
-  g_object_unref(plugin);
-  return nullptr;
 }
 
-static FlMethodErrorResponse* OnListenHandler(FlEventChannel* channel,
-                                              FlValue* arguments,
-                                              gpointer user_data) {
-  MicCapturePlugin* plugin = MIC_CAPTURE_PLUGIN(user_data);
-  (void)channel;
-  (void)arguments;
-  g_mutex_lock(&plugin->lock);
-  plugin->has_listener = TRUE;
-  g_mutex_unlock(&plugin->lock);
-  return nullptr;
+// Forgets the device state of a session that ended; a switch still opening
+// is dropped when it lands.
+void ForgetSessionDevice(MicCapturePlugin* plugin) {
+  plugin->switch_generation++;
+  plugin->is_switching = FALSE;
+  delete plugin->session_source_config;
+  plugin->session_source_config = nullptr;
+  ClearDeviceName(plugin);
 }
 
-static FlMethodErrorResponse* OnCancelHandler(FlEventChannel* channel,
-                                              FlValue* arguments,
-                                              gpointer user_data) {
-  MicCapturePlugin* plugin = MIC_CAPTURE_PLUGIN(user_data);
-  (void)channel;
-  (void)arguments;
-  g_mutex_lock(&plugin->lock);
-  plugin->has_listener = FALSE;
-  g_mutex_unlock(&plugin->lock);
-  return nullptr;
-}
-
-static FlMethodErrorResponse* OnStatusListenHandler(FlEventChannel* channel,
-                                                     FlValue* arguments,
-                                                     gpointer user_data) {
-  MicCapturePlugin* plugin = MIC_CAPTURE_PLUGIN(user_data);
-  (void)channel;
-  (void)arguments;
-  g_mutex_lock(&plugin->lock);
-  plugin->has_status_listener = TRUE;
-  const gboolean is_active = plugin->is_capturing;
-  g_mutex_unlock(&plugin->lock);
-
-  // Send current status immediately
-  g_autoptr(FlValue) status_map = fl_value_new_map();
-  fl_value_set_string_take(status_map, "isActive", fl_value_new_bool(is_active));
-  fl_value_set_string_take(status_map, "timestamp", fl_value_new_float(g_get_real_time() / 1000000.0));
-  
-  g_autoptr(GError) error = nullptr;
-  fl_event_channel_send(plugin->status_event_channel, status_map, nullptr, &error);
-  
-  return nullptr;
-}
+// Starts capturing with the settings in the arguments of |method_call| and
+// answers it once the stream is open. The open, including any wait for a
+// Bluetooth headset's recording profile, runs off the main thread. With
+// |armed| set the session is only set up, with its stream corked, and the
+// next startCapture merely uncorks it.
+void StartCapture(MicCapturePlugin* plugin, FlMethodCall* method_call,
+                  bool armed) {
+  if (plugin->session->StartWithoutOpening(method_call, armed)) {
+    return;
+  }
+  const int64_t requested_us = g_get_monotonic_time();
+
+  // Ends the session a new start replaces the way stopCapture does, so its
+  // last partial chunk is delivered and Dart sees it go inactive first.
+  plugin->session->Stop();
+
+  const audio_capture::CaptureArguments arguments =
+      audio_capture::ParseCaptureArguments(
+          fl_method_call_get_args(method_call));
+
+  // An id the server does not list yet is waited for with the open, as a
+  // Bluetooth headset's input only appears once it switches profile.
+  audio_capture::AudioDeviceInfo device;
+  if (!arguments.device_id.empty() && plugin->device_monitor != nullptr) {
+    plugin->device_monitor->FindSource(arguments.device_id, &device);
+  }
+
+  audio_capture::CaptureSourceConfig source_config;
+  audio_capture::CaptureEngineConfig config;
+  audio_capture::ConfigureCapture(arguments, kBufferSizeFrames, &source_config,
+                                  &config);
+  // Empty device selects the default source (microphone)
+  source_config.device = arguments.device_id;
+  source_config.monitor = device.is_monitor;
+  source_config.stream_name = "Mic Capture";
+  source_config.start_paused = armed;
+  config.thread_name = "voxa-mic-capture";
+  config.requested_us = requested_us;
 
-static FlMethodErrorResponse* OnStatusCancelHandler(FlEventChannel* channel,
-                                                    FlValue* arguments,
-                                                    gpointer user_data) {
-  MicCapturePlugin* plugin = MIC_CAPTURE_PLUGIN(user_data);
-  (void)channel;
-  (void)arguments;
-  g_mutex_lock(&plugin->lock);
-  plugin->has_status_listener = FALSE;
-  g_mutex_unlock(&plugin->lock);
-  return nullptr;
+  g_debug("🎤 Starting capture with config:");
+  g_debug("  Sample Rate: %d Hz", arguments.sample_rate);
+  g_debug("  Channels: %d", arguments.channels);
+  g_debug("  Sample Format: %s",
+          audio_capture::SampleFormatName(arguments.sample_format));
+  g_debug("  Channel Layout: %s",
+          audio_capture::ChannelLayoutName(arguments.channel_layout));
+  g_debug("  Gain Boost: %.2fx", arguments.gain_boost);
+  g_debug("  Input Volume: %.2f", arguments.input_volume);
+  g_debug("  Device: %s", arguments.device_id.empty()
+                              ? "default"
+                              : arguments.device_id.c_str());
+  g_debug("  Backend: %s",
+          audio_capture::CaptureBackendName(arguments.backend));
+  g_debug("  Target Latency: %d ms", arguments.target_latency_ms);
+
+  SetDeviceName(plugin, arguments.device_id);
+
+  // Only the monitor is shared with the open, and it is thread-safe. The
+  // session keeps the plugin alive until the open has landed.
+  audio_capture::PulseDeviceMonitor* monitor = plugin->device_monitor;
+  const audio_capture::CaptureBackend backend = arguments.backend;
+  const std::string device_id = arguments.device_id;
+  const bool native_format = arguments.native_format;
+  // Channels kept apart are delivered as many as were asked for.
+  const bool keep_channels =
+      arguments.channel_layout != audio_capture::ChannelLayout::kMono;
+  plugin->session->Open(
+      method_call, armed, config, backend,
+      [monitor, backend, device_id, native_format, keep_channels,
+       source_config]() {
+        audio_capture::CaptureSourceOpening opening;
+        opening.config = source_config;
+        opening.backend = backend;
+        if (!WaitForCaptureTransport(monitor, device_id)) {
+          opening.error_message = "Unknown capture device '" + device_id + "'";
+          return opening;
+        }
+        // After the wait, as a Bluetooth headset's rate depends on its
+        // profile.
+        if (native_format) {
+          UseDeviceFormat(monitor, device_id, keep_channels, &opening.config);
+        }
+        // Opening returns once the server reports the stream ready; a later
+        // failure is the engine's to reconnect.
+        opening.source = audio_capture::OpenCaptureSource(
+            backend, opening.config, &opening.backend,
+            &opening.error_message);
+        return opening;
+      },
+      [](audio_capture::CaptureBackend backend,
+         const audio_capture::CaptureSourceConfig& config) {
+        // A session started on the default source follows it.
+        return MakeReopenFactory(backend, config, config.device.empty());
+      },
+      [plugin](const audio_capture::CaptureSourceConfig& config) {
+        delete plugin->session_source_config;
+        plugin->session_source_config =
+            new audio_capture::CaptureSourceConfig(config);
+        plugin->follow_default_device = config.device.empty();
+        // Only known now for a source that appeared during the wait.
+        SetDeviceName(plugin, config.device);
+      });
 }
 
-static FlMethodErrorResponse* OnDecibelListenHandler(FlEventChannel* channel,
-                                                      FlValue* arguments,
-                                                      gpointer user_data) {
-  MicCapturePlugin* plugin = MIC_CAPTURE_PLUGIN(user_data);
-  (void)channel;
-  (void)arguments;
-  g_mutex_lock(&plugin->lock);
-  plugin->has_decibel_listener = TRUE;
-  g_mutex_unlock(&plugin->lock);
-  return nullptr;
-}
+// Takes over from SwitchCaptureDevice() once the device for switch
+// |generation| is open, or failed to open, and answers |method_call| if
+// there is one.
+void FinishSwitchCaptureDevice(MicCapturePlugin* plugin, guint generation,
+                               FlMethodCall* method_call, bool follow_default,
+                               int64_t started_us,
+                               audio_capture::CaptureSourceOpening opening) {
+  bool switched = false;
+  const char* device = opening.config.device.empty()
+                           ? "default source"
+                           : opening.config.device.c_str();
+  if (generation != plugin->switch_generation) {
+    // Stopped or overtaken by another switch while opening.
+  } else if (opening.source == nullptr) {
+    g_warning("Failed to open %s for switching: %s", device,
+              opening.error_message.c_str());
+  } else {
+    switched = plugin->session->engine()->SwitchSource(
+        std::move(opening.source),
+        MakeReopenFactory(plugin->session->backend(), opening.config,
+                          follow_default));
+  }
+
+  if (generation == plugin->switch_generation) {
+    plugin->is_switching = FALSE;
+    if (switched) {
+      g_debug("Switched capture to %s in %" PRId64 " ms", device,
+              (g_get_monotonic_time() - started_us) / 1000);
+
+      *plugin->session_source_config = opening.config;
+      plugin->follow_default_device = follow_default;
+      // Only known now for a source that appeared during the wait.
+      SetDeviceName(plugin, opening.config.device);
+    }
+    plugin->session->SendStatus();
+  }
 
-static FlMethodErrorResponse* OnDecibelCancelHandler(FlEventChannel* channel,
-                                                      FlValue* arguments,
-                                                      gpointer user_data) {
-  MicCapturePlugin* plugin = MIC_CAPTURE_PLUGIN(user_data);
-  (void)channel;
-  (void)arguments;
-  g_mutex_lock(&plugin->lock);
-  plugin->has_decibel_listener = FALSE;
-  g_mutex_unlock(&plugin->lock);
-  return nullptr;
+  if (method_call != nullptr) {
+    audio_capture::RespondBool(method_call, switched);
+    g_object_unref(method_call);
+  }
 }
 
-bool StartCapture(MicCapturePlugin* plugin, FlValue* args) {
-  // Always cleanup any existing capture first to ensure clean start
-  // This is important even if isCapturing is false (state might be out of sync)
-  CleanupExistingCapture(plugin);
-  
-  int sample_rate = kDefaultSampleRate;
-  int channels = kDefaultChannels;
-  int bits_per_sample = kDefaultBitsPerSample;
-  float gain_boost = kDefaultGainBoost;
-  float input_volume = kDefaultInputVolume;
-
-  if (args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
-    FlValue* value = nullptr;
-
-    value = fl_value_lookup_string(args, "sampleRate");
-    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_INT) {
-      sample_rate = fl_value_get_int(value);
+// Moves the running session to |device_id|, or to the default source when it
+// is empty, and answers |method_call|, if there is one, once it has. Only the
+// new device is opened, off the main thread as it may first have to wait for
+// a Bluetooth headset's recording profile; the engine then swaps it in under
+// the running pipeline, so chunk assembly, counters and event channels carry
+// on and the audio missed in between is reported as a gap.
+void SwitchCaptureDevice(MicCapturePlugin* plugin,
+                         const std::string& device_id,
+                         FlMethodCall* method_call) {
+  if (plugin->session_source_config == nullptr ||
+      plugin->session->engine() == nullptr ||
+      !plugin->session->engine()->running()) {
+    g_warning("Cannot switch device: not capturing");
+    if (method_call != nullptr) {
+      audio_capture::RespondBool(method_call, false);
     }
-
-    value = fl_value_lookup_string(args, "channels");
-    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_INT) {
-      channels = fl_value_get_int(value);
+    return;
+  }
+
+  audio_capture::AudioDeviceInfo device;
+  bool found = false;
+  if (plugin->device_monitor != nullptr) {
+    found = device_id.empty()
+                ? plugin->device_monitor->DefaultSource(&device)
+                : plugin->device_monitor->FindSource(device_id, &device);
+  }
+
+  // Bind to the device itself, so a later default change is our decision.
+  audio_capture::CaptureSourceConfig config = *plugin->session_source_config;
+  config.device = found ? device.id : device_id;
+  config.monitor = device.is_monitor;
+  // The session keeps its format; only a device laid out the same way keeps
+  // its own channel map.
+  if (!config.channel_map.empty()) {
+    config.channel_map = found && device.channels == config.channels
+                             ? device.channel_map
+                             : std::string();
+  }
+  if (config.device == plugin->session_source_config->device) {
+    // Already there; a switch away still opening is dropped.
+    if (plugin->is_switching) {
+      plugin->switch_generation++;
+      plugin->is_switching = FALSE;
+      plugin->session->SendStatus();
     }
-
-    value = fl_value_lookup_string(args, "bitDepth");
-    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_INT) {
-      bits_per_sample = fl_value_get_int(value);
-    }
-
-    value = fl_value_lookup_string(args, "gainBoost");
-    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_FLOAT) {
-      gain_boost = fl_value_get_float(value);
-      gain_boost = std::max(0.1f, std::min(10.0f, gain_boost));
+    plugin->follow_default_device = device_id.empty();
+    if (method_call != nullptr) {
+      audio_capture::RespondBool(method_call, true);
     }
+    return;
+  }
+
+  plugin->is_switching = TRUE;
+  const guint generation = ++plugin->switch_generation;
+  plugin->session->SendStatus();
+
+  const int64_t started_us = g_get_monotonic_time();
+  audio_capture::PulseDeviceMonitor* monitor = plugin->device_monitor;
+  const audio_capture::CaptureBackend backend = plugin->session->backend();
+  audio_capture::OpenCaptureSourceAsync(
+      plugin->main_context,
+      [monitor, backend, config]() {
+        audio_capture::CaptureSourceOpening opening;
+        opening.config = config;
+        opening.backend = backend;
+        if (!WaitForCaptureTransport(monitor, config.device)) {
+          opening.error_message =
+              "Unknown capture device '" + config.device + "'";
+          return opening;
+        }
+        opening.source = audio_capture::OpenCaptureSource(
+            backend, opening.config, &opening.backend,
+            &opening.error_message);
+        return opening;
+      },
+      [plugin = MIC_CAPTURE_PLUGIN(g_object_ref(plugin)), generation,
+       call = method_call != nullptr
+                  ? static_cast<FlMethodCall*>(g_object_ref(method_call))
+                  : nullptr,
+       follow_default = device_id.empty(),
+       started_us](audio_capture::CaptureSourceOpening opening) {
+        FinishSwitchCaptureDevice(plugin, generation, call, follow_default,
+                                  started_us, std::move(opening));
+        g_object_unref(plugin);
+      });
+}
 
-    value = fl_value_lookup_string(args, "inputVolume");
-    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_FLOAT) {
-      input_volume = fl_value_get_float(value);
-      input_volume = std::max(0.0f, std::min(1.0f, input_volume));
-    }
+// Runs on the main thread after the device monitor saw the default source
+// change.
+gboolean OnDefaultSourceChanged(gpointer user_data) {
+  MicCapturePlugin* plugin = MIC_CAPTURE_PLUGIN(user_data);
+  if (plugin->follow_default_device &&
+      plugin->session_source_config != nullptr) {
+    SwitchCaptureDevice(plugin, std::string(), nullptr);
   }
+  return G_SOURCE_REMOVE;
+}
 
-  // Clamp values
-  sample_rate = std::max(sample_rate, 8000);
-  channels = std::max(1, std::min(channels, 2));
-  bits_per_sample = 16;  // Force 16-bit
-  gain_boost = std::max(0.1f, std::min(10.0f, gain_boost));
-  input_volume = std::max(0.0f, std::min(1.0f, input_volume));
-
-  size_t chunk_size =
-      CalculateChunkSize(sample_rate, channels, bits_per_sample);
+bool HasInputDevice(MicCapturePlugin* plugin) {
+  return plugin->device_monitor != nullptr &&
+         plugin->device_monitor->HasInputDevice();
+}
 
-  // Detect if device is Bluetooth and adjust wait times accordingly
-  bool is_bluetooth = IsBluetoothDevice();
-  
-  g_debug("🎤 Starting capture with config:");
-  g_debug("  Sample Rate: %d Hz", sample_rate);
-  g_debug("  Channels: %d", channels);
-  g_debug("  Bits Per Sample: %d", bits_per_sample);
-  g_debug("  Gain Boost: %.2fx", gain_boost);
-  g_debug("  Input Volume: %.2f", input_volume);
-  g_debug("  Is Bluetooth: %s", is_bluetooth ? "yes" : "no");
-
-  pa_simple* stream = nullptr;
-  std::string error_message;
-
-  // Open stream with retry mechanism
-  if (!OpenPulseStreamWithRetry(sample_rate, channels, bits_per_sample, chunk_size,
-                                 is_bluetooth, &stream, &error_message)) {
-    g_warning("Failed to open PulseAudio stream: %s", error_message.c_str());
-    return false;
+const char* DeviceType(const audio_capture::AudioDeviceInfo& device) {
+  if (device.is_bluetooth()) {
+    return "bluetooth";
   }
-
-  // Get device name
-  std::string device_name = GetCurrentDeviceName();
-  
-  g_mutex_lock(&plugin->lock);
-  if (plugin->is_capturing) {
-    g_mutex_unlock(&plugin->lock);
-    pa_simple_free(stream);
-    g_warning("⚠️ State mismatch: isCapturing=true after cleanup, aborting");
-    return false;
+  if (device.bus == "pci" || device.bus == "platform" || device.bus == "isa") {
+    return "built-in";
   }
+  return "external";
+}
 
-  g_atomic_int_set(&plugin->should_stop, 0);
-  plugin->is_capturing = TRUE;
-  
-  // Store device name
-  if (plugin->current_device_name != nullptr) {
-    g_free(plugin->current_device_name);
+// Lists microphones from the device cache; sink monitors only on request.
+FlValue* GetAvailableInputDevices(MicCapturePlugin* plugin, FlValue* args) {
+  g_autoptr(FlValue) device_list = fl_value_new_list();
+  if (plugin->device_monitor == nullptr) {
+    return g_steal_pointer(&device_list);
   }
-  plugin->current_device_name = g_strdup(device_name.c_str());
-
-  auto* context = new CaptureThreadContext{
-      plugin, stream, chunk_size, sample_rate, channels,
-      bits_per_sample, gain_boost, input_volume};
 
-  g_object_ref(plugin);
-  plugin->capture_thread =
-      g_thread_new("voxa-mic-capture", CaptureThread, context);
-  g_mutex_unlock(&plugin->lock);
-
-  if (plugin->capture_thread == nullptr) {
-    g_warning("Failed to create capture thread");
-    g_mutex_lock(&plugin->lock);
-    plugin->is_capturing = FALSE;
-    if (plugin->current_device_name != nullptr) {
-      g_free(plugin->current_device_name);
-      plugin->current_device_name = nullptr;
+  bool include_monitors = false;
+  if (args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    FlValue* value = fl_value_lookup_string(args, "includeMonitors");
+    if (value != nullptr && fl_value_get_type(value) == FL_VALUE_TYPE_BOOL) {
+      include_monitors = fl_value_get_bool(value);
     }
-    g_mutex_unlock(&plugin->lock);
-    pa_simple_free(stream);
-    g_object_unref(plugin);
-    delete context;
-    return false;
   }
 
-  // Wait a bit to ensure thread has started
-  g_usleep(200000);  // 0.2 seconds
-
-  // Send status update with device name
-  g_mutex_lock(&plugin->lock);
-  const gboolean has_status_listener = plugin->has_status_listener;
-  const gchar* device_name_cstr = plugin->current_device_name;
-  g_mutex_unlock(&plugin->lock);
-  
-  if (has_status_listener && plugin->status_event_channel != nullptr) {
-    g_autoptr(FlValue) status_map = fl_value_new_map();
-    fl_value_set_string_take(status_map, "isActive", fl_value_new_bool(TRUE));
-    fl_value_set_string_take(status_map, "timestamp", fl_value_new_float(g_get_real_time() / 1000000.0));
-    if (device_name_cstr != nullptr) {
-      fl_value_set_string_take(status_map, "deviceName", fl_value_new_string(device_name_cstr));
+  for (const audio_capture::AudioDeviceInfo& device :
+       plugin->device_monitor->Sources()) {
+    if (device.is_monitor && !include_monitors) {
+      continue;
     }
-    
-    g_autoptr(GError) error = nullptr;
-    fl_event_channel_send(plugin->status_event_channel, status_map, nullptr, &error);
-  }
-
-  g_debug("✅ Microphone capture started successfully!");
-  if (device_name_cstr != nullptr) {
-    g_debug("  Device: %s", device_name_cstr);
-  }
-
-  return true;
-}
-
-bool StopCapture(MicCapturePlugin* plugin) {
-  g_mutex_lock(&plugin->lock);
-  if (!plugin->is_capturing) {
-    g_mutex_unlock(&plugin->lock);
-    return false;
+    g_autoptr(FlValue) device_map = fl_value_new_map();
+    fl_value_set_string_take(device_map, "id",
+                             fl_value_new_string(device.id.c_str()));
+    fl_value_set_string_take(device_map, "name",
+                             fl_value_new_string(device.name.c_str()));
+    fl_value_set_string_take(device_map, "type",
+                             fl_value_new_string(DeviceType(device)));
+    fl_value_set_string_take(device_map, "channelCount",
+                             fl_value_new_int(device.channels));
+    fl_value_set_string_take(device_map, "sampleRate",
+                             fl_value_new_int(device.sample_rate));
+    fl_value_set_string_take(device_map, "isMonitor",
+                             fl_value_new_bool(device.is_monitor));
+    fl_value_set_string_take(device_map, "isDefault",
+                             fl_value_new_bool(device.is_default));
+    fl_value_append(device_list, device_map);
   }
-  g_atomic_int_set(&plugin->should_stop, 1);
-  GThread* thread = plugin->capture_thread;
-  g_mutex_unlock(&plugin->lock);
 
-  if (thread != nullptr) {
-    g_thread_join(thread);
-  }
-
-  g_mutex_lock(&plugin->lock);
-  plugin->capture_thread = nullptr;
-  plugin->is_capturing = FALSE;
-  const gboolean has_status_listener = plugin->has_status_listener;
-  g_mutex_unlock(&plugin->lock);
-
-  // Wait a bit to ensure thread has fully stopped
-  g_usleep(100000);  // 0.1 seconds
-
-  // Send status update
-  g_mutex_lock(&plugin->lock);
-  if (plugin->current_device_name != nullptr) {
-    g_free(plugin->current_device_name);
-    plugin->current_device_name = nullptr;
-  }
-  g_mutex_unlock(&plugin->lock);
-  
-  if (has_status_listener && plugin->status_event_channel != nullptr) {
-    g_autoptr(FlValue) status_map = fl_value_new_map();
-    fl_value_set_string_take(status_map, "isActive", fl_value_new_bool(FALSE));
-    fl_value_set_string_take(status_map, "timestamp", fl_value_new_float(g_get_real_time() / 1000000.0));
-    
-    g_autoptr(GError) error = nullptr;
-    fl_event_channel_send(plugin->status_event_channel, status_map, nullptr, &error);
-  }
-
-  return true;
-}
-
-bool HasInputDevice() {
-  return CheckMicSupport();
-}
-
-FlValue* GetAvailableInputDevices() {
-  // For now, return a simple list with default device
-  // In a full implementation, you could use pa_context to query all sources
-  g_autoptr(FlValue) device_list = fl_value_new_list();
-  
-  // Get default device info
-  std::string device_name = GetCurrentDeviceName();
-  bool is_bluetooth = IsBluetoothDevice();
-  
-  g_autoptr(FlValue) device_map = fl_value_new_map();
-  fl_value_set_string_take(device_map, "id", fl_value_new_string("default"));
-  fl_value_set_string_take(device_map, "name", fl_value_new_string(device_name.c_str()));
-  fl_value_set_string_take(device_map, "type", fl_value_new_string(is_bluetooth ? "bluetooth" : "external"));
-  fl_value_set_string_take(device_map, "channelCount", fl_value_new_int(1));
-  fl_value_set_string_take(device_map, "isDefault", fl_value_new_bool(TRUE));
-  
-  fl_value_append_take(device_list, device_map);
-  
   return g_steal_pointer(&device_list);
 }
 
@@ -738,21 +504,50 @@ void HandleMethodCall(MicCapturePlugin* plugin, FlMethodCall* method_call) {
     g_autoptr(FlValue) result = fl_value_new_bool(TRUE);
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
   } else if (strcmp(method, "hasInputDevice") == 0) {
-    const bool has_device = HasInputDevice();
+    const bool has_device = HasInputDevice(plugin);
     g_autoptr(FlValue) result = fl_value_new_bool(has_device);
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
   } else if (strcmp(method, "getAvailableInputDevices") == 0) {
-    g_autoptr(FlValue) devices = GetAvailableInputDevices();
+    g_autoptr(FlValue) devices =
+        GetAvailableInputDevices(plugin, fl_method_call_get_args(method_call));
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(devices));
-  } else if (strcmp(method, "startCapture") == 0) {
-    FlValue* args = fl_method_call_get_args(method_call);
-    const bool started = StartCapture(plugin, args);
-    g_autoptr(FlValue) result = fl_value_new_bool(started);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "startCapture") == 0 ||
+             strcmp(method, "armCapture") == 0) {
+    // Answered once the stream is open.
+    StartCapture(plugin, method_call, strcmp(method, "armCapture") == 0);
+    return;
   } else if (strcmp(method, "stopCapture") == 0) {
-    const bool stopped = StopCapture(plugin);
+    const bool stopped = plugin->session->Stop();
     g_autoptr(FlValue) result = fl_value_new_bool(stopped);
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "pauseCapture") == 0 ||
+             strcmp(method, "resumeCapture") == 0) {
+    const bool done =
+        plugin->session->SetPaused(strcmp(method, "pauseCapture") == 0);
+    g_autoptr(FlValue) result = fl_value_new_bool(done);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  } else if (strcmp(method, "switchDevice") == 0) {
+    FlValue* args = fl_method_call_get_args(method_call);
+    std::string device_id;
+    if (args != nullptr && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+      FlValue* value = fl_value_lookup_string(args, "deviceId");
+      if (value != nullptr &&
+          fl_value_get_type(value) == FL_VALUE_TYPE_STRING) {
+        device_id = fl_value_get_string(value);
+      }
+    }
+    // Answered once the new device is open.
+    SwitchCaptureDevice(plugin, device_id, method_call);
+    return;
+  } else if (strcmp(method, "getStats") == 0) {
+    if (plugin->session->engine() != nullptr) {
+      g_autoptr(FlValue) result = audio_capture::CaptureStatsToValue(
+          plugin->session->engine()->stats());
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    } else {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "UNAVAILABLE", "Capture engine is unavailable", nullptr));
+    }
   } else {
     response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
   }
@@ -775,22 +570,24 @@ static void MethodCallHandler(FlMethodChannel* channel,
 static void mic_capture_plugin_dispose(GObject* object) {
   MicCapturePlugin* plugin = MIC_CAPTURE_PLUGIN(object);
 
-  StopCapture(plugin);
-
-  if (plugin->method_channel != nullptr) {
-    g_clear_object(&plugin->method_channel);
+  if (plugin->device_monitor != nullptr) {
+    plugin->device_monitor->set_default_source_changed_callback(nullptr);
   }
 
-  if (plugin->event_channel != nullptr) {
-    g_clear_object(&plugin->event_channel);
+  if (plugin->session != nullptr) {
+    plugin->session->Stop();
+    delete plugin->session;
+    plugin->session = nullptr;
   }
 
-  if (plugin->status_event_channel != nullptr) {
-    g_clear_object(&plugin->status_event_channel);
-  }
+  delete plugin->device_monitor;
+  plugin->device_monitor = nullptr;
+
+  delete plugin->session_source_config;
+  plugin->session_source_config = nullptr;
 
-  if (plugin->decibel_event_channel != nullptr) {
-    g_clear_object(&plugin->decibel_event_channel);
+  if (plugin->method_channel != nullptr) {
+    g_clear_object(&plugin->method_channel);
   }
 
   if (plugin->current_device_name != nullptr) {
@@ -816,17 +613,34 @@ static void mic_capture_plugin_class_init(MicCapturePluginClass* klass) {
 static void mic_capture_plugin_init(MicCapturePlugin* plugin) {
   g_mutex_init(&plugin->lock);
   plugin->main_context = g_main_context_ref_thread_default();
-  plugin->is_capturing = FALSE;
-  plugin->has_listener = FALSE;
-  plugin->has_status_listener = FALSE;
-  plugin->has_decibel_listener = FALSE;
   plugin->method_channel = nullptr;
-  plugin->event_channel = nullptr;
-  plugin->status_event_channel = nullptr;
-  plugin->decibel_event_channel = nullptr;
-  plugin->capture_thread = nullptr;
   plugin->current_device_name = nullptr;
-  g_atomic_int_set(&plugin->should_stop, 0);
+  plugin->session_source_config = nullptr;
+  plugin->follow_default_device = FALSE;
+  plugin->is_switching = FALSE;
+  plugin->switch_generation = 0;
+
+  // Start listing devices now so the first query is answered from memory.
+  plugin->device_monitor =
+      audio_capture::PulseDeviceMonitor::Create().release();
+  if (plugin->device_monitor != nullptr) {
+    // Hop to the main thread; the reference keeps the plugin alive until the
+    // callback has run.
+    plugin->device_monitor->set_default_source_changed_callback([plugin]() {
+      g_main_context_invoke_full(plugin->main_context, G_PRIORITY_DEFAULT,
+                                 OnDefaultSourceChanged, g_object_ref(plugin),
+                                 g_object_unref);
+    });
+  }
+
+  // The session is deleted before the plugin is disposed, so its hooks do
+  // not need to hold a reference.
+  plugin->session =
+      new audio_capture::CaptureSession(G_OBJECT(plugin), plugin->main_context);
+  plugin->session->set_status_extender(
+      [plugin](FlValue* status_map) { AddDeviceStatus(plugin, status_map); });
+  plugin->session->set_end_handler(
+      [plugin]() { ForgetSessionDevice(plugin); });
 }
 
 void mic_capture_plugin_register_with_registrar(FlPluginRegistrar* registrar) {
@@ -846,32 +660,9 @@ void mic_capture_plugin_register_with_messenger(FlBinaryMessenger* messenger) {
                                             MethodCallHandler, g_object_ref(plugin),
                                             g_object_unref);
 
-  plugin->event_channel = fl_event_channel_new(messenger, kEventChannelName,
-                                                 FL_METHOD_CODEC(codec));
-
-  fl_event_channel_set_stream_handlers(plugin->event_channel, OnListenHandler,
-                                        OnCancelHandler, g_object_ref(plugin),
-                                        g_object_unref);
-
-  // Register status event channel
-  plugin->status_event_channel = fl_event_channel_new(
-      messenger, kStatusEventChannelName, FL_METHOD_CODEC(codec));
-  fl_event_channel_set_stream_handlers(
-      plugin->status_event_channel,
-      OnStatusListenHandler,
-      OnStatusCancelHandler,
-      g_object_ref(plugin),
-      g_object_unref);
-
-  // Register decibel event channel
-  plugin->decibel_event_channel = fl_event_channel_new(
-      messenger, kDecibelEventChannelName, FL_METHOD_CODEC(codec));
-  fl_event_channel_set_stream_handlers(
-      plugin->decibel_event_channel,
-      OnDecibelListenHandler,
-      OnDecibelCancelHandler,
-      g_object_ref(plugin),
-      g_object_unref);
+  plugin->session->RegisterChannels(
+      messenger, FL_METHOD_CODEC(codec), kEventChannelName,
+      kStatusEventChannelName, kDecibelEventChannelName);
 
   g_object_unref(plugin);
 }
@@ -0,0 +1,312 @@
+#include "pipewire_capture_source.h"
+
+#include <spa/param/audio/format-utils.h>
+#include <spa/pod/builder.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+namespace audio_capture {
+
+namespace {
+
+constexpr char kClientName[] = "Voxa";
+constexpr char kLoopName[] = "voxa-pipewire";
+constexpr auto kConnectTimeout = std::chrono::seconds(2);
+
+// Renamed in 0.3.64; the old key is still honoured by newer daemons.
+#ifdef PW_KEY_TARGET_OBJECT
+constexpr char kTargetKey[] = PW_KEY_TARGET_OBJECT;
+#else
+constexpr char kTargetKey[] = PW_KEY_NODE_TARGET;
+#endif
+
+void InitPipeWire() {
+  static std::once_flag once;
+  std::call_once(once, [] { pw_init(nullptr, nullptr); });
+}
+
+spa_audio_info_raw MakeAudioInfo(const CaptureSourceConfig& config) {
+  spa_audio_info_raw info;
+  std::memset(&info, 0, sizeof(info));
+  info.format = config.format == SampleFormat::kF32 ? SPA_AUDIO_FORMAT_F32_LE
+                                                   : SPA_AUDIO_FORMAT_S16_LE;
+  info.rate = static_cast<uint32_t>(config.sample_rate);
+  info.channels = static_cast<uint32_t>(config.channels);
+  if (config.channels == 1) {
+    info.position[0] = SPA_AUDIO_CHANNEL_MONO;
+  } else if (config.channels == 2) {
+    info.position[0] = SPA_AUDIO_CHANNEL_FL;
+    info.position[1] = SPA_AUDIO_CHANNEL_FR;
+  } else {
+    info.flags = SPA_AUDIO_FLAG_UNPOSITIONED;
+  }
+  return info;
+}
+
+// Device ids are PulseAudio source names, which call a sink's monitor
+// "<sink>.monitor". PipeWire instead targets the sink node itself and records
+// its output because stream.capture.sink is set.
+std::string TargetName(const CaptureSourceConfig& config) {
+  static const std::string kMonitorSuffix = ".monitor";
+  const std::string& device = config.device;
+  if (config.monitor && device.size() > kMonitorSuffix.size() &&
+      device.compare(device.size() - kMonitorSuffix.size(),
+                     kMonitorSuffix.size(), kMonitorSuffix) == 0) {
+    return device.substr(0, device.size() - kMonitorSuffix.size());
+  }
+  return device;
+}
+
+bool IsLinked(pw_stream_state state) {
+  return state == PW_STREAM_STATE_PAUSED || state == PW_STREAM_STATE_STREAMING;
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<PipeWireStreamSource> PipeWireStreamSource::Open(
+    const CaptureSourceConfig& config, std::string* error_message) {
+  std::unique_ptr<PipeWireStreamSource> source(new PipeWireStreamSource());
+  if (!source->Connect(config, error_message)) {
+    return nullptr;
+  }
+  return source;
+}
+
+PipeWireStreamSource::~PipeWireStreamSource() {
+  if (loop_ == nullptr) {
+    return;
+  }
+
+  pw_thread_loop_lock(loop_);
+  if (stream_ != nullptr) {
+    if (buffer_ != nullptr) {
+      pw_stream_queue_buffer(stream_, buffer_);
+      buffer_ = nullptr;
+    }
+    pw_stream_destroy(stream_);
+    stream_ = nullptr;
+  }
+  pw_thread_loop_unlock(loop_);
+
+  // The loop thread must not be stopped while holding its lock.
+  pw_thread_loop_stop(loop_);
+  pw_thread_loop_destroy(loop_);
+  loop_ = nullptr;
+}
+
+bool PipeWireStreamSource::Connect(const CaptureSourceConfig& config,
+                                   std::string* error_message) {
+  InitPipeWire();
+
+  frame_bytes_ =
+      BytesPerSample(config.format) * static_cast<size_t>(config.channels);
+  sample_rate_ = config.sample_rate;
+
+  loop_ = pw_thread_loop_new(kLoopName, nullptr);
+  if (loop_ == nullptr) {
+    *error_message = "pw_thread_loop_new() failed";
+    return false;
+  }
+
+  pw_properties* props = pw_properties_new(
+      PW_KEY_MEDIA_TYPE, "Audio", PW_KEY_MEDIA_CATEGORY, "Capture",
+      PW_KEY_APP_NAME, kClientName, nullptr);
+  // Ask the graph for a quantum of one fragment so buffers arrive at the same
+  // pace as fragments from the PulseAudio backend.
+  const size_t fragment_frames =
+      std::max<size_t>(config.fragment_bytes / frame_bytes_, 1);
+  pw_properties_setf(props, PW_KEY_NODE_LATENCY, "%zu/%d", fragment_frames,
+                     config.sample_rate);
+  if (!config.device.empty()) {
+    pw_properties_set(props, kTargetKey, TargetName(config).c_str());
+  }
+  if (config.monitor) {
+    pw_properties_set(props, PW_KEY_STREAM_CAPTURE_SINK, "true");
+  }
+
+  events_.version = PW_VERSION_STREAM_EVENTS;
+  events_.state_changed = OnStateChanged;
+  events_.process = OnProcess;
+
+  pw_thread_loop_lock(loop_);
+
+  if (pw_thread_loop_start(loop_) < 0) {
+    *error_message = "pw_thread_loop_start() failed";
+    pw_properties_free(props);
+    pw_thread_loop_unlock(loop_);
+    return false;
+  }
+
+  // Takes ownership of |props| and connects to the daemon.
+  stream_ = pw_stream_new_simple(pw_thread_loop_get_loop(loop_),
+                                 config.stream_name.c_str(), props, &events_,
+                                 this);
+  if (stream_ == nullptr) {
+    *error_message = std::string("cannot connect to PipeWire: ") +
+                     std::strerror(errno);
+    pw_thread_loop_unlock(loop_);
+    return false;
+  }
+
+  // The daemon converts from the node's native format to exactly this one.
+  uint8_t pod_storage[1024];
+  spa_pod_builder builder;
+  spa_pod_builder_init(&builder, pod_storage, sizeof(pod_storage));
+  spa_audio_info_raw info = MakeAudioInfo(config);
+  const spa_pod* params[1] = {
+      spa_format_audio_raw_build(&builder, SPA_PARAM_EnumFormat, &info)};
+
+  pw_stream_flags flags = static_cast<pw_stream_flags>(
+      PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS);
+  if (config.start_paused) {
+    flags = static_cast<pw_stream_flags>(flags | PW_STREAM_FLAG_INACTIVE);
+  }
+  const int result = pw_stream_connect(stream_, PW_DIRECTION_INPUT, PW_ID_ANY,
+                                       flags, params, 1);
+  if (result < 0) {
+    *error_message = std::string("pw_stream_connect() failed: ") +
+                     std::strerror(-result);
+    pw_thread_loop_unlock(loop_);
+    return false;
+  }
+
+  // Without a matching node the stream stays connecting forever, so give up
+  // after a while and let the caller fall back to another backend.
+  const auto deadline = std::chrono::steady_clock::now() + kConnectTimeout;
+  while (!IsLinked(state_)) {
+    if (state_ == PW_STREAM_STATE_ERROR) {
+      *error_message = stream_error_;
+      pw_thread_loop_unlock(loop_);
+      return false;
+    }
+    if (std::chrono::steady_clock::now() >= deadline) {
+      *error_message = "timed out linking the PipeWire stream";
+      pw_thread_loop_unlock(loop_);
+      return false;
+    }
+    pw_thread_loop_timed_wait(loop_, 1);
+  }
+
+  pw_thread_loop_unlock(loop_);
+  return true;
+}
+
+CaptureReadStatus PipeWireStreamSource::Acquire(const uint8_t** data,
+                                                size_t* bytes) {
+  pw_thread_loop_lock(loop_);
+
+  for (;;) {
+    if (interrupted_) {
+      pw_thread_loop_unlock(loop_);
+      return CaptureReadStatus::kInterrupted;
+    }
+
+    if (!IsLinked(state_) && state_ != PW_STREAM_STATE_CONNECTING) {
+      // The daemon or the node we were linked to went away.
+      last_error_ = stream_error_.empty() ? "PipeWire stream disconnected"
+                                          : stream_error_;
+      pw_thread_loop_unlock(loop_);
+      return CaptureReadStatus::kDisconnected;
+    }
+
+    pw_buffer* buffer = pw_stream_dequeue_buffer(stream_);
+    if (buffer == nullptr) {
+      pw_thread_loop_wait(loop_);
+      continue;
+    }
+
+    const spa_buffer* planes = buffer->buffer;
+    const spa_data* plane = planes->n_datas > 0 ? &planes->datas[0] : nullptr;
+    if (plane == nullptr || plane->data == nullptr || plane->chunk == nullptr) {
+      pw_stream_queue_buffer(stream_, buffer);
+      continue;
+    }
+
+    const uint32_t offset = std::min(plane->chunk->offset, plane->maxsize);
+    size_t length = std::min(plane->chunk->size, plane->maxsize - offset);
+    length -= length % frame_bytes_;
+    if (length == 0) {
+      pw_stream_queue_buffer(stream_, buffer);
+      continue;
+    }
+
+    buffer_ = buffer;
+    fragment_latency_us_ = FragmentLatency();
+    quantum_us_ = static_cast<int64_t>(length / frame_bytes_) * 1000000 /
+                  sample_rate_;
+    *data = static_cast<const uint8_t*>(plane->data) + offset;
+    *bytes = length;
+    pw_thread_loop_unlock(loop_);
+    return CaptureReadStatus::kOk;
+  }
+}
+
+void PipeWireStreamSource::Release() {
+  pw_thread_loop_lock(loop_);
+  if (buffer_ != nullptr) {
+    pw_stream_queue_buffer(stream_, buffer_);
+    buffer_ = nullptr;
+  }
+  pw_thread_loop_unlock(loop_);
+}
+
+void PipeWireStreamSource::Interrupt() {
+  pw_thread_loop_lock(loop_);
+  interrupted_ = true;
+  pw_thread_loop_signal(loop_, false);
+  pw_thread_loop_unlock(loop_);
+}
+
+bool PipeWireStreamSource::SetPaused(bool paused) {
+  pw_thread_loop_lock(loop_);
+  const bool done = pw_stream_set_active(stream_, !paused) >= 0;
+  pw_thread_loop_unlock(loop_);
+  return done;
+}
+
+// Called with the loop lock held, right after a buffer was dequeued.
+int64_t PipeWireStreamSource::FragmentLatency() const {
+  pw_time time;
+  if (pw_stream_get_time_n(stream_, &time, sizeof(time)) < 0 ||
+      time.rate.denom == 0) {
+    return 0;
+  }
+
+  // |delay| is how long ago, in graph clock ticks, the device captured what
+  // the stream is receiving now; |buffered| frames still sit in the stream's
+  // converter on top of that.
+  const int64_t delay_us = time.delay * 1000000 *
+                           static_cast<int64_t>(time.rate.num) /
+                           static_cast<int64_t>(time.rate.denom);
+  const int64_t buffered_us =
+      static_cast<int64_t>(time.buffered) * 1000000 / sample_rate_;
+  return std::max<int64_t>(delay_us + buffered_us, 0);
+}
+
+// static
+void PipeWireStreamSource::OnStateChanged(void* user_data,
+                                          pw_stream_state old_state,
+                                          pw_stream_state state,
+                                          const char* error) {
+  (void)old_state;
+  auto* self = static_cast<PipeWireStreamSource*>(user_data);
+  self->state_ = state;
+  if (state == PW_STREAM_STATE_ERROR) {
+    self->stream_error_ = error != nullptr ? error : "PipeWire stream error";
+  }
+  pw_thread_loop_signal(self->loop_, false);
+}
+
+// static
+void PipeWireStreamSource::OnProcess(void* user_data) {
+  auto* self = static_cast<PipeWireStreamSource*>(user_data);
+  pw_thread_loop_signal(self->loop_, false);
+}
+
+}  // namespace audio_capture
@@ -0,0 +1,67 @@
+#ifndef FLUTTER_PLUGIN_PIPEWIRE_CAPTURE_SOURCE_H_
+#define FLUTTER_PLUGIN_PIPEWIRE_CAPTURE_SOURCE_H_
+
+#include <pipewire/pipewire.h>
+
+#include <memory>
+#include <string>
+
+#include "capture_source.h"
+
+namespace audio_capture {
+
+// Native PipeWire capture stream driven by pw_thread_loop. PipeWire hands the
+// stream one buffer per graph cycle (quantum); the process callback only
+// wakes the consumer, which dequeues the buffer zero-copy and queues it back
+// on Release().
+class PipeWireStreamSource : public CaptureSource {
+ public:
+  // Fails when no PipeWire daemon is reachable or the stream cannot be linked
+  // to a node within a couple of seconds.
+  static std::unique_ptr<PipeWireStreamSource> Open(
+      const CaptureSourceConfig& config, std::string* error_message);
+
+  ~PipeWireStreamSource() override;
+
+  PipeWireStreamSource(const PipeWireStreamSource&) = delete;
+  PipeWireStreamSource& operator=(const PipeWireStreamSource&) = delete;
+
+  CaptureReadStatus Acquire(const uint8_t** data, size_t* bytes) override;
+  void Release() override;
+  void Interrupt() override;
+  // Deactivates or reactivates the stream in the graph.
+  bool SetPaused(bool paused) override;
+
+  int64_t fragment_latency_us() const override { return fragment_latency_us_; }
+  int64_t negotiated_latency_us() const override { return quantum_us_; }
+
+ private:
+  PipeWireStreamSource() = default;
+
+  bool Connect(const CaptureSourceConfig& config, std::string* error_message);
+  int64_t FragmentLatency() const;
+
+  static void OnStateChanged(void* user_data, pw_stream_state old_state,
+                             pw_stream_state state, const char* error);
+  static void OnProcess(void* user_data);
+
+  pw_thread_loop* loop_ = nullptr;
+  pw_stream* stream_ = nullptr;
+  pw_stream_events events_{};
+  pw_buffer* buffer_ = nullptr;
+  size_t frame_bytes_ = 0;
+  int sample_rate_ = 0;
+  int64_t fragment_latency_us_ = 0;
+  // Duration of the last buffer, i.e. the graph quantum currently in force.
+  int64_t quantum_us_ = 0;
+
+  // Written by the loop thread with the loop lock held.
+  pw_stream_state state_ = PW_STREAM_STATE_UNCONNECTED;
+  std::string stream_error_;
+  // Set with the loop lock held.
+  bool interrupted_ = false;
+};
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_PIPEWIRE_CAPTURE_SOURCE_H_
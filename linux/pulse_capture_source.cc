@@ -0,0 +1,415 @@
+#include "pulse_capture_source.h"
+
+#include <glib.h>
+#include <pulse/error.h>
+
+#include <cinttypes>
+#include <cstdint>
+
+namespace audio_capture {
+
+namespace {
+
+constexpr char kClientName[] = "Voxa";
+constexpr char kDefaultMonitorName[] = "@DEFAULT_MONITOR@";
+
+// nullptr selects the server's default source.
+const char* SourceName(const CaptureSourceConfig& config) {
+  if (!config.device.empty()) {
+    return config.device.c_str();
+  }
+  return config.monitor ? kDefaultMonitorName : nullptr;
+}
+
+pa_sample_spec MakeSampleSpec(const CaptureSourceConfig& config) {
+  pa_sample_spec spec;
+  spec.format = config.format == SampleFormat::kF32 ? PA_SAMPLE_FLOAT32LE
+                                                   : PA_SAMPLE_S16LE;
+  spec.rate = static_cast<uint32_t>(config.sample_rate);
+  spec.channels = static_cast<uint8_t>(config.channels);
+  return spec;
+}
+
+// The configured channel map, or nullptr for the default map of the
+// configured channel count.
+const pa_channel_map* ParseChannelMap(const CaptureSourceConfig& config,
+                                      pa_channel_map* map) {
+  if (config.channel_map.empty() ||
+      pa_channel_map_parse(map, config.channel_map.c_str()) == nullptr ||
+      map->channels != config.channels) {
+    return nullptr;
+  }
+  return map;
+}
+
+// Failures that reconnecting cannot fix, such as a refused format or missing
+// permission, are errors; everything else means the server, the connection
+// or the device went away.
+CaptureReadStatus ReadFailure(int error) {
+  switch (error) {
+    case PA_ERR_ACCESS:
+    case PA_ERR_INVALID:
+    case PA_ERR_AUTHKEY:
+    case PA_ERR_VERSION:
+    case PA_ERR_NOTSUPPORTED:
+      return CaptureReadStatus::kError;
+    default:
+      return CaptureReadStatus::kDisconnected;
+  }
+}
+
+pa_buffer_attr MakeBufferAttr(const CaptureSourceConfig& config) {
+  pa_buffer_attr attr;
+  attr.maxlength = static_cast<uint32_t>(config.max_buffer_bytes);
+  attr.tlength = static_cast<uint32_t>(-1);
+  attr.prebuf = static_cast<uint32_t>(-1);
+  attr.minreq = static_cast<uint32_t>(-1);
+  attr.fragsize = static_cast<uint32_t>(config.fragment_bytes);
+  return attr;
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<PulseStreamSource> PulseStreamSource::Open(
+    const CaptureSourceConfig& config, std::string* error_message) {
+  std::unique_ptr<PulseStreamSource> source(new PulseStreamSource());
+  if (!source->Connect(config, error_message)) {
+    return nullptr;
+  }
+  return source;
+}
+
+PulseStreamSource::~PulseStreamSource() {
+  if (mainloop_ == nullptr) {
+    return;
+  }
+
+  pa_threaded_mainloop_lock(mainloop_);
+  if (stream_ != nullptr) {
+    if (has_fragment_) {
+      pa_stream_drop(stream_);
+    }
+    pa_stream_set_state_callback(stream_, nullptr, nullptr);
+    pa_stream_set_read_callback(stream_, nullptr, nullptr);
+    pa_stream_set_overflow_callback(stream_, nullptr, nullptr);
+    pa_stream_disconnect(stream_);
+    pa_stream_unref(stream_);
+    stream_ = nullptr;
+  }
+  if (context_ != nullptr) {
+    pa_context_set_state_callback(context_, nullptr, nullptr);
+    pa_context_disconnect(context_);
+    pa_context_unref(context_);
+    context_ = nullptr;
+  }
+  pa_threaded_mainloop_unlock(mainloop_);
+
+  // The mainloop thread must not be stopped while holding its lock.
+  pa_threaded_mainloop_stop(mainloop_);
+  pa_threaded_mainloop_free(mainloop_);
+  mainloop_ = nullptr;
+}
+
+bool PulseStreamSource::Connect(const CaptureSourceConfig& config,
+                                std::string* error_message) {
+  mainloop_ = pa_threaded_mainloop_new();
+  if (mainloop_ == nullptr) {
+    *error_message = "pa_threaded_mainloop_new() failed";
+    return false;
+  }
+
+  context_ = pa_context_new(pa_threaded_mainloop_get_api(mainloop_),
+                            kClientName);
+  if (context_ == nullptr) {
+    *error_message = "pa_context_new() failed";
+    return false;
+  }
+  pa_context_set_state_callback(context_, OnContextState, this);
+
+  pa_threaded_mainloop_lock(mainloop_);
+
+  if (pa_context_connect(context_, nullptr, PA_CONTEXT_NOFLAGS, nullptr) < 0 ||
+      pa_threaded_mainloop_start(mainloop_) < 0) {
+    *error_message = ContextError();
+    pa_threaded_mainloop_unlock(mainloop_);
+    return false;
+  }
+
+  for (;;) {
+    const pa_context_state_t state = pa_context_get_state(context_);
+    if (state == PA_CONTEXT_READY) {
+      break;
+    }
+    if (!PA_CONTEXT_IS_GOOD(state)) {
+      *error_message = ContextError();
+      pa_threaded_mainloop_unlock(mainloop_);
+      return false;
+    }
+    pa_threaded_mainloop_wait(mainloop_);
+  }
+
+  const pa_sample_spec spec = MakeSampleSpec(config);
+  pa_channel_map map;
+  stream_ = pa_stream_new(context_, config.stream_name.c_str(), &spec,
+                          ParseChannelMap(config, &map));
+  if (stream_ == nullptr) {
+    *error_message = ContextError();
+    pa_threaded_mainloop_unlock(mainloop_);
+    return false;
+  }
+  pa_stream_set_state_callback(stream_, OnStreamState, this);
+  pa_stream_set_read_callback(stream_, OnStreamRead, this);
+  pa_stream_set_overflow_callback(stream_, OnStreamOverflow, this);
+
+  // Keep timing info fresh so every fragment can be stamped with its capture
+  // latency without a server round trip.
+  pa_stream_flags_t flags = static_cast<pa_stream_flags_t>(
+      PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE);
+  if (config.adjust_latency) {
+    // fragsize then becomes the overall latency target and the server
+    // reconfigures the source to meet it.
+    flags = static_cast<pa_stream_flags_t>(flags | PA_STREAM_ADJUST_LATENCY);
+  }
+  if (config.start_paused) {
+    flags = static_cast<pa_stream_flags_t>(flags | PA_STREAM_START_CORKED);
+  }
+  const pa_buffer_attr attr = MakeBufferAttr(config);
+  const char* device = SourceName(config);
+  if (pa_stream_connect_record(stream_, device, &attr, flags) < 0) {
+    *error_message = ContextError();
+    pa_threaded_mainloop_unlock(mainloop_);
+    return false;
+  }
+
+  for (;;) {
+    const pa_stream_state_t state = pa_stream_get_state(stream_);
+    if (state == PA_STREAM_READY) {
+      break;
+    }
+    if (!PA_STREAM_IS_GOOD(state)) {
+      *error_message = ContextError();
+      pa_threaded_mainloop_unlock(mainloop_);
+      return false;
+    }
+    pa_threaded_mainloop_wait(mainloop_);
+  }
+
+  const pa_buffer_attr* negotiated = pa_stream_get_buffer_attr(stream_);
+  if (negotiated != nullptr) {
+    negotiated_latency_us_ = static_cast<int64_t>(
+        pa_bytes_to_usec(negotiated->fragsize, &spec));
+    g_debug("PulseAudio record stream negotiated %" PRId64
+            " us (fragsize %u, maxlength %u)", negotiated_latency_us_,
+            negotiated->fragsize, negotiated->maxlength);
+  }
+
+  pa_threaded_mainloop_unlock(mainloop_);
+  return true;
+}
+
+CaptureReadStatus PulseStreamSource::Acquire(const uint8_t** data,
+                                             size_t* bytes) {
+  pa_threaded_mainloop_lock(mainloop_);
+
+  for (;;) {
+    if (interrupted_) {
+      pa_threaded_mainloop_unlock(mainloop_);
+      return CaptureReadStatus::kInterrupted;
+    }
+
+    if (!PA_STREAM_IS_GOOD(pa_stream_get_state(stream_))) {
+      last_error_ = ContextError();
+      const int error = pa_context_errno(context_);
+      pa_threaded_mainloop_unlock(mainloop_);
+      return ReadFailure(error);
+    }
+
+    if (pa_stream_readable_size(stream_) > 0) {
+      const void* fragment = nullptr;
+      size_t length = 0;
+      if (pa_stream_peek(stream_, &fragment, &length) < 0) {
+        last_error_ = ContextError();
+        const int error = pa_context_errno(context_);
+        pa_threaded_mainloop_unlock(mainloop_);
+        return ReadFailure(error);
+      }
+
+      if (fragment == nullptr && length > 0) {
+        // A hole in the record buffer; nothing to hand out.
+        pa_stream_drop(stream_);
+        continue;
+      }
+
+      if (length > 0) {
+        has_fragment_ = true;
+        fragment_latency_us_ = FragmentLatency(length);
+        *data = static_cast<const uint8_t*>(fragment);
+        *bytes = length;
+        pa_threaded_mainloop_unlock(mainloop_);
+        return CaptureReadStatus::kOk;
+      }
+    }
+
+    pa_threaded_mainloop_wait(mainloop_);
+  }
+}
+
+void PulseStreamSource::Release() {
+  pa_threaded_mainloop_lock(mainloop_);
+  if (has_fragment_) {
+    pa_stream_drop(stream_);
+    has_fragment_ = false;
+  }
+  pa_threaded_mainloop_unlock(mainloop_);
+}
+
+void PulseStreamSource::Interrupt() {
+  pa_threaded_mainloop_lock(mainloop_);
+  interrupted_ = true;
+  pa_threaded_mainloop_signal(mainloop_, 0);
+  pa_threaded_mainloop_unlock(mainloop_);
+}
+
+bool PulseStreamSource::SetPaused(bool paused) {
+  pa_threaded_mainloop_lock(mainloop_);
+  cork_result_ = -1;
+  pa_operation* operation =
+      pa_stream_cork(stream_, paused ? 1 : 0, OnStreamCorked, this);
+  if (operation == nullptr) {
+    pa_threaded_mainloop_unlock(mainloop_);
+    return false;
+  }
+  // One round trip. The operation is cancelled if the stream dies meanwhile.
+  while (pa_operation_get_state(operation) == PA_OPERATION_RUNNING) {
+    pa_threaded_mainloop_wait(mainloop_);
+  }
+  pa_operation_unref(operation);
+  const bool corked = cork_result_ > 0;
+  pa_threaded_mainloop_unlock(mainloop_);
+  return corked;
+}
+
+// Called with the mainloop lock held, right after |fragment_bytes| were
+// peeked.
+int64_t PulseStreamSource::FragmentLatency(size_t fragment_bytes) const {
+  const pa_timing_info* timing = pa_stream_get_timing_info(stream_);
+  if (timing == nullptr || timing->read_index_corrupt ||
+      timing->write_index_corrupt) {
+    return 0;
+  }
+
+  // The newest frame of the fragment sits at read_index + fragment_bytes.
+  // Everything the server wrote after it was captured later, and the device
+  // itself holds source_usec more.
+  const int64_t queued = timing->write_index - timing->read_index -
+                         static_cast<int64_t>(fragment_bytes);
+  const pa_usec_t queued_usec =
+      queued > 0 ? pa_bytes_to_usec(static_cast<uint64_t>(queued),
+                                    pa_stream_get_sample_spec(stream_))
+                 : 0;
+  return static_cast<int64_t>(timing->source_usec + timing->transport_usec +
+                              queued_usec);
+}
+
+std::string PulseStreamSource::ContextError() const {
+  if (context_ == nullptr) {
+    return "no PulseAudio context";
+  }
+  return pa_strerror(pa_context_errno(context_));
+}
+
+// static
+void PulseStreamSource::OnContextState(pa_context* context, void* user_data) {
+  (void)context;
+  auto* self = static_cast<PulseStreamSource*>(user_data);
+  pa_threaded_mainloop_signal(self->mainloop_, 0);
+}
+
+// static
+void PulseStreamSource::OnStreamState(pa_stream* stream, void* user_data) {
+  (void)stream;
+  auto* self = static_cast<PulseStreamSource*>(user_data);
+  pa_threaded_mainloop_signal(self->mainloop_, 0);
+}
+
+// static
+void PulseStreamSource::OnStreamRead(pa_stream* stream, size_t length,
+                                     void* user_data) {
+  (void)stream;
+  (void)length;
+  auto* self = static_cast<PulseStreamSource*>(user_data);
+  pa_threaded_mainloop_signal(self->mainloop_, 0);
+}
+
+// static
+void PulseStreamSource::OnStreamOverflow(pa_stream* stream, void* user_data) {
+  (void)stream;
+  auto* self = static_cast<PulseStreamSource*>(user_data);
+  self->overruns_.fetch_add(1, std::memory_order_relaxed);
+}
+
+// static
+void PulseStreamSource::OnStreamCorked(pa_stream* stream, int success,
+                                       void* user_data) {
+  (void)stream;
+  auto* self = static_cast<PulseStreamSource*>(user_data);
+  self->cork_result_ = success;
+  pa_threaded_mainloop_signal(self->mainloop_, 0);
+}
+
+// static
+std::unique_ptr<PulseSimpleSource> PulseSimpleSource::Open(
+    const CaptureSourceConfig& config, std::string* error_message) {
+  const pa_sample_spec spec = MakeSampleSpec(config);
+  pa_channel_map map;
+  const pa_buffer_attr attr = MakeBufferAttr(config);
+  const char* device = SourceName(config);
+
+  int error = 0;
+  pa_simple* stream = pa_simple_new(
+      nullptr, kClientName, PA_STREAM_RECORD, device,
+      config.stream_name.c_str(), &spec, ParseChannelMap(config, &map), &attr,
+      &error);
+  if (stream == nullptr) {
+    *error_message = pa_strerror(error);
+    return nullptr;
+  }
+
+  return std::unique_ptr<PulseSimpleSource>(
+      new PulseSimpleSource(stream, config.fragment_bytes));
+}
+
+PulseSimpleSource::PulseSimpleSource(pa_simple* stream, size_t fragment_bytes)
+    : stream_(stream), fragment_(fragment_bytes) {}
+
+PulseSimpleSource::~PulseSimpleSource() {
+  pa_simple_free(stream_);
+}
+
+CaptureReadStatus PulseSimpleSource::Acquire(const uint8_t** data,
+                                             size_t* bytes) {
+  int error = 0;
+  if (pa_simple_read(stream_, fragment_.data(), fragment_.size(), &error) < 0) {
+    last_error_ = pa_strerror(error);
+    return ReadFailure(error);
+  }
+  *data = fragment_.data();
+  *bytes = fragment_.size();
+  return CaptureReadStatus::kOk;
+}
+
+std::unique_ptr<CaptureSource> OpenPulseCaptureSource(
+    const CaptureSourceConfig& config, std::string* error_message) {
+  std::unique_ptr<CaptureSource> source =
+      PulseStreamSource::Open(config, error_message);
+  if (source != nullptr) {
+    return source;
+  }
+
+  g_debug("pa_stream capture unavailable (%s), falling back to pa_simple",
+          error_message->c_str());
+  return PulseSimpleSource::Open(config, error_message);
+}
+
+}  // namespace audio_capture
@@ -0,0 +1,100 @@
+#ifndef FLUTTER_PLUGIN_PULSE_CAPTURE_SOURCE_H_
+#define FLUTTER_PLUGIN_PULSE_CAPTURE_SOURCE_H_
+
+#include <pulse/pulseaudio.h>
+#include <pulse/simple.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "capture_source.h"
+
+namespace audio_capture {
+
+// Record stream driven by pa_threaded_mainloop. The read callback only wakes
+// the consumer; fragments are handed out zero-copy via pa_stream_peek.
+class PulseStreamSource : public CaptureSource {
+ public:
+  static std::unique_ptr<PulseStreamSource> Open(
+      const CaptureSourceConfig& config, std::string* error_message);
+
+  ~PulseStreamSource() override;
+
+  PulseStreamSource(const PulseStreamSource&) = delete;
+  PulseStreamSource& operator=(const PulseStreamSource&) = delete;
+
+  CaptureReadStatus Acquire(const uint8_t** data, size_t* bytes) override;
+  void Release() override;
+  void Interrupt() override;
+  // Corks or uncorks the stream, waiting for the server to confirm.
+  bool SetPaused(bool paused) override;
+
+  int64_t fragment_latency_us() const override { return fragment_latency_us_; }
+  int64_t negotiated_latency_us() const override {
+    return negotiated_latency_us_;
+  }
+  uint64_t overrun_count() const override {
+    return overruns_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  PulseStreamSource() = default;
+
+  int64_t FragmentLatency(size_t fragment_bytes) const;
+
+  bool Connect(const CaptureSourceConfig& config, std::string* error_message);
+  std::string ContextError() const;
+
+  static void OnContextState(pa_context* context, void* user_data);
+  static void OnStreamState(pa_stream* stream, void* user_data);
+  static void OnStreamRead(pa_stream* stream, size_t length, void* user_data);
+  static void OnStreamOverflow(pa_stream* stream, void* user_data);
+  static void OnStreamCorked(pa_stream* stream, int success, void* user_data);
+
+  pa_threaded_mainloop* mainloop_ = nullptr;
+  pa_context* context_ = nullptr;
+  pa_stream* stream_ = nullptr;
+  bool has_fragment_ = false;
+  // Set with the mainloop lock held.
+  bool interrupted_ = false;
+  // Outcome of the last cork request: -1 while it is in flight.
+  int cork_result_ = 0;
+  int64_t fragment_latency_us_ = 0;
+  int64_t negotiated_latency_us_ = 0;
+  std::atomic<uint64_t> overruns_{0};
+};
+
+// Blocking pa_simple fallback for servers where the asynchronous API cannot be
+// set up. Reads one fragment at a time so chunking still happens upstream;
+// pa_simple_read cannot be woken, so that also bounds how long an interrupt
+// takes.
+class PulseSimpleSource : public CaptureSource {
+ public:
+  static std::unique_ptr<PulseSimpleSource> Open(
+      const CaptureSourceConfig& config, std::string* error_message);
+
+  ~PulseSimpleSource() override;
+
+  PulseSimpleSource(const PulseSimpleSource&) = delete;
+  PulseSimpleSource& operator=(const PulseSimpleSource&) = delete;
+
+  CaptureReadStatus Acquire(const uint8_t** data, size_t* bytes) override;
+  void Release() override {}
+
+ private:
+  PulseSimpleSource(pa_simple* stream, size_t fragment_bytes);
+
+  pa_simple* stream_;
+  std::vector<uint8_t> fragment_;
+};
+
+// Opens a callback-driven record stream, falling back to pa_simple when the
+// asynchronous connection fails.
+std::unique_ptr<CaptureSource> OpenPulseCaptureSource(
+    const CaptureSourceConfig& config, std::string* error_message);
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_PULSE_CAPTURE_SOURCE_H_
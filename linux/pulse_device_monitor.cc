@@ -0,0 +1,446 @@
+#include "pulse_device_monitor.h"
+
+#include <glib.h>
+
+#include <chrono>
+#include <utility>
+
+namespace audio_capture {
+
+namespace {
+
+constexpr char kClientName[] = "Voxa";
+constexpr auto kInitialSyncTimeout = std::chrono::milliseconds(500);
+constexpr pa_usec_t kReconnectDelayUs = PA_USEC_PER_SEC;
+
+void Unref(pa_operation* operation) {
+  if (operation != nullptr) {
+    pa_operation_unref(operation);
+  }
+}
+
+}  // namespace
+
+// static
+std::unique_ptr<PulseDeviceMonitor> PulseDeviceMonitor::Create() {
+  std::unique_ptr<PulseDeviceMonitor> monitor(new PulseDeviceMonitor());
+  if (!monitor->Start()) {
+    return nullptr;
+  }
+  return monitor;
+}
+
+PulseDeviceMonitor::~PulseDeviceMonitor() {
+  if (mainloop_ == nullptr) {
+    return;
+  }
+
+  pa_threaded_mainloop_lock(mainloop_);
+  if (reconnect_event_ != nullptr) {
+    pa_threaded_mainloop_get_api(mainloop_)->time_free(reconnect_event_);
+    reconnect_event_ = nullptr;
+  }
+  DropContext();
+  pa_threaded_mainloop_unlock(mainloop_);
+
+  // The mainloop thread must not be stopped while holding its lock.
+  pa_threaded_mainloop_stop(mainloop_);
+  pa_threaded_mainloop_free(mainloop_);
+  mainloop_ = nullptr;
+}
+
+bool PulseDeviceMonitor::Start() {
+  mainloop_ = pa_threaded_mainloop_new();
+  if (mainloop_ == nullptr) {
+    g_warning("Device monitor: pa_threaded_mainloop_new() failed");
+    return false;
+  }
+
+  pa_threaded_mainloop_lock(mainloop_);
+  Connect();
+  const bool started = pa_threaded_mainloop_start(mainloop_) >= 0;
+  pa_threaded_mainloop_unlock(mainloop_);
+  if (!started) {
+    g_warning("Device monitor: pa_threaded_mainloop_start() failed");
+  }
+  return started;
+}
+
+std::vector<AudioDeviceInfo> PulseDeviceMonitor::Sources() const {
+  WaitForSync();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<AudioDeviceInfo> sources;
+  sources.reserve(sources_.size());
+  for (const auto& entry : sources_) {
+    sources.push_back(Describe(entry.second));
+  }
+  return sources;
+}
+
+bool PulseDeviceMonitor::HasInputDevice() const {
+  WaitForSync();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& entry : sources_) {
+    if (!entry.second.is_monitor) {
+      return true;
+    }
+  }
+  return false;
+}
+
+template <typename Predicate>
+bool PulseDeviceMonitor::FindIf(Predicate predicate,
+                                AudioDeviceInfo* info) const {
+  WaitForSync();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (const auto& entry : sources_) {
+    if (predicate(entry.second)) {
+      *info = Describe(entry.second);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool PulseDeviceMonitor::DefaultSource(AudioDeviceInfo* info) const {
+  return FindIf(
+      [this](const AudioDeviceInfo& source) {
+        return source.id == default_source_;
+      },
+      info);
+}
+
+bool PulseDeviceMonitor::DefaultSinkMonitor(AudioDeviceInfo* info) const {
+  return FindIf(
+      [this](const AudioDeviceInfo& source) {
+        return source.is_monitor && !default_sink_.empty() &&
+               source.monitor_of == default_sink_;
+      },
+      info);
+}
+
+bool PulseDeviceMonitor::FindSource(const std::string& id,
+                                    AudioDeviceInfo* info) const {
+  return FindIf(
+      [&id](const AudioDeviceInfo& source) { return source.id == id; }, info);
+}
+
+bool PulseDeviceMonitor::WaitForReadySource(const std::string& id,
+                                            std::chrono::milliseconds timeout,
+                                            AudioDeviceInfo* info) const {
+  WaitForSync();
+
+  bool ready = false;
+  std::unique_lock<std::mutex> lock(mutex_);
+  devices_changed_.wait_for(lock, timeout, [this, &id, info, &ready] {
+    const std::string& wanted = id.empty() ? default_source_ : id;
+    for (const auto& entry : sources_) {
+      if (!wanted.empty() && entry.second.id == wanted) {
+        *info = Describe(entry.second);
+        ready = info->transport_ready;
+        return ready;
+      }
+    }
+    return false;
+  });
+  return ready;
+}
+
+AudioDeviceInfo PulseDeviceMonitor::Describe(
+    const AudioDeviceInfo& source) const {
+  AudioDeviceInfo info = source;
+  info.is_default = source.id == default_source_;
+  const auto card = cards_.find(source.card);
+  if (card != cards_.end()) {
+    info.card_profile = card->second.profile;
+  }
+  // A Bluetooth card exposes its microphone only in a headset profile; until
+  // the switch completes the source may linger but records nothing. Sink
+  // monitors do not depend on the profile's inputs.
+  if (info.is_bluetooth() && !info.is_monitor) {
+    info.transport_ready = card != cards_.end() && card->second.has_input;
+  }
+  return info;
+}
+
+void PulseDeviceMonitor::set_default_source_changed_callback(
+    DefaultSourceChangedCallback callback) {
+  std::lock_guard<std::mutex> lock(callback_mutex_);
+  default_source_changed_ = std::move(callback);
+}
+
+void PulseDeviceMonitor::WaitForSync() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  synced_changed_.wait_for(lock, kInitialSyncTimeout,
+                           [this] { return synced_; });
+}
+
+void PulseDeviceMonitor::Connect() {
+  context_ = pa_context_new(pa_threaded_mainloop_get_api(mainloop_),
+                            kClientName);
+  if (context_ == nullptr) {
+    g_warning("Device monitor: pa_context_new() failed");
+    MarkSynced();
+    return;
+  }
+  pa_context_set_state_callback(context_, OnContextState, this);
+  pa_context_set_subscribe_callback(context_, OnSubscriptionEvent, this);
+
+  if (pa_context_connect(context_, nullptr, PA_CONTEXT_NOFLAGS, nullptr) < 0) {
+    MarkSynced();
+    ScheduleReconnect();
+  }
+}
+
+void PulseDeviceMonitor::DropContext() {
+  if (context_ == nullptr) {
+    return;
+  }
+  pa_context_set_state_callback(context_, nullptr, nullptr);
+  pa_context_set_subscribe_callback(context_, nullptr, nullptr);
+  pa_context_disconnect(context_);
+  pa_context_unref(context_);
+  context_ = nullptr;
+}
+
+void PulseDeviceMonitor::ScheduleReconnect() {
+  if (reconnect_event_ != nullptr) {
+    return;
+  }
+  struct timeval when;
+  pa_timeval_add(pa_gettimeofday(&when), kReconnectDelayUs);
+  pa_mainloop_api* api = pa_threaded_mainloop_get_api(mainloop_);
+  reconnect_event_ = api->time_new(api, &when, OnReconnectTimer, this);
+}
+
+void PulseDeviceMonitor::MarkSynced() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    synced_ = true;
+  }
+  synced_changed_.notify_all();
+}
+
+void PulseDeviceMonitor::FinishInitialRequest() {
+  if (pending_requests_ > 0 && --pending_requests_ == 0) {
+    MarkSynced();
+  }
+}
+
+void PulseDeviceMonitor::UpdateSource(const pa_source_info& source) {
+  AudioDeviceInfo info;
+  info.id = source.name != nullptr ? source.name : "";
+  info.name = source.description != nullptr ? source.description : info.id;
+  info.channels = source.sample_spec.channels;
+  info.sample_rate = static_cast<int>(source.sample_spec.rate);
+  char channel_map[PA_CHANNEL_MAP_SNPRINT_MAX];
+  info.channel_map =
+      pa_channel_map_snprint(channel_map, sizeof(channel_map),
+                             &source.channel_map);
+  info.is_monitor = source.monitor_of_sink != PA_INVALID_INDEX;
+  if (info.is_monitor && source.monitor_of_sink_name != nullptr) {
+    info.monitor_of = source.monitor_of_sink_name;
+  }
+  const char* bus = pa_proplist_gets(source.proplist, PA_PROP_DEVICE_BUS);
+  info.bus = bus != nullptr ? bus : "";
+  const char* api = pa_proplist_gets(source.proplist, PA_PROP_DEVICE_API);
+  info.api = api != nullptr ? api : "";
+  info.card = source.card;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sources_[source.index] = info;
+  }
+  devices_changed_.notify_all();
+}
+
+void PulseDeviceMonitor::RemoveSource(uint32_t index) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sources_.erase(index);
+  }
+  devices_changed_.notify_all();
+}
+
+void PulseDeviceMonitor::UpdateCard(const pa_card_info& card) {
+  CardState state;
+  const pa_card_profile_info2* profile = card.active_profile2;
+  if (profile != nullptr) {
+    state.profile = profile->name != nullptr ? profile->name : "";
+    state.has_input =
+        profile->n_sources > 0 && profile->available != PA_AVAILABLE_NO;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cards_[card.index] = state;
+  }
+  devices_changed_.notify_all();
+}
+
+void PulseDeviceMonitor::RemoveCard(uint32_t index) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cards_.erase(index);
+  }
+  devices_changed_.notify_all();
+}
+
+// static
+void PulseDeviceMonitor::OnContextState(pa_context* context, void* user_data) {
+  auto* self = static_cast<PulseDeviceMonitor*>(user_data);
+  switch (pa_context_get_state(context)) {
+    case PA_CONTEXT_READY: {
+      const pa_subscription_mask_t mask = static_cast<pa_subscription_mask_t>(
+          PA_SUBSCRIPTION_MASK_SOURCE | PA_SUBSCRIPTION_MASK_SERVER |
+          PA_SUBSCRIPTION_MASK_CARD);
+      Unref(pa_context_subscribe(context, mask, nullptr, nullptr));
+      self->pending_requests_ = 3;
+      Unref(pa_context_get_server_info(context, OnServerInfo, self));
+      Unref(pa_context_get_source_info_list(context, OnSourceList, self));
+      Unref(pa_context_get_card_info_list(context, OnCardList, self));
+      break;
+    }
+    case PA_CONTEXT_FAILED: {
+      // The server went away or never answered. Forget what it reported and
+      // try again shortly; queries meanwhile see no devices.
+      {
+        std::lock_guard<std::mutex> lock(self->mutex_);
+        self->sources_.clear();
+        self->cards_.clear();
+        self->default_source_.clear();
+        self->default_sink_.clear();
+      }
+      self->pending_requests_ = 0;
+      self->MarkSynced();
+      self->ScheduleReconnect();
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+// static
+void PulseDeviceMonitor::OnSubscriptionEvent(
+    pa_context* context, pa_subscription_event_type_t event, uint32_t index,
+    void* user_data) {
+  auto* self = static_cast<PulseDeviceMonitor*>(user_data);
+  const int facility = event & PA_SUBSCRIPTION_EVENT_FACILITY_MASK;
+  const int type = event & PA_SUBSCRIPTION_EVENT_TYPE_MASK;
+
+  if (facility == PA_SUBSCRIPTION_EVENT_SOURCE) {
+    if (type == PA_SUBSCRIPTION_EVENT_REMOVE) {
+      self->RemoveSource(index);
+    } else {
+      Unref(pa_context_get_source_info_by_index(context, index,
+                                                OnSourceChanged, self));
+    }
+  } else if (facility == PA_SUBSCRIPTION_EVENT_CARD) {
+    // Profile switches, e.g. a headset moving to its hands-free profile.
+    if (type == PA_SUBSCRIPTION_EVENT_REMOVE) {
+      self->RemoveCard(index);
+    } else {
+      Unref(pa_context_get_card_info_by_index(context, index, OnCardChanged,
+                                              self));
+    }
+  } else if (facility == PA_SUBSCRIPTION_EVENT_SERVER) {
+    // The default source and sink are server properties.
+    Unref(pa_context_get_server_info(context, OnServerInfo, self));
+  }
+}
+
+// static
+void PulseDeviceMonitor::OnServerInfo(pa_context* context,
+                                      const pa_server_info* info,
+                                      void* user_data) {
+  (void)context;
+  auto* self = static_cast<PulseDeviceMonitor*>(user_data);
+  bool source_changed = false;
+  if (info != nullptr) {
+    const std::string default_source =
+        info->default_source_name != nullptr ? info->default_source_name : "";
+    std::lock_guard<std::mutex> lock(self->mutex_);
+    // The first answer after connecting is the starting point, not a change.
+    source_changed = self->synced_ && self->pending_requests_ == 0 &&
+                     default_source != self->default_source_;
+    self->default_source_ = default_source;
+    self->default_sink_ =
+        info->default_sink_name != nullptr ? info->default_sink_name : "";
+  }
+  self->devices_changed_.notify_all();
+  self->FinishInitialRequest();
+
+  if (source_changed) {
+    std::lock_guard<std::mutex> lock(self->callback_mutex_);
+    if (self->default_source_changed_) {
+      self->default_source_changed_();
+    }
+  }
+}
+
+// static
+void PulseDeviceMonitor::OnSourceList(pa_context* context,
+                                      const pa_source_info* source, int eol,
+                                      void* user_data) {
+  (void)context;
+  auto* self = static_cast<PulseDeviceMonitor*>(user_data);
+  if (eol != 0 || source == nullptr) {
+    self->FinishInitialRequest();
+    return;
+  }
+  self->UpdateSource(*source);
+}
+
+// static
+void PulseDeviceMonitor::OnSourceChanged(pa_context* context,
+                                         const pa_source_info* source, int eol,
+                                         void* user_data) {
+  (void)context;
+  auto* self = static_cast<PulseDeviceMonitor*>(user_data);
+  if (eol == 0 && source != nullptr) {
+    self->UpdateSource(*source);
+  }
+}
+
+// static
+void PulseDeviceMonitor::OnCardList(pa_context* context,
+                                    const pa_card_info* card, int eol,
+                                    void* user_data) {
+  (void)context;
+  auto* self = static_cast<PulseDeviceMonitor*>(user_data);
+  if (eol != 0 || card == nullptr) {
+    self->FinishInitialRequest();
+    return;
+  }
+  self->UpdateCard(*card);
+}
+
+// static
+void PulseDeviceMonitor::OnCardChanged(pa_context* context,
+                                       const pa_card_info* card, int eol,
+                                       void* user_data) {
+  (void)context;
+  auto* self = static_cast<PulseDeviceMonitor*>(user_data);
+  if (eol == 0 && card != nullptr) {
+    self->UpdateCard(*card);
+  }
+}
+
+// static
+void PulseDeviceMonitor::OnReconnectTimer(pa_mainloop_api* api,
+                                          pa_time_event* event,
+                                          const struct timeval* time,
+                                          void* user_data) {
+  (void)time;
+  auto* self = static_cast<PulseDeviceMonitor*>(user_data);
+  api->time_free(event);
+  self->reconnect_event_ = nullptr;
+  self->DropContext();
+  self->Connect();
+}
+
+}  // namespace audio_capture
@@ -0,0 +1,175 @@
+#ifndef FLUTTER_PLUGIN_PULSE_DEVICE_MONITOR_H_
+#define FLUTTER_PLUGIN_PULSE_DEVICE_MONITOR_H_
+
+#include <pulse/pulseaudio.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace audio_capture {
+
+namespace test {
+class PulseDeviceMonitorPeer;
+}  // namespace test
+
+// A PulseAudio source as last reported by the server.
+struct AudioDeviceInfo {
+  // Server-side source name, stable across restarts. Used as the device id.
+  std::string id;
+  // Human-readable description.
+  std::string name;
+  int channels = 0;
+  int sample_rate = 0;
+  // Channel positions, e.g. "front-left,front-right".
+  std::string channel_map;
+  // Records what a sink plays rather than a physical input.
+  bool is_monitor = false;
+  // Name of the sink a monitor records; empty for inputs.
+  std::string monitor_of;
+  bool is_default = false;
+  // "device.bus" property, e.g. "pci", "usb" or "bluetooth". May be empty.
+  std::string bus;
+  // "device.api" property, e.g. "alsa" or "bluez5". May be empty.
+  std::string api;
+  // Index of the card the source belongs to, or PA_INVALID_INDEX.
+  uint32_t card = PA_INVALID_INDEX;
+  // Active profile of that card, e.g. "headset-head-unit". May be empty.
+  std::string card_profile;
+  // Whether audio can flow right away. Always true for wired sources; a
+  // Bluetooth input only once its card runs a profile that records.
+  bool transport_ready = true;
+
+  bool is_bluetooth() const {
+    return bus == "bluetooth" || api.compare(0, 5, "bluez") == 0;
+  }
+};
+
+// Keeps a cache of the server's sources current from a long-lived pa_context
+// and its subscription events, so device queries are answered from memory
+// instead of probing the server. Reconnects on its own when the server
+// restarts. Thread-safe.
+class PulseDeviceMonitor {
+ public:
+  // Called on the monitor's own thread whenever the server's default source
+  // changes.
+  using DefaultSourceChangedCallback = std::function<void()>;
+
+  // Starts connecting in the background. Returns nullptr if no mainloop
+  // could be set up.
+  static std::unique_ptr<PulseDeviceMonitor> Create();
+
+  ~PulseDeviceMonitor();
+
+  PulseDeviceMonitor(const PulseDeviceMonitor&) = delete;
+  PulseDeviceMonitor& operator=(const PulseDeviceMonitor&) = delete;
+
+  // All sources, in the order the server created them. Right after startup
+  // this waits briefly for the first listing; afterwards it never blocks on
+  // the server.
+  std::vector<AudioDeviceInfo> Sources() const;
+
+  // Whether any source other than a sink monitor exists.
+  bool HasInputDevice() const;
+
+  // The default source, if the server has one.
+  bool DefaultSource(AudioDeviceInfo* info) const;
+
+  // The monitor of the default sink, if the server has one.
+  bool DefaultSinkMonitor(AudioDeviceInfo* info) const;
+
+  // The source whose id is |id|, if it exists.
+  bool FindSource(const std::string& id, AudioDeviceInfo* info) const;
+
+  // Waits up to |timeout| for the source |id|, or the default source when
+  // |id| is empty, to exist with its transport ready, e.g. for a Bluetooth
+  // headset to finish switching to a headset profile. Returns at once if it
+  // already is; false if it did not get there in time, with |info| holding
+  // the last state seen, if any.
+  bool WaitForReadySource(const std::string& id,
+                          std::chrono::milliseconds timeout,
+                          AudioDeviceInfo* info) const;
+
+  // Replaces the default source listener. Once this returns, the previous
+  // listener is no longer running and will not be called again.
+  void set_default_source_changed_callback(
+      DefaultSourceChangedCallback callback);
+
+ private:
+  // Feeds server events to the cache in tests.
+  friend class test::PulseDeviceMonitorPeer;
+
+  PulseDeviceMonitor() = default;
+
+  bool Start();
+  void WaitForSync() const;
+  // Copies the first cached source matching |predicate| into |info|.
+  template <typename Predicate>
+  bool FindIf(Predicate predicate, AudioDeviceInfo* info) const;
+  // |source| completed with what is known about the server and its card.
+  // Called with |mutex_| held.
+  AudioDeviceInfo Describe(const AudioDeviceInfo& source) const;
+
+  // Called on the mainloop thread.
+  void Connect();
+  void DropContext();
+  void ScheduleReconnect();
+  void MarkSynced();
+  void FinishInitialRequest();
+  void UpdateSource(const pa_source_info& source);
+  void RemoveSource(uint32_t index);
+  void UpdateCard(const pa_card_info& card);
+  void RemoveCard(uint32_t index);
+
+  static void OnContextState(pa_context* context, void* user_data);
+  static void OnSubscriptionEvent(pa_context* context,
+                                  pa_subscription_event_type_t event,
+                                  uint32_t index, void* user_data);
+  static void OnServerInfo(pa_context* context, const pa_server_info* info,
+                           void* user_data);
+  static void OnSourceList(pa_context* context, const pa_source_info* source,
+                           int eol, void* user_data);
+  static void OnSourceChanged(pa_context* context,
+                              const pa_source_info* source, int eol,
+                              void* user_data);
+  static void OnCardList(pa_context* context, const pa_card_info* card,
+                         int eol, void* user_data);
+  static void OnCardChanged(pa_context* context, const pa_card_info* card,
+                            int eol, void* user_data);
+  static void OnReconnectTimer(pa_mainloop_api* api, pa_time_event* event,
+                               const struct timeval* time, void* user_data);
+
+  pa_threaded_mainloop* mainloop_ = nullptr;
+  pa_context* context_ = nullptr;
+  pa_time_event* reconnect_event_ = nullptr;
+  // Replies still outstanding for the listing that follows each connect.
+  int pending_requests_ = 0;
+
+  mutable std::mutex mutex_;
+  mutable std::condition_variable synced_changed_;
+  bool synced_ = false;
+  // Notified on every change to the cached sources, cards or defaults.
+  mutable std::condition_variable devices_changed_;
+  std::map<uint32_t, AudioDeviceInfo> sources_;
+  // Per card index, whether its active profile can record.
+  struct CardState {
+    std::string profile;
+    bool has_input = false;
+  };
+  std::map<uint32_t, CardState> cards_;
+  std::string default_source_;
+  std::string default_sink_;
+
+  std::mutex callback_mutex_;
+  DefaultSourceChangedCallback default_source_changed_;
+};
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_PULSE_DEVICE_MONITOR_H_
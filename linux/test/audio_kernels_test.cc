@@ -0,0 +1,266 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "audio_kernels.h"
+
+namespace audio_capture {
+namespace test {
+
+namespace {
+
+const KernelIsa kAllIsas[] = {KernelIsa::kScalar, KernelIsa::kSse2,
+                              KernelIsa::kAvx2, KernelIsa::kNeon};
+
+std::vector<int16_t> RandomSamples(size_t count, uint32_t seed) {
+  std::mt19937 engine(seed);
+  std::uniform_int_distribution<int> distribution(-32768, 32767);
+  std::vector<int16_t> samples(count);
+  for (int16_t& sample : samples) {
+    sample = static_cast<int16_t>(distribution(engine));
+  }
+  // Make sure the extremes are always exercised.
+  samples[0] = -32768;
+  samples[count - 1] = 32767;
+  return samples;
+}
+
+}  // namespace
+
+TEST(AudioKernels, MonoAppliesGainAndSaturates) {
+  const int16_t input[] = {100, -100, 20000, -20000};
+  int16_t output[4];
+  MixToMono(input, output, 4, 1, 1.0f, 2.0f);
+  EXPECT_EQ(output[0], 200);
+  EXPECT_EQ(output[1], -200);
+  EXPECT_EQ(output[2], 32767);
+  EXPECT_EQ(output[3], -32768);
+}
+
+TEST(AudioKernels, StereoAveragesChannels) {
+  const int16_t input[] = {100, 300, -32768, -32768, 7, 8};
+  int16_t output[3];
+  MixToMono(input, output, 3, 2, 1.0f, 1.0f);
+  EXPECT_EQ(output[0], 200);
+  EXPECT_EQ(output[1], -32768);
+  EXPECT_EQ(output[2], 7);
+}
+
+TEST(AudioKernels, VolumeTruncatesBeforeGain) {
+  // 3 * 0.5 truncates to 1 before the gain boost is applied.
+  const int16_t input[] = {3, -3};
+  int16_t output[2];
+  MixToMono(input, output, 2, 1, 0.5f, 4.0f);
+  EXPECT_EQ(output[0], 4);
+  EXPECT_EQ(output[1], -4);
+}
+
+TEST(AudioKernels, MultichannelDownmixesFirstTwoChannels) {
+  const int16_t input[] = {100, 300, 9999, -9999, -100, -300, 9999, -9999};
+  int16_t output[2];
+  MixToMono(input, output, 2, 4, 1.0f, 1.0f);
+  EXPECT_EQ(output[0], 200);
+  EXPECT_EQ(output[1], -200);
+}
+
+TEST(AudioKernels, SimdMatchesScalarReference) {
+  const MixToMonoFunction reference = GetMixToMonoKernel(KernelIsa::kScalar);
+  ASSERT_NE(reference, nullptr);
+
+  // Odd frame counts cover the scalar tail after the last full vector.
+  const size_t frame_counts[] = {0, 1, 7, 15, 16, 17, 480, 961};
+  const float volumes[] = {1.0f, 0.73f, 0.0f};
+  const float gains[] = {1.0f, 2.5f, 0.1f, 10.0f};
+
+  for (KernelIsa isa : kAllIsas) {
+    const MixToMonoFunction kernel = GetMixToMonoKernel(isa);
+    if (kernel == nullptr) {
+      continue;
+    }
+    for (int channels = 1; channels <= 3; ++channels) {
+      for (size_t frames : frame_counts) {
+        const std::vector<int16_t> input = RandomSamples(
+            frames * channels + 1, static_cast<uint32_t>(frames + channels));
+        for (float volume : volumes) {
+          for (float gain : gains) {
+            std::vector<int16_t> expected(frames + 1, 0);
+            std::vector<int16_t> actual(frames + 1, 0);
+            LevelAccumulator expected_levels{0, 0, 0};
+            LevelAccumulator actual_levels{0, 0, 0};
+            reference(input.data(), expected.data(), frames, channels, volume,
+                      gain, &expected_levels);
+            kernel(input.data(), actual.data(), frames, channels, volume, gain,
+                   &actual_levels);
+            EXPECT_EQ(expected, actual)
+                << KernelIsaName(isa) << " channels=" << channels
+                << " frames=" << frames << " volume=" << volume
+                << " gain=" << gain;
+            EXPECT_EQ(expected_levels.sum_of_squares,
+                      actual_levels.sum_of_squares)
+                << KernelIsaName(isa);
+            EXPECT_EQ(expected_levels.peak, actual_levels.peak)
+                << KernelIsaName(isa);
+            EXPECT_EQ(actual_levels.sample_count, frames);
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(AudioKernels, AccumulatesLevelsOfOutput) {
+  const int16_t input[] = {3, -4, 0, 0};
+  int16_t output[4];
+  LevelAccumulator levels{0, 0, 0};
+  MixToMono(input, output, 4, 1, 1.0f, 1.0f, &levels);
+  EXPECT_EQ(levels.sum_of_squares, 25u);
+  EXPECT_EQ(levels.sample_count, 4u);
+  EXPECT_EQ(levels.peak, 4);
+}
+
+TEST(AudioKernels, FullScaleSquaresDoNotOverflow) {
+  // Pairs of -32768 overflow a signed pmaddwd lane.
+  const std::vector<int16_t> input(64, -32768);
+  std::vector<int16_t> output(64);
+  for (KernelIsa isa : kAllIsas) {
+    const MixToMonoFunction kernel = GetMixToMonoKernel(isa);
+    if (kernel == nullptr) {
+      continue;
+    }
+    LevelAccumulator levels{0, 0, 0};
+    kernel(input.data(), output.data(), 64, 1, 1.0f, 1.0f, &levels);
+    EXPECT_EQ(levels.sum_of_squares, uint64_t{64} * 32768 * 32768)
+        << KernelIsaName(isa);
+    EXPECT_EQ(levels.peak, 32768) << KernelIsaName(isa);
+  }
+}
+
+TEST(AudioKernels, FloatMixKeepsHeadroom) {
+  const float input[] = {0.5f, 0.25f, -0.75f, -0.25f};
+  float output[2];
+  LevelAccumulator levels{0, 0, 0};
+  MixToMonoFloat(input, output, 2, 2, 1.0f, 4.0f, &levels);
+  EXPECT_FLOAT_EQ(output[0], 1.5f);
+  EXPECT_FLOAT_EQ(output[1], -2.0f);
+  // Meters as the int16 kernel would after saturating.
+  EXPECT_EQ(levels.sample_count, 2u);
+  EXPECT_EQ(levels.peak, 32768);
+  EXPECT_EQ(levels.sum_of_squares,
+            uint64_t{32767} * 32767 + uint64_t{32768} * 32768);
+}
+
+TEST(AudioKernels, FloatMixAttenuatesByVolume) {
+  const float input[] = {0.5f, -1.0f};
+  float output[2];
+  MixToMonoFloat(input, output, 2, 1, 0.5f, 2.0f);
+  EXPECT_FLOAT_EQ(output[0], 0.5f);
+  EXPECT_FLOAT_EQ(output[1], -1.0f);
+}
+
+TEST(AudioKernels, ConvertsBetweenFloatAndIntegers) {
+  const int16_t samples[] = {-32768, -16384, 0, 16384, 32767};
+  float normalized[5];
+  Int16ToFloat(samples, normalized, 5);
+  EXPECT_FLOAT_EQ(normalized[0], -1.0f);
+  EXPECT_FLOAT_EQ(normalized[1], -0.5f);
+  EXPECT_FLOAT_EQ(normalized[3], 0.5f);
+
+  int16_t round_trip[5];
+  FloatToInt16(normalized, round_trip, 5);
+  EXPECT_EQ(std::vector<int16_t>(round_trip, round_trip + 5),
+            std::vector<int16_t>(samples, samples + 5));
+
+  const float loud[] = {-2.0f, -0.5f, 0.5f, 1.0f, 2.0f};
+  int16_t narrow[5];
+  FloatToInt16(loud, narrow, 5);
+  EXPECT_EQ(narrow[0], -32768);
+  EXPECT_EQ(narrow[1], -16384);
+  EXPECT_EQ(narrow[3], 32767);
+  EXPECT_EQ(narrow[4], 32767);
+
+  int32_t wide[5];
+  FloatToInt32(loud, wide, 5);
+  EXPECT_EQ(wide[0], INT32_MIN);
+  EXPECT_EQ(wide[1], -1073741824);
+  EXPECT_EQ(wide[2], 1073741824);
+  EXPECT_EQ(wide[3], INT32_MAX);
+  EXPECT_EQ(wide[4], INT32_MAX);
+}
+
+TEST(AudioKernels, DeinterleavesAndInterleavesEveryChannelCount) {
+  std::mt19937 engine(7);
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+  for (int channels = 1; channels <= 8; ++channels) {
+    // Frame counts around the vector width exercise the scalar tail.
+    for (size_t frames : {0u, 3u, 4u, 9u, 33u}) {
+      std::vector<float> input(frames * channels);
+      for (float& sample : input) {
+        sample = distribution(engine);
+      }
+      std::vector<float> gains(channels);
+      for (int channel = 0; channel < channels; ++channel) {
+        gains[channel] = 0.5f + 0.25f * channel;
+      }
+
+      std::vector<std::vector<float>> planes(channels,
+                                             std::vector<float>(frames));
+      std::vector<float*> plane_pointers;
+      for (std::vector<float>& plane : planes) {
+        plane_pointers.push_back(plane.data());
+      }
+      DeinterleaveFloat(input.data(), frames, channels, gains.data(),
+                        plane_pointers.data());
+      for (int channel = 0; channel < channels; ++channel) {
+        for (size_t i = 0; i < frames; ++i) {
+          ASSERT_EQ(planes[channel][i],
+                    input[i * channels + channel] * gains[channel])
+              << channels << " channels, frame " << i;
+        }
+      }
+
+      std::vector<float> interleaved(frames * channels);
+      InterleaveFloat(plane_pointers.data(), frames, channels,
+                      interleaved.data());
+      for (size_t i = 0; i < interleaved.size(); ++i) {
+        ASSERT_EQ(interleaved[i], input[i] * gains[i % channels])
+            << channels << " channels, sample " << i;
+      }
+    }
+  }
+}
+
+TEST(AudioKernels, DotProductMatchesScalarReference) {
+  std::mt19937 engine(11);
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+  std::vector<float> a(261);
+  std::vector<float> b(a.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    a[i] = distribution(engine);
+    b[i] = distribution(engine);
+  }
+  const DotProductFunction reference = GetDotProductKernel(KernelIsa::kScalar);
+  ASSERT_NE(reference, nullptr);
+  for (KernelIsa isa : kAllIsas) {
+    const DotProductFunction kernel = GetDotProductKernel(isa);
+    if (kernel == nullptr) {
+      continue;
+    }
+    // Lengths around the vector widths cover every tail; the odd offset
+    // covers unaligned loads.
+    for (size_t count : {0u, 1u, 3u, 4u, 7u, 8u, 15u, 16u, 17u, 32u, 260u}) {
+      EXPECT_NEAR(kernel(a.data() + 1, b.data(), count),
+                  reference(a.data() + 1, b.data(), count), 1e-4f)
+          << KernelIsaName(isa) << " count=" << count;
+    }
+  }
+}
+
+TEST(AudioKernels, ActiveKernelIsAvailable) {
+  EXPECT_NE(GetMixToMonoKernel(ActiveKernelIsa()), nullptr);
+  EXPECT_NE(GetDotProductKernel(ActiveKernelIsa()), nullptr);
+}
+
+}  // namespace test
+}  // namespace audio_capture
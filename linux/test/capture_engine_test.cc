@@ -0,0 +1,798 @@
+#include <gtest/gtest.h>
+#include <poll.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "capture_engine.h"
+
+namespace audio_capture {
+namespace test {
+
+namespace {
+
+template <typename Sample>
+std::vector<uint8_t> SampleBytes(const std::vector<Sample>& samples) {
+  std::vector<uint8_t> bytes(samples.size() * sizeof(Sample));
+  std::memcpy(bytes.data(), samples.data(), bytes.size());
+  return bytes;
+}
+
+// Plays back |samples| in fragments of |fragment_frames| frames, then fails
+// with |end_status|. With |endless| set it loops instead, and with a stall
+// set it blocks until interrupted, like a device that went quiet.
+class FakeCaptureSource : public CaptureSource {
+ public:
+  FakeCaptureSource(const std::vector<int16_t>& samples, int channels,
+                    size_t fragment_frames, bool endless = false)
+      : samples_(SampleBytes(samples)),
+        fragment_bytes_(fragment_frames * channels * sizeof(int16_t)),
+        endless_(endless),
+        position_(0) {}
+  // Plays back raw |samples| of any format in fragments of |fragment_bytes|.
+  FakeCaptureSource(std::vector<uint8_t> samples, size_t fragment_bytes)
+      : samples_(std::move(samples)),
+        fragment_bytes_(fragment_bytes),
+        endless_(false),
+        position_(0) {}
+
+  CaptureReadStatus Acquire(const uint8_t** data, size_t* bytes) override {
+    if (position_ >= samples_.size() && stall_) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      stalled_.store(true);
+      interrupt_.wait(lock, [this] { return interrupted_; });
+    }
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      interrupt_.wait(lock, [this] { return !paused_ || interrupted_; });
+      if (interrupted_) {
+        return CaptureReadStatus::kInterrupted;
+      }
+    }
+    if (position_ >= samples_.size()) {
+      if (!endless_) {
+        last_error_ = "end of fake stream";
+        return end_status_;
+      }
+      position_ = 0;
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    const size_t count =
+        std::min(fragment_bytes_, samples_.size() - position_);
+    *data = samples_.data() + position_;
+    *bytes = count;
+    position_ += count;
+    return CaptureReadStatus::kOk;
+  }
+
+  void Release() override {}
+
+  void Interrupt() override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      interrupted_ = true;
+    }
+    interrupt_.notify_all();
+  }
+
+  bool SetPaused(bool paused) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      paused_ = paused;
+    }
+    interrupt_.notify_all();
+    return true;
+  }
+
+  int64_t fragment_latency_us() const override { return latency_us_; }
+  int64_t negotiated_latency_us() const override { return negotiated_us_; }
+  uint64_t overrun_count() const override { return overruns_; }
+
+  void set_end_status(CaptureReadStatus status) { end_status_ = status; }
+  void set_stall() { stall_ = true; }
+  // Whether the source ran dry and is waiting to be interrupted.
+  bool stalled() const { return stalled_.load(); }
+
+  void set_timing(int64_t latency_us, uint64_t overruns,
+                  int64_t negotiated_us = 0) {
+    latency_us_ = latency_us;
+    overruns_ = overruns;
+    negotiated_us_ = negotiated_us;
+  }
+
+ private:
+  const std::vector<uint8_t> samples_;
+  const size_t fragment_bytes_;
+  const bool endless_;
+  size_t position_;
+  CaptureReadStatus end_status_ = CaptureReadStatus::kError;
+  int64_t latency_us_ = 0;
+  uint64_t overruns_ = 0;
+  int64_t negotiated_us_ = 0;
+  bool stall_ = false;
+  std::atomic<bool> stalled_{false};
+  std::mutex mutex_;
+  std::condition_variable interrupt_;
+  bool interrupted_ = false;
+  bool paused_ = false;
+};
+
+CaptureEngineConfig MakeConfig(int channels, size_t chunk_frames) {
+  CaptureEngineConfig config;
+  config.sample_rate = 1000;
+  config.channels = channels;
+  config.chunk_frames = chunk_frames;
+  config.gain_boost = 1.0f;
+  config.input_volume = 1.0f;
+  config.meter_rate_hz = 10.0;
+  config.thread_name = "fake-capture";
+  return config;
+}
+
+// Collects everything the engine emits until its source runs dry.
+struct Collected {
+  std::vector<std::vector<int16_t>> chunks;
+  // Chunks as delivered, whatever their sample format.
+  std::vector<std::vector<uint8_t>> raw_chunks;
+  std::vector<LevelReading> readings;
+  std::vector<ChannelLevels> channel_levels;
+  std::vector<CaptureGap> gaps;
+};
+
+void DrainInto(CaptureEngine* engine, Collected* collected) {
+  engine->Drain(
+      [collected](uint8_t* buffer, size_t bytes) {
+        std::vector<int16_t> chunk(bytes / sizeof(int16_t));
+        std::memcpy(chunk.data(), buffer, bytes);
+        collected->chunks.push_back(chunk);
+        collected->raw_chunks.emplace_back(buffer, buffer + bytes);
+        CaptureEngine::ReleaseChunk(buffer);
+      },
+      [collected](const LevelReading& reading, const ChannelLevels& channels,
+                  int64_t timestamp_us) {
+        EXPECT_GT(timestamp_us, 0);
+        collected->readings.push_back(reading);
+        collected->channel_levels.push_back(channels);
+      },
+      [collected](const CaptureGap& gap) { collected->gaps.push_back(gap); });
+}
+
+void RunUntilFinished(CaptureEngine* engine, Collected* collected) {
+  pollfd fd{engine->wakeup_fd(), POLLIN, 0};
+  for (int i = 0; i < 1000 && !engine->finished(); ++i) {
+    poll(&fd, 1, 10);
+    DrainInto(engine, collected);
+  }
+  ASSERT_TRUE(engine->finished());
+  engine->Stop();
+  DrainInto(engine, collected);
+}
+
+std::vector<int16_t> Ramp(size_t count) {
+  std::vector<int16_t> samples(count);
+  for (size_t i = 0; i < count; ++i) {
+    samples[i] = static_cast<int16_t>(i);
+  }
+  return samples;
+}
+
+}  // namespace
+
+TEST(CaptureEngine, AssemblesChunksAcrossFragments) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  // 7-frame fragments never line up with 10-frame chunks.
+  std::unique_ptr<CaptureSource> source(
+      new FakeCaptureSource(Ramp(35), 1, 7));
+  ASSERT_TRUE(engine->Start(std::move(source), MakeConfig(1, 10)));
+
+  Collected collected;
+  RunUntilFinished(engine.get(), &collected);
+
+  // The trailing partial chunk is never emitted.
+  ASSERT_EQ(collected.chunks.size(), 3u);
+  for (size_t i = 0; i < collected.chunks.size(); ++i) {
+    ASSERT_EQ(collected.chunks[i].size(), 10u);
+    for (size_t j = 0; j < 10; ++j) {
+      EXPECT_EQ(collected.chunks[i][j], static_cast<int16_t>(i * 10 + j));
+    }
+  }
+  EXPECT_EQ(engine->last_error(), "end of fake stream");
+  EXPECT_EQ(engine->dropped_chunks(), 0u);
+}
+
+TEST(CaptureEngine, MixesStereoToMonoWithGain) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  std::unique_ptr<CaptureSource> source(
+      new FakeCaptureSource({100, 300, -50, -150}, 2, 2));
+  CaptureEngineConfig config = MakeConfig(2, 2);
+  config.gain_boost = 2.0f;
+  ASSERT_TRUE(engine->Start(std::move(source), config));
+
+  Collected collected;
+  RunUntilFinished(engine.get(), &collected);
+
+  ASSERT_EQ(collected.chunks.size(), 1u);
+  EXPECT_EQ(collected.chunks[0], (std::vector<int16_t>{400, -200}));
+}
+
+TEST(CaptureEngine, MetersAtConfiguredRateOnlyWhenEnabled) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  // One second at 1 kHz, metered at 10 Hz, chunked every 250 frames.
+  Collected collected;
+  ASSERT_TRUE(engine->Start(
+      std::unique_ptr<CaptureSource>(
+          new FakeCaptureSource(std::vector<int16_t>(1000, 16384), 1, 64)),
+      MakeConfig(1, 250)));
+  RunUntilFinished(engine.get(), &collected);
+  EXPECT_EQ(collected.chunks.size(), 4u);
+  EXPECT_TRUE(collected.readings.empty());
+
+  engine->set_metering(true);
+  collected = Collected();
+  ASSERT_TRUE(engine->Start(
+      std::unique_ptr<CaptureSource>(
+          new FakeCaptureSource(std::vector<int16_t>(1000, 16384), 1, 64)),
+      MakeConfig(1, 250)));
+  RunUntilFinished(engine.get(), &collected);
+  EXPECT_EQ(collected.chunks.size(), 4u);
+  ASSERT_EQ(collected.readings.size(), 10u);
+  EXPECT_NEAR(collected.readings.back().rms, 0.5, 0.01);
+}
+
+TEST(CaptureEngine, DropsChunksWhenConsumerFallsBehind) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  const size_t chunk_count = CaptureEngine::kChunkQueueCapacity * 3;
+  ASSERT_TRUE(engine->Start(
+      std::unique_ptr<CaptureSource>(
+          new FakeCaptureSource(Ramp(chunk_count * 4), 1, 4)),
+      MakeConfig(1, 4)));
+
+  // Let the whole stream through without draining.
+  for (int i = 0; i < 1000 && !engine->finished(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_TRUE(engine->finished());
+  engine->Stop();
+
+  Collected collected;
+  DrainInto(engine.get(), &collected);
+  EXPECT_GT(engine->dropped_chunks(), 0u);
+  EXPECT_EQ(collected.chunks.size() + engine->dropped_chunks(), chunk_count);
+}
+
+TEST(CaptureEngine, AccountsLatencyOfEveryDeliveredChunk) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  std::unique_ptr<FakeCaptureSource> source(
+      new FakeCaptureSource(Ramp(40), 1, 10));
+  source->set_timing(5000, 2, 10000);
+  ASSERT_TRUE(engine->Start(std::move(source), MakeConfig(1, 10)));
+
+  Collected collected;
+  RunUntilFinished(engine.get(), &collected);
+  ASSERT_EQ(collected.chunks.size(), 4u);
+
+  const CaptureStats stats = engine->stats();
+  EXPECT_EQ(stats.capture.count(), 4u);
+  EXPECT_EQ(stats.capture.min(), 5000);
+  EXPECT_EQ(stats.process.count(), 4u);
+  EXPECT_EQ(stats.dispatch.count(), 4u);
+  EXPECT_EQ(stats.send.count(), 4u);
+  EXPECT_EQ(stats.total.count(), 4u);
+  EXPECT_GE(stats.total.min(), 5000);
+  EXPECT_EQ(stats.resample.count(), 0u);
+  EXPECT_EQ(stats.source_sample_rate, 1000);
+  EXPECT_EQ(stats.negotiated_latency_us, 10000);
+  EXPECT_EQ(stats.overruns, 2u);
+  EXPECT_EQ(stats.dropped_chunks, 0u);
+  EXPECT_EQ(stats.queue_depth, 0u);
+  EXPECT_GE(stats.max_queue_depth, 1u);
+  EXPECT_GT(stats.time_to_first_sample_us, 0);
+}
+
+TEST(CaptureEngine, ResamplesSourceRateToSessionRate) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  // 1.5 s of stereo DC at 3 kHz become about 1.5 s at 1 kHz, less the
+  // resampler's delay. Short enough for every chunk and reading to fit the
+  // queues.
+  std::unique_ptr<CaptureSource> source(new FakeCaptureSource(
+      std::vector<int16_t>(2 * 4500, 8000), 2, 480));
+  CaptureEngineConfig config = MakeConfig(2, 250);
+  config.source_sample_rate = 3000;
+  engine->set_metering(true);
+  ASSERT_TRUE(engine->Start(std::move(source), config));
+
+  Collected collected;
+  RunUntilFinished(engine.get(), &collected);
+  engine->set_metering(false);
+
+  ASSERT_EQ(collected.chunks.size(), 5u);
+  for (const std::vector<int16_t>& chunk : collected.chunks) {
+    ASSERT_EQ(chunk.size(), 250u);
+  }
+  // Past the filter's start-up the level is unchanged.
+  for (size_t i = 1; i < collected.chunks.size(); ++i) {
+    for (int16_t sample : collected.chunks[i]) {
+      EXPECT_NEAR(sample, 8000, 1);
+    }
+  }
+  // Levels are metered at the source's rate, still ten readings a second.
+  EXPECT_EQ(collected.readings.size(), 15u);
+
+  const CaptureStats stats = engine->stats();
+  EXPECT_EQ(stats.source_sample_rate, 3000);
+  EXPECT_EQ(stats.source_channels, 2);
+  EXPECT_EQ(stats.resample.count(), 5u);
+  EXPECT_EQ(stats.process.count(), 5u);
+}
+
+TEST(CaptureEngine, ProcessesFloatSourceInFloat) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  // A 3x boost takes these past full scale; float output keeps them intact.
+  std::unique_ptr<CaptureSource> source(new FakeCaptureSource(
+      SampleBytes(std::vector<float>{0.25f, 0.75f, -0.5f, -0.5f, 0.1f, 0.1f,
+                                     0.0f, 0.2f}),
+      3 * 2 * sizeof(float)));
+  CaptureEngineConfig config = MakeConfig(2, 2);
+  config.source_format = SampleFormat::kF32;
+  config.output_format = SampleFormat::kF32;
+  config.gain_boost = 3.0f;
+  ASSERT_TRUE(engine->Start(std::move(source), config));
+
+  Collected collected;
+  RunUntilFinished(engine.get(), &collected);
+
+  std::vector<float> samples;
+  for (const std::vector<uint8_t>& chunk : collected.raw_chunks) {
+    ASSERT_EQ(chunk.size(), 2 * sizeof(float));
+    const float* values = reinterpret_cast<const float*>(chunk.data());
+    samples.insert(samples.end(), values, values + 2);
+  }
+  ASSERT_EQ(samples.size(), 4u);
+  EXPECT_FLOAT_EQ(samples[0], 1.5f);
+  EXPECT_FLOAT_EQ(samples[1], -1.5f);
+  EXPECT_FLOAT_EQ(samples[2], 0.3f);
+  EXPECT_FLOAT_EQ(samples[3], 0.3f);
+}
+
+TEST(CaptureEngine, ConvertsInt16SourceToRequestedFormat) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  std::unique_ptr<CaptureSource> source(new FakeCaptureSource(
+      std::vector<int16_t>{16384, -16384, 20000, -32768}, 1, 3));
+  CaptureEngineConfig config = MakeConfig(1, 4);
+  config.output_format = SampleFormat::kS32;
+  config.gain_boost = 2.0f;
+  ASSERT_TRUE(engine->Start(std::move(source), config));
+
+  Collected collected;
+  RunUntilFinished(engine.get(), &collected);
+
+  ASSERT_EQ(collected.raw_chunks.size(), 1u);
+  ASSERT_EQ(collected.raw_chunks[0].size(), 4 * sizeof(int32_t));
+  int32_t samples[4];
+  std::memcpy(samples, collected.raw_chunks[0].data(), sizeof(samples));
+  EXPECT_EQ(samples[0], INT32_MAX);
+  EXPECT_EQ(samples[1], INT32_MIN);
+  EXPECT_EQ(samples[2], INT32_MAX);
+  EXPECT_EQ(samples[3], INT32_MIN);
+}
+
+TEST(CaptureEngine, ResamplesInFloatForFloatOutput) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  std::unique_ptr<CaptureSource> source(new FakeCaptureSource(
+      SampleBytes(std::vector<float>(1500, 0.5f)), 480 * sizeof(float)));
+  CaptureEngineConfig config = MakeConfig(1, 250);
+  config.source_sample_rate = 3000;
+  config.source_format = SampleFormat::kF32;
+  config.output_format = SampleFormat::kF32;
+  config.gain_boost = 4.0f;
+  ASSERT_TRUE(engine->Start(std::move(source), config));
+
+  Collected collected;
+  RunUntilFinished(engine.get(), &collected);
+
+  // Half a second at 3 kHz resamples to just under two chunks at 1 kHz; only
+  // the full one is delivered when the source runs dry.
+  ASSERT_EQ(collected.raw_chunks.size(), 1u);
+  ASSERT_EQ(collected.raw_chunks[0].size(), 250 * sizeof(float));
+  const float* samples =
+      reinterpret_cast<const float*>(collected.raw_chunks[0].data());
+  for (size_t i = 50; i < 250; ++i) {
+    EXPECT_NEAR(samples[i], 2.0f, 1e-3f);
+  }
+  EXPECT_EQ(engine->stats().resample.count(), 1u);
+}
+
+TEST(CaptureEngine, KeepsChannelsInterleavedWithTheirOwnGain) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  // 200 frames of four channels, each at its own constant level.
+  std::vector<int16_t> samples;
+  for (int frame = 0; frame < 200; ++frame) {
+    samples.insert(samples.end(), {1000, -2000, 4000, 0});
+  }
+  std::unique_ptr<CaptureSource> source(
+      new FakeCaptureSource(samples, 4, 30));
+  CaptureEngineConfig config = MakeConfig(4, 50);
+  config.layout = ChannelLayout::kInterleaved;
+  config.gain_boost = 2.0f;
+  config.channel_gains = {1.0f, 0.5f, 2.0f};
+  engine->set_metering(true);
+  ASSERT_TRUE(engine->Start(std::move(source), config));
+
+  Collected collected;
+  RunUntilFinished(engine.get(), &collected);
+  engine->set_metering(false);
+
+  ASSERT_EQ(collected.chunks.size(), 4u);
+  for (const std::vector<int16_t>& chunk : collected.chunks) {
+    ASSERT_EQ(chunk.size(), 50u * 4);
+    for (size_t i = 0; i < chunk.size(); i += 4) {
+      EXPECT_EQ(chunk[i], 2000);
+      EXPECT_EQ(chunk[i + 1], -2000);
+      EXPECT_EQ(chunk[i + 2], 16000);
+      EXPECT_EQ(chunk[i + 3], 0);
+    }
+  }
+
+  ASSERT_EQ(collected.channel_levels.size(), 2u);
+  const ChannelLevels& levels = collected.channel_levels.back();
+  ASSERT_EQ(levels.count, 4);
+  EXPECT_NEAR(levels.readings[0].peak, 2000.0 / 32768, 1e-4);
+  EXPECT_NEAR(levels.readings[2].peak, 16000.0 / 32768, 1e-4);
+  EXPECT_LE(levels.readings[3].peak, 1e-9);
+  // The overall reading follows the loudest channel.
+  EXPECT_DOUBLE_EQ(collected.readings.back().peak, levels.readings[2].peak);
+}
+
+TEST(CaptureEngine, KeepsChannelsPlanarAndCompactsShortChunk) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  // Three channels: a ramp, its negation and a constant.
+  std::vector<int16_t> samples;
+  for (int16_t frame = 0; frame < 50; ++frame) {
+    samples.insert(samples.end(),
+                   {frame, static_cast<int16_t>(-frame), 7});
+  }
+  std::unique_ptr<FakeCaptureSource> source(
+      new FakeCaptureSource(samples, 3, 10));
+  source->set_stall();
+  const FakeCaptureSource* fake = source.get();
+  CaptureEngineConfig config = MakeConfig(3, 32);
+  config.layout = ChannelLayout::kPlanar;
+  ASSERT_TRUE(engine->Start(std::move(source), config));
+
+  for (int i = 0; i < 1000 && !fake->stalled(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_TRUE(fake->stalled());
+  engine->Stop();
+
+  Collected collected;
+  DrainInto(engine.get(), &collected);
+  ASSERT_EQ(collected.chunks.size(), 2u);
+  const size_t lengths[] = {32, 18};
+  int16_t first_frame = 0;
+  for (size_t index = 0; index < 2; ++index) {
+    const std::vector<int16_t>& chunk = collected.chunks[index];
+    const size_t frames = lengths[index];
+    ASSERT_EQ(chunk.size(), frames * 3);
+    for (size_t i = 0; i < frames; ++i) {
+      const int16_t frame = static_cast<int16_t>(first_frame + i);
+      EXPECT_EQ(chunk[i], frame);
+      EXPECT_EQ(chunk[frames + i], -frame);
+      EXPECT_EQ(chunk[2 * frames + i], 7);
+    }
+    first_frame += static_cast<int16_t>(frames);
+  }
+}
+
+TEST(CaptureEngine, ResamplesEveryChannelKeptApart) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  std::vector<float> samples;
+  for (int frame = 0; frame < 1500; ++frame) {
+    samples.insert(samples.end(), {0.25f, -0.5f});
+  }
+  std::unique_ptr<CaptureSource> source(new FakeCaptureSource(
+      SampleBytes(samples), 480 * 2 * sizeof(float)));
+  CaptureEngineConfig config = MakeConfig(2, 250);
+  config.source_sample_rate = 3000;
+  config.source_format = SampleFormat::kF32;
+  config.output_format = SampleFormat::kF32;
+  config.layout = ChannelLayout::kInterleaved;
+  ASSERT_TRUE(engine->Start(std::move(source), config));
+
+  Collected collected;
+  RunUntilFinished(engine.get(), &collected);
+
+  ASSERT_EQ(collected.raw_chunks.size(), 1u);
+  ASSERT_EQ(collected.raw_chunks[0].size(), 250 * 2 * sizeof(float));
+  const float* frames =
+      reinterpret_cast<const float*>(collected.raw_chunks[0].data());
+  for (size_t i = 50; i < 250; ++i) {
+    EXPECT_NEAR(frames[2 * i], 0.25f, 1e-4f);
+    EXPECT_NEAR(frames[2 * i + 1], -0.5f, 1e-4f);
+  }
+}
+
+TEST(CaptureEngine, RefusesMoreChannelsThanItCanKeepApart) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  CaptureEngineConfig config = MakeConfig(kMaxCaptureChannels + 1, 10);
+  config.layout = ChannelLayout::kPlanar;
+  EXPECT_FALSE(engine->Start(
+      std::unique_ptr<CaptureSource>(new FakeCaptureSource(
+          std::vector<int16_t>(90, 0), kMaxCaptureChannels + 1, 10)),
+      config));
+  EXPECT_FALSE(engine->last_error().empty());
+}
+
+TEST(CaptureEngine, SwitchesSourceWithoutRestarting) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  ASSERT_TRUE(engine->Start(
+      std::unique_ptr<CaptureSource>(new FakeCaptureSource(
+          std::vector<int16_t>(10, 1), 1, 5, true)),
+      MakeConfig(1, 10)));
+
+  Collected collected;
+  pollfd fd{engine->wakeup_fd(), POLLIN, 0};
+  for (int i = 0; i < 1000 && collected.chunks.size() < 3; ++i) {
+    poll(&fd, 1, 10);
+    DrainInto(engine.get(), &collected);
+  }
+  ASSERT_GE(collected.chunks.size(), 3u);
+
+  // The new source runs dry after three chunks' worth, ending the session.
+  EXPECT_TRUE(engine->SwitchSource(std::unique_ptr<CaptureSource>(
+      new FakeCaptureSource(std::vector<int16_t>(30, 2), 1, 5))));
+  RunUntilFinished(engine.get(), &collected);
+
+  std::vector<int16_t> samples;
+  for (const std::vector<int16_t>& chunk : collected.chunks) {
+    ASSERT_EQ(chunk.size(), 10u);
+    samples.insert(samples.end(), chunk.begin(), chunk.end());
+  }
+  // Chunk assembly carried on: the old audio is followed by the new, with
+  // nothing dropped or duplicated at the seam.
+  EXPECT_TRUE(std::is_sorted(samples.begin(), samples.end()));
+  EXPECT_EQ(samples.front(), 1);
+  EXPECT_EQ(std::count(samples.begin(), samples.end(), 2) % 5, 0);
+  EXPECT_EQ(samples.back(), 2);
+
+  ASSERT_EQ(collected.gaps.size(), 1u);
+  EXPECT_EQ(collected.gaps[0].reason, CaptureGapReason::kSourceSwitch);
+  EXPECT_GT(collected.gaps[0].timestamp_us, 0);
+  EXPECT_EQ(engine->stats().gaps, 1u);
+  EXPECT_EQ(engine->stats().lost_frames, collected.gaps[0].lost_frames);
+  EXPECT_FALSE(engine->SwitchSource(std::unique_ptr<CaptureSource>(
+      new FakeCaptureSource(std::vector<int16_t>(10, 3), 1, 5))));
+}
+
+TEST(CaptureEngine, ReconnectsDisconnectedSource) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  std::unique_ptr<FakeCaptureSource> source(
+      new FakeCaptureSource(std::vector<int16_t>(10, 1), 1, 5));
+  source->set_end_status(CaptureReadStatus::kDisconnected);
+
+  // The first attempt finds the server still down.
+  int attempts = 0;
+  CaptureEngineConfig config = MakeConfig(1, 10);
+  config.max_reconnect_attempts = 3;
+  config.reconnect_delay_ms = 1;
+  config.reopen_source = [&attempts](std::string* error_message) {
+    if (++attempts == 1) {
+      *error_message = "server still down";
+      return std::unique_ptr<CaptureSource>();
+    }
+    return std::unique_ptr<CaptureSource>(
+        new FakeCaptureSource(std::vector<int16_t>(20, 2), 1, 5));
+  };
+  ASSERT_TRUE(engine->Start(std::move(source), config));
+
+  Collected collected;
+  RunUntilFinished(engine.get(), &collected);
+
+  EXPECT_EQ(attempts, 2);
+  ASSERT_EQ(collected.chunks.size(), 3u);
+  EXPECT_EQ(collected.chunks[0], std::vector<int16_t>(10, 1));
+  EXPECT_EQ(collected.chunks[2], std::vector<int16_t>(10, 2));
+  ASSERT_EQ(collected.gaps.size(), 1u);
+  EXPECT_EQ(collected.gaps[0].reason, CaptureGapReason::kReconnect);
+  EXPECT_EQ(engine->stats().reconnects, 1u);
+  // The reopened source's own failure is fatal and ends the session.
+  EXPECT_EQ(engine->last_error(), "end of fake stream");
+}
+
+TEST(CaptureEngine, GivesUpReconnectingAfterMaxAttempts) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  std::unique_ptr<FakeCaptureSource> source(
+      new FakeCaptureSource(Ramp(10), 1, 5));
+  source->set_end_status(CaptureReadStatus::kDisconnected);
+
+  int attempts = 0;
+  CaptureEngineConfig config = MakeConfig(1, 10);
+  config.max_reconnect_attempts = 3;
+  config.reconnect_delay_ms = 1;
+  config.reopen_source = [&attempts](std::string* error_message) {
+    ++attempts;
+    *error_message = "server down";
+    return std::unique_ptr<CaptureSource>();
+  };
+  ASSERT_TRUE(engine->Start(std::move(source), config));
+
+  Collected collected;
+  RunUntilFinished(engine.get(), &collected);
+
+  EXPECT_EQ(attempts, 3);
+  EXPECT_EQ(collected.chunks.size(), 1u);
+  EXPECT_TRUE(collected.gaps.empty());
+  EXPECT_EQ(engine->stats().reconnects, 0u);
+  EXPECT_NE(engine->last_error().find("server down"), std::string::npos);
+}
+
+TEST(CaptureEngine, StopInterruptsBlockedReadAndFlushesPartialChunk) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  std::unique_ptr<FakeCaptureSource> source(
+      new FakeCaptureSource(Ramp(50), 1, 10));
+  source->set_stall();
+  const FakeCaptureSource* fake = source.get();
+  ASSERT_TRUE(engine->Start(std::move(source), MakeConfig(1, 32)));
+
+  for (int i = 0; i < 1000 && !fake->stalled(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  ASSERT_TRUE(fake->stalled());
+
+  const auto start = std::chrono::steady_clock::now();
+  engine->Stop();
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(10));
+  EXPECT_FALSE(engine->finished());
+
+  Collected collected;
+  DrainInto(engine.get(), &collected);
+  ASSERT_EQ(collected.chunks.size(), 2u);
+  EXPECT_EQ(collected.chunks[0].size(), 32u);
+  ASSERT_EQ(collected.chunks[1].size(), 18u);
+  EXPECT_EQ(collected.chunks[1].front(), 32);
+  EXPECT_EQ(collected.chunks[1].back(), 49);
+}
+
+TEST(CaptureEngine, PausesAndResumesWithoutRestarting) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  EXPECT_FALSE(engine->Pause());
+  ASSERT_TRUE(engine->Start(
+      std::unique_ptr<CaptureSource>(new FakeCaptureSource(Ramp(64), 1, 16,
+                                                           true)),
+      MakeConfig(1, 32)));
+
+  Collected collected;
+  pollfd fd{engine->wakeup_fd(), POLLIN, 0};
+  for (int i = 0; i < 100 && collected.chunks.empty(); ++i) {
+    poll(&fd, 1, 10);
+    DrainInto(engine.get(), &collected);
+  }
+  ASSERT_FALSE(collected.chunks.empty());
+
+  ASSERT_TRUE(engine->Pause());
+  EXPECT_TRUE(engine->paused());
+  // A fragment already acquired may still complete a chunk.
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  DrainInto(engine.get(), &collected);
+  const size_t paused_count = collected.chunks.size();
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  DrainInto(engine.get(), &collected);
+  EXPECT_EQ(collected.chunks.size(), paused_count);
+
+  ASSERT_TRUE(engine->Resume());
+  EXPECT_FALSE(engine->paused());
+  for (int i = 0; i < 100 && collected.chunks.size() == paused_count; ++i) {
+    poll(&fd, 1, 10);
+    DrainInto(engine.get(), &collected);
+  }
+  EXPECT_GT(collected.chunks.size(), paused_count);
+  EXPECT_TRUE(collected.gaps.empty());
+
+  // Stopping a paused session does not wait for it to resume.
+  ASSERT_TRUE(engine->Pause());
+  engine->Stop();
+  EXPECT_FALSE(engine->paused());
+}
+
+TEST(CaptureEngine, ArmedSessionStartsOnResume) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  CaptureEngineConfig config = MakeConfig(1, 32);
+  config.start_paused = true;
+  ASSERT_TRUE(engine->Start(
+      std::unique_ptr<CaptureSource>(new FakeCaptureSource(Ramp(64), 1, 16,
+                                                           true)),
+      config));
+  EXPECT_TRUE(engine->paused());
+
+  Collected collected;
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  DrainInto(engine.get(), &collected);
+  EXPECT_TRUE(collected.chunks.empty());
+  EXPECT_EQ(engine->stats().time_to_first_sample_us, 0);
+
+  ASSERT_TRUE(engine->Resume());
+  pollfd fd{engine->wakeup_fd(), POLLIN, 0};
+  for (int i = 0; i < 100 && collected.chunks.empty(); ++i) {
+    poll(&fd, 1, 10);
+    DrainInto(engine.get(), &collected);
+  }
+  EXPECT_FALSE(collected.chunks.empty());
+  // Counted from Resume(), not from arming.
+  EXPECT_GT(engine->stats().time_to_first_sample_us, 0);
+  EXPECT_LT(engine->stats().time_to_first_sample_us, 30000);
+  engine->Stop();
+}
+
+TEST(CaptureEngine, StopEndsEndlessSession) {
+  std::unique_ptr<CaptureEngine> engine = CaptureEngine::Create();
+  ASSERT_NE(engine, nullptr);
+
+  ASSERT_TRUE(engine->Start(
+      std::unique_ptr<CaptureSource>(new FakeCaptureSource(Ramp(64), 1, 16,
+                                                           true)),
+      MakeConfig(1, 32)));
+  EXPECT_TRUE(engine->running());
+  EXPECT_FALSE(engine->Start(
+      std::unique_ptr<CaptureSource>(new FakeCaptureSource(Ramp(64), 1, 16)),
+      MakeConfig(1, 32)));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  engine->Stop();
+  EXPECT_FALSE(engine->running());
+  // A requested stop is not reported as the session finishing on its own.
+  EXPECT_FALSE(engine->finished());
+  EXPECT_GT(engine->stats().time_to_first_sample_us, 0);
+  EXPECT_GT(engine->stats().time_to_stopped_us, 0);
+  EXPECT_LT(engine->stats().time_to_stopped_us, 1000000);
+}
+
+}  // namespace test
+}  // namespace audio_capture
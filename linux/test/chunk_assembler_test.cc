@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "chunk_assembler.h"
+
+namespace audio_capture {
+namespace test {
+
+namespace {
+
+// Bytes that differ from their neighbours, so misplaced data shows.
+std::vector<uint8_t> Sequence(size_t size) {
+  std::vector<uint8_t> bytes(size);
+  for (size_t i = 0; i < size; ++i) {
+    bytes[i] = static_cast<uint8_t>(i * 7 + i / 251);
+  }
+  return bytes;
+}
+
+// Reads every complete chunk, appending it to |output| and its length to
+// |frame_counts|.
+void Drain(ChunkAssembler* assembler, std::vector<uint8_t>* output,
+           std::vector<size_t>* frame_counts) {
+  size_t frames = 0;
+  while (const uint8_t* chunk = assembler->PeekChunk(&frames)) {
+    output->insert(output->end(), chunk,
+                   chunk + frames * assembler->frame_bytes());
+    frame_counts->push_back(frames);
+    assembler->ConsumeChunk();
+  }
+}
+
+}  // namespace
+
+TEST(ChunkAssembler, ReassemblesFragmentsOfAnySize) {
+  // Stereo int16 at 16 kHz in 20 ms chunks of 320 frames.
+  ChunkAssembler assembler(4, 16000, 20);
+  ASSERT_EQ(assembler.max_chunk_frames(), 320u);
+  const std::vector<uint8_t> input = Sequence(25 * 1280 + 100);
+
+  // Fragments split frames and straddle chunks and the end of the ring.
+  const size_t fragments[] = {1, 3, 7, 1279, 1, 2000, 641, 333};
+  std::vector<uint8_t> output;
+  std::vector<size_t> frame_counts;
+  size_t offset = 0;
+  for (size_t i = 0; offset < input.size(); ++i) {
+    const size_t end = std::min(offset + fragments[i % 8], input.size());
+    // Fragments larger than the free space go in as chunks are read, the
+    // way the capture loops feed them.
+    while (offset < end) {
+      offset += assembler.Write(input.data() + offset, end - offset);
+      Drain(&assembler, &output, &frame_counts);
+    }
+  }
+
+  ASSERT_EQ(frame_counts.size(), 25u);
+  for (size_t frames : frame_counts) {
+    EXPECT_EQ(frames, 320u);
+  }
+  EXPECT_EQ(output, std::vector<uint8_t>(input.begin(), input.end() - 100));
+  EXPECT_EQ(assembler.buffered_bytes(), 100u);
+  EXPECT_EQ(assembler.consumed_frames(), 25u * 320);
+}
+
+TEST(ChunkAssembler, CarriesFractionalFramesBetweenChunks) {
+  // 30 ms chunks are 661.5 frames at 22050 Hz and 1323.03 at 44101 Hz.
+  struct Case {
+    int sample_rate;
+    size_t max_chunk_frames;
+    // Frames in 100 chunks, 3 s.
+    size_t total_frames;
+  };
+  const Case cases[] = {{22050, 662, 66150}, {44101, 1324, 132303}};
+  const std::vector<uint8_t> packet = Sequence(441 * 2);
+  for (const Case& test_case : cases) {
+    ChunkAssembler assembler(2, test_case.sample_rate, 30);
+    EXPECT_EQ(assembler.max_chunk_frames(), test_case.max_chunk_frames);
+
+    std::vector<uint8_t> expected;
+    std::vector<uint8_t> output;
+    std::vector<size_t> frame_counts;
+    size_t written = 0;
+    while (written < test_case.total_frames) {
+      const size_t frames =
+          std::min<size_t>(441, test_case.total_frames - written);
+      ASSERT_EQ(assembler.Write(packet.data(), frames * 2), frames * 2);
+      expected.insert(expected.end(), packet.begin(),
+                      packet.begin() + frames * 2);
+      written += frames;
+      Drain(&assembler, &output, &frame_counts);
+    }
+
+    // Without the carry, 100 chunks would fall 50 or 3 frames short.
+    ASSERT_EQ(frame_counts.size(), 100u) << test_case.sample_rate;
+    // Chunks of alternating sizes wrap around the ring at varying offsets.
+    EXPECT_EQ(output, expected);
+    EXPECT_EQ(assembler.consumed_frames(), test_case.total_frames);
+    EXPECT_EQ(assembler.buffered_bytes(), 0u);
+    for (size_t frames : frame_counts) {
+      EXPECT_GE(frames, test_case.max_chunk_frames - 1);
+      EXPECT_LE(frames, test_case.max_chunk_frames);
+    }
+  }
+}
+
+TEST(ChunkAssembler, WritesShortWhenChunksAreNotRead) {
+  ChunkAssembler assembler(2, 8000, 10);
+  const std::vector<uint8_t> input = Sequence(1000);
+  // The ring holds two 80-frame chunks.
+  EXPECT_EQ(assembler.Write(input.data(), input.size()), 320u);
+  EXPECT_EQ(assembler.Write(input.data(), 1), 0u);
+
+  size_t frames = 0;
+  const uint8_t* chunk = assembler.PeekChunk(&frames);
+  ASSERT_NE(chunk, nullptr);
+  EXPECT_EQ(std::vector<uint8_t>(chunk, chunk + 160),
+            std::vector<uint8_t>(input.begin(), input.begin() + 160));
+  assembler.ConsumeChunk();
+  EXPECT_EQ(assembler.Write(input.data() + 320, 500), 160u);
+}
+
+TEST(ChunkAssembler, ResetForgetsBufferedData) {
+  ChunkAssembler assembler(2, 22050, 30);
+  const std::vector<uint8_t> input = Sequence(2000);
+  assembler.Write(input.data(), input.size());
+  size_t frames = 0;
+  ASSERT_NE(assembler.PeekChunk(&frames), nullptr);
+  EXPECT_EQ(frames, 661u);
+  assembler.ConsumeChunk();
+
+  assembler.Reset();
+  EXPECT_EQ(assembler.buffered_bytes(), 0u);
+  EXPECT_EQ(assembler.consumed_frames(), 0u);
+  EXPECT_EQ(assembler.PeekChunk(&frames), nullptr);
+  assembler.Write(input.data(), input.size());
+  ASSERT_NE(assembler.PeekChunk(&frames), nullptr);
+  EXPECT_EQ(frames, 661u);
+}
+
+}  // namespace test
+}  // namespace audio_capture
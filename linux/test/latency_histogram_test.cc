@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+#include "latency_histogram.h"
+
+namespace audio_capture {
+namespace test {
+
+TEST(LatencyHistogram, EmptyReportsZero) {
+  LatencyHistogram histogram;
+  EXPECT_EQ(histogram.count(), 0u);
+  EXPECT_EQ(histogram.min(), 0);
+  EXPECT_EQ(histogram.max(), 0);
+  EXPECT_EQ(histogram.mean(), 0.0);
+  EXPECT_EQ(histogram.Percentile(50), 0);
+}
+
+TEST(LatencyHistogram, SmallValuesAreExact) {
+  LatencyHistogram histogram;
+  for (int64_t value = 0; value < 16; ++value) {
+    histogram.Record(value);
+  }
+  EXPECT_EQ(histogram.count(), 16u);
+  EXPECT_EQ(histogram.min(), 0);
+  EXPECT_EQ(histogram.max(), 15);
+  EXPECT_DOUBLE_EQ(histogram.mean(), 7.5);
+  EXPECT_EQ(histogram.Percentile(50), 7);
+  EXPECT_EQ(histogram.Percentile(100), 15);
+}
+
+TEST(LatencyHistogram, PercentilesStayWithinBucketResolution) {
+  LatencyHistogram histogram;
+  // 1 to 100000 us, uniformly.
+  for (int64_t value = 1; value <= 100000; ++value) {
+    histogram.Record(value);
+  }
+  const double tolerance = 1.0 / LatencyHistogram::kSubBuckets;
+  EXPECT_NEAR(histogram.Percentile(50), 50000, 50000 * tolerance);
+  EXPECT_NEAR(histogram.Percentile(99), 99000, 99000 * tolerance);
+  EXPECT_GE(histogram.Percentile(99), 99000);
+  EXPECT_EQ(histogram.Percentile(100), 100000);
+}
+
+TEST(LatencyHistogram, ClampsOutOfRangeValues) {
+  LatencyHistogram histogram;
+  histogram.Record(-5);
+  histogram.Record(INT64_C(1) << 50);
+  EXPECT_EQ(histogram.min(), 0);
+  EXPECT_EQ(histogram.max(), INT64_C(1) << 50);
+  EXPECT_EQ(histogram.Percentile(50), 0);
+  EXPECT_EQ(histogram.Percentile(100), INT64_C(1) << 50);
+}
+
+TEST(LatencyHistogram, ResetForgetsEverything) {
+  LatencyHistogram histogram;
+  histogram.Record(1000);
+  histogram.Reset();
+  EXPECT_EQ(histogram.count(), 0u);
+  EXPECT_EQ(histogram.max(), 0);
+  EXPECT_EQ(histogram.Percentile(99), 0);
+}
+
+}  // namespace test
+}  // namespace audio_capture
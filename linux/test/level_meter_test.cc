@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "level_meter.h"
+
+namespace audio_capture {
+namespace test {
+
+namespace {
+
+// Meters |frame_count| mono frames of constant |value| the way the capture
+// threads do, returning every reading taken.
+std::vector<LevelReading> Feed(LevelMeter* meter, int16_t value,
+                               size_t frame_count, size_t fragment_frames) {
+  std::vector<int16_t> input(fragment_frames, value);
+  std::vector<int16_t> output(fragment_frames);
+  std::vector<LevelReading> readings;
+
+  while (frame_count > 0) {
+    size_t fragment = std::min(frame_count, fragment_frames);
+    frame_count -= fragment;
+    const int16_t* samples = input.data();
+    while (fragment > 0) {
+      const size_t frames = std::min(fragment, meter->frames_until_reading());
+      MixToMono(samples, output.data(), frames, 1, 1.0f, 1.0f,
+                meter->levels());
+      samples += frames;
+      fragment -= frames;
+
+      LevelReading reading;
+      if (meter->TakeReading(&reading)) {
+        readings.push_back(reading);
+      }
+    }
+  }
+  return readings;
+}
+
+}  // namespace
+
+TEST(LevelMeter, DecibelMatchesFullScaleReference) {
+  LevelAccumulator levels{0, 0, 0};
+  const int16_t samples[] = {32767, -32767};
+  int16_t output[2];
+  MixToMono(samples, output, 2, 1, 1.0f, 1.0f, &levels);
+  const LevelReading reading = ReadLevels(levels);
+  EXPECT_DOUBLE_EQ(reading.rms, 1.0);
+  EXPECT_DOUBLE_EQ(reading.decibel, 0.0);
+  EXPECT_DOUBLE_EQ(reading.peak_decibel, 0.0);
+}
+
+TEST(LevelMeter, SilenceIsMinusOneTwenty) {
+  const LevelReading reading = ReadLevels(LevelAccumulator{0, 0, 0});
+  EXPECT_EQ(reading.decibel, -120.0);
+  EXPECT_EQ(LevelToDecibel(0.0), -120.0);
+}
+
+TEST(LevelMeter, RateIsIndependentOfFragmentSize) {
+  // One second at 48 kHz metered at 30 Hz, delivered in odd-sized fragments.
+  LevelMeter meter(48000, 30.0);
+  const std::vector<LevelReading> readings = Feed(&meter, 1000, 48000, 777);
+  EXPECT_EQ(readings.size(), 30u);
+}
+
+TEST(LevelMeter, InstantBallisticsTrackInput) {
+  LevelMeter meter(16000, 50.0, 0.0, 0.0);
+  const std::vector<LevelReading> readings = Feed(&meter, 16384, 320, 320);
+  ASSERT_EQ(readings.size(), 1u);
+  EXPECT_NEAR(readings[0].rms, 16384 / 32767.0, 1e-9);
+  EXPECT_NEAR(readings[0].peak, 16384 / 32767.0, 1e-9);
+}
+
+TEST(LevelMeter, ReleaseIsSlowerThanAttack) {
+  LevelMeter meter(16000, 100.0, 5.0, 500.0);
+  const std::vector<LevelReading> rise = Feed(&meter, 20000, 1600, 160);
+  ASSERT_FALSE(rise.empty());
+  const double loud = rise.back().rms;
+  EXPECT_NEAR(loud, 20000 / 32767.0, 1e-3);
+
+  const std::vector<LevelReading> fall = Feed(&meter, 0, 160, 160);
+  ASSERT_EQ(fall.size(), 1u);
+  // A 10 ms step against a 500 ms release keeps most of the level.
+  EXPECT_GT(fall[0].rms, loud * 0.9);
+  EXPECT_LT(fall[0].rms, loud);
+}
+
+TEST(LevelMeter, ResetDropsPartialInterval) {
+  LevelMeter meter(1000, 10.0);
+  EXPECT_EQ(meter.frames_until_reading(), 100u);
+  Feed(&meter, 100, 40, 40);
+  EXPECT_EQ(meter.frames_until_reading(), 60u);
+  meter.Reset();
+  EXPECT_EQ(meter.frames_until_reading(), 100u);
+}
+
+}  // namespace test
+}  // namespace audio_capture
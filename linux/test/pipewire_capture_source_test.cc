@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "capture_backend.h"
+#include "pipewire_capture_source.h"
+
+// These tests record from a real PipeWire daemon and skip themselves when
+// none is reachable. To run them headless, start a private daemon with a
+// null sink whose monitor provides a clocked (silent) stream:
+//
+//   export XDG_RUNTIME_DIR=$(mktemp -d)
+//   pipewire & wireplumber &
+//   pw-cli create-node adapter '{ factory.name=support.null-audio-sink
+//       node.name=test-sink media.class=Audio/Sink object.linger=true
+//       audio.position=[FL FR] }'
+//   ./desktop_audio_capture_test --gtest_filter='PipeWire*'
+
+namespace audio_capture {
+namespace test {
+
+namespace {
+
+CaptureSourceConfig MakeMonitorConfig(int channels) {
+  CaptureSourceConfig config;
+  config.monitor = true;
+  config.stream_name = "PipeWire Test";
+  config.sample_rate = 16000;
+  config.channels = channels;
+  config.fragment_bytes = 320 * sizeof(int16_t) * channels;
+  config.max_buffer_bytes = config.fragment_bytes * 16;
+  return config;
+}
+
+}  // namespace
+
+TEST(PipeWireCaptureSource, DeliversWholeFramesFromSinkMonitor) {
+  for (int channels = 1; channels <= 2; ++channels) {
+    std::string error;
+    std::unique_ptr<PipeWireStreamSource> source =
+        PipeWireStreamSource::Open(MakeMonitorConfig(channels), &error);
+    if (source == nullptr) {
+      GTEST_SKIP() << "no PipeWire daemon: " << error;
+    }
+
+    const size_t frame_bytes = sizeof(int16_t) * channels;
+    size_t total = 0;
+    for (int i = 0; i < 20; ++i) {
+      const uint8_t* data = nullptr;
+      size_t bytes = 0;
+      ASSERT_EQ(source->Acquire(&data, &bytes), CaptureReadStatus::kOk)
+          << source->last_error();
+      ASSERT_NE(data, nullptr);
+      ASSERT_GT(bytes, 0u);
+      EXPECT_EQ(bytes % frame_bytes, 0u);
+      EXPECT_GE(source->fragment_latency_us(), 0);
+      total += bytes;
+      source->Release();
+    }
+    EXPECT_GE(total, 20 * frame_bytes);
+  }
+}
+
+TEST(PipeWireCaptureSource, ExplicitBackendDoesNotFallBack) {
+  CaptureBackend opened = CaptureBackend::kAuto;
+  std::string error;
+  std::unique_ptr<CaptureSource> source = OpenCaptureSource(
+      CaptureBackend::kPipeWire, MakeMonitorConfig(1), &opened, &error);
+  if (source == nullptr) {
+    EXPECT_FALSE(error.empty());
+    EXPECT_EQ(opened, CaptureBackend::kAuto);
+    return;
+  }
+  EXPECT_EQ(opened, CaptureBackend::kPipeWire);
+}
+
+TEST(PipeWireCaptureSource, ParsesBackendNames) {
+  CaptureBackend backend = CaptureBackend::kAuto;
+  ASSERT_TRUE(ParseCaptureBackend("pipewire", &backend));
+  EXPECT_EQ(backend, CaptureBackend::kPipeWire);
+  ASSERT_TRUE(ParseCaptureBackend("pulseaudio", &backend));
+  EXPECT_EQ(backend, CaptureBackend::kPulseAudio);
+  ASSERT_TRUE(ParseCaptureBackend("auto", &backend));
+  EXPECT_EQ(backend, CaptureBackend::kAuto);
+  EXPECT_FALSE(ParseCaptureBackend("alsa", &backend));
+  EXPECT_EQ(backend, CaptureBackend::kAuto);
+  for (CaptureBackend value : {CaptureBackend::kAuto, CaptureBackend::kPipeWire,
+                               CaptureBackend::kPulseAudio}) {
+    ASSERT_TRUE(ParseCaptureBackend(CaptureBackendName(value), &backend));
+    EXPECT_EQ(backend, value);
+  }
+}
+
+}  // namespace test
+}  // namespace audio_capture
@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pulse_device_monitor.h"
+
+namespace audio_capture {
+namespace test {
+
+class PulseDeviceMonitorPeer {
+ public:
+  static void UpdateSource(PulseDeviceMonitor* monitor,
+                           const pa_source_info& source) {
+    monitor->UpdateSource(source);
+  }
+
+  static void UpdateCard(PulseDeviceMonitor* monitor,
+                         const pa_card_info& card) {
+    monitor->UpdateCard(card);
+  }
+};
+
+// Works with or without a running server: without one the cache is simply
+// empty, but queries must still return promptly.
+TEST(PulseDeviceMonitor, AnswersFromCacheAfterFirstListing) {
+  std::unique_ptr<PulseDeviceMonitor> monitor = PulseDeviceMonitor::Create();
+  ASSERT_NE(monitor, nullptr);
+
+  const std::vector<AudioDeviceInfo> first = monitor->Sources();
+
+  const auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 100; ++i) {
+    monitor->Sources();
+    monitor->HasInputDevice();
+  }
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  EXPECT_LT(elapsed, std::chrono::milliseconds(100));
+
+  int defaults = 0;
+  bool has_input = false;
+  for (const AudioDeviceInfo& device : first) {
+    EXPECT_FALSE(device.id.empty());
+    EXPECT_FALSE(device.name.empty());
+    EXPECT_GT(device.channels, 0);
+    EXPECT_GT(device.sample_rate, 0);
+    defaults += device.is_default ? 1 : 0;
+    has_input = has_input || !device.is_monitor;
+    if (!device.is_bluetooth()) {
+      EXPECT_TRUE(device.transport_ready);
+    }
+  }
+  EXPECT_LE(defaults, 1);
+  EXPECT_EQ(monitor->HasInputDevice(), has_input);
+
+  AudioDeviceInfo device;
+  if (monitor->DefaultSource(&device)) {
+    EXPECT_TRUE(device.is_default);
+  }
+}
+
+// Wired sources are ready as soon as they are listed, and unknown ids wait
+// out the timeout instead of blocking indefinitely.
+TEST(PulseDeviceMonitor, WaitsForReadySourceOnlyWhenNeeded) {
+  std::unique_ptr<PulseDeviceMonitor> monitor = PulseDeviceMonitor::Create();
+  ASSERT_NE(monitor, nullptr);
+
+  AudioDeviceInfo device;
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(monitor->WaitForReadySource(
+      "no-such-source", std::chrono::milliseconds(50), &device));
+  EXPECT_LT(std::chrono::steady_clock::now() - start,
+            std::chrono::seconds(1));
+
+  for (const AudioDeviceInfo& source : monitor->Sources()) {
+    if (source.is_bluetooth()) {
+      continue;
+    }
+    start = std::chrono::steady_clock::now();
+    EXPECT_TRUE(monitor->WaitForReadySource(
+        source.id, std::chrono::seconds(5), &device));
+    EXPECT_LT(std::chrono::steady_clock::now() - start,
+              std::chrono::milliseconds(100));
+    EXPECT_EQ(device.id, source.id);
+  }
+}
+
+// A headset still in a playback-only profile has no input source; its
+// hands-free source and recording profile only show up once it switches,
+// which may be after the wait began.
+TEST(PulseDeviceMonitor, WaitsForSourceThatAppearsAfterTheWaitStarts) {
+  std::unique_ptr<PulseDeviceMonitor> monitor = PulseDeviceMonitor::Create();
+  ASSERT_NE(monitor, nullptr);
+  // Indices no server hands out in practice.
+  constexpr uint32_t kSourceIndex = 0x7ffffff0;
+  constexpr uint32_t kCardIndex = 0x7ffffff1;
+  const std::string id = "bluez_input.00_11_22_33_44_55.0";
+  // Past the first listing, or the first failed connect without a server,
+  // either of which would replace what is fed in below.
+  monitor->Sources();
+
+  std::thread server([&monitor, &id] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    pa_proplist* properties = pa_proplist_new();
+    pa_proplist_sets(properties, PA_PROP_DEVICE_BUS, "bluetooth");
+    pa_proplist_sets(properties, PA_PROP_DEVICE_API, "bluez5");
+    pa_source_info source = {};
+    source.name = id.c_str();
+    source.index = kSourceIndex;
+    source.description = "Test Headset";
+    source.sample_spec.format = PA_SAMPLE_S16LE;
+    source.sample_spec.rate = 16000;
+    source.sample_spec.channels = 1;
+    pa_channel_map_init_mono(&source.channel_map);
+    source.monitor_of_sink = PA_INVALID_INDEX;
+    source.proplist = properties;
+    source.card = kCardIndex;
+    PulseDeviceMonitorPeer::UpdateSource(monitor.get(), source);
+    pa_proplist_free(properties);
+
+    // Listed before its card reports the profile, so not ready yet.
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    pa_card_profile_info2 profile = {};
+    profile.name = "headset-head-unit";
+    profile.n_sources = 1;
+    profile.available = PA_AVAILABLE_YES;
+    pa_card_info card = {};
+    card.index = kCardIndex;
+    card.active_profile2 = &profile;
+    PulseDeviceMonitorPeer::UpdateCard(monitor.get(), card);
+  });
+
+  AudioDeviceInfo device;
+  EXPECT_FALSE(monitor->FindSource(id, &device));
+  const auto start = std::chrono::steady_clock::now();
+  const bool ready =
+      monitor->WaitForReadySource(id, std::chrono::seconds(5), &device);
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  server.join();
+
+  EXPECT_TRUE(ready);
+  EXPECT_GE(elapsed, std::chrono::milliseconds(90));
+  EXPECT_LT(elapsed, std::chrono::seconds(5));
+  EXPECT_EQ(device.id, id);
+  EXPECT_TRUE(device.is_bluetooth());
+  EXPECT_TRUE(device.transport_ready);
+  EXPECT_EQ(device.card_profile, "headset-head-unit");
+}
+
+}  // namespace test
+}  // namespace audio_capture
@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "resampler.h"
+
+namespace audio_capture {
+namespace test {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+std::vector<int16_t> Tone(double frequency, int sample_rate, size_t frames,
+                          double amplitude) {
+  std::vector<int16_t> samples(frames);
+  for (size_t i = 0; i < frames; ++i) {
+    samples[i] = static_cast<int16_t>(std::lrint(
+        amplitude * std::sin(2.0 * kPi * frequency * i / sample_rate)));
+  }
+  return samples;
+}
+
+// Feeds |input| through |resampler| in fragments of |fragment_frames|.
+std::vector<int16_t> Resample(Resampler* resampler,
+                              const std::vector<int16_t>& input,
+                              size_t fragment_frames) {
+  std::vector<int16_t> output;
+  std::vector<int16_t> buffer(resampler->MaxOutputFrames(fragment_frames));
+  for (size_t offset = 0; offset < input.size(); offset += fragment_frames) {
+    const size_t frames = std::min(fragment_frames, input.size() - offset);
+    const size_t produced =
+        resampler->Process(input.data() + offset, frames, buffer.data());
+    EXPECT_LE(produced, resampler->MaxOutputFrames(frames));
+    output.insert(output.end(), buffer.begin(), buffer.begin() + produced);
+  }
+  return output;
+}
+
+// Resamples a unit-amplitude float tone in one call, free of int16 rounding.
+std::vector<float> ResampleFloatTone(Resampler* resampler, double frequency,
+                                     size_t frames) {
+  const int rate = resampler->input_rate();
+  std::vector<float> input(frames);
+  for (size_t i = 0; i < frames; ++i) {
+    input[i] = static_cast<float>(std::sin(2.0 * kPi * frequency * i / rate));
+  }
+  std::vector<float> output(resampler->MaxOutputFrames(frames));
+  output.resize(resampler->Process(input.data(), frames, output.data()));
+  return output;
+}
+
+// RMS of |samples| past the filter's start-up.
+template <typename Sample>
+double SteadyRms(const std::vector<Sample>& samples, size_t skip) {
+  double sum = 0.0;
+  size_t count = 0;
+  for (size_t i = skip; i < samples.size(); ++i) {
+    sum += static_cast<double>(samples[i]) * samples[i];
+    ++count;
+  }
+  return count > 0 ? std::sqrt(sum / count) : 0.0;
+}
+
+}  // namespace
+
+TEST(Resampler, ProducesOutputAtTheRateRatio) {
+  const int rates[][2] = {{48000, 16000}, {44100, 16000}, {16000, 48000},
+                          {44100, 48000}, {96000, 8000},  {22050, 44100},
+                          {44101, 16000}};
+  for (const auto& rate : rates) {
+    Resampler resampler(rate[0], rate[1]);
+    const std::vector<int16_t> input(static_cast<size_t>(rate[0]), 0);
+    const size_t produced = Resample(&resampler, input, 441).size();
+    // One second in, one second out, less the filter delay.
+    EXPECT_NEAR(static_cast<double>(produced), rate[1],
+                resampler.taps() * static_cast<double>(rate[1]) / rate[0])
+        << rate[0] << " -> " << rate[1];
+  }
+}
+
+TEST(Resampler, FragmentSizeDoesNotChangeOutput) {
+  const std::vector<int16_t> input = Tone(997.0, 44100, 8820, 12000.0);
+
+  Resampler whole(44100, 16000);
+  const std::vector<int16_t> expected = Resample(&whole, input, input.size());
+
+  const size_t fragments[] = {1, 7, 64, 441, 1000};
+  for (size_t fragment : fragments) {
+    Resampler split(44100, 16000);
+    EXPECT_EQ(Resample(&split, input, fragment), expected)
+        << "fragment " << fragment;
+  }
+}
+
+TEST(Resampler, KeepsPassbandLevel) {
+  Resampler resampler(48000, 16000);
+  const std::vector<int16_t> output =
+      Resample(&resampler, Tone(1000.0, 48000, 48000, 10000.0), 480);
+  EXPECT_NEAR(SteadyRms(output, 1000), 10000.0 / std::sqrt(2.0), 100.0);
+
+  Resampler upsampler(16000, 44100);
+  const std::vector<int16_t> upsampled =
+      Resample(&upsampler, Tone(1000.0, 16000, 16000, 10000.0), 160);
+  EXPECT_NEAR(SteadyRms(upsampled, 2000), 10000.0 / std::sqrt(2.0), 100.0);
+}
+
+TEST(Resampler, RejectsWhatWouldAlias) {
+  // 12 kHz is above the 8 kHz Nyquist frequency of the output and would
+  // fold back to 4 kHz without filtering.
+  Resampler resampler(48000, 16000);
+  const std::vector<int16_t> output =
+      Resample(&resampler, Tone(12000.0, 48000, 48000, 20000.0), 480);
+  const double attenuation_db =
+      20.0 * std::log10(SteadyRms(output, 1000) / (20000.0 / std::sqrt(2.0)));
+  EXPECT_LT(attenuation_db, -60.0);
+}
+
+TEST(Resampler, QualityTiersTradeTapsForStopband) {
+  struct Tier {
+    ResamplerQuality quality;
+    double max_alias_db;
+  };
+  const Tier tiers[] = {{ResamplerQuality::kLow, -60.0},
+                        {ResamplerQuality::kMedium, -80.0},
+                        {ResamplerQuality::kHigh, -100.0}};
+  int previous_taps = 0;
+  for (const Tier& tier : tiers) {
+    Resampler resampler(48000, 16000, tier.quality);
+    EXPECT_GT(resampler.taps(), previous_taps);
+    EXPECT_EQ(resampler.taps() % 8, 0);
+    previous_taps = resampler.taps();
+
+    // A 12 kHz tone would fold back to 4 kHz.
+    const double alias_db = 20.0 * std::log10(SteadyRms(
+        ResampleFloatTone(&resampler, 12000.0, 48000), 1000) * std::sqrt(2.0));
+    EXPECT_LT(alias_db, tier.max_alias_db)
+        << "quality " << static_cast<int>(tier.quality);
+
+    Resampler passband(48000, 16000, tier.quality);
+    EXPECT_NEAR(SteadyRms(ResampleFloatTone(&passband, 1000.0, 48000), 1000),
+                1.0 / std::sqrt(2.0), 0.01)
+        << "quality " << static_cast<int>(tier.quality);
+  }
+}
+
+TEST(Resampler, FloatMatchesInt16) {
+  const std::vector<int16_t> input = Tone(997.0, 44100, 4410, 12000.0);
+  Resampler integer(44100, 16000);
+  const std::vector<int16_t> expected = Resample(&integer, input, 441);
+
+  Resampler floating(44100, 16000);
+  const std::vector<float> samples(input.begin(), input.end());
+  std::vector<float> output(floating.MaxOutputFrames(samples.size()));
+  output.resize(floating.Process(samples.data(), samples.size(),
+                                 output.data()));
+  ASSERT_EQ(output.size(), expected.size());
+  for (size_t i = 0; i < output.size(); ++i) {
+    EXPECT_NEAR(output[i], expected[i], 1.0f) << i;
+  }
+}
+
+TEST(Resampler, ResetForgetsHistory) {
+  Resampler resampler(44100, 48000);
+  const std::vector<int16_t> input = Tone(440.0, 44100, 4410, 8000.0);
+  const std::vector<int16_t> first = Resample(&resampler, input, 441);
+  resampler.Reset();
+  EXPECT_EQ(Resample(&resampler, input, 441), first);
+}
+
+}  // namespace test
+}  // namespace audio_capture
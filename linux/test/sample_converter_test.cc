@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "audio_kernels.h"
+#include "sample_converter.h"
+
+namespace audio_capture {
+namespace test {
+
+namespace {
+
+const PcmEncoding kIntegerEncodings[] = {PcmEncoding::kS16, PcmEncoding::kS24,
+                                         PcmEncoding::kS24In32,
+                                         PcmEncoding::kS32};
+
+// Bits of a left-justified int32 that |encoding| keeps.
+uint32_t KeptBits(PcmEncoding encoding) {
+  switch (encoding) {
+    case PcmEncoding::kS16:
+      return 0xFFFF0000u;
+    case PcmEncoding::kS24:
+    case PcmEncoding::kS24In32:
+      return 0xFFFFFF00u;
+    default:
+      return 0xFFFFFFFFu;
+  }
+}
+
+// Writes |sample|, left-justified in an int32, in |format|. The high byte of
+// kS24In32 is filled with junk the converter must ignore.
+void Encode(int32_t sample, PcmFormat format, uint8_t* output) {
+  const uint32_t word = static_cast<uint32_t>(sample);
+  const uint8_t msb_first[] = {static_cast<uint8_t>(word >> 24),
+                               static_cast<uint8_t>(word >> 16),
+                               static_cast<uint8_t>(word >> 8),
+                               static_cast<uint8_t>(word)};
+  std::vector<uint8_t> bytes;
+  switch (format.encoding) {
+    case PcmEncoding::kS16:
+      bytes.assign(msb_first, msb_first + 2);
+      break;
+    case PcmEncoding::kS24:
+      bytes.assign(msb_first, msb_first + 3);
+      break;
+    case PcmEncoding::kS24In32:
+      bytes = {0xA5, msb_first[0], msb_first[1], msb_first[2]};
+      break;
+    default:
+      bytes.assign(msb_first, msb_first + 4);
+      break;
+  }
+  if (!format.big_endian) {
+    std::reverse(bytes.begin(), bytes.end());
+  }
+  std::copy(bytes.begin(), bytes.end(), output);
+}
+
+std::vector<int32_t> RandomSamples(size_t count, PcmEncoding encoding) {
+  std::mt19937 engine(static_cast<uint32_t>(encoding) + 1);
+  std::uniform_int_distribution<int32_t> distribution(INT32_MIN, INT32_MAX);
+  std::vector<int32_t> samples(count);
+  for (int32_t& sample : samples) {
+    sample = static_cast<int32_t>(static_cast<uint32_t>(distribution(engine)) &
+                                  KeptBits(encoding));
+  }
+  // Make sure the extremes are always exercised.
+  samples[0] = INT32_MIN;
+  samples[1] = static_cast<int32_t>(INT32_MAX & KeptBits(encoding));
+  return samples;
+}
+
+}  // namespace
+
+TEST(SampleConverter, ConvertsEveryIntegerEncoding) {
+  // Counts around the SIMD block sizes cover every tail; the odd offset
+  // covers unaligned input.
+  constexpr size_t kMaxCount = 37;
+  for (PcmEncoding encoding : kIntegerEncodings) {
+    for (bool big_endian : {false, true}) {
+      const PcmFormat format{encoding, big_endian};
+      const size_t bytes = PcmBytesPerSample(encoding);
+      const std::vector<int32_t> samples = RandomSamples(kMaxCount, encoding);
+      std::vector<uint8_t> input(1 + kMaxCount * bytes);
+      for (size_t i = 0; i < kMaxCount; ++i) {
+        Encode(samples[i], format, &input[1 + i * bytes]);
+      }
+
+      for (size_t count = 0; count <= kMaxCount; ++count) {
+        std::vector<int16_t> narrow(count + 1, 0x7777);
+        std::vector<float> wide(count + 1, 7.0f);
+        ConvertToInt16(&input[1], format, count, narrow.data());
+        ConvertToFloat(&input[1], format, count, wide.data());
+        for (size_t i = 0; i < count; ++i) {
+          ASSERT_EQ(narrow[i], static_cast<int16_t>(samples[i] >> 16))
+              << "encoding " << static_cast<int>(encoding) << " big-endian "
+              << big_endian << " count " << count << " sample " << i;
+          ASSERT_EQ(wide[i], static_cast<float>(samples[i]) / 2147483648.0f)
+              << "encoding " << static_cast<int>(encoding) << " big-endian "
+              << big_endian << " count " << count << " sample " << i;
+        }
+        // Nothing past |count| is written.
+        EXPECT_EQ(narrow[count], 0x7777);
+        EXPECT_EQ(wide[count], 7.0f);
+      }
+    }
+  }
+}
+
+TEST(SampleConverter, ConvertsFloatsLikeTheKernels) {
+  std::mt19937 engine(3);
+  std::uniform_real_distribution<float> distribution(-1.5f, 1.5f);
+  std::vector<float> samples(29);
+  for (float& sample : samples) {
+    sample = distribution(engine);
+  }
+  samples[0] = -1.0f;
+  samples[1] = 1.0f;
+  samples[2] = 0.99999f;
+  std::vector<int16_t> expected(samples.size());
+  FloatToInt16(samples.data(), expected.data(), samples.size());
+
+  for (bool big_endian : {false, true}) {
+    const PcmFormat format{PcmEncoding::kF32, big_endian};
+    std::vector<uint8_t> input(samples.size() * 4);
+    for (size_t i = 0; i < samples.size(); ++i) {
+      uint32_t word;
+      std::memcpy(&word, &samples[i], sizeof(word));
+      Encode(static_cast<int32_t>(word), format, &input[i * 4]);
+    }
+    std::vector<int16_t> narrow(samples.size());
+    std::vector<float> wide(samples.size());
+    ConvertToInt16(input.data(), format, samples.size(), narrow.data());
+    ConvertToFloat(input.data(), format, samples.size(), wide.data());
+    EXPECT_EQ(narrow, expected) << "big-endian " << big_endian;
+    EXPECT_EQ(wide, samples) << "big-endian " << big_endian;
+  }
+}
+
+TEST(SampleConverter, ReadsPackedAndPaddedTwentyFourBit) {
+  // -2^23, 2^23 - 1 and 256 in packed little-endian 24-bit.
+  const uint8_t packed[] = {0x00, 0x00, 0x80, 0xFF, 0xFF,
+                            0x7F, 0x00, 0x01, 0x00};
+  int16_t narrow[3];
+  float wide[3];
+  ConvertToInt16(packed, {PcmEncoding::kS24, false}, 3, narrow);
+  ConvertToFloat(packed, {PcmEncoding::kS24, false}, 3, wide);
+  EXPECT_EQ(narrow[0], -32768);
+  EXPECT_EQ(narrow[1], 32767);
+  EXPECT_EQ(narrow[2], 1);
+  EXPECT_EQ(wide[0], -1.0f);
+  EXPECT_EQ(wide[2], 256.0f / 8388608.0f);
+
+  // The same samples in big-endian S24_32, with a sign-extended high byte.
+  const uint8_t padded[] = {0xFF, 0x80, 0x00, 0x00, 0x00, 0x7F, 0xFF,
+                            0xFF, 0x00, 0x00, 0x01, 0x00};
+  ConvertToInt16(padded, {PcmEncoding::kS24In32, true}, 3, narrow);
+  EXPECT_EQ(narrow[0], -32768);
+  EXPECT_EQ(narrow[1], 32767);
+  EXPECT_EQ(narrow[2], 1);
+}
+
+}  // namespace test
+}  // namespace audio_capture
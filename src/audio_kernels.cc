@@ -0,0 +1,839 @@
+#include "audio_kernels.h"
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define AUDIO_KERNELS_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define AUDIO_KERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+// AVX2 code lives in this translation unit next to the baseline code, so it is
+// compiled for AVX2 per function and only reached after the CPU check.
+#if defined(AUDIO_KERNELS_X86) && !defined(_MSC_VER)
+#define AUDIO_KERNELS_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define AUDIO_KERNELS_TARGET_AVX2
+#endif
+
+namespace audio_capture {
+
+namespace {
+
+constexpr float kMaxSample = 32767.0f;
+constexpr float kMinSample = -32768.0f;
+
+// Scale between normalized floats and int16 / int32 samples.
+constexpr float kInt16Scale = 32768.0f;
+constexpr float kInt32Scale = 2147483648.0f;
+
+// Scalar reference. The SIMD kernels reproduce this arithmetic operation by
+// operation, and fall back to it for the frames left over after their last
+// full vector.
+float ScaleInput(int16_t sample, bool apply_volume, float input_volume) {
+  if (!apply_volume) {
+    return static_cast<float>(sample);
+  }
+  return static_cast<float>(
+      static_cast<int16_t>(static_cast<float>(sample) * input_volume));
+}
+
+int16_t Saturate(float sample) {
+  return static_cast<int16_t>(
+      std::max(kMinSample, std::min(kMaxSample, sample)));
+}
+
+void AccumulateLevels(const int16_t* samples, size_t count,
+                      LevelAccumulator* levels) {
+  uint64_t sum_of_squares = 0;
+  int32_t peak = levels->peak;
+  for (size_t i = 0; i < count; ++i) {
+    const int32_t sample = samples[i];
+    sum_of_squares += static_cast<uint64_t>(sample * sample);
+    peak = std::max(peak, sample < 0 ? -sample : sample);
+  }
+  levels->sum_of_squares += sum_of_squares;
+  levels->peak = peak;
+}
+
+// Folds the lane-wise partial levels of a SIMD kernel into |levels|.
+void MergeLevels(uint64_t sum_of_squares, int32_t max_sample,
+                 int32_t min_sample, LevelAccumulator* levels) {
+  levels->sum_of_squares += sum_of_squares;
+  levels->peak = std::max(levels->peak, std::max(max_sample, -min_sample));
+}
+
+void MixToMonoScalarRange(const int16_t* input, int16_t* output, size_t begin,
+                          size_t end, int input_channels, float input_volume,
+                          float gain_boost, LevelAccumulator* levels) {
+  const bool apply_volume = input_volume < 1.0f;
+
+  if (input_channels == 1) {
+    for (size_t i = begin; i < end; ++i) {
+      output[i] =
+          Saturate(ScaleInput(input[i], apply_volume, input_volume) * gain_boost);
+    }
+  } else {
+    const size_t stride = static_cast<size_t>(input_channels);
+    for (size_t i = begin; i < end; ++i) {
+      const float left =
+          ScaleInput(input[i * stride], apply_volume, input_volume);
+      const float right =
+          ScaleInput(input[i * stride + 1], apply_volume, input_volume);
+      output[i] = Saturate((left + right) / 2.0f * gain_boost);
+    }
+  }
+
+  if (levels != nullptr && end > begin) {
+    AccumulateLevels(output + begin, end - begin, levels);
+  }
+}
+
+void MixToMonoScalar(const int16_t* input, int16_t* output, size_t frame_count,
+                     int input_channels, float input_volume, float gain_boost,
+                     LevelAccumulator* levels) {
+  MixToMonoScalarRange(input, output, 0, frame_count, input_channels,
+                       input_volume, gain_boost, levels);
+  if (levels != nullptr) {
+    levels->sample_count += frame_count;
+  }
+}
+
+float DotProductScalar(const float* a, const float* b, size_t count) {
+  float sum = 0.0f;
+  for (size_t i = 0; i < count; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+#if defined(AUDIO_KERNELS_X86)
+
+__m128 ScaleSse2(__m128i samples, bool apply_volume, __m128 volume) {
+  const __m128 value = _mm_cvtepi32_ps(samples);
+  if (!apply_volume) {
+    return value;
+  }
+  return _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(value, volume)));
+}
+
+__m128i SaturateSse2(__m128 value) {
+  return _mm_cvttps_epi32(_mm_max_ps(_mm_set1_ps(kMinSample),
+                                     _mm_min_ps(_mm_set1_ps(kMaxSample), value)));
+}
+
+// Left and right samples of four interleaved stereo frames, sign extended.
+__m128i LeftSse2(__m128i frames) {
+  return _mm_srai_epi32(_mm_slli_epi32(frames, 16), 16);
+}
+
+__m128i RightSse2(__m128i frames) {
+  return _mm_srai_epi32(frames, 16);
+}
+
+// Squares are summed with pmaddwd. Two -32768 samples make a pair sum of 2^31,
+// which only fits unsigned, so the pair sums are zero-extended to 64 bits.
+class LevelsSse2 {
+ public:
+  LevelsSse2()
+      : sum_(_mm_setzero_si128()),
+        max_(_mm_setzero_si128()),
+        min_(_mm_setzero_si128()) {}
+
+  void Add(__m128i samples) {
+    const __m128i squares = _mm_madd_epi16(samples, samples);
+    const __m128i zero = _mm_setzero_si128();
+    sum_ = _mm_add_epi64(sum_, _mm_unpacklo_epi32(squares, zero));
+    sum_ = _mm_add_epi64(sum_, _mm_unpackhi_epi32(squares, zero));
+    max_ = _mm_max_epi16(max_, samples);
+    min_ = _mm_min_epi16(min_, samples);
+  }
+
+  void MergeInto(LevelAccumulator* levels) const {
+    uint64_t sums[2];
+    int16_t maxima[8];
+    int16_t minima[8];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(sums), sum_);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(maxima), max_);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(minima), min_);
+    MergeLevels(sums[0] + sums[1], *std::max_element(maxima, maxima + 8),
+                *std::min_element(minima, minima + 8), levels);
+  }
+
+ private:
+  __m128i sum_;
+  __m128i max_;
+  __m128i min_;
+};
+
+void MixToMonoSse2(const int16_t* input, int16_t* output, size_t frame_count,
+                   int input_channels, float input_volume, float gain_boost,
+                   LevelAccumulator* levels) {
+  if (input_channels > 2) {
+    MixToMonoScalar(input, output, frame_count, input_channels, input_volume,
+                    gain_boost, levels);
+    return;
+  }
+
+  const bool apply_volume = input_volume < 1.0f;
+  const __m128 volume = _mm_set1_ps(input_volume);
+  const __m128 gain = _mm_set1_ps(gain_boost);
+  const __m128 half = _mm_set1_ps(0.5f);
+  const size_t vector_end = frame_count & ~static_cast<size_t>(7);
+  LevelsSse2 vector_levels;
+
+  if (input_channels == 1) {
+    for (size_t i = 0; i < vector_end; i += 8) {
+      const __m128i samples =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+      const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+      const __m128i high =
+          _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+      const __m128 low_out =
+          _mm_mul_ps(ScaleSse2(low, apply_volume, volume), gain);
+      const __m128 high_out =
+          _mm_mul_ps(ScaleSse2(high, apply_volume, volume), gain);
+      const __m128i mono =
+          _mm_packs_epi32(SaturateSse2(low_out), SaturateSse2(high_out));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), mono);
+      if (levels != nullptr) {
+        vector_levels.Add(mono);
+      }
+    }
+  } else {
+    for (size_t i = 0; i < vector_end; i += 8) {
+      const __m128i first =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i * 2));
+      const __m128i second =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i * 2 + 8));
+      const __m128 first_sum =
+          _mm_add_ps(ScaleSse2(LeftSse2(first), apply_volume, volume),
+                     ScaleSse2(RightSse2(first), apply_volume, volume));
+      const __m128 second_sum =
+          _mm_add_ps(ScaleSse2(LeftSse2(second), apply_volume, volume),
+                     ScaleSse2(RightSse2(second), apply_volume, volume));
+      const __m128 first_out = _mm_mul_ps(_mm_mul_ps(first_sum, half), gain);
+      const __m128 second_out = _mm_mul_ps(_mm_mul_ps(second_sum, half), gain);
+      const __m128i mono =
+          _mm_packs_epi32(SaturateSse2(first_out), SaturateSse2(second_out));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), mono);
+      if (levels != nullptr) {
+        vector_levels.Add(mono);
+      }
+    }
+  }
+
+  MixToMonoScalarRange(input, output, vector_end, frame_count, input_channels,
+                       input_volume, gain_boost, levels);
+  if (levels != nullptr) {
+    vector_levels.MergeInto(levels);
+    levels->sample_count += frame_count;
+  }
+}
+
+AUDIO_KERNELS_TARGET_AVX2
+__m256 ScaleAvx2(__m256i samples, bool apply_volume, __m256 volume) {
+  const __m256 value = _mm256_cvtepi32_ps(samples);
+  if (!apply_volume) {
+    return value;
+  }
+  return _mm256_cvtepi32_ps(_mm256_cvttps_epi32(_mm256_mul_ps(value, volume)));
+}
+
+AUDIO_KERNELS_TARGET_AVX2
+__m256i SaturateAvx2(__m256 value) {
+  return _mm256_cvttps_epi32(
+      _mm256_max_ps(_mm256_set1_ps(kMinSample),
+                    _mm256_min_ps(_mm256_set1_ps(kMaxSample), value)));
+}
+
+// Packs two vectors of eight int32 samples into sixteen int16 samples in
+// order. _mm256_packs_epi32 interleaves the 128-bit lanes of its inputs.
+AUDIO_KERNELS_TARGET_AVX2
+__m256i PackAvx2(__m256i first, __m256i second) {
+  return _mm256_permute4x64_epi64(_mm256_packs_epi32(first, second), 0xD8);
+}
+
+class LevelsAvx2 {
+ public:
+  AUDIO_KERNELS_TARGET_AVX2
+  LevelsAvx2()
+      : sum_(_mm256_setzero_si256()),
+        max_(_mm256_setzero_si256()),
+        min_(_mm256_setzero_si256()) {}
+
+  AUDIO_KERNELS_TARGET_AVX2
+  void Add(__m256i samples) {
+    const __m256i squares = _mm256_madd_epi16(samples, samples);
+    const __m256i zero = _mm256_setzero_si256();
+    sum_ = _mm256_add_epi64(sum_, _mm256_unpacklo_epi32(squares, zero));
+    sum_ = _mm256_add_epi64(sum_, _mm256_unpackhi_epi32(squares, zero));
+    max_ = _mm256_max_epi16(max_, samples);
+    min_ = _mm256_min_epi16(min_, samples);
+  }
+
+  AUDIO_KERNELS_TARGET_AVX2
+  void MergeInto(LevelAccumulator* levels) const {
+    uint64_t sums[4];
+    int16_t maxima[16];
+    int16_t minima[16];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(sums), sum_);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(maxima), max_);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(minima), min_);
+    MergeLevels(sums[0] + sums[1] + sums[2] + sums[3],
+                *std::max_element(maxima, maxima + 16),
+                *std::min_element(minima, minima + 16), levels);
+  }
+
+ private:
+  __m256i sum_;
+  __m256i max_;
+  __m256i min_;
+};
+
+AUDIO_KERNELS_TARGET_AVX2
+void MixToMonoAvx2(const int16_t* input, int16_t* output, size_t frame_count,
+                   int input_channels, float input_volume, float gain_boost,
+                   LevelAccumulator* levels) {
+  if (input_channels > 2) {
+    MixToMonoScalar(input, output, frame_count, input_channels, input_volume,
+                    gain_boost, levels);
+    return;
+  }
+
+  const bool apply_volume = input_volume < 1.0f;
+  const __m256 volume = _mm256_set1_ps(input_volume);
+  const __m256 gain = _mm256_set1_ps(gain_boost);
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const size_t vector_end = frame_count & ~static_cast<size_t>(15);
+  LevelsAvx2 vector_levels;
+
+  if (input_channels == 1) {
+    for (size_t i = 0; i < vector_end; i += 16) {
+      const __m256i low = _mm256_cvtepi16_epi32(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i)));
+      const __m256i high = _mm256_cvtepi16_epi32(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 8)));
+      const __m256 low_out =
+          _mm256_mul_ps(ScaleAvx2(low, apply_volume, volume), gain);
+      const __m256 high_out =
+          _mm256_mul_ps(ScaleAvx2(high, apply_volume, volume), gain);
+      const __m256i mono =
+          PackAvx2(SaturateAvx2(low_out), SaturateAvx2(high_out));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), mono);
+      if (levels != nullptr) {
+        vector_levels.Add(mono);
+      }
+    }
+  } else {
+    for (size_t i = 0; i < vector_end; i += 16) {
+      const __m256i first =
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(input + i * 2));
+      const __m256i second = _mm256_loadu_si256(
+          reinterpret_cast<const __m256i*>(input + i * 2 + 16));
+      const __m256i first_left =
+          _mm256_srai_epi32(_mm256_slli_epi32(first, 16), 16);
+      const __m256i second_left =
+          _mm256_srai_epi32(_mm256_slli_epi32(second, 16), 16);
+      const __m256 first_sum = _mm256_add_ps(
+          ScaleAvx2(first_left, apply_volume, volume),
+          ScaleAvx2(_mm256_srai_epi32(first, 16), apply_volume, volume));
+      const __m256 second_sum = _mm256_add_ps(
+          ScaleAvx2(second_left, apply_volume, volume),
+          ScaleAvx2(_mm256_srai_epi32(second, 16), apply_volume, volume));
+      const __m256 first_out =
+          _mm256_mul_ps(_mm256_mul_ps(first_sum, half), gain);
+      const __m256 second_out =
+          _mm256_mul_ps(_mm256_mul_ps(second_sum, half), gain);
+      const __m256i mono =
+          PackAvx2(SaturateAvx2(first_out), SaturateAvx2(second_out));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(output + i), mono);
+      if (levels != nullptr) {
+        vector_levels.Add(mono);
+      }
+    }
+  }
+
+  MixToMonoScalarRange(input, output, vector_end, frame_count, input_channels,
+                       input_volume, gain_boost, levels);
+  if (levels != nullptr) {
+    vector_levels.MergeInto(levels);
+    levels->sample_count += frame_count;
+  }
+}
+
+float HorizontalSumSse2(__m128 sums) {
+  sums = _mm_add_ps(sums, _mm_movehl_ps(sums, sums));
+  sums = _mm_add_ss(sums, _mm_shuffle_ps(sums, sums, 1));
+  return _mm_cvtss_f32(sums);
+}
+
+// Two accumulators hide the latency of the adds behind each other.
+float DotProductSse2(const float* a, const float* b, size_t count) {
+  __m128 sum0 = _mm_setzero_ps();
+  __m128 sum1 = _mm_setzero_ps();
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    sum0 = _mm_add_ps(sum0,
+                      _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    sum1 = _mm_add_ps(
+        sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+  }
+  if (i + 4 <= count) {
+    sum0 = _mm_add_ps(sum0,
+                      _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    i += 4;
+  }
+  float sum = HorizontalSumSse2(_mm_add_ps(sum0, sum1));
+  for (; i < count; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+AUDIO_KERNELS_TARGET_AVX2
+float DotProductAvx2(const float* a, const float* b, size_t count) {
+  __m256 sum0 = _mm256_setzero_ps();
+  __m256 sum1 = _mm256_setzero_ps();
+  size_t i = 0;
+  for (; i + 16 <= count; i += 16) {
+    sum0 = _mm256_add_ps(
+        sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    sum1 = _mm256_add_ps(sum1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8),
+                                             _mm256_loadu_ps(b + i + 8)));
+  }
+  if (i + 8 <= count) {
+    sum0 = _mm256_add_ps(
+        sum0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    i += 8;
+  }
+  const __m256 sums = _mm256_add_ps(sum0, sum1);
+  float sum = HorizontalSumSse2(_mm_add_ps(_mm256_castps256_ps128(sums),
+                                           _mm256_extractf128_ps(sums, 1)));
+  for (; i < count; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+bool CpuSupportsAvx2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
+  }
+
+  // AVX2 also needs the OS to save the upper halves of the YMM registers.
+  __cpuid(info, 1);
+  const bool osxsave = (info[2] & (1 << 27)) != 0;
+  const bool avx = (info[2] & (1 << 28)) != 0;
+  if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+    return false;
+  }
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif  // AUDIO_KERNELS_X86
+
+#if defined(AUDIO_KERNELS_NEON)
+
+float32x4_t ScaleNeon(int16x4_t samples, bool apply_volume,
+                      float32x4_t volume) {
+  const float32x4_t value = vcvtq_f32_s32(vmovl_s16(samples));
+  if (!apply_volume) {
+    return value;
+  }
+  return vcvtq_f32_s32(vcvtq_s32_f32(vmulq_f32(value, volume)));
+}
+
+int16x4_t SaturateNeon(float32x4_t value) {
+  return vqmovn_s32(vcvtq_s32_f32(vmaxq_f32(
+      vdupq_n_f32(kMinSample), vminq_f32(vdupq_n_f32(kMaxSample), value))));
+}
+
+// Squares of int16 samples fit int32; vpadalq widens pairs of them into the
+// 64-bit accumulator.
+class LevelsNeon {
+ public:
+  LevelsNeon()
+      : sum_(vdupq_n_s64(0)), max_(vdupq_n_s16(0)), min_(vdupq_n_s16(0)) {}
+
+  void Add(int16x8_t samples) {
+    const int16x4_t low = vget_low_s16(samples);
+    const int16x4_t high = vget_high_s16(samples);
+    sum_ = vpadalq_s32(sum_, vmull_s16(low, low));
+    sum_ = vpadalq_s32(sum_, vmull_s16(high, high));
+    max_ = vmaxq_s16(max_, samples);
+    min_ = vminq_s16(min_, samples);
+  }
+
+  void MergeInto(LevelAccumulator* levels) const {
+    MergeLevels(static_cast<uint64_t>(vgetq_lane_s64(sum_, 0) +
+                                      vgetq_lane_s64(sum_, 1)),
+                vmaxvq_s16(max_), vminvq_s16(min_), levels);
+  }
+
+ private:
+  int64x2_t sum_;
+  int16x8_t max_;
+  int16x8_t min_;
+};
+
+void MixToMonoNeon(const int16_t* input, int16_t* output, size_t frame_count,
+                   int input_channels, float input_volume, float gain_boost,
+                   LevelAccumulator* levels) {
+  if (input_channels > 2) {
+    MixToMonoScalar(input, output, frame_count, input_channels, input_volume,
+                    gain_boost, levels);
+    return;
+  }
+
+  const bool apply_volume = input_volume < 1.0f;
+  const float32x4_t volume = vdupq_n_f32(input_volume);
+  const float32x4_t gain = vdupq_n_f32(gain_boost);
+  const float32x4_t half = vdupq_n_f32(0.5f);
+  const size_t vector_end = frame_count & ~static_cast<size_t>(7);
+  LevelsNeon vector_levels;
+
+  if (input_channels == 1) {
+    for (size_t i = 0; i < vector_end; i += 8) {
+      const int16x8_t samples = vld1q_s16(input + i);
+      const float32x4_t low_out = vmulq_f32(
+          ScaleNeon(vget_low_s16(samples), apply_volume, volume), gain);
+      const float32x4_t high_out = vmulq_f32(
+          ScaleNeon(vget_high_s16(samples), apply_volume, volume), gain);
+      const int16x8_t mono =
+          vcombine_s16(SaturateNeon(low_out), SaturateNeon(high_out));
+      vst1q_s16(output + i, mono);
+      if (levels != nullptr) {
+        vector_levels.Add(mono);
+      }
+    }
+  } else {
+    for (size_t i = 0; i < vector_end; i += 8) {
+      // vld2q deinterleaves eight stereo frames into left and right.
+      const int16x8x2_t frames = vld2q_s16(input + i * 2);
+      const float32x4_t low_sum = vaddq_f32(
+          ScaleNeon(vget_low_s16(frames.val[0]), apply_volume, volume),
+          ScaleNeon(vget_low_s16(frames.val[1]), apply_volume, volume));
+      const float32x4_t high_sum = vaddq_f32(
+          ScaleNeon(vget_high_s16(frames.val[0]), apply_volume, volume),
+          ScaleNeon(vget_high_s16(frames.val[1]), apply_volume, volume));
+      const float32x4_t low_out = vmulq_f32(vmulq_f32(low_sum, half), gain);
+      const float32x4_t high_out = vmulq_f32(vmulq_f32(high_sum, half), gain);
+      const int16x8_t mono =
+          vcombine_s16(SaturateNeon(low_out), SaturateNeon(high_out));
+      vst1q_s16(output + i, mono);
+      if (levels != nullptr) {
+        vector_levels.Add(mono);
+      }
+    }
+  }
+
+  MixToMonoScalarRange(input, output, vector_end, frame_count, input_channels,
+                       input_volume, gain_boost, levels);
+  if (levels != nullptr) {
+    vector_levels.MergeInto(levels);
+    levels->sample_count += frame_count;
+  }
+}
+
+float DotProductNeon(const float* a, const float* b, size_t count) {
+  float32x4_t sum0 = vdupq_n_f32(0.0f);
+  float32x4_t sum1 = vdupq_n_f32(0.0f);
+  size_t i = 0;
+  for (; i + 8 <= count; i += 8) {
+    sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+    sum1 = vmlaq_f32(sum1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+  }
+  if (i + 4 <= count) {
+    sum0 = vmlaq_f32(sum0, vld1q_f32(a + i), vld1q_f32(b + i));
+    i += 4;
+  }
+  float sum = vaddvq_f32(vaddq_f32(sum0, sum1));
+  for (; i < count; ++i) {
+    sum += a[i] * b[i];
+  }
+  return sum;
+}
+
+#endif  // AUDIO_KERNELS_NEON
+
+struct KernelSelection {
+  KernelIsa isa;
+  MixToMonoFunction mix_to_mono;
+  DotProductFunction dot_product;
+};
+
+KernelSelection SelectKernels() {
+  const KernelIsa preference[] = {KernelIsa::kAvx2, KernelIsa::kNeon,
+                                  KernelIsa::kSse2};
+  for (KernelIsa isa : preference) {
+    MixToMonoFunction kernel = GetMixToMonoKernel(isa);
+    if (kernel != nullptr) {
+      return {isa, kernel, GetDotProductKernel(isa)};
+    }
+  }
+  return {KernelIsa::kScalar, MixToMonoScalar, DotProductScalar};
+}
+
+const KernelSelection& ActiveKernels() {
+  static const KernelSelection selection = SelectKernels();
+  return selection;
+}
+
+}  // namespace
+
+void MixToMono(const int16_t* input, int16_t* output, size_t frame_count,
+               int input_channels, float input_volume, float gain_boost,
+               LevelAccumulator* levels) {
+  ActiveKernels().mix_to_mono(input, output, frame_count, input_channels,
+                              input_volume, gain_boost, levels);
+}
+
+float DotProduct(const float* a, const float* b, size_t count) {
+  return ActiveKernels().dot_product(a, b, count);
+}
+
+// The float conversions are plain loops the compiler vectorizes for the
+// baseline instruction set; unlike the int16 mix they have no bit-exactness
+// contract with another implementation to keep.
+void MixToMonoFloat(const float* input, float* output, size_t frame_count,
+                    int input_channels, float input_volume, float gain_boost,
+                    LevelAccumulator* levels) {
+  const float scale = std::min(input_volume, 1.0f) * gain_boost;
+  if (input_channels == 1) {
+    for (size_t i = 0; i < frame_count; ++i) {
+      output[i] = input[i] * scale;
+    }
+  } else {
+    const size_t stride = static_cast<size_t>(input_channels);
+    const float half_scale = scale / 2.0f;
+    for (size_t i = 0; i < frame_count; ++i) {
+      output[i] = (input[i * stride] + input[i * stride + 1]) * half_scale;
+    }
+  }
+
+  if (levels != nullptr) {
+    MeterFloat(output, frame_count, levels);
+  }
+}
+
+void MeterFloat(const float* samples, size_t count, LevelAccumulator* levels) {
+  uint64_t sum_of_squares = 0;
+  int32_t peak = levels->peak;
+  for (size_t i = 0; i < count; ++i) {
+    const int32_t sample = static_cast<int32_t>(
+        std::max(kMinSample, std::min(kMaxSample, samples[i] * kInt16Scale)));
+    sum_of_squares += static_cast<uint64_t>(sample * sample);
+    peak = std::max(peak, sample < 0 ? -sample : sample);
+  }
+  levels->sum_of_squares += sum_of_squares;
+  levels->sample_count += count;
+  levels->peak = peak;
+}
+
+void DeinterleaveFloat(const float* input, size_t frame_count, int channels,
+                       const float* gains, float* const* planes) {
+  size_t begin = 0;
+#if defined(AUDIO_KERNELS_X86)
+  if (channels == 2) {
+    const __m128 left_gain = _mm_set1_ps(gains[0]);
+    const __m128 right_gain = _mm_set1_ps(gains[1]);
+    for (; begin + 4 <= frame_count; begin += 4) {
+      const __m128 first = _mm_loadu_ps(input + begin * 2);
+      const __m128 second = _mm_loadu_ps(input + begin * 2 + 4);
+      const __m128 left =
+          _mm_shuffle_ps(first, second, _MM_SHUFFLE(2, 0, 2, 0));
+      const __m128 right =
+          _mm_shuffle_ps(first, second, _MM_SHUFFLE(3, 1, 3, 1));
+      _mm_storeu_ps(planes[0] + begin, _mm_mul_ps(left, left_gain));
+      _mm_storeu_ps(planes[1] + begin, _mm_mul_ps(right, right_gain));
+    }
+  } else if (channels == 4) {
+    __m128 gain[4];
+    for (int channel = 0; channel < 4; ++channel) {
+      gain[channel] = _mm_set1_ps(gains[channel]);
+    }
+    for (; begin + 4 <= frame_count; begin += 4) {
+      // Four frames of four channels transpose into four channel vectors.
+      __m128 row0 = _mm_loadu_ps(input + begin * 4);
+      __m128 row1 = _mm_loadu_ps(input + begin * 4 + 4);
+      __m128 row2 = _mm_loadu_ps(input + begin * 4 + 8);
+      __m128 row3 = _mm_loadu_ps(input + begin * 4 + 12);
+      _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+      _mm_storeu_ps(planes[0] + begin, _mm_mul_ps(row0, gain[0]));
+      _mm_storeu_ps(planes[1] + begin, _mm_mul_ps(row1, gain[1]));
+      _mm_storeu_ps(planes[2] + begin, _mm_mul_ps(row2, gain[2]));
+      _mm_storeu_ps(planes[3] + begin, _mm_mul_ps(row3, gain[3]));
+    }
+  }
+#elif defined(AUDIO_KERNELS_NEON)
+  if (channels == 2) {
+    for (; begin + 4 <= frame_count; begin += 4) {
+      const float32x4x2_t frames = vld2q_f32(input + begin * 2);
+      vst1q_f32(planes[0] + begin, vmulq_n_f32(frames.val[0], gains[0]));
+      vst1q_f32(planes[1] + begin, vmulq_n_f32(frames.val[1], gains[1]));
+    }
+  } else if (channels == 4) {
+    for (; begin + 4 <= frame_count; begin += 4) {
+      const float32x4x4_t frames = vld4q_f32(input + begin * 4);
+      for (int channel = 0; channel < 4; ++channel) {
+        vst1q_f32(planes[channel] + begin,
+                  vmulq_n_f32(frames.val[channel], gains[channel]));
+      }
+    }
+  }
+#endif
+  const size_t stride = static_cast<size_t>(channels);
+  for (int channel = 0; channel < channels; ++channel) {
+    float* plane = planes[channel];
+    const float gain = gains[channel];
+    for (size_t i = begin; i < frame_count; ++i) {
+      plane[i] = input[i * stride + channel] * gain;
+    }
+  }
+}
+
+void InterleaveFloat(const float* const* planes, size_t frame_count,
+                     int channels, float* output) {
+  size_t begin = 0;
+#if defined(AUDIO_KERNELS_X86)
+  if (channels == 2) {
+    for (; begin + 4 <= frame_count; begin += 4) {
+      const __m128 left = _mm_loadu_ps(planes[0] + begin);
+      const __m128 right = _mm_loadu_ps(planes[1] + begin);
+      _mm_storeu_ps(output + begin * 2, _mm_unpacklo_ps(left, right));
+      _mm_storeu_ps(output + begin * 2 + 4, _mm_unpackhi_ps(left, right));
+    }
+  } else if (channels == 4) {
+    for (; begin + 4 <= frame_count; begin += 4) {
+      __m128 row0 = _mm_loadu_ps(planes[0] + begin);
+      __m128 row1 = _mm_loadu_ps(planes[1] + begin);
+      __m128 row2 = _mm_loadu_ps(planes[2] + begin);
+      __m128 row3 = _mm_loadu_ps(planes[3] + begin);
+      _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+      _mm_storeu_ps(output + begin * 4, row0);
+      _mm_storeu_ps(output + begin * 4 + 4, row1);
+      _mm_storeu_ps(output + begin * 4 + 8, row2);
+      _mm_storeu_ps(output + begin * 4 + 12, row3);
+    }
+  }
+#elif defined(AUDIO_KERNELS_NEON)
+  if (channels == 2) {
+    for (; begin + 4 <= frame_count; begin += 4) {
+      float32x4x2_t frames;
+      frames.val[0] = vld1q_f32(planes[0] + begin);
+      frames.val[1] = vld1q_f32(planes[1] + begin);
+      vst2q_f32(output + begin * 2, frames);
+    }
+  } else if (channels == 4) {
+    for (; begin + 4 <= frame_count; begin += 4) {
+      float32x4x4_t frames;
+      for (int channel = 0; channel < 4; ++channel) {
+        frames.val[channel] = vld1q_f32(planes[channel] + begin);
+      }
+      vst4q_f32(output + begin * 4, frames);
+    }
+  }
+#endif
+  const size_t stride = static_cast<size_t>(channels);
+  for (int channel = 0; channel < channels; ++channel) {
+    const float* plane = planes[channel];
+    for (size_t i = begin; i < frame_count; ++i) {
+      output[i * stride + channel] = plane[i];
+    }
+  }
+}
+
+void Int16ToFloat(const int16_t* input, float* output, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    output[i] = static_cast<float>(input[i]) / kInt16Scale;
+  }
+}
+
+void FloatToInt16(const float* input, int16_t* output, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    output[i] = Saturate(input[i] * kInt16Scale);
+  }
+}
+
+void FloatToInt32(const float* input, int32_t* output, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    // INT32_MAX is not representable as a float; anything at or above 2^31
+    // saturates to it.
+    const float sample = input[i] * kInt32Scale;
+    output[i] = sample >= kInt32Scale
+                    ? INT32_MAX
+                    : static_cast<int32_t>(std::max(-kInt32Scale, sample));
+  }
+}
+
+MixToMonoFunction GetMixToMonoKernel(KernelIsa isa) {
+  switch (isa) {
+    case KernelIsa::kScalar:
+      return MixToMonoScalar;
+#if defined(AUDIO_KERNELS_X86)
+    case KernelIsa::kSse2:
+      return MixToMonoSse2;
+    case KernelIsa::kAvx2:
+      return CpuSupportsAvx2() ? MixToMonoAvx2 : nullptr;
+#endif
+#if defined(AUDIO_KERNELS_NEON)
+    case KernelIsa::kNeon:
+      return MixToMonoNeon;
+#endif
+    default:
+      return nullptr;
+  }
+}
+
+DotProductFunction GetDotProductKernel(KernelIsa isa) {
+  switch (isa) {
+    case KernelIsa::kScalar:
+      return DotProductScalar;
+#if defined(AUDIO_KERNELS_X86)
+    case KernelIsa::kSse2:
+      return DotProductSse2;
+    case KernelIsa::kAvx2:
+      return CpuSupportsAvx2() ? DotProductAvx2 : nullptr;
+#endif
+#if defined(AUDIO_KERNELS_NEON)
+    case KernelIsa::kNeon:
+      return DotProductNeon;
+#endif
+    default:
+      return nullptr;
+  }
+}
+
+KernelIsa ActiveKernelIsa() {
+  return ActiveKernels().isa;
+}
+
+const char* KernelIsaName(KernelIsa isa) {
+  switch (isa) {
+    case KernelIsa::kScalar:
+      return "scalar";
+    case KernelIsa::kSse2:
+      return "sse2";
+    case KernelIsa::kAvx2:
+      return "avx2";
+    case KernelIsa::kNeon:
+      return "neon";
+  }
+  return "unknown";
+}
+
+}  // namespace audio_capture
@@ -0,0 +1,97 @@
+#ifndef FLUTTER_PLUGIN_AUDIO_KERNELS_H_
+#define FLUTTER_PLUGIN_AUDIO_KERNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace audio_capture {
+
+// Instruction sets the sample kernels are implemented for.
+enum class KernelIsa { kScalar, kSse2, kAvx2, kNeon };
+
+// Running sum of squares and peak magnitude of kernel output samples. Integer
+// accumulation keeps the result exact and identical across instruction sets.
+struct LevelAccumulator {
+  uint64_t sum_of_squares;
+  uint64_t sample_count;
+  int32_t peak;
+};
+
+// Applies input volume and gain boost to |frame_count| interleaved int16
+// frames, downmixes them to mono and saturates the result into |output|, in a
+// single pass.
+//
+// Mono input is scaled as is. Multichannel input is downmixed from its first
+// two channels. When |input_volume| is below 1 each sample is attenuated and
+// truncated back to int16 before the gain boost is applied, which keeps the
+// output identical to the original per-sample loops.
+//
+// When |levels| is not null the output samples are also metered into it as
+// they are produced, so levels need no second pass over the chunk.
+using MixToMonoFunction = void (*)(const int16_t* input, int16_t* output,
+                                   size_t frame_count, int input_channels,
+                                   float input_volume, float gain_boost,
+                                   LevelAccumulator* levels);
+
+// Dispatches to the fastest implementation supported by the running CPU.
+void MixToMono(const int16_t* input, int16_t* output, size_t frame_count,
+               int input_channels, float input_volume, float gain_boost,
+               LevelAccumulator* levels = nullptr);
+
+// Returns the sum of the |count| products of |a| and |b|: the inner loop of
+// the resampler's filter. Implementations only differ in the order they add
+// the products in, so results agree to float rounding rather than bit for bit.
+using DotProductFunction = float (*)(const float* a, const float* b,
+                                     size_t count);
+
+// Dispatches to the fastest implementation supported by the running CPU.
+float DotProduct(const float* a, const float* b, size_t count);
+
+// Float counterpart of MixToMono() for samples normalized to [-1, 1]. Volume
+// and gain boost are applied as one scale and nothing is clamped, so samples
+// the gain boost pushes past full scale keep their headroom until the output
+// format is chosen. |levels| are metered on the same int16 scale MixToMono()
+// meters on, with samples capped at full scale.
+void MixToMonoFloat(const float* input, float* output, size_t frame_count,
+                    int input_channels, float input_volume, float gain_boost,
+                    LevelAccumulator* levels = nullptr);
+
+// Meters |count| normalized float samples into |levels| on the int16 scale,
+// as MixToMonoFloat() does.
+void MeterFloat(const float* samples, size_t count, LevelAccumulator* levels);
+
+// Splits |frame_count| interleaved float frames of |channels| channels into
+// one plane per channel, scaling each channel by its entry in |gains|.
+// Two- and four-channel audio is shuffled with SSE2 or NEON where available;
+// the result is identical to the scalar loop either way.
+void DeinterleaveFloat(const float* input, size_t frame_count, int channels,
+                       const float* gains, float* const* planes);
+
+// Interleaves |frame_count| frames from one plane per channel into |output|.
+void InterleaveFloat(const float* const* planes, size_t frame_count,
+                     int channels, float* output);
+
+// Converts |count| int16 samples to floats normalized to [-1, 1).
+void Int16ToFloat(const int16_t* input, float* output, size_t count);
+
+// Convert |count| normalized floats to integer samples, truncating and
+// saturating at full scale.
+void FloatToInt16(const float* input, int16_t* output, size_t count);
+void FloatToInt32(const float* input, int32_t* output, size_t count);
+
+// Returns the implementation for |isa|, or nullptr when it was not compiled in
+// or the running CPU lacks it. Every implementation produces bit-identical
+// output to the kScalar one.
+MixToMonoFunction GetMixToMonoKernel(KernelIsa isa);
+
+// Same for DotProduct(), whose implementations are not bit-identical.
+DotProductFunction GetDotProductKernel(KernelIsa isa);
+
+// The instruction set MixToMono() and DotProduct() dispatch to.
+KernelIsa ActiveKernelIsa();
+
+const char* KernelIsaName(KernelIsa isa);
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_AUDIO_KERNELS_H_
@@ -0,0 +1,85 @@
+#include "buffer_pool.h"
+
+#include <cstdlib>
+
+namespace audio_capture {
+
+namespace {
+
+size_t RoundUp(size_t value, size_t multiple) {
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+}  // namespace
+
+constexpr size_t BufferPool::kAlignment;
+
+// static
+BufferPool* BufferPool::Create(size_t buffer_count, size_t buffer_bytes) {
+  BufferPool* pool = new BufferPool(buffer_count, buffer_bytes);
+  if (pool->allocation_ == nullptr) {
+    delete pool;
+    return nullptr;
+  }
+  return pool;
+}
+
+BufferPool::BufferPool(size_t buffer_count, size_t buffer_bytes)
+    : buffer_count_(buffer_count),
+      buffer_bytes_(buffer_bytes),
+      stride_(kAlignment + RoundUp(buffer_bytes, kAlignment)),
+      allocation_(std::malloc(buffer_count * stride_ + kAlignment)) {
+  if (allocation_ == nullptr) {
+    return;
+  }
+
+  // Each buffer is preceded by a header holding the owning pool, so a bare
+  // buffer pointer is enough to return it.
+  const uintptr_t base = RoundUp(reinterpret_cast<uintptr_t>(allocation_),
+                                 kAlignment);
+  free_list_.reserve(buffer_count);
+  for (size_t i = 0; i < buffer_count; ++i) {
+    uint8_t* header = reinterpret_cast<uint8_t*>(base + i * stride_);
+    *reinterpret_cast<BufferPool**>(header) = this;
+    free_list_.push_back(header + kAlignment);
+  }
+}
+
+BufferPool::~BufferPool() {
+  std::free(allocation_);
+}
+
+uint8_t* BufferPool::Acquire() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (free_list_.empty()) {
+    exhausted_count_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  uint8_t* buffer = free_list_.back();
+  free_list_.pop_back();
+  ref_count_.fetch_add(1, std::memory_order_relaxed);
+  return buffer;
+}
+
+// static
+void BufferPool::ReleaseBuffer(void* buffer) {
+  uint8_t* data = static_cast<uint8_t*>(buffer);
+  BufferPool* pool = *reinterpret_cast<BufferPool**>(data - kAlignment);
+  pool->Release(data);
+}
+
+void BufferPool::Release(uint8_t* buffer) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_list_.push_back(buffer);
+  }
+  Unref();
+}
+
+void BufferPool::Unref() {
+  if (ref_count_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    delete this;
+  }
+}
+
+}  // namespace audio_capture
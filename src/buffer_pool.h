@@ -0,0 +1,67 @@
+#ifndef FLUTTER_PLUGIN_BUFFER_POOL_H_
+#define FLUTTER_PLUGIN_BUFFER_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace audio_capture {
+
+// Fixed set of cache-line aligned chunk buffers carved out of one allocation.
+//
+// Buffers are acquired by the capture thread and may be released from any
+// thread, which makes them suitable as the backing store of GBytes created
+// with g_bytes_new_with_free_func(..., BufferPool::ReleaseBuffer, buffer).
+// The pool is reference counted: the owner drops its reference with Unref()
+// and the memory is freed once every outstanding buffer has come back.
+class BufferPool {
+ public:
+  static constexpr size_t kAlignment = 64;
+
+  static BufferPool* Create(size_t buffer_count, size_t buffer_bytes);
+
+  BufferPool(const BufferPool&) = delete;
+  BufferPool& operator=(const BufferPool&) = delete;
+
+  // Returns nullptr when every buffer is in use. Each such miss is counted in
+  // exhausted_count() so callers can surface it.
+  uint8_t* Acquire();
+
+  // Returns |buffer| to the pool it was acquired from. Has the signature of a
+  // GDestroyNotify so it can be handed to GLib directly.
+  static void ReleaseBuffer(void* buffer);
+
+  // Drops the owner's reference.
+  void Unref();
+
+  size_t buffer_bytes() const { return buffer_bytes_; }
+  size_t buffer_count() const { return buffer_count_; }
+  uint64_t exhausted_count() const {
+    return exhausted_count_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  BufferPool(size_t buffer_count, size_t buffer_bytes);
+  ~BufferPool();
+
+  void Release(uint8_t* buffer);
+
+  const size_t buffer_count_;
+  const size_t buffer_bytes_;
+  // Distance between two consecutive buffers, including the header that
+  // points back at the pool.
+  const size_t stride_;
+
+  void* allocation_;
+  std::mutex mutex_;
+  std::vector<uint8_t*> free_list_;
+
+  std::atomic<size_t> ref_count_{1};
+  std::atomic<uint64_t> exhausted_count_{0};
+};
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_BUFFER_POOL_H_
@@ -0,0 +1,82 @@
+#include "chunk_assembler.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace audio_capture {
+
+namespace {
+
+constexpr uint64_t kMillisecondsPerSecond = 1000;
+
+}  // namespace
+
+ChunkAssembler::ChunkAssembler(size_t frame_bytes, int sample_rate,
+                               int chunk_ms)
+    : frame_bytes_(std::max<size_t>(frame_bytes, 1)),
+      // At least a frame per chunk.
+      chunk_numerator_(std::max(
+          static_cast<uint64_t>(std::max(sample_rate, 1)) *
+              static_cast<uint64_t>(std::max(chunk_ms, 1)),
+          kMillisecondsPerSecond)),
+      max_chunk_frames_(static_cast<size_t>(
+          (chunk_numerator_ + kMillisecondsPerSecond - 1) /
+          kMillisecondsPerSecond)),
+      capacity_(2 * max_chunk_frames_ * frame_bytes_),
+      storage_(capacity_ + max_chunk_frames_ * frame_bytes_) {}
+
+size_t ChunkAssembler::Write(const uint8_t* data, size_t size) {
+  size = std::min(size, capacity_ - buffered_bytes_);
+  const size_t write_offset = (read_offset_ + buffered_bytes_) % capacity_;
+  const size_t first = std::min(size, capacity_ - write_offset);
+  Copy(write_offset, data, first);
+  Copy(0, data + first, size - first);
+  buffered_bytes_ += size;
+  return size;
+}
+
+const uint8_t* ChunkAssembler::PeekChunk(size_t* frame_count) const {
+  const size_t frames = NextChunkFrames();
+  if (buffered_bytes_ < frames * frame_bytes_) {
+    return nullptr;
+  }
+  *frame_count = frames;
+  return storage_.data() + read_offset_;
+}
+
+void ChunkAssembler::ConsumeChunk() {
+  const size_t frames = NextChunkFrames();
+  const size_t bytes = std::min(frames * frame_bytes_, buffered_bytes_);
+  read_offset_ = (read_offset_ + bytes) % capacity_;
+  buffered_bytes_ -= bytes;
+  remainder_ = (remainder_ + chunk_numerator_) % kMillisecondsPerSecond;
+  consumed_frames_ += frames;
+}
+
+void ChunkAssembler::Reset() {
+  read_offset_ = 0;
+  buffered_bytes_ = 0;
+  remainder_ = 0;
+  consumed_frames_ = 0;
+}
+
+// Writes |size| bytes at |offset| of the ring, which they must not run past,
+// and whatever part of them lands in the mirrored start again after the end.
+void ChunkAssembler::Copy(size_t offset, const uint8_t* data, size_t size) {
+  if (size == 0) {
+    return;
+  }
+  std::memcpy(storage_.data() + offset, data, size);
+  const size_t mirror_bytes = storage_.size() - capacity_;
+  if (offset < mirror_bytes) {
+    std::memcpy(storage_.data() + capacity_ + offset, data,
+                std::min(size, mirror_bytes - offset));
+  }
+}
+
+size_t ChunkAssembler::NextChunkFrames() const {
+  return static_cast<size_t>((remainder_ + chunk_numerator_) /
+                             kMillisecondsPerSecond);
+}
+
+}  // namespace audio_capture
@@ -0,0 +1,77 @@
+#ifndef FLUTTER_PLUGIN_CHUNK_ASSEMBLER_H_
+#define FLUTTER_PLUGIN_CHUNK_ASSEMBLER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace audio_capture {
+
+// Collects device packets of any size, down to fragments of a frame, into
+// fixed-duration chunks of whole frames, without ever moving buffered data.
+//
+// The ring is followed by a mirror of its first max_chunk_bytes() bytes,
+// kept up to date as they are written, so a chunk that wraps around the end
+// can still be read in one piece straight from the ring.
+//
+// Chunk durations rarely come out to a whole number of frames (30 ms at
+// 22050 Hz is 661.5 frames). The remainder is carried from one chunk to the
+// next, so chunks alternate between the two nearest sizes and their average
+// duration is exact rather than drifting.
+//
+// Not thread-safe: packets are written and chunks read on the capture thread.
+class ChunkAssembler {
+ public:
+  ChunkAssembler(size_t frame_bytes, int sample_rate, int chunk_ms);
+
+  ChunkAssembler(const ChunkAssembler&) = delete;
+  ChunkAssembler& operator=(const ChunkAssembler&) = delete;
+
+  size_t frame_bytes() const { return frame_bytes_; }
+  // Frames in the largest chunk, which buffers handed chunks must fit.
+  size_t max_chunk_frames() const { return max_chunk_frames_; }
+  size_t max_chunk_bytes() const { return max_chunk_frames_ * frame_bytes_; }
+  size_t buffered_bytes() const { return buffered_bytes_; }
+
+  // Copies as much of |size| bytes of |data| as there is room for and returns
+  // how many that was. The ring holds two of the largest chunks, so a write
+  // only falls short when more than a chunk is left unread.
+  size_t Write(const uint8_t* data, size_t size);
+
+  // Returns the next chunk, contiguous, or nullptr until enough frames are
+  // buffered. |frame_count| receives its length. Writes never touch unread
+  // bytes, so the view stays valid until ConsumeChunk().
+  const uint8_t* PeekChunk(size_t* frame_count) const;
+
+  // Drops the chunk PeekChunk() returned.
+  void ConsumeChunk();
+
+  // Frames in the chunks consumed since the last Reset(). Divided by the
+  // sample rate it is the exact start time of the next chunk.
+  uint64_t consumed_frames() const { return consumed_frames_; }
+
+  // Forgets buffered data and restarts the chunk size sequence.
+  void Reset();
+
+ private:
+  void Copy(size_t offset, const uint8_t* data, size_t size);
+  size_t NextChunkFrames() const;
+
+  const size_t frame_bytes_;
+  // Each chunk adds |chunk_numerator_| / 1000 frames to the running total.
+  const uint64_t chunk_numerator_;
+  const size_t max_chunk_frames_;
+  const size_t capacity_;
+
+  // |capacity_| bytes of ring followed by the mirror of its start.
+  std::vector<uint8_t> storage_;
+  size_t read_offset_ = 0;
+  size_t buffered_bytes_ = 0;
+  // Thousandths of a frame carried over from the chunks consumed so far.
+  uint64_t remainder_ = 0;
+  uint64_t consumed_frames_ = 0;
+};
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_CHUNK_ASSEMBLER_H_
@@ -0,0 +1,112 @@
+#include "latency_histogram.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace audio_capture {
+
+namespace {
+
+// Index of the highest set bit of a non-zero |value|.
+int HighestBit(uint64_t value) {
+#if defined(_MSC_VER)
+  unsigned long index = 0;
+  _BitScanReverse64(&index, value);
+  return static_cast<int>(index);
+#else
+  return 63 - __builtin_clzll(value);
+#endif
+}
+
+}  // namespace
+
+constexpr int LatencyHistogram::kSubBucketBits;
+constexpr int LatencyHistogram::kSubBuckets;
+constexpr int LatencyHistogram::kMaxBits;
+constexpr size_t LatencyHistogram::kBucketCount;
+
+LatencyHistogram::LatencyHistogram() {
+  Reset();
+}
+
+void LatencyHistogram::Record(int64_t duration_us) {
+  const int64_t value = std::max<int64_t>(duration_us, 0);
+  ++buckets_[BucketIndex(static_cast<uint64_t>(value))];
+  ++count_;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+  sum_ += value;
+}
+
+void LatencyHistogram::Reset() {
+  std::fill(buckets_, buckets_ + kBucketCount, 0u);
+  count_ = 0;
+  min_ = std::numeric_limits<int64_t>::max();
+  max_ = 0;
+  sum_ = 0;
+}
+
+double LatencyHistogram::mean() const {
+  if (count_ == 0) {
+    return 0.0;
+  }
+  return static_cast<double>(sum_) / static_cast<double>(count_);
+}
+
+int64_t LatencyHistogram::Percentile(double percentile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+
+  const double clamped = std::max(0.0, std::min(100.0, percentile));
+  const uint64_t rank = std::max<uint64_t>(
+      static_cast<uint64_t>(std::ceil(clamped / 100.0 * count_)), 1);
+
+  uint64_t seen = 0;
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    seen += buckets_[i];
+    if (seen >= rank) {
+      if (i == kBucketCount - 1) {
+        return max_;
+      }
+      const int64_t bound = static_cast<int64_t>(BucketUpperBound(i));
+      return std::max(min_, std::min(max_, bound));
+    }
+  }
+  return max_;
+}
+
+// static
+size_t LatencyHistogram::BucketIndex(uint64_t value) {
+  if (value < static_cast<uint64_t>(kSubBuckets)) {
+    return static_cast<size_t>(value);
+  }
+
+  const int msb = HighestBit(value);
+  if (msb >= kMaxBits) {
+    return kBucketCount - 1;
+  }
+
+  const int shift = msb - kSubBucketBits;
+  const size_t sub = static_cast<size_t>(value >> shift) & (kSubBuckets - 1);
+  return static_cast<size_t>(shift + 1) * kSubBuckets + sub;
+}
+
+// static
+uint64_t LatencyHistogram::BucketUpperBound(size_t index) {
+  if (index < static_cast<size_t>(kSubBuckets)) {
+    return index;
+  }
+
+  const int shift = static_cast<int>(index / kSubBuckets) - 1;
+  const uint64_t sub = index % kSubBuckets;
+  const uint64_t lower = (kSubBuckets + sub) << shift;
+  return lower + (uint64_t{1} << shift) - 1;
+}
+
+}  // namespace audio_capture
@@ -0,0 +1,53 @@
+#ifndef FLUTTER_PLUGIN_LATENCY_HISTOGRAM_H_
+#define FLUTTER_PLUGIN_LATENCY_HISTOGRAM_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace audio_capture {
+
+// Fixed-size log-linear histogram of durations in microseconds.
+//
+// Every power of two is split into kSubBuckets linear buckets, so percentiles
+// are within 1/kSubBuckets of the true value while recording stays a handful
+// of integer operations with no allocation. Not thread-safe; each histogram is
+// written by a single thread.
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 3;
+  static constexpr int kSubBuckets = 1 << kSubBucketBits;
+  // Durations up to 2^kMaxBits us (about 12 days) are bucketed; longer ones
+  // land in the last bucket.
+  static constexpr int kMaxBits = 40;
+  static constexpr size_t kBucketCount =
+      (kMaxBits - kSubBucketBits + 1) * kSubBuckets;
+
+  LatencyHistogram();
+
+  // Negative durations, e.g. from clock adjustments, count as zero.
+  void Record(int64_t duration_us);
+  void Reset();
+
+  uint64_t count() const { return count_; }
+  int64_t min() const { return count_ > 0 ? min_ : 0; }
+  int64_t max() const { return max_; }
+  double mean() const;
+
+  // Upper bound of the bucket holding the |percentile| (0 to 100) sample,
+  // clamped to the recorded range. 0 when empty.
+  int64_t Percentile(double percentile) const;
+
+ private:
+  static size_t BucketIndex(uint64_t value);
+  static uint64_t BucketUpperBound(size_t index);
+
+  uint32_t buckets_[kBucketCount];
+  uint64_t count_;
+  int64_t min_;
+  int64_t max_;
+  int64_t sum_;
+};
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_LATENCY_HISTOGRAM_H_
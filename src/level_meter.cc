@@ -0,0 +1,100 @@
+#include "level_meter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace audio_capture {
+
+namespace {
+
+constexpr double kFullScale = 32767.0;
+constexpr double kMinDecibel = -120.0;
+
+// Per-reading smoothing coefficient of a one-pole filter with time constant
+// |time_ms|, updated every |interval_ms|.
+double SmoothingCoefficient(double time_ms, double interval_ms) {
+  if (time_ms <= 0.0) {
+    return 0.0;
+  }
+  return std::exp(-interval_ms / time_ms);
+}
+
+double Smooth(double current, double target, double attack, double release) {
+  const double coefficient = target > current ? attack : release;
+  return target + coefficient * (current - target);
+}
+
+uint64_t IntervalFrames(int sample_rate, double rate_hz) {
+  const double frames = std::round(sample_rate / rate_hz);
+  return std::max<uint64_t>(static_cast<uint64_t>(frames), 1);
+}
+
+}  // namespace
+
+constexpr double LevelMeter::kDefaultRateHz;
+constexpr double LevelMeter::kDefaultAttackMs;
+constexpr double LevelMeter::kDefaultReleaseMs;
+
+double LevelToDecibel(double level) {
+  if (level <= 0.0) {
+    return kMinDecibel;
+  }
+  return std::max(kMinDecibel, std::min(0.0, 20.0 * std::log10(level)));
+}
+
+LevelReading ReadLevels(const LevelAccumulator& levels) {
+  LevelReading reading{0.0, 0.0, kMinDecibel, kMinDecibel};
+  if (levels.sample_count == 0) {
+    return reading;
+  }
+
+  const double mean_square = static_cast<double>(levels.sum_of_squares) /
+                             static_cast<double>(levels.sample_count);
+  reading.rms = std::min(1.0, std::sqrt(mean_square) / kFullScale);
+  reading.peak = std::min(1.0, levels.peak / kFullScale);
+  reading.decibel = LevelToDecibel(reading.rms);
+  reading.peak_decibel = LevelToDecibel(reading.peak);
+  return reading;
+}
+
+LevelMeter::LevelMeter(int sample_rate, double rate_hz, double attack_ms,
+                       double release_ms)
+    : interval_frames_(IntervalFrames(sample_rate, rate_hz)),
+      attack_coefficient_(SmoothingCoefficient(attack_ms, 1000.0 / rate_hz)),
+      release_coefficient_(SmoothingCoefficient(release_ms, 1000.0 / rate_hz)),
+      levels_{0, 0, 0},
+      rms_(0.0),
+      peak_(0.0) {}
+
+size_t LevelMeter::frames_until_reading() const {
+  if (levels_.sample_count >= interval_frames_) {
+    return 0;
+  }
+  return static_cast<size_t>(interval_frames_ - levels_.sample_count);
+}
+
+bool LevelMeter::TakeReading(LevelReading* reading) {
+  if (levels_.sample_count < interval_frames_) {
+    return false;
+  }
+
+  const LevelReading raw = ReadLevels(levels_);
+  levels_ = LevelAccumulator{0, 0, 0};
+
+  rms_ = Smooth(rms_, raw.rms, attack_coefficient_, release_coefficient_);
+  peak_ = Smooth(peak_, raw.peak, attack_coefficient_, release_coefficient_);
+
+  reading->rms = rms_;
+  reading->peak = peak_;
+  reading->decibel = LevelToDecibel(rms_);
+  reading->peak_decibel = LevelToDecibel(peak_);
+  return true;
+}
+
+void LevelMeter::Reset() {
+  levels_ = LevelAccumulator{0, 0, 0};
+  rms_ = 0.0;
+  peak_ = 0.0;
+}
+
+}  // namespace audio_capture
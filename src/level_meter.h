@@ -0,0 +1,69 @@
+#ifndef FLUTTER_PLUGIN_LEVEL_METER_H_
+#define FLUTTER_PLUGIN_LEVEL_METER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "audio_kernels.h"
+
+namespace audio_capture {
+
+// Signal level relative to int16 full scale.
+struct LevelReading {
+  double rms;           // Linear, 0 to 1.
+  double peak;          // Linear, 0 to 1.
+  double decibel;       // RMS in dBFS, -120 to 0.
+  double peak_decibel;  // Peak in dBFS, -120 to 0.
+};
+
+// Converts a linear level to dBFS, clamped to the -120..0 dB range the
+// decibel streams have always used.
+double LevelToDecibel(double level);
+
+// Unsmoothed reading of everything accumulated in |levels|.
+LevelReading ReadLevels(const LevelAccumulator& levels);
+
+// Turns the levels accumulated by the sample kernels into readings published
+// at a fixed rate, independent of how audio is chunked.
+//
+// Callers feed at most frames_until_reading() frames into levels() per kernel
+// call, then call TakeReading(). Readings are smoothed with attack/release
+// ballistics: rising levels follow the attack time constant, falling levels
+// the release one.
+class LevelMeter {
+ public:
+  static constexpr double kDefaultRateHz = 30.0;
+  static constexpr double kDefaultAttackMs = 10.0;
+  static constexpr double kDefaultReleaseMs = 300.0;
+
+  LevelMeter(int sample_rate, double rate_hz,
+             double attack_ms = kDefaultAttackMs,
+             double release_ms = kDefaultReleaseMs);
+
+  LevelMeter(const LevelMeter&) = delete;
+  LevelMeter& operator=(const LevelMeter&) = delete;
+
+  LevelAccumulator* levels() { return &levels_; }
+
+  size_t frames_until_reading() const;
+
+  // Returns true and fills |reading| when a full metering interval has been
+  // accumulated, then starts the next interval.
+  bool TakeReading(LevelReading* reading);
+
+  // Drops the partial interval and the ballistics state.
+  void Reset();
+
+ private:
+  const uint64_t interval_frames_;
+  const double attack_coefficient_;
+  const double release_coefficient_;
+
+  LevelAccumulator levels_;
+  double rms_;
+  double peak_;
+};
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_LEVEL_METER_H_
@@ -0,0 +1,206 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace audio_capture {
+
+namespace {
+
+struct FilterDesign {
+  // Taps per phase when not decimating. A multiple of 8 so the SIMD dot
+  // product has no scalar tail.
+  int taps;
+  // Kaiser window shape; sets the sidelobe level.
+  double kaiser_beta;
+  // Filter cutoff relative to the lower of the two Nyquist frequencies. Leaves
+  // room for the transition band of a |taps| filter to end before aliasing
+  // starts.
+  double cutoff;
+};
+
+FilterDesign DesignFor(ResamplerQuality quality) {
+  switch (quality) {
+    case ResamplerQuality::kLow:
+      return {16, 6.0, 0.8};
+    case ResamplerQuality::kMedium:
+      break;
+    case ResamplerQuality::kHigh:
+      return {64, 10.0, 0.9};
+  }
+  return {32, 8.0, 0.85};
+}
+
+constexpr double kPi = 3.14159265358979323846;
+
+// Zeroth-order modified Bessel function of the first kind.
+double BesselI0(double x) {
+  double sum = 1.0;
+  double term = 1.0;
+  const double half_x = x / 2.0;
+  for (int k = 1; k < 64; ++k) {
+    term *= half_x / k;
+    const double squared = term * term;
+    sum += squared;
+    if (squared < sum * 1e-12) {
+      break;
+    }
+  }
+  return sum;
+}
+
+uint32_t GreatestCommonDivisor(uint32_t a, uint32_t b) {
+  while (b != 0) {
+    const uint32_t remainder = a % b;
+    a = b;
+    b = remainder;
+  }
+  return a;
+}
+
+int16_t SaturateToInt16(float sample) {
+  const long rounded = std::lrintf(sample);
+  return static_cast<int16_t>(
+      std::max<long>(INT16_MIN, std::min<long>(INT16_MAX, rounded)));
+}
+
+void Store(float sample, int16_t* output) {
+  *output = SaturateToInt16(sample);
+}
+
+void Store(float sample, float* output) { *output = sample; }
+
+}  // namespace
+
+constexpr int Resampler::kMaxTaps;
+constexpr int Resampler::kMaxPhases;
+
+Resampler::Resampler(int input_rate, int output_rate,
+                     ResamplerQuality quality)
+    : input_rate_(std::max(input_rate, 1)),
+      output_rate_(std::max(output_rate, 1)),
+      quality_(quality) {
+  const uint32_t divisor =
+      GreatestCommonDivisor(static_cast<uint32_t>(input_rate_),
+                            static_cast<uint32_t>(output_rate_));
+  period_ = static_cast<uint32_t>(output_rate_) / divisor;
+  step_ = static_cast<uint32_t>(input_rate_) / divisor;
+  step_frames_ = step_ / period_;
+  step_fraction_ = step_ % period_;
+  phases_ = static_cast<int>(std::min<uint32_t>(period_, kMaxPhases));
+
+  // Decimating lowers the cutoff by the rate ratio; the filter is widened by
+  // the same factor so it keeps as many zero crossings.
+  const FilterDesign design = DesignFor(quality_);
+  const double ratio = static_cast<double>(output_rate_) / input_rate_;
+  const double cutoff = design.cutoff * std::min(1.0, ratio);
+  taps_ = design.taps;
+  if (ratio < 1.0) {
+    const int widened = static_cast<int>(std::ceil(design.taps / ratio));
+    taps_ = std::min(kMaxTaps, (widened + 7) & ~7);
+  }
+
+  const int half = taps_ / 2;
+  const double window_norm = BesselI0(design.kaiser_beta);
+  coefficients_.resize(static_cast<size_t>(phases_) * taps_);
+  for (int phase = 0; phase < phases_; ++phase) {
+    float* row = &coefficients_[static_cast<size_t>(phase) * taps_];
+    const double offset = static_cast<double>(phase) / phases_;
+    double sum = 0.0;
+    for (int tap = 0; tap < taps_; ++tap) {
+      // Distance, in input frames, from the output instant to this tap.
+      const double t = (tap - half + 1) - offset;
+      const double x = cutoff * t;
+      const double sinc = x == 0.0 ? 1.0 : std::sin(kPi * x) / (kPi * x);
+      const double position = t / half;
+      const double window =
+          position <= -1.0 || position >= 1.0
+              ? 0.0
+              : BesselI0(design.kaiser_beta *
+                         std::sqrt(1.0 - position * position)) /
+                    window_norm;
+      const double coefficient = cutoff * sinc * window;
+      row[tap] = static_cast<float>(coefficient);
+      sum += coefficient;
+    }
+    // Unity gain at DC for every phase, so a constant input stays constant.
+    for (int tap = 0; tap < taps_; ++tap) {
+      row[tap] = static_cast<float>(row[tap] / sum);
+    }
+  }
+
+  dot_product_ = GetDotProductKernel(ActiveKernelIsa());
+  Reset();
+}
+
+size_t Resampler::MaxOutputFrames(size_t input_frames) const {
+  // At most taps() / 2 frames of earlier input are still waiting to be
+  // interpolated between.
+  const uint64_t pending = input_frames + static_cast<size_t>(taps_ / 2);
+  return static_cast<size_t>(pending * period_ / step_) + 1;
+}
+
+size_t Resampler::Process(const int16_t* input, size_t frame_count,
+                          int16_t* output) {
+  return Filter(input, frame_count, output);
+}
+
+size_t Resampler::Process(const float* input, size_t frame_count,
+                          float* output) {
+  return Filter(input, frame_count, output);
+}
+
+template <typename Sample>
+size_t Resampler::Filter(const Sample* input, size_t frame_count,
+                         Sample* output) {
+  const size_t half = static_cast<size_t>(taps_ / 2);
+  if (history_.size() < history_frames_ + frame_count) {
+    history_.resize(history_frames_ + frame_count);
+  }
+  float* appended = history_.data() + history_frames_;
+  for (size_t i = 0; i < frame_count; ++i) {
+    appended[i] = input[i];
+  }
+  history_frames_ += frame_count;
+
+  size_t produced = 0;
+  while (position_ + half < history_frames_) {
+    const size_t phase =
+        phases_ == static_cast<int>(period_)
+            ? fraction_
+            : static_cast<size_t>(static_cast<uint64_t>(fraction_) *
+                                  phases_ / period_);
+    const float* row = &coefficients_[phase * taps_];
+    const float* samples = &history_[position_ + 1 - half];
+    Store(dot_product_(samples, row, static_cast<size_t>(taps_)),
+          &output[produced++]);
+
+    position_ += step_frames_;
+    fraction_ += step_fraction_;
+    if (fraction_ >= period_) {
+      fraction_ -= period_;
+      ++position_;
+    }
+  }
+
+  // Keep only what the next output frame's filter still reaches back to.
+  const size_t consumed = std::min(position_ + 1 - half, history_frames_);
+  std::memmove(history_.data(), history_.data() + consumed,
+               (history_frames_ - consumed) * sizeof(float));
+  history_frames_ -= consumed;
+  position_ -= consumed;
+  return produced;
+}
+
+void Resampler::Reset() {
+  // The first output frame lines up with the first input frame, preceded by
+  // silence.
+  const size_t half = static_cast<size_t>(taps_ / 2);
+  history_.assign(static_cast<size_t>(taps_), 0.0f);
+  history_frames_ = half - 1;
+  position_ = half - 1;
+  fraction_ = 0;
+}
+
+}  // namespace audio_capture
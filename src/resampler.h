@@ -0,0 +1,97 @@
+#ifndef FLUTTER_PLUGIN_RESAMPLER_H_
+#define FLUTTER_PLUGIN_RESAMPLER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "audio_kernels.h"
+
+namespace audio_capture {
+
+// Filter length, stopband attenuation and passband width, traded against CPU.
+// Stopband figures are for the window alone; passband is the share of the
+// lower Nyquist frequency kept flat.
+//   kLow:    16 taps, about -60 dB, 80 %
+//   kMedium: 32 taps, about -80 dB, 85 %
+//   kHigh:   64 taps, about -100 dB, 90 %
+enum class ResamplerQuality { kLow, kMedium, kHigh };
+
+// Converts mono int16 or float audio from one sample rate to another with a
+// Kaiser-windowed sinc filter evaluated as a polyphase bank.
+//
+// The filter history is kept across calls, so audio can be fed in fragments
+// of any size and the output is the same as for one long call, without
+// discontinuities at fragment boundaries. Output lags the input by half the
+// filter length, about taps() / 2 input frames.
+//
+// Rate pairs with a small common period (every pair of the usual 8 to 192 kHz
+// rates) get an exact phase per output frame; others snap to the nearest of
+// kMaxPhases phases.
+//
+// The taps are summed with the DotProduct() kernel for the running CPU.
+class Resampler {
+ public:
+  // Decimation widens the filter by the rate ratio, up to kMaxTaps taps per
+  // phase, so its cutoff can drop without losing stopband.
+  static constexpr int kMaxTaps = 256;
+  static constexpr int kMaxPhases = 1024;
+
+  Resampler(int input_rate, int output_rate,
+            ResamplerQuality quality = ResamplerQuality::kMedium);
+
+  Resampler(const Resampler&) = delete;
+  Resampler& operator=(const Resampler&) = delete;
+
+  int input_rate() const { return input_rate_; }
+  int output_rate() const { return output_rate_; }
+  ResamplerQuality quality() const { return quality_; }
+  int taps() const { return taps_; }
+
+  // Most frames a Process() call with |input_frames| frames can produce.
+  size_t MaxOutputFrames(size_t input_frames) const;
+
+  // Resamples |frame_count| frames of |input| into |output|, which must have
+  // room for MaxOutputFrames(frame_count) frames. Returns the frames written.
+  // Does not allocate once a call has seen the largest |frame_count| in use.
+  size_t Process(const int16_t* input, size_t frame_count, int16_t* output);
+  // Same for float samples, which are filtered at whatever scale they come in
+  // and never clipped. A Resampler should be fed one sample type only.
+  size_t Process(const float* input, size_t frame_count, float* output);
+
+  // Forgets the filter history, as if no audio had been processed.
+  void Reset();
+
+ private:
+  template <typename Sample>
+  size_t Filter(const Sample* input, size_t frame_count, Sample* output);
+
+  const int input_rate_;
+  const int output_rate_;
+  const ResamplerQuality quality_;
+  // Output frames advance the input position by |step_| / |period_| frames.
+  uint32_t period_ = 1;
+  uint32_t step_ = 1;
+  // |step_| split into whole frames and a remainder, so advancing needs no
+  // division.
+  size_t step_frames_ = 1;
+  uint32_t step_fraction_ = 0;
+  int phases_ = 1;
+  int taps_ = 0;
+  // |phases_| rows of |taps_| coefficients.
+  std::vector<float> coefficients_;
+  // Looked up once rather than dispatched for every output frame.
+  DotProductFunction dot_product_ = nullptr;
+
+  // Input not yet fully consumed, preceded by the history the filter needs.
+  std::vector<float> history_;
+  size_t history_frames_ = 0;
+  // Input frame the next output frame is interpolated after, and how far
+  // past it, in units of 1 / |period_| frames.
+  size_t position_ = 0;
+  uint32_t fraction_ = 0;
+};
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_RESAMPLER_H_
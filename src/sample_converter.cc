@@ -0,0 +1,360 @@
+#include "sample_converter.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SAMPLE_CONVERTER_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define SAMPLE_CONVERTER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace audio_capture {
+
+namespace {
+
+constexpr float kInt16Scale = 32768.0f;
+constexpr float kMaxInt16Sample = 32767.0f;
+constexpr float kMinInt16Sample = -32768.0f;
+constexpr float kLeftJustifiedScale = 1.0f / 2147483648.0f;
+
+// Integer samples of every width are first widened to int32 with their sign
+// bit at bit 31. From there int16 is the top half and float a single scale,
+// whatever the width was.
+uint32_t Word(uint8_t b3, uint8_t b2, uint8_t b1, uint8_t b0) {
+  return static_cast<uint32_t>(b3) << 24 | static_cast<uint32_t>(b2) << 16 |
+         static_cast<uint32_t>(b1) << 8 | b0;
+}
+
+template <PcmEncoding kEncoding>
+int32_t LoadLeftJustified(const uint8_t* p, bool big_endian) {
+  uint32_t word = 0;
+  switch (kEncoding) {
+    case PcmEncoding::kS16:
+      word = big_endian ? Word(p[0], p[1], 0, 0) : Word(p[1], p[0], 0, 0);
+      break;
+    case PcmEncoding::kS24:
+      word = big_endian ? Word(p[0], p[1], p[2], 0) : Word(p[2], p[1], p[0], 0);
+      break;
+    case PcmEncoding::kS24In32:
+      word = big_endian ? Word(p[1], p[2], p[3], 0) : Word(p[2], p[1], p[0], 0);
+      break;
+    case PcmEncoding::kS32:
+      word = big_endian ? Word(p[0], p[1], p[2], p[3])
+                        : Word(p[3], p[2], p[1], p[0]);
+      break;
+    case PcmEncoding::kF32:
+      break;
+  }
+  return static_cast<int32_t>(word);
+}
+
+float LoadFloat(const uint8_t* p, bool big_endian) {
+  const uint32_t word = big_endian ? Word(p[0], p[1], p[2], p[3])
+                                   : Word(p[3], p[2], p[1], p[0]);
+  float sample;
+  std::memcpy(&sample, &word, sizeof(sample));
+  return sample;
+}
+
+void StoreLeftJustified(int32_t sample, int16_t* output) {
+  *output = static_cast<int16_t>(sample >> 16);
+}
+
+void StoreLeftJustified(int32_t sample, float* output) {
+  *output = static_cast<float>(sample) * kLeftJustifiedScale;
+}
+
+// Same arithmetic as FloatToInt16().
+void StoreFloat(float sample, int16_t* output) {
+  const float scaled = sample * kInt16Scale;
+  *output = scaled >= kInt16Scale
+                ? INT16_MAX
+                : static_cast<int16_t>(std::max(kMinInt16Sample, scaled));
+}
+
+void StoreFloat(float sample, float* output) { *output = sample; }
+
+#if defined(SAMPLE_CONVERTER_SSE2)
+
+__m128i ByteSwap16Sse2(__m128i v) {
+  return _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+}
+
+__m128i ByteSwap32Sse2(__m128i v) {
+  v = ByteSwap16Sse2(v);
+  return _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16));
+}
+
+// Bytes LoadLeftJustifiedSse2() reads for four samples, which for packed
+// 24-bit samples runs 4 bytes past them.
+constexpr size_t LoadBytesSse2(PcmEncoding encoding) {
+  return encoding == PcmEncoding::kS16 ? 8 : 16;
+}
+
+// Four samples, left-justified as LoadLeftJustified() does.
+template <PcmEncoding kEncoding>
+__m128i LoadLeftJustifiedSse2(const uint8_t* p, bool big_endian) {
+  switch (kEncoding) {
+    case PcmEncoding::kS16: {
+      __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p));
+      if (big_endian) {
+        v = ByteSwap16Sse2(v);
+      }
+      return _mm_unpacklo_epi16(_mm_setzero_si128(), v);
+    }
+    case PcmEncoding::kS24: {
+      // Gathers bytes 0-3, 3-6, 6-9 and 9-12 into the four lanes; the
+      // byte each lane holds of the next sample is then shifted or masked
+      // out.
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      const __m128i lanes = _mm_unpacklo_epi64(
+          _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3)),
+          _mm_unpacklo_epi32(_mm_srli_si128(v, 6), _mm_srli_si128(v, 9)));
+      if (big_endian) {
+        return _mm_and_si128(ByteSwap32Sse2(lanes),
+                             _mm_set1_epi32(static_cast<int>(0xFFFFFF00u)));
+      }
+      return _mm_slli_epi32(lanes, 8);
+    }
+    case PcmEncoding::kS24In32:
+    case PcmEncoding::kS32: {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      if (big_endian) {
+        v = ByteSwap32Sse2(v);
+      }
+      return kEncoding == PcmEncoding::kS32 ? v : _mm_slli_epi32(v, 8);
+    }
+    case PcmEncoding::kF32:
+      break;
+  }
+  return _mm_setzero_si128();
+}
+
+void StoreLeftJustifiedSse2(__m128i samples, int16_t* output) {
+  _mm_storel_epi64(reinterpret_cast<__m128i*>(output),
+                   _mm_packs_epi32(_mm_srai_epi32(samples, 16),
+                                   _mm_setzero_si128()));
+}
+
+void StoreLeftJustifiedSse2(__m128i samples, float* output) {
+  _mm_storeu_ps(output, _mm_mul_ps(_mm_cvtepi32_ps(samples),
+                                   _mm_set1_ps(kLeftJustifiedScale)));
+}
+
+// Clamped before truncating, since out-of-range floats convert to INT32_MIN.
+void StoreFloatSse2(__m128 samples, int16_t* output) {
+  const __m128 scaled = _mm_mul_ps(samples, _mm_set1_ps(kInt16Scale));
+  const __m128 clamped =
+      _mm_max_ps(_mm_set1_ps(kMinInt16Sample),
+                 _mm_min_ps(_mm_set1_ps(kMaxInt16Sample), scaled));
+  _mm_storel_epi64(
+      reinterpret_cast<__m128i*>(output),
+      _mm_packs_epi32(_mm_cvttps_epi32(clamped), _mm_setzero_si128()));
+}
+
+void StoreFloatSse2(__m128 samples, float* output) {
+  _mm_storeu_ps(output, samples);
+}
+
+#endif  // SAMPLE_CONVERTER_SSE2
+
+#if defined(SAMPLE_CONVERTER_NEON)
+
+// Eight samples, left-justified as LoadLeftJustified() does.
+template <PcmEncoding kEncoding>
+int32x4x2_t LoadLeftJustifiedNeon(const uint8_t* p, bool big_endian) {
+  int32x4x2_t samples;
+  switch (kEncoding) {
+    case PcmEncoding::kS16: {
+      uint8x16_t bytes = vld1q_u8(p);
+      if (big_endian) {
+        bytes = vrev16q_u8(bytes);
+      }
+      const int16x8_t narrow = vreinterpretq_s16_u8(bytes);
+      samples.val[0] = vshll_n_s16(vget_low_s16(narrow), 16);
+      samples.val[1] = vshll_n_s16(vget_high_s16(narrow), 16);
+      break;
+    }
+    case PcmEncoding::kS24: {
+      // vld3 splits the bytes by position; zipping them back with a zero
+      // byte in front gives each sample's little-endian word, shifted up.
+      const uint8x8x3_t planes = vld3_u8(p);
+      const uint8x8_t low = planes.val[big_endian ? 2 : 0];
+      const uint8x8_t high = planes.val[big_endian ? 0 : 2];
+      const uint8x8x2_t low_pairs = vzip_u8(vdup_n_u8(0), low);
+      const uint8x8x2_t high_pairs = vzip_u8(planes.val[1], high);
+      const uint16x8x2_t words = vzipq_u16(
+          vreinterpretq_u16_u8(vcombine_u8(low_pairs.val[0], low_pairs.val[1])),
+          vreinterpretq_u16_u8(
+              vcombine_u8(high_pairs.val[0], high_pairs.val[1])));
+      samples.val[0] = vreinterpretq_s32_u16(words.val[0]);
+      samples.val[1] = vreinterpretq_s32_u16(words.val[1]);
+      break;
+    }
+    case PcmEncoding::kS24In32:
+    case PcmEncoding::kS32: {
+      for (int half = 0; half < 2; ++half) {
+        uint8x16_t bytes = vld1q_u8(p + 16 * half);
+        if (big_endian) {
+          bytes = vrev32q_u8(bytes);
+        }
+        const int32x4_t word = vreinterpretq_s32_u8(bytes);
+        samples.val[half] =
+            kEncoding == PcmEncoding::kS32 ? word : vshlq_n_s32(word, 8);
+      }
+      break;
+    }
+    case PcmEncoding::kF32:
+      samples.val[0] = vdupq_n_s32(0);
+      samples.val[1] = vdupq_n_s32(0);
+      break;
+  }
+  return samples;
+}
+
+void StoreLeftJustifiedNeon(int32x4x2_t samples, int16_t* output) {
+  vst1q_s16(output, vcombine_s16(vshrn_n_s32(samples.val[0], 16),
+                                 vshrn_n_s32(samples.val[1], 16)));
+}
+
+void StoreLeftJustifiedNeon(int32x4x2_t samples, float* output) {
+  vst1q_f32(output, vmulq_n_f32(vcvtq_f32_s32(samples.val[0]),
+                                kLeftJustifiedScale));
+  vst1q_f32(output + 4, vmulq_n_f32(vcvtq_f32_s32(samples.val[1]),
+                                    kLeftJustifiedScale));
+}
+
+// vcvtq truncates and saturates, and vqmovn saturates again to int16.
+void StoreFloatNeon(float32x4x2_t samples, int16_t* output) {
+  vst1q_s16(output,
+            vcombine_s16(vqmovn_s32(vcvtq_s32_f32(
+                             vmulq_n_f32(samples.val[0], kInt16Scale))),
+                         vqmovn_s32(vcvtq_s32_f32(
+                             vmulq_n_f32(samples.val[1], kInt16Scale)))));
+}
+
+void StoreFloatNeon(float32x4x2_t samples, float* output) {
+  vst1q_f32(output, samples.val[0]);
+  vst1q_f32(output + 4, samples.val[1]);
+}
+
+#endif  // SAMPLE_CONVERTER_NEON
+
+template <PcmEncoding kEncoding, typename Sample>
+void ConvertIntegers(const uint8_t* input, bool big_endian, size_t count,
+                     Sample* output) {
+  const size_t bytes = PcmBytesPerSample(kEncoding);
+  size_t i = 0;
+#if defined(SAMPLE_CONVERTER_SSE2)
+  for (; i * bytes + LoadBytesSse2(kEncoding) <= count * bytes; i += 4) {
+    StoreLeftJustifiedSse2(
+        LoadLeftJustifiedSse2<kEncoding>(input + i * bytes, big_endian),
+        output + i);
+  }
+#elif defined(SAMPLE_CONVERTER_NEON)
+  for (; i + 8 <= count; i += 8) {
+    StoreLeftJustifiedNeon(
+        LoadLeftJustifiedNeon<kEncoding>(input + i * bytes, big_endian),
+        output + i);
+  }
+#endif
+  for (; i < count; ++i) {
+    StoreLeftJustified(
+        LoadLeftJustified<kEncoding>(input + i * bytes, big_endian),
+        output + i);
+  }
+}
+
+template <typename Sample>
+void ConvertFloats(const uint8_t* input, bool big_endian, size_t count,
+                   Sample* output) {
+  size_t i = 0;
+#if defined(SAMPLE_CONVERTER_SSE2)
+  for (; i + 4 <= count; i += 4) {
+    __m128i words =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i * 4));
+    if (big_endian) {
+      words = ByteSwap32Sse2(words);
+    }
+    StoreFloatSse2(_mm_castsi128_ps(words), output + i);
+  }
+#elif defined(SAMPLE_CONVERTER_NEON)
+  for (; i + 8 <= count; i += 8) {
+    float32x4x2_t samples;
+    for (int half = 0; half < 2; ++half) {
+      uint8x16_t bytes = vld1q_u8(input + (i + 4 * half) * 4);
+      if (big_endian) {
+        bytes = vrev32q_u8(bytes);
+      }
+      samples.val[half] = vreinterpretq_f32_u8(bytes);
+    }
+    StoreFloatNeon(samples, output + i);
+  }
+#endif
+  for (; i < count; ++i) {
+    StoreFloat(LoadFloat(input + i * 4, big_endian), output + i);
+  }
+}
+
+template <typename Sample>
+void Convert(const uint8_t* input, PcmFormat format, size_t count,
+             Sample* output) {
+  const bool big_endian = format.big_endian;
+  switch (format.encoding) {
+    case PcmEncoding::kS16:
+      ConvertIntegers<PcmEncoding::kS16>(input, big_endian, count, output);
+      return;
+    case PcmEncoding::kS24:
+      ConvertIntegers<PcmEncoding::kS24>(input, big_endian, count, output);
+      return;
+    case PcmEncoding::kS24In32:
+      ConvertIntegers<PcmEncoding::kS24In32>(input, big_endian, count,
+                                             output);
+      return;
+    case PcmEncoding::kS32:
+      ConvertIntegers<PcmEncoding::kS32>(input, big_endian, count, output);
+      return;
+    case PcmEncoding::kF32:
+      ConvertFloats(input, big_endian, count, output);
+      return;
+  }
+}
+
+}  // namespace
+
+size_t PcmBytesPerSample(PcmEncoding encoding) {
+  switch (encoding) {
+    case PcmEncoding::kS16:
+      return 2;
+    case PcmEncoding::kS24:
+      return 3;
+    case PcmEncoding::kS24In32:
+    case PcmEncoding::kS32:
+    case PcmEncoding::kF32:
+      return 4;
+  }
+  return 0;
+}
+
+void ConvertToInt16(const uint8_t* input, PcmFormat format, size_t count,
+                    int16_t* output) {
+  if (format.encoding == PcmEncoding::kS16 && !format.big_endian) {
+    std::memcpy(output, input, count * sizeof(int16_t));
+    return;
+  }
+  Convert(input, format, count, output);
+}
+
+void ConvertToFloat(const uint8_t* input, PcmFormat format, size_t count,
+                    float* output) {
+  if (format.encoding == PcmEncoding::kF32 && !format.big_endian) {
+    std::memcpy(output, input, count * sizeof(float));
+    return;
+  }
+  Convert(input, format, count, output);
+}
+
+}  // namespace audio_capture
@@ -0,0 +1,50 @@
+#ifndef FLUTTER_PLUGIN_SAMPLE_CONVERTER_H_
+#define FLUTTER_PLUGIN_SAMPLE_CONVERTER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace audio_capture {
+
+// Encodings capture devices deliver samples in, named after their PulseAudio
+// counterparts.
+enum class PcmEncoding {
+  // Signed 16-bit integers.
+  kS16,
+  // Signed 24-bit integers packed into 3 bytes.
+  kS24,
+  // Signed 24-bit integers in the low 3 bytes of 4 (S24_32). The high byte
+  // is ignored.
+  kS24In32,
+  // Signed 32-bit integers. WASAPI's 24-in-32 formats are left-justified and
+  // so convert as this.
+  kS32,
+  // IEEE floats, full scale at 1.0.
+  kF32,
+};
+
+struct PcmFormat {
+  PcmEncoding encoding;
+  bool big_endian;
+};
+
+size_t PcmBytesPerSample(PcmEncoding encoding);
+
+// Converts |count| samples of |format| from |input|, which need not be
+// aligned, into |output|. Neither call allocates.
+//
+// Integers are narrowed to int16 by dropping their low bits; floats are
+// scaled, truncated and saturated as FloatToInt16() does. Both produce the
+// same samples with or without SIMD.
+void ConvertToInt16(const uint8_t* input, PcmFormat format, size_t count,
+                    int16_t* output);
+
+// Converts to floats normalized to [-1, 1), exactly for every integer
+// encoding but kS32, which is rounded to float precision. Floats are copied,
+// swapping bytes if needed, and keep anything past full scale.
+void ConvertToFloat(const uint8_t* input, PcmFormat format, size_t count,
+                    float* output);
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_SAMPLE_CONVERTER_H_
@@ -0,0 +1,47 @@
+#ifndef FLUTTER_PLUGIN_SAMPLE_FORMAT_H_
+#define FLUTTER_PLUGIN_SAMPLE_FORMAT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace audio_capture {
+
+// Encodings audio is recorded and delivered in. All are little-endian and
+// interleaved; floats are normalized to [-1, 1].
+enum class SampleFormat { kS16, kS32, kF32 };
+
+inline size_t BytesPerSample(SampleFormat format) {
+  return format == SampleFormat::kS16 ? sizeof(int16_t) : sizeof(int32_t);
+}
+
+inline const char* SampleFormatName(SampleFormat format) {
+  switch (format) {
+    case SampleFormat::kS16:
+      return "int16";
+    case SampleFormat::kS32:
+      return "int32";
+    case SampleFormat::kF32:
+      return "float32";
+  }
+  return "unknown";
+}
+
+// Parses the "sampleFormat" startCapture argument ("int16", "int32" or
+// "float32"). Returns false for anything else.
+inline bool ParseSampleFormat(const std::string& name, SampleFormat* format) {
+  if (name == "int16") {
+    *format = SampleFormat::kS16;
+  } else if (name == "int32") {
+    *format = SampleFormat::kS32;
+  } else if (name == "float32") {
+    *format = SampleFormat::kF32;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_SAMPLE_FORMAT_H_
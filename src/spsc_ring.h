@@ -0,0 +1,90 @@
+#ifndef FLUTTER_PLUGIN_SPSC_RING_H_
+#define FLUTTER_PLUGIN_SPSC_RING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace audio_capture {
+
+// Lock-free single-producer/single-consumer ring of preallocated slots.
+//
+// Slots are written and read in place: the producer fills the slot returned by
+// BeginWrite() and publishes it with CommitWrite(); the consumer mirrors this
+// with BeginRead()/CommitRead(). No allocation happens after construction.
+template <typename T>
+class SpscRing {
+ public:
+  // |capacity| is rounded up to a power of two. Every slot starts as a copy of
+  // |prototype|, which lets callers preallocate per-slot storage.
+  SpscRing(size_t capacity, const T& prototype)
+      : slots_(RoundUpToPowerOfTwo(capacity), prototype),
+        mask_(slots_.size() - 1) {}
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  // Producer side. Returns nullptr when the ring is full.
+  T* BeginWrite() {
+    const size_t head = head_.value.load(std::memory_order_relaxed);
+    if (head - tail_.value.load(std::memory_order_acquire) == slots_.size()) {
+      return nullptr;
+    }
+    return &slots_[head & mask_];
+  }
+
+  void CommitWrite() {
+    head_.value.store(head_.value.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_release);
+  }
+
+  // Consumer side. Returns nullptr when the ring is empty.
+  T* BeginRead() {
+    const size_t tail = tail_.value.load(std::memory_order_relaxed);
+    if (tail == head_.value.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &slots_[tail & mask_];
+  }
+
+  void CommitRead() {
+    tail_.value.store(tail_.value.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_release);
+  }
+
+  // Number of committed, unread slots. Exact only when called from one of the
+  // two owning threads while the other is idle.
+  size_t size() const {
+    return head_.value.load(std::memory_order_acquire) -
+           tail_.value.load(std::memory_order_acquire);
+  }
+
+  size_t capacity() const { return slots_.size(); }
+
+ private:
+  static constexpr size_t kCacheLineSize = 64;
+
+  static size_t RoundUpToPowerOfTwo(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  // Producer and consumer indices live on separate cache lines so the two
+  // threads don't invalidate each other on every update.
+  struct PaddedIndex {
+    char padding[kCacheLineSize];
+    std::atomic<size_t> value{0};
+  };
+
+  std::vector<T> slots_;
+  const size_t mask_;
+  PaddedIndex head_;
+  PaddedIndex tail_;
+};
+
+}  // namespace audio_capture
+
+#endif  // FLUTTER_PLUGIN_SPSC_RING_H_
@@ -26,6 +26,46 @@ void main() {
           return true;
         case 'stopCapture':
           return true;
+        case 'getStats':
+          return {
+            'latency': {
+              'total': {
+                'count': 12,
+                'minUs': 900,
+                'avgUs': 1500.5,
+                'p50Us': 1400,
+                'p99Us': 4100,
+                'maxUs': 5000,
+              },
+              'resample': {
+                'count': 12,
+                'minUs': 40,
+                'avgUs': 55.0,
+                'p50Us': 52,
+                'p99Us': 90,
+                'maxUs': 95,
+              },
+            },
+            'sourceSampleRate': 48000,
+            'sourceChannels': 2,
+            'negotiatedLatencyUs': 20000,
+            'overruns': 1,
+            'gaps': 1,
+            'lostSamples': 320,
+            'reconnects': 1,
+            'droppedChunks': 2,
+            'poolMisses': 0,
+            'queueDepth': 0,
+            'maxQueueDepth': 3,
+            'timeToFirstSampleUs': 42000,
+            'timeToStoppedUs': 3000,
+          };
+        case 'switchDevice':
+          return methodCall.arguments['deviceId'] != 'missing';
+        case 'armCapture':
+        case 'pauseCapture':
+        case 'resumeCapture':
+          return true;
         case 'hasInputDevice':
           return true;
         case 'getAvailableInputDevices':
@@ -43,7 +83,18 @@ void main() {
               'type': 'external',
               'channelCount': 2,
               'isDefault': false,
+              'sampleRate': 48000,
             },
+            if ((methodCall.arguments as Map?)?['includeMonitors'] == true)
+              {
+                'id': 'sink.monitor',
+                'name': 'Monitor of Speakers',
+                'type': 'built-in',
+                'channelCount': 2,
+                'isDefault': false,
+                'sampleRate': 44100,
+                'isMonitor': true,
+              },
           ];
         default:
           return null;
@@ -148,6 +199,18 @@ void main() {
       expect(devices[1].name, 'USB Microphone');
       expect(devices[1].type, InputDeviceType.external);
       expect(devices[1].isDefault, false);
+      expect(devices[1].sampleRate, 48000);
+      expect(devices.any((device) => device.isMonitor), false);
+    });
+
+    test('getAvailableInputDevices lists monitors on request', () async {
+      final devices =
+          await micCapture.getAvailableInputDevices(includeMonitors: true);
+      expect(methodCallLog.last.arguments['includeMonitors'], true);
+      expect(devices.length, 3);
+      expect(devices[2].isMonitor, true);
+      expect(devices[2].sampleRate, 44100);
+      expect(devices[0].sampleRate, 0);
     });
 
     test('getAvailableInputDevices returns empty list when null', () async {
@@ -187,6 +250,105 @@ void main() {
       expect(methodCallLog[1].arguments['channels'], 2);
     });
 
+    test('startCapture passes meter rate', () async {
+      await micCapture.startCapture(config: MicAudioConfig(meterRateHz: 60.0));
+      expect(methodCallLog[1].arguments['meterRateHz'], 60.0);
+    });
+
+    test('startCapture passes latency target', () async {
+      await micCapture.startCapture(
+        config: MicAudioConfig(targetLatencyMs: 10),
+      );
+      expect(methodCallLog[1].arguments['targetLatencyMs'], 10);
+    });
+
+    test('startCapture passes native format option', () async {
+      await micCapture.startCapture(
+        config: MicAudioConfig(nativeFormat: true),
+      );
+      expect(methodCallLog.last.arguments['nativeFormat'], true);
+      expect(MicAudioConfig().toMap()['nativeFormat'], false);
+    });
+
+    test('startCapture passes sample format', () async {
+      await micCapture.startCapture(
+        config: MicAudioConfig(sampleFormat: SampleFormat.float32),
+      );
+      expect(methodCallLog.last.arguments['sampleFormat'], 'float32');
+      expect(MicAudioConfig().toMap()['sampleFormat'], 'int16');
+      expect(SampleFormat.fromString('INT32'), SampleFormat.int32);
+      expect(SampleFormat.fromString('pcm'), SampleFormat.int16);
+      expect(SampleFormat.float32.bytesPerSample, 4);
+    });
+
+    test('startCapture passes device id', () async {
+      final devices = await micCapture.getAvailableInputDevices();
+      await micCapture.startCapture(
+        config: MicAudioConfig(deviceId: devices[1].id),
+      );
+      expect(methodCallLog.last.method, 'startCapture');
+      expect(methodCallLog.last.arguments['deviceId'], 'device2');
+      expect(MicAudioConfig().toMap()['deviceId'], isNull);
+    });
+
+    test('startCapture passes capture backend', () async {
+      await micCapture.startCapture(
+        config: MicAudioConfig(backend: CaptureBackend.pipewire),
+      );
+      expect(methodCallLog[1].arguments['backend'], 'pipewire');
+      expect(methodCallLog[1].arguments['targetLatencyMs'], isNull);
+      expect(CaptureBackend.fromString('PulseAudio'),
+          CaptureBackend.pulseaudio);
+      expect(CaptureBackend.fromString('alsa'), CaptureBackend.auto);
+    });
+
+    test('DecibelData.fromMap reads optional meter fields', () {
+      final data = DecibelData.fromMap({
+        'decibel': -20.0,
+        'timestamp': 1.0,
+        'peakDecibel': -6.0,
+        'rms': 0.1,
+        'peak': 0.5,
+      });
+      expect(data.peakDecibel, -6.0);
+      expect(data.rms, 0.1);
+      expect(data.peak, 0.5);
+      expect(DecibelData.fromMap({'decibel': -20.0}).peak, isNull);
+      expect(DecibelData.fromMap({'decibel': -20.0}).channels, isNull);
+    });
+
+    test('DecibelData.fromMap reads per-channel levels', () {
+      final data = DecibelData.fromMap({
+        'decibel': -10.0,
+        'timestamp': 2.0,
+        'channels': [
+          {'decibel': -10.0, 'peak': 0.5},
+          {'decibel': -40.0, 'peak': 0.01},
+        ],
+      });
+      expect(data.channels, hasLength(2));
+      expect(data.channels![1].decibel, -40.0);
+      expect(data.channels![1].peak, 0.01);
+      expect(data.channels![1].timestamp, 2.0);
+      expect(data.toMap()['channels'], hasLength(2));
+    });
+
+    test('startCapture passes channel layout and gains', () async {
+      await micCapture.startCapture(
+        config: MicAudioConfig(
+          channels: 4,
+          channelLayout: ChannelLayout.planar,
+          channelGains: [1.0, 0.5],
+        ),
+      );
+      expect(methodCallLog.last.arguments['channelLayout'], 'planar');
+      expect(methodCallLog.last.arguments['channelGains'], [1.0, 0.5]);
+      expect(MicAudioConfig().toMap()['channelLayout'], 'mono');
+      expect(ChannelLayout.fromString('Interleaved'),
+          ChannelLayout.interleaved);
+      expect(ChannelLayout.fromString('surround'), ChannelLayout.mono);
+    });
+
     test('startCapture does not start again if already recording', () async {
       await micCapture.startCapture();
       final initialCallCount = methodCallLog.length;
@@ -284,5 +446,140 @@ void main() {
       await micCapture.startCapture();
       expect(micCapture.decibelStream, isNotNull);
     });
+
+    test('getStats parses latency and counters', () async {
+      final stats = await micCapture.getStats();
+      expect(methodCallLog.last.method, 'getStats');
+      expect(stats.total.count, 12);
+      expect(stats.total.avgUs, 1500.5);
+      expect(stats.total.p99Us, 4100);
+      expect(stats.capture.count, 0);
+      expect(stats.resample.p99Us, 90);
+      expect(stats.sourceSampleRate, 48000);
+      expect(stats.sourceChannels, 2);
+      expect(stats.negotiatedLatencyUs, 20000);
+      expect(stats.overruns, 1);
+      expect(stats.gaps, 1);
+      expect(stats.lostSamples, 320);
+      expect(stats.reconnects, 1);
+      expect(stats.droppedChunks, 2);
+      expect(stats.maxQueueDepth, 3);
+      expect(stats.timeToFirstSampleUs, 42000);
+      expect(stats.timeToStoppedUs, 3000);
+    });
+
+    test('switchDevice passes device id', () async {
+      expect(await micCapture.switchDevice('device2'), true);
+      expect(methodCallLog.last.method, 'switchDevice');
+      expect(methodCallLog.last.arguments['deviceId'], 'device2');
+      expect(await micCapture.switchDevice(null), true);
+      expect(methodCallLog.last.arguments['deviceId'], isNull);
+      expect(await micCapture.switchDevice('missing'), false);
+    });
+
+    test('pauseCapture and resumeCapture call the platform', () async {
+      expect(await micCapture.pauseCapture(), true);
+      expect(methodCallLog.last.method, 'pauseCapture');
+      expect(await micCapture.resumeCapture(), true);
+      expect(methodCallLog.last.method, 'resumeCapture');
+
+      final status = MicAudioStatus.fromJson({
+        'isActive': true,
+        'isPaused': true,
+      });
+      expect(status.isPaused, true);
+      expect(MicAudioStatus.fromJson({'isActive': true}).isPaused, false);
+
+      final switching = MicAudioStatus.fromJson({
+        'isActive': true,
+        'isSwitching': true,
+      });
+      expect(switching.isSwitching, true);
+      expect(switching.isStarting, false);
+      expect(
+        MicAudioStatus.fromJson({'isActive': false, 'isStarting': true})
+            .isStarting,
+        true,
+      );
+    });
+
+    test('armCapture prepares a session that startCapture starts', () async {
+      expect(await micCapture.armCapture(), true);
+      expect(methodCallLog.last.method, 'armCapture');
+      expect(micCapture.isRecording, false);
+
+      await micCapture.startCapture();
+      expect(methodCallLog.last.method, 'startCapture');
+      expect(micCapture.isRecording, true);
+    });
+
+    test('stopCapture releases an armed session', () async {
+      await micCapture.armCapture();
+      await micCapture.stopCapture();
+      expect(methodCallLog.last.method, 'stopCapture');
+      expect(micCapture.isRecording, false);
+    });
+
+    test('MicAudioStatus.fromJson reads capture gaps', () {
+      final status = MicAudioStatus.fromJson({
+        'isActive': true,
+        'deviceName': 'USB Microphone',
+        'gap': {
+          'reason': 'deviceSwitch',
+          'lostSamples': 160,
+          'timestamp': 2.5,
+        },
+      });
+      expect(status.gap?.reason, CaptureGapReason.deviceSwitch);
+      expect(status.gap?.lostSamples, 160);
+      expect(status.gap?.timestamp, 2.5);
+      expect(MicAudioStatus.fromJson({'isActive': true}).gap, isNull);
+
+      final system = SystemAudioStatus.fromJson({
+        'isActive': true,
+        'gap': {'reason': 'reconnect', 'lostSamples': 8000, 'timestamp': 3.0},
+      });
+      expect(system.gap?.reason, CaptureGapReason.reconnect);
+      expect(system.gap?.lostSamples, 8000);
+      expect(CaptureGapReason.fromString('later'), CaptureGapReason.unknown);
+    });
+
+    test('status equality covers every field', () {
+      const running = MicAudioStatus(isActive: true, deviceName: 'USB Mic');
+      const paused = MicAudioStatus(
+        isActive: true,
+        deviceName: 'USB Mic',
+        isPaused: true,
+      );
+      expect(paused, isNot(equals(running)));
+      expect(paused, equals(running.copyWith(isPaused: true)));
+      expect(paused.hashCode, running.copyWith(isPaused: true).hashCode);
+      expect(running.copyWith(isSwitching: true), isNot(equals(running)));
+
+      const gap = CaptureGap(
+        reason: CaptureGapReason.deviceSwitch,
+        lostSamples: 160,
+        timestamp: 2.5,
+      );
+      expect(
+        running.copyWith(gap: gap),
+        equals(running.copyWith(
+          gap: CaptureGap.fromMap(const {
+            'reason': 'deviceSwitch',
+            'lostSamples': 160,
+            'timestamp': 2.5,
+          }),
+        )),
+      );
+
+      expect(
+        SystemAudioStatus(isActive: true, isPaused: true),
+        isNot(equals(SystemAudioStatus(isActive: true))),
+      );
+      expect(
+        SystemAudioStatus(isActive: true),
+        equals(SystemAudioStatus(isActive: true)),
+      );
+    });
   });
 }
@@ -27,6 +27,29 @@ void main() {
           return true;
         case 'stopCapture':
           return true;
+        case 'armCapture':
+        case 'pauseCapture':
+          return true;
+        case 'resumeCapture':
+          return false;
+        case 'getStats':
+          return {
+            'latency': {
+              'total': {
+                'count': 12,
+                'minUs': 900,
+                'avgUs': 1500.5,
+                'p50Us': 1400,
+                'p99Us': 4100,
+                'maxUs': 5000,
+              },
+            },
+            'overruns': 1,
+            'droppedChunks': 2,
+            'poolMisses': 0,
+            'queueDepth': 0,
+            'maxQueueDepth': 3,
+          };
         default:
           return null;
       }
@@ -117,6 +140,24 @@ void main() {
       expect(methodCallLog[1].arguments['channels'], 2);
     });
 
+    test('startCapture passes sample format', () async {
+      await systemCapture.startCapture(
+        config: SystemAudioConfig(sampleFormat: SampleFormat.int32),
+      );
+      expect(methodCallLog[1].arguments['sampleFormat'], 'int32');
+    });
+
+    test('startCapture passes channel layout', () async {
+      await systemCapture.startCapture(
+        config: SystemAudioConfig(
+          channels: 6,
+          channelLayout: ChannelLayout.interleaved,
+        ),
+      );
+      expect(methodCallLog[1].arguments['channelLayout'], 'interleaved');
+      expect(methodCallLog[1].arguments['channelGains'], isNull);
+    });
+
     test('startCapture does not start again if already recording', () async {
       await systemCapture.startCapture();
       final initialCallCount = methodCallLog.length;
@@ -214,5 +255,48 @@ void main() {
       await systemCapture.startCapture();
       expect(systemCapture.decibelStream, isNotNull);
     });
+
+    test('getStats parses latency and counters', () async {
+      final stats = await systemCapture.getStats();
+      expect(methodCallLog.last.method, 'getStats');
+      expect(stats.total.count, 12);
+      expect(stats.total.avgUs, 1500.5);
+      expect(stats.total.p99Us, 4100);
+      expect(stats.capture.count, 0);
+      expect(stats.overruns, 1);
+      expect(stats.droppedChunks, 2);
+      expect(stats.maxQueueDepth, 3);
+    });
+
+    test('pause and resume report the platform result', () async {
+      expect(await systemCapture.pauseCapture(), true);
+      expect(methodCallLog.last.method, 'pauseCapture');
+      expect(await systemCapture.resumeCapture(), false);
+      expect(methodCallLog.last.method, 'resumeCapture');
+      expect(
+        SystemAudioStatus.fromJson({'isActive': true, 'isPaused': true})
+            .isPaused,
+        true,
+      );
+      expect(
+        SystemAudioStatus.fromJson({'isActive': false, 'isStarting': true})
+            .isStarting,
+        true,
+      );
+      expect(SystemAudioStatus.fromJson({'isActive': true}).isStarting, false);
+    });
+
+    test('armCapture prepares a session that startCapture starts', () async {
+      expect(await systemCapture.armCapture(), true);
+      expect(methodCallLog.last.method, 'armCapture');
+      expect(systemCapture.isRecording, false);
+
+      await systemCapture.startCapture();
+      expect(methodCallLog.last.method, 'startCapture');
+      expect(systemCapture.isRecording, true);
+
+      await systemCapture.stopCapture();
+      expect(methodCallLog.last.method, 'stopCapture');
+    });
   });
 }
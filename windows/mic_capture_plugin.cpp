@@ -33,6 +33,12 @@
 #include <queue>
 #include <chrono>
 
+#include "audio_kernels.h"
+#include "chunk_assembler.h"
+#include "level_meter.h"
+#include "resampler.h"
+#include "sample_converter.h"
+
 #pragma comment(lib, "ole32.lib")
 #pragma comment(lib, "oleaut32.lib")
 
@@ -302,61 +308,6 @@ void MicCapturePlugin::HandleMethodCall(
   }
 }
 
-void MicCapturePlugin::ApplyGainBoostAndConvertToMono(
-    const int16_t* input, int16_t* output, size_t frame_count,
-    int input_channels, float gain_boost) {
-  const float max_value = 32767.0f;
-  const float min_value = -32768.0f;
-
-  if (input_channels == 1) {
-    // Mono: just apply gain boost
-    for (size_t i = 0; i < frame_count; ++i) {
-      float sample = static_cast<float>(input[i]) * gain_boost;
-      float clamped_sample = (std::min)(max_value, sample);
-      sample = (std::max)(min_value, clamped_sample);
-      output[i] = static_cast<int16_t>(sample);
-    }
-  } else {
-    // Stereo: convert to mono and apply gain boost
-    for (size_t i = 0; i < frame_count; ++i) {
-      float left = static_cast<float>(input[i * 2]);
-      float right = static_cast<float>(input[i * 2 + 1]);
-      float mono = (left + right) / 2.0f * gain_boost;
-      float clamped_mono = (std::min)(max_value, mono);
-      mono = (std::max)(min_value, clamped_mono);
-      output[i] = static_cast<int16_t>(mono);
-    }
-  }
-}
-
-double MicCapturePlugin::CalculateDecibel(const int16_t* samples,
-                                         size_t sample_count) {
-  if (sample_count == 0) {
-    return -120.0;
-  }
-
-  // Calculate RMS (Root Mean Square)
-  double sum_of_squares = 0.0;
-  for (size_t i = 0; i < sample_count; ++i) {
-    double value = static_cast<double>(samples[i]);
-    sum_of_squares += value * value;
-  }
-  double mean_square = sum_of_squares / static_cast<double>(sample_count);
-  double rms = sqrt(mean_square);
-
-  // Calculate decibel: dB = 20 * log10(RMS / max_value)
-  const double max_value = 32767.0;
-  if (rms <= 0.0) {
-    return -120.0;  // Avoid log(0)
-  }
-
-  double decibel = 20.0 * log10(rms / max_value);
-
-  // Clamp to reasonable range (-120 dB to 0 dB)
-  double clamped_decibel = (std::min)(0.0, decibel);
-  return (std::max)(-120.0, clamped_decibel);
-}
-
 // UPDATED: SendStatusUpdate - also post to platform thread
 void MicCapturePlugin::SendStatusUpdate(bool is_active, const std::string& device_name) {
   registrar_->messenger()->Send(
@@ -907,16 +858,52 @@ void MicCapturePlugin::CaptureThread() {
     } else if (format_tag == WAVE_FORMAT_PCM) {
       is_pcm_format = true;
     }
+
+    // Mix formats are little-endian. 24-bit samples in 32-bit containers are
+    // left-justified, so they convert as 32-bit ones.
+    audio_capture::PcmFormat pcm_format{audio_capture::PcmEncoding::kS16,
+                                        false};
+    bool format_supported = true;
+    if (is_pcm_format && actual_bits_per_sample == 16) {
+      pcm_format.encoding = audio_capture::PcmEncoding::kS16;
+    } else if (is_float_format && actual_bits_per_sample == 32) {
+      pcm_format.encoding = audio_capture::PcmEncoding::kF32;
+    } else if (is_pcm_format && actual_bits_per_sample == 24) {
+      pcm_format.encoding = audio_capture::PcmEncoding::kS24;
+    } else if (is_pcm_format && actual_bits_per_sample == 32) {
+      pcm_format.encoding = audio_capture::PcmEncoding::kS32;
+    } else {
+      format_supported = false;
+    }
     
     // FIX LATENCY: Sử dụng chunk size nhỏ hơn (20-50ms) để giảm delay
     const int effective_chunk_ms = 30; // 30ms chunk size for lower latency
-    const size_t chunk_frames = (actual_sample_rate * effective_chunk_ms / 1000);
-    const size_t chunk_size_bytes = chunk_frames * frame_size;
-    const size_t output_frame_count = (sample_rate_ * effective_chunk_ms / 1000);
-    
-    std::vector<uint8_t> raw_buffer(chunk_size_bytes * 2); // Double buffer for safety
+
+    // Packets of any size are gathered into chunks of effective_chunk_ms,
+    // which alternate between the two nearest frame counts when the duration
+    // is not a whole number of frames.
+    audio_capture::ChunkAssembler assembler(
+        frame_size, static_cast<int>(actual_sample_rate), effective_chunk_ms);
+    const size_t chunk_frames = assembler.max_chunk_frames();
+
+    // Shared mode captures at the mix format's rate, not the requested one.
+    // The resampler keeps its filter history from chunk to chunk, so chunk
+    // boundaries do not click.
+    std::unique_ptr<audio_capture::Resampler> resampler;
+    size_t output_frame_count = chunk_frames;
+    if (actual_sample_rate != static_cast<UINT32>(sample_rate_)) {
+      resampler.reset(new audio_capture::Resampler(
+          static_cast<int>(actual_sample_rate), sample_rate_));
+      output_frame_count = resampler->MaxOutputFrames(chunk_frames);
+    }
+
+    std::vector<int16_t> converted_samples(chunk_frames * actual_channels);
+    std::vector<int16_t> mono_buffer(chunk_frames);
     std::vector<int16_t> output_buffer(output_frame_count);
-    size_t raw_buffer_pos = 0;
+
+    // Volume only attenuates; a volume of 0 has always left samples untouched
+    // on this platform.
+    const float input_volume = input_volume_ > 0.0f ? input_volume_ : 1.0f;
 
     while (!should_stop_) {
       UINT32 num_frames_available = 0;
@@ -942,96 +929,41 @@ void MicCapturePlugin::CaptureThread() {
           size_t data_offset = 0;
           
           while (data_offset < data_size && !should_stop_) {
-            const size_t space_available = raw_buffer.size() - raw_buffer_pos;
-            const size_t data_remaining = data_size - data_offset;
-            const size_t copy_size = (std::min)(space_available, data_remaining);
-            
-            if (copy_size > 0) {
-              memcpy(raw_buffer.data() + raw_buffer_pos, 
-                     reinterpret_cast<const uint8_t*>(data) + data_offset, 
-                     copy_size);
-              raw_buffer_pos += copy_size;
-              data_offset += copy_size;
-            }
+            data_offset += assembler.Write(
+                reinterpret_cast<const uint8_t*>(data) + data_offset,
+                data_size - data_offset);
 
-            if (raw_buffer_pos >= chunk_size_bytes) {
-              const size_t input_frame_count = chunk_size_bytes / frame_size;
+            size_t input_frame_count = 0;
+            while (const uint8_t* chunk =
+                       assembler.PeekChunk(&input_frame_count)) {
               const size_t total_samples = input_frame_count * actual_channels;
               
-              std::vector<int16_t> converted_samples(total_samples);
-              bool conversion_success = false;
-              
-              // Format conversion
-              if (is_pcm_format && actual_bits_per_sample == 16) {
-                const int16_t* raw_samples = reinterpret_cast<const int16_t*>(raw_buffer.data());
-                converted_samples.assign(raw_samples, raw_samples + total_samples);
-                conversion_success = true;
-              } else if (is_float_format && actual_bits_per_sample == 32) {
-                const float* float_samples = reinterpret_cast<const float*>(raw_buffer.data());
-                for (size_t i = 0; i < total_samples; ++i) {
-                  float sample = (std::min)(1.0f, (std::max)(-1.0f, float_samples[i]));
-                  converted_samples[i] = static_cast<int16_t>(sample * 32767.0f);
-                }
-                conversion_success = true;
-              } else if (is_pcm_format && actual_bits_per_sample == 24) {
-                const uint8_t* raw_bytes = raw_buffer.data();
-                for (size_t i = 0; i < total_samples; ++i) {
-                  size_t byte_offset = i * 3;
-                  int32_t sample24 = (static_cast<int32_t>(raw_bytes[byte_offset]) |
-                                     (static_cast<int32_t>(raw_bytes[byte_offset + 1]) << 8) |
-                                     (static_cast<int32_t>(raw_bytes[byte_offset + 2]) << 16));
-                  if (sample24 & 0x800000) sample24 |= 0xFF000000;
-                  converted_samples[i] = static_cast<int16_t>(sample24 >> 8);
-                }
-                conversion_success = true;
-              } else if (is_pcm_format && actual_bits_per_sample == 32) {
-                const int32_t* int32_samples = reinterpret_cast<const int32_t*>(raw_buffer.data());
-                for (size_t i = 0; i < total_samples; ++i) {
-                  converted_samples[i] = static_cast<int16_t>(int32_samples[i] >> 16);
-                }
-                conversion_success = true;
-              }
-              
-              if (!conversion_success) {
-                raw_buffer_pos = 0;
+              if (!format_supported) {
+                assembler.ConsumeChunk();
                 continue;
               }
-              
-              if (input_volume_ > 0.0f && input_volume_ < 1.0f) {
-                for (size_t i = 0; i < total_samples; ++i) {
-                  converted_samples[i] = static_cast<int16_t>(
-                      static_cast<float>(converted_samples[i]) * input_volume_);
-                }
-              }
+              audio_capture::ConvertToInt16(chunk, pcm_format, total_samples,
+                                            converted_samples.data());
+              const size_t input_frames = input_frame_count;
 
-              const size_t input_frames = converted_samples.size() / actual_channels;
-              
               // First: Convert to mono and apply gain boost (at input sample rate)
-              std::vector<int16_t> mono_buffer(input_frames);
-              ApplyGainBoostAndConvertToMono(converted_samples.data(), mono_buffer.data(),
-                                              input_frames, actual_channels, gain_boost_);
+              audio_capture::LevelAccumulator levels{0, 0, 0};
+              audio_capture::MixToMono(converted_samples.data(), mono_buffer.data(), input_frames,
+                                       actual_channels, input_volume, gain_boost_,
+                                       &levels);
               
               // Second: Resample if sample rates differ
-              // Calculate correct output frames based on resampling ratio
               size_t output_frames;
-              if (actual_sample_rate != static_cast<UINT32>(sample_rate_)) {
-                // Calculate output frames after resampling
-                output_frames = static_cast<size_t>(
-                    static_cast<double>(input_frames) * static_cast<double>(sample_rate_) / 
-                    static_cast<double>(actual_sample_rate));
-                output_frames = (std::min)(output_frames, output_frame_count);
-                
-                // Resample from actual_sample_rate to sample_rate_
-                ResampleAudio(mono_buffer.data(), input_frames,
-                             output_buffer.data(), output_frames,
-                             actual_sample_rate, sample_rate_);
+              if (resampler) {
+                output_frames = resampler->Process(
+                    mono_buffer.data(), input_frames, output_buffer.data());
               } else {
                 // No resampling needed, just copy
                 output_frames = (std::min)(input_frames, output_frame_count);
                 memcpy(output_buffer.data(), mono_buffer.data(), output_frames * sizeof(int16_t));
               }
 
-              double decibel = CalculateDecibel(output_buffer.data(), output_frames);
+              const double decibel = audio_capture::ReadLevels(levels).decibel;
 
               // CHANGED: Queue instead of direct send
               const size_t output_bytes = output_frames * sizeof(int16_t);
@@ -1040,14 +972,7 @@ void MicCapturePlugin::CaptureThread() {
                   reinterpret_cast<uint8_t*>(output_buffer.data()) + output_bytes);
               
               QueueAudioData(std::move(audio_data), decibel);
-
-              if (raw_buffer_pos > chunk_size_bytes) {
-                const size_t remaining = raw_buffer_pos - chunk_size_bytes;
-                memmove(raw_buffer.data(), raw_buffer.data() + chunk_size_bytes, remaining);
-                raw_buffer_pos = remaining;
-              } else {
-                raw_buffer_pos = 0;
-              }
+              assembler.ConsumeChunk();
             }
           }
         }
@@ -1068,44 +993,6 @@ void MicCapturePlugin::CaptureThread() {
   }
 }
 
-// Resample audio using linear interpolation
-void MicCapturePlugin::ResampleAudio(const int16_t* input, size_t input_frames,
-                                     int16_t* output, size_t output_frames,
-                                     int input_sample_rate, int output_sample_rate) {
-  if (input_frames == 0 || output_frames == 0) {
-    return;
-  }
-  
-  if (input_sample_rate == output_sample_rate) {
-    const size_t copy_frames = (std::min)(input_frames, output_frames);
-    memcpy(output, input, copy_frames * sizeof(int16_t));
-    return;
-  }
-  
-  // Linear interpolation resampling
-  const double ratio = static_cast<double>(input_sample_rate) / static_cast<double>(output_sample_rate);
-  
-  for (size_t i = 0; i < output_frames; ++i) {
-    const double src_pos = static_cast<double>(i) * ratio;
-    const size_t src_index = static_cast<size_t>(src_pos);
-    const double fraction = src_pos - static_cast<double>(src_index);
-    
-    if (src_index + 1 < input_frames) {
-      // Linear interpolation between two samples
-      const double sample0 = static_cast<double>(input[src_index]);
-      const double sample1 = static_cast<double>(input[src_index + 1]);
-      const double interpolated = sample0 + (sample1 - sample0) * fraction;
-      output[i] = static_cast<int16_t>((std::max)(-32768.0, (std::min)(32767.0, interpolated)));
-    } else if (src_index < input_frames) {
-      // Last sample, no interpolation
-      output[i] = input[src_index];
-    } else {
-      // Beyond input, use last sample
-      output[i] = input[input_frames - 1];
-    }
-  }
-}
-
 // Set high priority for capture thread to reduce latency
 void MicCapturePlugin::SetThreadPriority() {
   HANDLE current_thread = GetCurrentThread();
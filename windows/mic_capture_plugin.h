@@ -52,13 +52,6 @@ class MicCapturePlugin : public flutter::Plugin {
   bool StopCapture();
   void CaptureThread();
   void ProcessQueue();
-  double CalculateDecibel(const int16_t* samples, size_t sample_count);
-  void ApplyGainBoostAndConvertToMono(const int16_t* input, int16_t* output,
-                                     size_t frame_count, int input_channels,
-                                     float gain_boost);
-  void ResampleAudio(const int16_t* input, size_t input_frames,
-                     int16_t* output, size_t output_frames,
-                     int input_sample_rate, int output_sample_rate);
   void SendStatusUpdate(bool is_active, const std::string& device_name = "");
   void SendDecibelUpdate(double decibel);
   void QueueAudioData(std::vector<uint8_t> data, double decibel);
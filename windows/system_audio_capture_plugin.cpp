@@ -25,6 +25,12 @@
 #include <thread>
 #include <vector>
 
+#include "audio_kernels.h"
+#include "chunk_assembler.h"
+#include "level_meter.h"
+#include "resampler.h"
+#include "sample_converter.h"
+
 #pragma comment(lib, "ole32.lib")
 #pragma comment(lib, "oleaut32.lib")
 
@@ -210,61 +216,6 @@ void SystemAudioCapturePlugin::HandleMethodCall(
   }
 }
 
-void SystemAudioCapturePlugin::ApplyGainBoostAndConvertToMono(
-    const int16_t* input, int16_t* output, size_t frame_count,
-    int input_channels, float gain_boost) {
-  const float max_value = 32767.0f;
-  const float min_value = -32768.0f;
-
-  if (input_channels == 1) {
-    // Mono: just apply gain boost
-    for (size_t i = 0; i < frame_count; ++i) {
-      float sample = static_cast<float>(input[i]) * gain_boost;
-      float clamped_sample = (std::min)(max_value, sample);
-      sample = (std::max)(min_value, clamped_sample);
-      output[i] = static_cast<int16_t>(sample);
-    }
-  } else {
-    // Stereo: convert to mono and apply gain boost
-    for (size_t i = 0; i < frame_count; ++i) {
-      float left = static_cast<float>(input[i * 2]);
-      float right = static_cast<float>(input[i * 2 + 1]);
-      float mono = (left + right) / 2.0f * gain_boost;
-      float clamped_mono = (std::min)(max_value, mono);
-      mono = (std::max)(min_value, clamped_mono);
-      output[i] = static_cast<int16_t>(mono);
-    }
-  }
-}
-
-double SystemAudioCapturePlugin::CalculateDecibel(const int16_t* samples,
-                                                   size_t sample_count) {
-  if (sample_count == 0) {
-    return -120.0;
-  }
-
-  // Calculate RMS (Root Mean Square)
-  double sum_of_squares = 0.0;
-  for (size_t i = 0; i < sample_count; ++i) {
-    double value = static_cast<double>(samples[i]);
-    sum_of_squares += value * value;
-  }
-  double mean_square = sum_of_squares / static_cast<double>(sample_count);
-  double rms = sqrt(mean_square);
-
-  // Calculate decibel: dB = 20 * log10(RMS / max_value)
-  const double max_value = 32767.0;
-  if (rms <= 0.0) {
-    return -120.0;  // Avoid log(0)
-  }
-
-  double decibel = 20.0 * log10(rms / max_value);
-
-  // Clamp to reasonable range (-120 dB to 0 dB)
-  double clamped_decibel = (std::min)(0.0, decibel);
-  return (std::max)(-120.0, clamped_decibel);
-}
-
 void SystemAudioCapturePlugin::SendStatusUpdate(bool is_active) {
   try {
     std::lock_guard<std::mutex> lock(mutex_);
@@ -598,19 +549,65 @@ void SystemAudioCapturePlugin::CaptureThread() {
     const UINT32 actual_sample_rate = mix_format_->nSamplesPerSec;
     const WORD actual_channels = mix_format_->nChannels;
     const WORD actual_bits_per_sample = mix_format_->wBitsPerSample;
+
+    // Mix formats are little-endian. 24-bit samples in 32-bit containers are
+    // left-justified, so they convert as 32-bit ones.
+    bool is_float_format = mix_format_->wFormatTag == WAVE_FORMAT_IEEE_FLOAT;
+    bool is_pcm_format = mix_format_->wFormatTag == WAVE_FORMAT_PCM;
+    if (mix_format_->wFormatTag == WAVE_FORMAT_EXTENSIBLE &&
+        mix_format_->cbSize >= 22) {
+      const WAVEFORMATEXTENSIBLE* extensible =
+          reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(mix_format_);
+      is_float_format =
+          IsEqualGUID(extensible->SubFormat, KSDATAFORMAT_SUBTYPE_IEEE_FLOAT);
+      is_pcm_format =
+          IsEqualGUID(extensible->SubFormat, KSDATAFORMAT_SUBTYPE_PCM);
+    }
+    audio_capture::PcmFormat pcm_format{audio_capture::PcmEncoding::kS16,
+                                        false};
+    bool format_supported = true;
+    if (is_pcm_format && actual_bits_per_sample == 16) {
+      pcm_format.encoding = audio_capture::PcmEncoding::kS16;
+    } else if (is_float_format && actual_bits_per_sample == 32) {
+      pcm_format.encoding = audio_capture::PcmEncoding::kF32;
+    } else if (is_pcm_format && actual_bits_per_sample == 24) {
+      pcm_format.encoding = audio_capture::PcmEncoding::kS24;
+    } else if (is_pcm_format && actual_bits_per_sample == 32) {
+      pcm_format.encoding = audio_capture::PcmEncoding::kS32;
+    } else {
+      format_supported = false;
+    }
     
     // FIX LATENCY 1: Giảm chunk size xuống tối đa 50ms để giảm delay
     // Sử dụng chunk nhỏ hơn để gửi data nhanh hơn
     const int effective_chunk_ms = (std::max)(20, (std::min)(chunk_duration_ms_, 50));
     
-    // Calculate smaller chunk size for lower latency
-    const size_t chunk_frames = (actual_sample_rate * effective_chunk_ms / 1000);
-    const size_t chunk_size_bytes = chunk_frames * frame_size;
-    const size_t output_frame_count = (sample_rate_ * effective_chunk_ms / 1000);
+    // Calculate smaller chunk size for lower latency. Packets of any size are
+    // gathered into chunks of effective_chunk_ms, which alternate between the
+    // two nearest frame counts when the duration is not a whole number of
+    // frames.
+    audio_capture::ChunkAssembler assembler(
+        frame_size, static_cast<int>(actual_sample_rate), effective_chunk_ms);
+    const size_t chunk_frames = assembler.max_chunk_frames();
+
+    // Loopback captures at the mix format's rate, not the requested one. The
+    // resampler keeps its filter history from chunk to chunk, so chunk
+    // boundaries do not click.
+    std::unique_ptr<audio_capture::Resampler> resampler;
+    size_t output_frame_count = chunk_frames;
+    if (actual_sample_rate != static_cast<UINT32>(sample_rate_)) {
+      resampler.reset(new audio_capture::Resampler(
+          static_cast<int>(actual_sample_rate), sample_rate_));
+      output_frame_count = resampler->MaxOutputFrames(chunk_frames);
+    }
     
-    std::vector<uint8_t> raw_buffer(chunk_size_bytes * 2); // Double buffer for safety
+    std::vector<int16_t> converted_samples(chunk_frames * actual_channels);
+    std::vector<int16_t> mono_buffer(chunk_frames);
     std::vector<int16_t> output_buffer(output_frame_count);
-    size_t raw_buffer_pos = 0;
+
+    // Volume only attenuates; a volume of 0 has always left samples untouched
+    // on this platform.
+    const float input_volume = input_volume_ > 0.0f ? input_volume_ : 1.0f;
 
     // FIX LATENCY 2: Giảm sleep time xuống tối thiểu để giảm delay
     const int sleep_time_ms = 1; // Giảm xuống 1ms để phản hồi nhanh hơn
@@ -650,77 +647,40 @@ void SystemAudioCapturePlugin::CaptureThread() {
           size_t data_offset = 0;
           
           while (data_offset < data_size && !should_stop_) {
-            const size_t space_available = raw_buffer.size() - raw_buffer_pos;
-            const size_t data_remaining = data_size - data_offset;
-            const size_t copy_size = (std::min)(space_available, data_remaining);
-            
-            if (copy_size > 0) {
-              memcpy(raw_buffer.data() + raw_buffer_pos, 
-                     reinterpret_cast<const uint8_t*>(data) + data_offset, 
-                     copy_size);
-              raw_buffer_pos += copy_size;
-              data_offset += copy_size;
-            }
+            data_offset += assembler.Write(
+                reinterpret_cast<const uint8_t*>(data) + data_offset,
+                data_size - data_offset);
 
             // FIX LATENCY 4: Gửi data ngay khi đủ chunk nhỏ, không đợi buffer đầy
-            if (raw_buffer_pos >= chunk_size_bytes) {
-              const size_t input_frame_count = chunk_size_bytes / frame_size;
+            size_t input_frame_count = 0;
+            while (const uint8_t* chunk =
+                       assembler.PeekChunk(&input_frame_count)) {
               const size_t total_samples = input_frame_count * actual_channels;
               
-              std::vector<int16_t> converted_samples(total_samples);
-              bool conversion_success = false;
-              
-              // Convert based on format
-              if (actual_bits_per_sample == 16 && 
-                  (mix_format_->wFormatTag == WAVE_FORMAT_PCM || 
-                   mix_format_->wFormatTag == WAVE_FORMAT_EXTENSIBLE)) {
-                const int16_t* raw_samples = reinterpret_cast<const int16_t*>(raw_buffer.data());
-                converted_samples.assign(raw_samples, raw_samples + total_samples);
-                conversion_success = true;
-              } else if (actual_bits_per_sample == 32 && 
-                         (mix_format_->wFormatTag == WAVE_FORMAT_IEEE_FLOAT ||
-                          mix_format_->wFormatTag == WAVE_FORMAT_EXTENSIBLE)) {
-                const float* float_samples = reinterpret_cast<const float*>(raw_buffer.data());
-                for (size_t i = 0; i < total_samples; ++i) {
-                  float sample = (std::min)(1.0f, (std::max)(-1.0f, float_samples[i]));
-                  converted_samples[i] = static_cast<int16_t>(sample * 32767.0f);
-                }
-                conversion_success = true;
-              } else if (actual_bits_per_sample == 24) {
-                const uint8_t* raw_bytes = raw_buffer.data();
-                for (size_t i = 0; i < total_samples; ++i) {
-                  size_t byte_offset = i * 3;
-                  int32_t sample24 = (static_cast<int32_t>(raw_bytes[byte_offset]) |
-                                     (static_cast<int32_t>(raw_bytes[byte_offset + 1]) << 8) |
-                                     (static_cast<int32_t>(raw_bytes[byte_offset + 2]) << 16));
-                  if (sample24 & 0x800000) {
-                    sample24 |= 0xFF000000;
-                  }
-                  converted_samples[i] = static_cast<int16_t>(sample24 >> 8);
-                }
-                conversion_success = true;
-              }
-              
-              if (!conversion_success) {
-                raw_buffer_pos = 0;
+              if (!format_supported) {
+                assembler.ConsumeChunk();
                 continue;
               }
-              
-              // Apply input volume if needed
-              if (input_volume_ > 0.0f && input_volume_ < 1.0f) {
-                for (size_t i = 0; i < total_samples; ++i) {
-                  converted_samples[i] = static_cast<int16_t>(
-                      static_cast<float>(converted_samples[i]) * input_volume_);
-                }
-              }
-
-              const size_t frames_to_process = converted_samples.size() / actual_channels;
-              const size_t output_frames = (std::min)(frames_to_process, output_frame_count);
-
-              ApplyGainBoostAndConvertToMono(converted_samples.data(), output_buffer.data(),
-                                              output_frames, actual_channels, gain_boost_);
-
-              double decibel = CalculateDecibel(output_buffer.data(), output_frames);
+              audio_capture::ConvertToInt16(chunk, pcm_format, total_samples,
+                                            converted_samples.data());
+
+              const size_t frames_to_process = input_frame_count;
+
+              // Downmix at the mix rate, then bring the mono signal to the
+              // requested rate.
+              audio_capture::LevelAccumulator levels{0, 0, 0};
+              audio_capture::MixToMono(converted_samples.data(),
+                                       resampler ? mono_buffer.data()
+                                                 : output_buffer.data(),
+                                       frames_to_process, actual_channels,
+                                       input_volume, gain_boost_, &levels);
+              const size_t output_frames =
+                  resampler ? resampler->Process(mono_buffer.data(),
+                                                 frames_to_process,
+                                                 output_buffer.data())
+                            : frames_to_process;
+
+              const double decibel = audio_capture::ReadLevels(levels).decibel;
 
               // FIX LATENCY 5: Tối ưu mutex - giữ lock thời gian ngắn nhất
               {
@@ -735,15 +695,7 @@ void SystemAudioCapturePlugin::CaptureThread() {
               }
 
               SendDecibelUpdate(decibel);
-
-              // Move remaining data
-              if (raw_buffer_pos > chunk_size_bytes) {
-                const size_t remaining = raw_buffer_pos - chunk_size_bytes;
-                memmove(raw_buffer.data(), raw_buffer.data() + chunk_size_bytes, remaining);
-                raw_buffer_pos = remaining;
-              } else {
-                raw_buffer_pos = 0;
-              }
+              assembler.ConsumeChunk();
             }
           }
         }
@@ -42,10 +42,6 @@ class SystemAudioCapturePlugin : public flutter::Plugin {
   bool StopCapture();
   void CaptureThread();
   void SetThreadPriority();
-  double CalculateDecibel(const int16_t* samples, size_t sample_count);
-  void ApplyGainBoostAndConvertToMono(const int16_t* input, int16_t* output,
-                                      size_t frame_count, int input_channels,
-                                      float gain_boost);
   void SendStatusUpdate(bool is_active);
   void SendDecibelUpdate(double decibel);
 